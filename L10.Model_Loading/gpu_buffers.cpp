@@ -1,8 +1,11 @@
 #include "gpu_buffers.h"
+#include "dds_file.h"
+#include "mip_generator.h"
 
-#include <DirectXTex.h>
-#include <DirectXTK\DDSTextureLoader.h>
 #include <array>
+#include <vector>
+#include <utility>
+#include <algorithm>
 #include <cassert>
 
 using namespace dx11_lessons;
@@ -21,11 +24,45 @@ namespace
 
 		return buffer;
 	}
+
+	auto make_view_desc(const dds_texture &texture) -> D3D11_SHADER_RESOURCE_VIEW_DESC
+	{
+		auto desc = D3D11_SHADER_RESOURCE_VIEW_DESC{};
+		desc.Format = static_cast<DXGI_FORMAT>(texture.format);
+
+		if (texture.is_cube and texture.array_size > 6)
+		{
+			desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBEARRAY;
+			desc.TextureCubeArray.MipLevels = texture.mip_count;
+			desc.TextureCubeArray.NumCubes = texture.array_size / 6;
+		}
+		else if (texture.is_cube)
+		{
+			desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+			desc.TextureCube.MipLevels = texture.mip_count;
+		}
+		else if (texture.array_size > 1)
+		{
+			desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+			desc.Texture2DArray.MipLevels = texture.mip_count;
+			desc.Texture2DArray.ArraySize = texture.array_size;
+		}
+		else
+		{
+			desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+			desc.Texture2D.MipLevels = texture.mip_count;
+		}
+		return desc;
+	}
 }
 
 #pragma region Mesh Buffer
 mesh_buffer::mesh_buffer(device_t device, const mesh &data) :
-	buffer_strides{ sizeof(data.vertices.back()) }, 
+	mesh_buffer(device, mesh_view{ data.vertices, data.indicies })
+{ }
+
+mesh_buffer::mesh_buffer(device_t device, const mesh_view &data) :
+	buffer_strides{ sizeof(vertex) }, 
 	buffer_offsets{ 0 }
 {
 	auto &vertices = data.vertices;
@@ -35,7 +72,7 @@ mesh_buffer::mesh_buffer(device_t device, const mesh &data) :
 	grp.index_count = static_cast<uint32_t>(data.indicies.size());
 
 	auto desc = D3D11_BUFFER_DESC{};
-	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
 	desc.CPUAccessFlags = NULL;
 	
 	auto srd = D3D11_SUBRESOURCE_DATA{};
@@ -52,7 +89,7 @@ mesh_buffer::mesh_buffer(device_t device, const mesh &data) :
 }
 
 mesh_buffer::mesh_buffer(direct3d11::device_t device, const instanced_mesh &data) :
-	mesh_buffer(device, mesh{ data.vertices, data.indicies })
+	mesh_buffer(device, mesh_view{ data.vertices, data.indicies })
 {
 	buffer_strides.push_back(sizeof(data.instance_transforms.back()));
 	buffer_offsets.push_back(0);
@@ -245,73 +282,67 @@ void constant_buffer::create_set_function()
 #pragma endregion
 
 #pragma region Shader Resource
-shader_resource::shader_resource(device_t device, shader_stage stage_, shader_slot slot_, const std::vector<uint8_t> &data) :
+shader_resource::shader_resource(device_t device, shader_stage stage_, shader_slot slot_, std::span<const std::byte> data) :
 	stage{ stage_ }, slot{ slot_ }, resource{ }
 {
-	auto hr = DirectX::CreateDDSTextureFromMemory(device,
-	                                              data.data(),
-	                                              data.size(),
-	                                              &resource, &resource_view);
-	assert(SUCCEEDED(hr));
-	
-	create_set_function();
-}
-
-shader_resource::shader_resource(direct3d11::device_t device, shader_stage stage_, shader_slot slot_, const texture_t texture) :
-	stage{ stage_ }, slot{ slot_ }, resource{ texture }
-{
-	auto hr = device->CreateShaderResourceView(resource, nullptr, &resource_view);
-	assert(SUCCEEDED(hr));
-
-	create_set_function();
-}
+	// Subresources point into data, so the texture is made straight from the file bytes
+	auto dds = read_dds(data);
+	assert(dds.has_value());
 
-shader_resource::shader_resource(direct3d11::device_t device, shader_stage stage_, shader_slot slot_, 
-                                 const std::vector<std::vector<uint8_t>> &data) :
-	stage{ stage_ }, slot{ slot_ }
-{
-	auto texture_images = std::vector<DirectX::ScratchImage>{};
-	for (auto &tex_data : data)
+	// Unless it came without mips, then they are made here. Cooked textures already have them.
+	auto generated_mips = std::vector<std::byte>{};
+	if (dds->mip_count == 1 and can_generate_mips(dds->format) and (dds->width > 1 or dds->height > 1))
 	{
-		auto info = DirectX::TexMetadata{};
-		auto &image = texture_images.emplace_back(DirectX::ScratchImage{});
-		DirectX::LoadFromDDSMemory(tex_data.data(), tex_data.size(), DirectX::DDS_FLAGS_NONE, &info, image);
+		generated_mips = generate_mips(*dds, mip_settings{});
+		dds->mip_count = full_mip_count(dds->width, dds->height);
+		dds->data = generated_mips;
 	}
 
-	auto srds = std::vector<D3D11_SUBRESOURCE_DATA>{};
-	for (auto &image : texture_images)
+	auto td = D3D11_TEXTURE2D_DESC{};
+	td.Width = dds->width;
+	td.Height = dds->height;
+	td.MipLevels = dds->mip_count;
+	td.ArraySize = dds->array_size;
+	td.Format = static_cast<DXGI_FORMAT>(dds->format);
+	td.SampleDesc = { 1, 0 };
+	td.Usage = D3D11_USAGE_IMMUTABLE;
+	td.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	td.MiscFlags = dds->is_cube ? D3D11_RESOURCE_MISC_TEXTURECUBE : 0;
+
+	auto subresources = std::vector<D3D11_SUBRESOURCE_DATA>{};
+	for (auto &sub : dds_subresources(*dds))
 	{
-		auto &srd = srds.emplace_back(D3D11_SUBRESOURCE_DATA{});
-		srd.pSysMem = image.GetPixels();
-		srd.SysMemPitch = static_cast<uint32_t>(image.GetImages()->rowPitch);
-		srd.SysMemSlicePitch = 0;
+		subresources.push_back({ sub.data, sub.row_pitch, sub.slice_pitch });
 	}
 
-	auto metadata = texture_images.front().GetMetadata();
-	auto td = D3D11_TEXTURE2D_DESC{};
-	td.Width = static_cast<uint32_t>(metadata.width);
-	td.Height = static_cast<uint32_t>(metadata.height);
-	td.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-	td.Usage = D3D11_USAGE_DEFAULT;
-	td.Format = metadata.format;
-	td.SampleDesc = { 1, 0 };
-	td.ArraySize = static_cast<uint32_t>(texture_images.size());
-	td.MipLevels = 1;
-	td.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE;
+	auto texture = CComPtr<ID3D11Texture2D>{};
+	auto hr = device->CreateTexture2D(&td, subresources.data(), &texture);
+	assert(SUCCEEDED(hr));
+	resource = texture;
 
-	auto tex_array = texture_t{};
-	auto hr = device->CreateTexture2D(&td, &srds[0], &tex_array);
+	auto srvd = make_view_desc(*dds);
+	hr = device->CreateShaderResourceView(resource, &srvd, &resource_view);
 	assert(SUCCEEDED(hr));
 
-	resource = tex_array;
+	create_set_function();
+}
 
-	auto srvd = D3D11_SHADER_RESOURCE_VIEW_DESC{};
-	srvd.Format = td.Format;
-	srvd.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
-	srvd.TextureCube.MipLevels = td.MipLevels;
-	srvd.TextureCube.MostDetailedMip = 0;
+shader_resource::shader_resource(direct3d11::device_t device, shader_stage stage_, shader_slot slot_, const texture_t texture) :
+	stage{ stage_ }, slot{ slot_ }, resource{ texture }
+{
+	// A default view of a cube texture is an array of faces, the desc says which it is
+	auto td = D3D11_TEXTURE2D_DESC{};
+	texture->GetDesc(&td);
+	auto view_of = dds_texture
+	{
+		static_cast<dxgi_format>(td.Format),
+		td.Width, td.Height, td.MipLevels, td.ArraySize,
+		(td.MiscFlags & D3D11_RESOURCE_MISC_TEXTURECUBE) != 0,
+		{}
+	};
 
-	hr = device->CreateShaderResourceView(resource, &srvd, &resource_view);
+	auto srvd = make_view_desc(view_of);
+	auto hr = device->CreateShaderResourceView(resource, &srvd, &resource_view);
 	assert(SUCCEEDED(hr));
 
 	create_set_function();
@@ -352,4 +383,142 @@ void shader_resource::create_set_function()
 			break;
 	}
 }
+#pragma endregion
+
+#pragma region Texture Stream
+texture_stream::texture_stream(device_t device_, std::span<const std::byte> file_data, std::shared_ptr<const void> file_owner_) :
+	device{ device_ }, file_owner{ std::move(file_owner_) }
+{
+	auto parsed = read_dds(file_data);
+	assert(parsed.has_value());
+	dds = *parsed;
+
+	// Streaming needs mips, so a texture without them gets them the same way shader_resource does
+	if (dds.mip_count == 1 and can_generate_mips(dds.format) and (dds.width > 1 or dds.height > 1))
+	{
+		generated_mips = generate_mips(dds, mip_settings{});
+		dds.mip_count = full_mip_count(dds.width, dds.height);
+		dds.data = generated_mips;
+	}
+
+	allocated_mip = dds.mip_count;
+	resident_mip = dds.mip_count;
+}
+
+texture_stream::~texture_stream() = default;
+
+auto texture_stream::get_texture() const -> shader_resource::texture_t
+{
+	return texture;
+}
+
+auto texture_stream::info() const -> streamed_texture_info
+{
+	auto result = streamed_texture_info{ (std::max)(dds.width, dds.height), {} };
+	for (auto mip = 0u; mip < dds.mip_count; mip++)
+	{
+		auto bytes = std::size_t{};
+		for (auto slice = 0u; slice < dds.array_size; slice++)
+		{
+			bytes += dds_subresource(dds, slice, mip).size();
+		}
+		result.mip_bytes.push_back(bytes);
+	}
+	return result;
+}
+
+auto texture_stream::upload_mip(context_t context, uint32_t mip, uint32_t wanted_mip) -> bool
+{
+	assert(mip + 1 == resident_mip);
+	auto remade = mip < allocated_mip and reallocate(context, (std::min)(mip, wanted_mip));
+	resident_mip = mip;
+
+	auto subresources = dds_subresources(dds);
+	auto mip_levels = dds.mip_count - allocated_mip;
+	for (auto slice = 0u; slice < dds.array_size; slice++)
+	{
+		auto &sub = subresources[D3D11CalcSubresource(mip, slice, dds.mip_count)];
+		context->UpdateSubresource(texture, D3D11CalcSubresource(mip - allocated_mip, slice, mip_levels),
+		                           nullptr, sub.data, sub.row_pitch, sub.slice_pitch);
+	}
+
+	context->SetResourceMinLOD(texture, static_cast<float>(resident_mip - allocated_mip));
+	return remade;
+}
+
+void texture_stream::evict_mip(context_t context, uint32_t mip)
+{
+	assert(mip == resident_mip and mip + 1 < dds.mip_count);
+	resident_mip = mip + 1;
+
+	context->SetResourceMinLOD(texture, static_cast<float>(resident_mip - allocated_mip));
+}
+
+auto texture_stream::trim(context_t context) -> bool
+{
+	if (resident_mip == allocated_mip or not reallocate(context, resident_mip))
+	{
+		return false;
+	}
+
+	context->SetResourceMinLOD(texture, static_cast<float>(resident_mip - allocated_mip));
+	return true;
+}
+
+auto texture_stream::reallocate(context_t context, uint32_t top_mip) -> bool
+{
+	// The top may be finer than asked, the mips above resident_mip are then left without data
+	while (top_mip > 0 and not can_be_top_mip(top_mip))
+	{
+		top_mip--;
+	}
+	if (top_mip == allocated_mip)
+	{
+		return false;
+	}
+
+	auto mip_levels = dds.mip_count - top_mip;
+	auto td = D3D11_TEXTURE2D_DESC{};
+	td.Width = (std::max)(1u, dds.width >> top_mip);
+	td.Height = (std::max)(1u, dds.height >> top_mip);
+	td.MipLevels = mip_levels;
+	td.ArraySize = dds.array_size;
+	td.Format = static_cast<DXGI_FORMAT>(dds.format);
+	td.SampleDesc = { 1, 0 };
+	td.Usage = D3D11_USAGE_DEFAULT;
+	td.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	td.MiscFlags = dds.is_cube ? D3D11_RESOURCE_MISC_TEXTURECUBE : 0;
+
+	auto new_texture = shader_resource::texture_t{};
+	auto hr = device->CreateTexture2D(&td, nullptr, &new_texture);
+	assert(SUCCEEDED(hr));
+
+	// Mips with data in both stay on the GPU
+	auto old_levels = dds.mip_count - allocated_mip;
+	for (auto mip = (std::max)(top_mip, resident_mip); texture and mip < dds.mip_count; mip++)
+	{
+		for (auto slice = 0u; slice < dds.array_size; slice++)
+		{
+			context->CopySubresourceRegion(new_texture, D3D11CalcSubresource(mip - top_mip, slice, mip_levels), 0, 0, 0,
+			                               texture, D3D11CalcSubresource(mip - allocated_mip, slice, old_levels), nullptr);
+		}
+	}
+
+	texture = new_texture;
+	allocated_mip = top_mip;
+	return true;
+}
+
+// Block compressed textures need a top mip that is whole blocks
+auto texture_stream::can_be_top_mip(uint32_t mip) const -> bool
+{
+	if (not is_block_compressed(dds.format))
+	{
+		return true;
+	}
+
+	auto width = (std::max)(1u, dds.width >> mip),
+	     height = (std::max)(1u, dds.height >> mip);
+	return width % 4 == 0 and height % 4 == 0;
+}
 #pragma endregion
\ No newline at end of file
@@ -2,9 +2,14 @@
 
 #include "direct3d11.h"
 #include "gpu_datatypes.h"
+#include "dds_file.h"
+#include "texture_streamer.h"
 
 #include <functional>
+#include <memory>
 #include <vector>
+#include <span>
+#include <cstddef>
 #include <cstdint>
 
 namespace dx11_lessons
@@ -29,6 +34,7 @@ namespace dx11_lessons
 	public:
 		mesh_buffer() = delete;
 		mesh_buffer(direct3d11::device_t device, const mesh &data);
+		mesh_buffer(direct3d11::device_t device, const mesh_view &data);
 		mesh_buffer(direct3d11::device_t device, const instanced_mesh &data);
 		mesh_buffer(direct3d11::device_t device, const non_interleaved_mesh &data);
 		~mesh_buffer();
@@ -101,11 +107,9 @@ namespace dx11_lessons
 
 		shader_resource() = delete;
 		shader_resource(direct3d11::device_t device, shader_stage stage, shader_slot slot, 
-		                const std::vector<uint8_t> &data);
+		                std::span<const std::byte> data);
 		shader_resource(direct3d11::device_t device, shader_stage stage, shader_slot slot,
 		                const texture_t texture);
-		shader_resource(direct3d11::device_t device, shader_stage stage, shader_slot slot,
-		                const std::vector<std::vector<uint8_t>> &data);
 		~shader_resource();
 
 		void activate(direct3d11::context_t context);
@@ -128,4 +132,41 @@ namespace dx11_lessons
 
 		set_resource_fn set_resource;
 	};
+
+	// Texture holding the mips from the finest resident one down, so evicted mips free their memory.
+	// Uploads go in with UpdateSubresource and sampling is clamped to the finest with SetResourceMinLOD.
+	// An upload past the allocated mips makes the texture again, down to the mip the streamer wants so
+	// streaming in costs one reallocation, and trim gives back what evictions left unused. Both copy
+	// the mips kept on the GPU. Mips are read straight out of the file's bytes, which file_owner keeps
+	// alive, e.g. the mapped_file or unpacked buffer they are in.
+	class texture_stream
+	{
+	public:
+		texture_stream() = delete;
+		texture_stream(direct3d11::device_t device_, std::span<const std::byte> file_data,
+		               std::shared_ptr<const void> file_owner_);
+		~texture_stream();
+
+		// nullptr until the first upload, a different texture after upload_mip or trim return true
+		auto get_texture() const -> shader_resource::texture_t;
+		auto info() const -> streamed_texture_info;
+
+		// Mips one finer or the finest, as stream_schedule lists them. True when the texture was made again.
+		auto upload_mip(direct3d11::context_t context, uint32_t mip, uint32_t wanted_mip) -> bool;
+		void evict_mip(direct3d11::context_t context, uint32_t mip);
+		auto trim(direct3d11::context_t context) -> bool;
+
+	private:
+		auto reallocate(direct3d11::context_t context, uint32_t top_mip) -> bool;
+		auto can_be_top_mip(uint32_t mip) const -> bool;
+
+	private:
+		direct3d11::device_t device;
+		std::shared_ptr<const void> file_owner;
+		std::vector<std::byte> generated_mips{};
+		dds_texture dds;
+		shader_resource::texture_t texture{};
+		uint32_t allocated_mip;   // mip 0 of texture
+		uint32_t resident_mip;    // finest with data
+	};
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 
 #include <DirectXMath.h>
 #include <vector>
+#include <span>
 
 namespace dx11_lessons
 {
@@ -27,6 +28,13 @@ namespace dx11_lessons
 		std::vector<uint32_t> indicies;
 	};
 
+	// Read-only mesh data, e.g. constexpr primitives, uploaded without copying into a mesh
+	struct mesh_view
+	{
+		std::span<const vertex> vertices;
+		std::span<const uint32_t> indicies;
+	};
+
 	struct matrix
 	{
 		DirectX::XMMATRIX data;
@@ -0,0 +1,18 @@
+struct PS_INPUT
+{
+	float4 pos : SV_POSITION;
+	float3 nor : NORMAL;
+	float2 uv : TEXCOORD0;
+};
+
+// Model textures aren't loaded yet, so shade flat grey from a fixed light
+static const float3 light_dir = normalize(float3(0.4f, 1.0f, -0.3f));
+static const float3 base_color = float3(0.8f, 0.8f, 0.75f);
+static const float ambient = 0.25f;
+
+float4 main(PS_INPUT input) : SV_TARGET
+{
+	float light_intensity = saturate(dot(normalize(input.nor), light_dir));
+
+	return float4(base_color * (ambient + (1.0f - ambient) * light_intensity), 1.0f);
+}
\ No newline at end of file
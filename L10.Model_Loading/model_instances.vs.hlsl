@@ -0,0 +1,43 @@
+cbuffer frame_buffer : register(b0)
+{
+	matrix projection;
+}
+
+cbuffer object_buffer : register(b1)
+{
+	matrix view;
+	float3 eye_pos;
+}
+
+struct VS_INPUT
+{
+	float4 pos : POSITION;
+	float3 nor : NORMAL;
+	float2 uv : TEXCOORD;
+	float4x4 inst_mat : TRANSFORM;
+};
+
+struct VS_OUTPUT
+{
+	float4 pos : SV_POSITION;
+	float3 nor : NORMAL;
+	float2 uv : TEXCOORD0;
+};
+
+VS_OUTPUT main(VS_INPUT input)
+{
+	VS_OUTPUT output;
+
+	input.pos.w = 1.0f;
+
+	output.pos = mul(input.pos, input.inst_mat);
+	output.pos = mul(output.pos, view);
+	output.pos = mul(output.pos, projection);
+
+	output.uv = input.uv;
+
+	output.nor = mul(input.nor, (float3x3)input.inst_mat);
+	output.nor = normalize(output.nor);
+
+	return output;
+}
\ No newline at end of file
@@ -6,12 +6,21 @@
 #include "pipeline_state.h"
 #include "gpu_buffers.h"
 #include "gpu_datatypes.h"
+#include "primitives.h"
 
 #include "camera.h"
 #include "raw_input.h"
 #include "clock.h"
 #include "obj_mtl_parser.h"
+#include "mesh_welding.h"
+#include "triangle_bvh.h"
+#include "geometry_instancing.h"
 #include "helpers.h"
+#include "asset_pack.h"
+#include "load_progress.h"
+#include "cooked_mesh.h"
+#include "file_watcher.h"
+#include "texture_streamer.h"
 
 #include <cppitertools\enumerate.hpp>
 #include <fmt/core.h>
@@ -19,9 +28,10 @@
 #include <array>
 #include <cmath>
 #include <thread>
-#include <future>
 #include <string_view>
 #include <functional>
+#include <chrono>
+#include <stdexcept>
 
 using namespace dx11_lessons;
 using namespace DirectX;
@@ -36,66 +46,11 @@ namespace
 	constexpr auto near_z = 0.1f;
 	constexpr auto far_z = 100.0f;
 
-	constexpr auto front_normal = XMFLOAT3{ 0.0f, 0.0f, 1.0f }, back_normal = XMFLOAT3{ 0.0f,  0.0f, -1.0f };
-	constexpr auto left_normal = XMFLOAT3{ -1.0f, 0.0f, 0.0f }, right_normal = XMFLOAT3{ 1.0f,  0.0f,  0.0f };
-	constexpr auto top_normal = XMFLOAT3{ 0.0f, 1.0f, 0.0f }, bottom_normal = XMFLOAT3{ 0.0f, -1.0f,  0.0f };
-
-	const auto cube_base = mesh{
-		// Vertex List
-		{
-			// Front
-			{ { -1.0f, -1.0f, +1.0f }, front_normal, { 0.0f, 0.0f } },
-			{ { +1.0f, -1.0f, +1.0f }, front_normal, { 1.0f, 0.0f } },
-			{ { +1.0f, +1.0f, +1.0f }, front_normal, { 1.0f, 1.0f } },
-			{ { -1.0f, +1.0f, +1.0f }, front_normal, { 0.0f, 1.0f } },
-
-			// Bottom
-			{ { -1.0f, -1.0f, -1.0f }, bottom_normal, { 0.0f, 0.0f } },
-			{ { +1.0f, -1.0f, -1.0f }, bottom_normal, { 1.0f, 0.0f } },
-			{ { +1.0f, -1.0f, +1.0f }, bottom_normal, { 1.0f, 1.0f } },
-			{ { -1.0f, -1.0f, +1.0f }, bottom_normal, { 0.0f, 1.0f } },
-
-			// right
-			{ { +1.0f, -1.0f, -1.0f }, right_normal, { 0.0f, 0.0f } },
-			{ { +1.0f, +1.0f, -1.0f }, right_normal, { 1.0f, 0.0f } },
-			{ { +1.0f, +1.0f, +1.0f }, right_normal, { 1.0f, 1.0f } },
-			{ { +1.0f, -1.0f, +1.0f }, right_normal, { 0.0f, 1.0f } },
-
-			// left
-			{ { -1.0f, -1.0f, -1.0f }, left_normal, { 0.0f, 0.0f } },
-			{ { -1.0f, -1.0f, +1.0f }, left_normal, { 1.0f, 0.0f } },
-			{ { -1.0f, +1.0f, +1.0f }, left_normal, { 1.0f, 1.0f } },
-			{ { -1.0f, +1.0f, -1.0f }, left_normal, { 0.0f, 1.0f } },
-
-			// Back
-			{ { -1.0f, -1.0f, -1.0f }, back_normal, { 0.0f, 0.0f } },
-			{ { -1.0f, +1.0f, -1.0f }, back_normal, { 1.0f, 0.0f } },
-			{ { +1.0f, +1.0f, -1.0f }, back_normal, { 1.0f, 1.0f } },
-			{ { +1.0f, -1.0f, -1.0f }, back_normal, { 0.0f, 1.0f } },
-
-			// Top
-			{ { -1.0f, +1.0f, -1.0f }, top_normal, { 0.0f, 0.0f } },
-			{ { -1.0f, +1.0f, +1.0f }, top_normal, { 1.0f, 0.0f } },
-			{ { +1.0f, +1.0f, +1.0f }, top_normal, { 1.0f, 1.0f } },
-			{ { +1.0f, +1.0f, -1.0f }, top_normal, { 0.0f, 1.0f } },
-		},
-
-		// Index List
-		{
-			// Front
-			0, 1, 2, 0, 2, 3,
-			// Bottom
-			4, 5, 6, 4, 6, 7,
-			// Right
-			8, 9, 10, 8, 10, 11,
-			// Left
-			12, 13, 14, 12, 14, 15,
-			// Back
-			16, 17, 18, 16, 18, 19,
-			// Top
-			20, 21, 22, 20, 22, 23,
-		}
-	};
+	// Mips up to 16 texels are uploaded at once, finer ones about 256 KiB a frame.
+	// Past the memory budget the finest mips of textures least recently on screen are evicted.
+	constexpr auto stream_tail_size = 16u;
+	constexpr auto stream_bytes_per_frame = std::size_t{ 256 * 1024 };
+	constexpr auto texture_memory_budget = std::size_t{ 256 * 1024 * 1024 };
 
 	using bs = pipeline_state::blend_type;
 	using ds = pipeline_state::depth_stencil_type;
@@ -106,90 +61,33 @@ namespace
 	using slot = shader_slot;
 	using stage = shader_stage;
 
-	auto spherify_and_invert(const mesh &cube, uint32_t subdivide_count) -> mesh
+	auto make_projection(uint16_t width, uint16_t height) -> XMMATRIX
 	{
-		auto divide_edge = [](vertex v0, vertex v1) -> vertex
-		{
-			auto mp = vertex{};
-			mp.position = XMFLOAT3{
-				0.5f * (v0.position.x + v1.position.x),
-				0.5f * (v0.position.y + v1.position.y),
-				0.5f * (v0.position.z + v1.position.z),
-			};
-			mp.normal = v0.normal;
-			mp.texcoord = XMFLOAT2{
-				0.5f * (v0.texcoord.x + v1.texcoord.x),
-				0.5f * (v0.texcoord.y + v1.texcoord.y),
-			};
-
-			return mp;
-		};
-
-		auto sub_divide_triangle = [&](const vertex &v0, const vertex &v1, const vertex &v2, const uint32_t index) -> mesh
-		{
-			auto m0 = divide_edge(v0, v1),
-				m1 = divide_edge(v1, v2),
-				m2 = divide_edge(v2, v0);
-
-			return mesh
-			{
-				{ v0, m0, v1, m1, v2, m2 },
-				{
-					index + 0, index + 1, index + 5,
-					index + 1, index + 2, index + 3,
-					index + 3, index + 4, index + 5,
-					index + 1, index + 3, index + 5,
-				}
-			};
-		};
-
-		auto sub_divide_mesh = [&](const mesh &shape) -> mesh
-		{
-			auto result_mesh = mesh{};
-			auto &vertices = result_mesh.vertices;
-			auto &indicies = result_mesh.indicies;
-
-			auto number_of_triangles = shape.indicies.size() / 3u;
-			for (size_t i = 0; i < number_of_triangles; i++)
-			{
-				auto triangle = sub_divide_triangle(shape.vertices[shape.indicies[i * 3]],
-				                                    shape.vertices[shape.indicies[i * 3 + 1]],
-				                                    shape.vertices[shape.indicies[i * 3 + 2]],
-				                                    static_cast<uint32_t>(i) * 6);
-
-				vertices.insert(vertices.end(), triangle.vertices.begin(), triangle.vertices.end());
-				indicies.insert(indicies.end(), triangle.indicies.begin(), triangle.indicies.end());
-			}
+		constexpr auto h_fov = XMConvertToRadians(field_of_view);
+		auto aspect_ratio = width / static_cast<float>(height);
+		auto v_fov = 2.0f * std::atan(std::tan(h_fov / 2.0f) * aspect_ratio);
 
-			return result_mesh;
-		};
+		return XMMatrixPerspectiveFovLH(v_fov, aspect_ratio, near_z, far_z);
+	}
 
-		auto result_mesh = mesh{};
+	auto to_instanced_mesh(const instanced_geometry &geometry) -> instanced_mesh
+	{
+		auto result = instanced_mesh{};
+		result.indicies = geometry.indicies;
 
-		for (uint16_t i = 0; i < subdivide_count; i++)
+		result.vertices.reserve(geometry.vertices.size());
+		for (auto i = 0u; i < geometry.vertices.size(); i++)
 		{
-			auto &msh = (i == 0) ? cube : result_mesh;
-
-			result_mesh = sub_divide_mesh(msh);
+			result.vertices.push_back({ geometry.vertices[i], geometry.normals[i], geometry.uv_coords[i] });
 		}
 
-		result_mesh.vertices.shrink_to_fit();
-		result_mesh.indicies.shrink_to_fit();
-
-		for (auto &v : result_mesh.vertices)
+		result.instance_transforms.reserve(geometry.instance_transforms.size());
+		for (auto &transform : geometry.instance_transforms)
 		{
-			auto n = XMLoadFloat3(&v.normal);
-			n = -1.0f * n;
-			XMStoreFloat3(&v.normal, n);
-
-			auto p = XMLoadFloat3(&v.position);
-			p = XMVector3Normalize(p);
-			XMStoreFloat3(&v.position, p);
+			result.instance_transforms.push_back({ XMMatrixTranspose(XMLoadFloat4x4(&transform)) });
 		}
 
-
-
-		return result_mesh;
+		return result;
 	}
 
 	enum ps_ids
@@ -197,6 +95,7 @@ namespace
 		ps_default,
 		ps_text,
 		ps_sky,
+		ps_instances,
 	};
 
 	enum mb_ids
@@ -219,18 +118,18 @@ namespace
 		sr_sky,
 	};
 
-	auto list_of_files_to_load = std::array{
-		L"vertex_shader.cso"sv,
-		L"pixel_shader.cso"sv,
-		L"screen_space_text.vs.cso"sv,
-		L"sky_dome.vs.cso"sv,
-		L"sky_dome.ps.cso"sv,
-		L"left.dds"sv,
-		L"right.dds"sv,
-		L"top.dds"sv,
-		L"bottom.dds"sv,
-		L"back.dds"sv,
-		L"front.dds"sv,
+	constexpr auto asset_pack_file = L"model_loading.pak"sv;
+
+	constexpr auto list_of_files_to_load = std::array{
+		"vertex_shader.cso"sv,
+		"pixel_shader.cso"sv,
+		"screen_space_text.vs.cso"sv,
+		"sky_dome.vs.cso"sv,
+		"sky_dome.ps.cso"sv,
+		"sky.dds"sv,
+		"sky_dome.mesh"sv,
+		"model_instances.vs.cso"sv,
+		"model_instances.ps.cso"sv,
 	};
 
 	enum file_list
@@ -240,13 +139,138 @@ namespace
 		text_vso,
 		sky_vso,
 		sky_pso,
-		left_tex,
-		right_tex,
-		top_tex,
-		bottom_tex,
-		back_tex,
-		front_tex,
+		sky_tex,
+		sky_mesh,
+		instances_vso,
+		instances_pso,
+	};
+
+	// Shaders and blend of each pipeline state, shared by loading and live reload
+	struct pipeline_source
+	{
+		file_list vso;
+		file_list pso;
+		bs blend;
+		bool instanced{ false };   // per instance transforms in a second vertex buffer
+	};
+
+	constexpr auto pipeline_sources = std::array
+	{
+		pipeline_source{ basic_vso, basic_pso, bs::opaque },            // ps_default
+		pipeline_source{ text_vso, basic_pso, bs::non_premultipled },   // ps_text
+		pipeline_source{ sky_vso, sky_pso, bs::opaque },                // ps_sky
+		pipeline_source{ instances_vso, instances_pso, bs::opaque, true },   // ps_instances
 	};
+
+	// Load graph nodes reading files are named after them
+	auto file_inputs(const std::vector<file_list> &files) -> std::vector<std::string>
+	{
+		auto names = std::vector<std::string>{};
+		for (auto file : files)
+		{
+			names.emplace_back(list_of_files_to_load[file]);
+		}
+		return names;
+	}
+
+	auto pipeline_files(ps_ids id) -> std::vector<file_list>
+	{
+		return { pipeline_sources[id].vso, pipeline_sources[id].pso };
+	}
+
+	// An object made from pack files, counted in the progress by their unpacked size
+	void add_object(load_graph &loads, load_progress &progress, const asset_pack &assets,
+	                std::string_view name, const std::vector<file_list> &files, load_graph::node_fn make)
+	{
+		auto bytes = uint64_t{};
+		for (auto file : files)
+		{
+			auto idx = assets.find(list_of_files_to_load[file]);
+			assert(idx.has_value());
+			bytes += assets.entry_size(*idx);
+		}
+
+		progress.expect(load_stage::create, bytes);
+		loads.add(name, file_inputs(files), [&progress, bytes, make = std::move(make)]
+		{
+			progress.measure(load_stage::create, bytes, make);
+		});
+	}
+
+	auto read_material(job_system &jobs, std::filesystem::path path) -> task<mtl_data>
+	{
+		auto file = co_await read_file_async(jobs, std::move(path));
+		if (file.empty())
+		{
+			co_return mtl_data{};   // its materials stay undefined, the model still draws
+		}
+		co_return parse_mtl(file);
+	}
+
+	// Every MTL read and parsed at once, counted as one object. The caller awaits it, so references stay valid.
+	auto read_materials(job_system &jobs, load_progress &progress, uint64_t bytes, std::filesystem::path folder,
+	                    const std::vector<obj_data::file_path> &files, std::vector<mtl_data> &materials) -> task<>
+	{
+		auto start = load_progress::clock::now();
+		auto reads = std::vector<task<mtl_data>>{};
+		for (auto &file : files)
+		{
+			reads.push_back(read_material(jobs, folder / file));
+		}
+		materials = co_await when_all(jobs, std::move(reads));
+		progress.add(load_stage::create, bytes, load_progress::clock::now() - start);
+	}
+
+	// How long loading took and the chain of nodes that kept it from being shorter
+	auto describe_startup(const load_graph &loads) -> std::wstring
+	{
+		using ms = std::chrono::duration<double, std::milli>;
+
+		auto path = std::wstring{};
+		for (auto id : loads.critical_path())
+		{
+			auto name = loads.node_name(id);
+			path += fmt::format(L"{}{} {:.0f} ms", path.empty() ? L"" : L" > ",
+			                    std::wstring(name.begin(), name.end()), ms(loads.node_time(id)).count());
+		}
+		return fmt::format(L"Loaded in {:.0f} ms: {}", ms(loads.elapsed()).count(), path);
+	}
+
+	// nullptr if either shader isn't one the device takes, e.g. a .cso caught half written.
+	// Given no shader to fill in, the create calls only check the bytecode.
+	auto make_pipeline(direct3d11::device_t device, const pipeline_source &source,
+	                   std::span<const std::byte> vso, std::span<const std::byte> pso) -> std::unique_ptr<pipeline_state>
+	{
+		if (device->CreateVertexShader(vso.data(), vso.size(), nullptr, nullptr) != S_FALSE
+		    or device->CreatePixelShader(pso.data(), pso.size(), nullptr, nullptr) != S_FALSE)
+		{
+			return nullptr;
+		}
+
+		auto desc = pipeline_state::description
+		{
+			source.blend,
+			ds::read_write,
+			rs::cull_anti_clockwise,
+			ss::anisotropic_clamp,
+			source.instanced ? instanced_vertex_elements : vertex_elements,
+			vso,
+			pso,
+			D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST
+		};
+		return std::make_unique<pipeline_state>(device, desc);
+	}
+
+	// The working directory has the loose files the pack was built from. Compiling a shader
+	// while running (Ctrl+F7) or replacing a sky face changes them, and only what uses them is rebuilt.
+	constexpr auto reload_interval = std::chrono::milliseconds{ 250 };
+
+	constexpr auto sky_faces = std::array{
+		"left.dds"sv, "right.dds"sv, "top.dds"sv, "bottom.dds"sv, "back.dds"sv, "front.dds"sv,
+	};
+	// Same as the post-build step, the cook cache makes it a copy when nothing it reads changed
+	constexpr auto sky_cook_command = L"Tools.Asset_Cook.exe --cache cook_cache cube --filter kaiser --compress bc7 sky.dds "
+	                                  L"left.dds right.dds top.dds bottom.dds back.dds front.dds"sv;
 }
 
 model_loading::model_loading(HWND hwnd) :
@@ -256,17 +280,49 @@ model_loading::model_loading(HWND hwnd) :
 	d2d = std::make_unique<direct2d1>(d3d->get_dxgi_device());
 	rp = std::make_unique<render_pass>(d3d->get_device(), d3d->get_swapchain());
 
+	progress = std::make_unique<load_progress>();
+	loads = std::make_unique<load_graph>();
 	load_files();
 	create_pipeline_state_object();
 	create_mesh_buffers();
 	create_contant_buffers();
 	create_shader_resources();
+
+	// Nothing to make, it's done once what the load status is drawn with is
+	load_status_node = loads->add("load status", { "text pipeline", "text mesh", "orthographic cb", "text transform cb", "text texture" }, []
+	{
+	});
+	// A graph that can't start never finishes, stop here rather than sit on the loading screen forever
+	if (auto error = loads->start(job_system::shared()); error)
+	{
+		auto message = fmt::format("Load graph can't start, {}\n", describe(*error));
+		::OutputDebugStringA(message.c_str());
+		main_thread.run_until_done(model_task);   // it writes into members
+		throw std::runtime_error(message);
+	}
+
+	asset_watcher = std::make_unique<file_watcher>(std::vector{ std::filesystem::current_path() }, reload_interval);
 }
 
-model_loading::~model_loading() = default;
+model_loading::~model_loading()
+{
+	// Nodes, the model task and reloads still running write into members
+	main_thread.run_until_done(model_task);
+	for (auto &reload : reloads)
+	{
+		main_thread.run_until_done(reload);
+	}
+	loads.reset();
+}
 
 auto model_loading::on_resize(uintptr_t wParam, uintptr_t lParam) -> bool
 {
+	// Loading makes the objects remade here
+	if (loads != nullptr)
+	{
+		loads->wait();
+	}
+
 	rp.reset(nullptr);
 
 	d3d->resize();
@@ -286,24 +342,30 @@ auto model_loading::exit() const -> bool
 
 void model_loading::update(const game_clock &clk, const raw_input &input)
 {
-	auto all_good = true;
-	for (auto &f : object_futures)
-	{
-		all_good = all_good 
-		       and (f._Is_ready());
-	}
-	if (all_good
+	main_thread.run_pending();
+
+	if (loads != nullptr
+		and
+		loads->is_done()
 		and
-		not object_futures.empty())
+		model_task.is_done())
 	{
-		object_futures.clear();
+		model_task.get();
+		startup_text = describe_startup(*loads);
+		::OutputDebugStringA(("Load time breakdown\n" + progress->breakdown()).c_str());
+		loads.reset();
+		progress.reset();
 		files_loaded.clear();
+		unpacked_files.clear();
+		assets.reset();
 	}
 
-	if (all_good)
+	if (loads == nullptr)
 	{
+		reload_update();
 		input_update(clk, input);
 		camera_update();
+		stream_update();
 		text_update(clk);
 	}
 	else
@@ -318,7 +380,7 @@ void model_loading::render()
 	rp->activate(context);
 	rp->clear(context, clear_color);
 
-	if (not object_futures.empty())
+	if (loads != nullptr)
 	{
 		draw_load_status();
 	}
@@ -328,6 +390,7 @@ void model_loading::render()
 		constant_buffers[cb_camera]->activate(context);
 		
 		draw_sky();
+		draw_model_instances();
 
 		constant_buffers[cb_orthographic]->activate(context);
 		draw_text();
@@ -338,206 +401,237 @@ void model_loading::render()
 
 void model_loading::load_files()
 {
+	// The dialog stays on this thread, the pack files are left to the graph and the model to a task
 	auto obj_file = open_file_dialog(hWnd);
-	auto obj_file_data = load_binary_file(obj_file);
-	auto obj_data_v = parse_obj(obj_file_data);
-	auto mtl_data_v = std::vector<mtl_data>{};
-	for (auto &mtl_file : obj_data_v.mtl_files)
+
+	// One open and map for all the files, uncompressed entries are used in place
+	assets = std::make_shared<asset_pack>(asset_pack_file);
+	assert(assets->is_valid());
+
+	unpacked_files.resize(list_of_files_to_load.size());
+	files_loaded.resize(list_of_files_to_load.size());
+	for (auto i = 0u; i < list_of_files_to_load.size(); i++)
 	{
-		mtl_file = obj_file.parent_path() / mtl_file;
-		auto mtl_file_data = load_binary_file(mtl_file);
-		mtl_data_v.push_back(parse_mtl(mtl_file_data));
+		auto idx = assets->find(list_of_files_to_load[i]);
+		assert(idx.has_value());
+		auto stored_size = assets->entry_stored_size(*idx),
+		     size = assets->entry_size(*idx);
+		auto compressed = assets->entry_codec(*idx) != pack_codec::none;
+
+		// A compressed entry is read as it's unpacked, so its time is all decode
+		progress->expect(load_stage::read, stored_size);
+		if (compressed)
+		{
+			progress->expect(load_stage::decode, size);
+		}
+
+		loads->add(list_of_files_to_load[i], {}, [&, i, stored_size, size, compressed]
+		{
+			progress->measure(compressed ? load_stage::decode : load_stage::read, compressed ? size : stored_size, [&]
+			{
+				auto data = assets->load(list_of_files_to_load[i], unpacked_files[i]);
+				assert(data.has_value());
+				files_loaded[i] = *data;
+			});
+			if (compressed)
+			{
+				progress->add(load_stage::read, stored_size, {});
+			}
+		});
 	}
 
-	files_loaded.resize(list_of_files_to_load.size());
+	model_task = load_model(obj_file);
+	model_task.start();
+}
 
-	auto load_file_async = [&](uint16_t idx, std::wstring_view file_name)
+// Read in order, though no thread waits on any step: each co_await gives the thread back until what it waits on is done.
+// The model isn't in the pack, what's made from it is counted by its size.
+auto model_loading::load_model(std::filesystem::path obj_file) -> task<>
+{
+	auto &jobs = job_system::shared();
+	auto size_error = std::error_code{};
+	auto model_size = static_cast<uint64_t>(std::filesystem::file_size(obj_file, size_error));
+	if (size_error)
 	{
-		files_loaded[idx] = load_binary_file(file_name);
-		return true;
-	};
+		model_size = 0;
+	}
+	progress->expect(load_stage::read, model_size);
+	progress->expect(load_stage::decode, model_size);
+	progress->expect(load_stage::create, 3 * model_size, 3);
+
+	auto start = load_progress::clock::now();
+	auto obj_file_data = co_await read_file_async(jobs, obj_file);
+	progress->add(load_stage::read, model_size, load_progress::clock::now() - start);
 
-	for (auto &&[i, filename] : list_of_files_to_load | iter::enumerate)
+	// Loading finishes without it, the scene is drawn with nothing picked or instanced
+	if (obj_file_data.empty())
 	{
-		object_futures.emplace_back(
-		    std::async(std::launch::async, load_file_async, static_cast<uint16_t>(i), filename));
+		progress->add(load_stage::decode, model_size, {});
+		progress->add(load_stage::create, 3 * model_size, {}, 3);
+		co_await main_thread.resume();
+		model_text = fmt::format(L"Can't read {}", obj_file.wstring());
+		co_return;
 	}
-}
 
-void model_loading::create_pipeline_state_object()
-{
-	pipeline_states.resize(5);
+	// On the worker that read it from here
+	auto model = obj_data{};
+	auto weld = weld_stats{};
+	progress->measure(load_stage::decode, model_size, [&]
+	{
+		model = parse_obj(obj_file_data);
+		weld = weld_vertices(model);
+	});
 
-	make_text_ps();
+	auto bvh = std::unique_ptr<triangle_bvh>{};
+	auto meshes = std::vector<instanced_mesh>{};
+	auto instance_count = std::size_t{};
+	auto meshes_time = load_progress::clock::duration{};
+	auto materials = std::vector<mtl_data>{};
 
-	object_futures.emplace_back(
-		std::async(std::launch::async, [&]
+	auto steps = std::vector<task<>>{};
+	steps.push_back(run_on(jobs, [&]
 	{
-		make_default_ps();
-		return true;
+		progress->measure(load_stage::create, model_size, [&]
+		{
+			bvh = std::make_unique<triangle_bvh>(model);
+		});
 	}));
-
-	object_futures.emplace_back(
-		std::async(std::launch::async, [&]
+	steps.push_back(run_on(jobs, [&]
 	{
-		make_sky_dome_ps();
-		return true;
+		// Groups without copies are sets of one, so everything is drawn the same way
+		auto meshes_start = load_progress::clock::now();
+		for (auto &geometry : find_repeated_geometry(model, instancing_settings{ .min_instances = 1 }))
+		{
+			instance_count += geometry.instance_transforms.size();
+			meshes.push_back(to_instanced_mesh(geometry));
+		}
+		meshes_time = load_progress::clock::now() - meshes_start;
 	}));
-}
+	steps.push_back(read_materials(jobs, *progress, model_size, obj_file.parent_path(), model.mtl_files, materials));
+	co_await when_all(jobs, std::move(steps));
 
-void model_loading::make_default_ps()
-{
-	if (not object_futures[basic_vso]._Is_ready())
+	// Buffers are made and everything is handed over between frames, nothing drawing or picking sees it half done
+	co_await main_thread.resume();
+
+	auto buffers_start = load_progress::clock::now();
+	auto device = d3d->get_device();
+	for (auto &mesh : meshes)
 	{
-		object_futures[basic_vso].wait();
+		model_instance_buffers.push_back(std::make_unique<mesh_buffer>(device, mesh));
 	}
-	if (not object_futures[basic_pso]._Is_ready())
+	progress->add(load_stage::create, model_size, meshes_time + (load_progress::clock::now() - buffers_start));
+
+	model_bvh = std::move(bvh);
+	model_materials = std::move(materials);
+	for (auto &grp : model.groups)
 	{
-		object_futures[basic_pso].wait();
+		model_group_names.push_back(grp.name);
 	}
-
-	auto device = d3d->get_device();
-	auto &vso = files_loaded[basic_vso], //load_binary_file(L"vertex_shader.cso"),
-	     &pso = files_loaded[basic_pso]; //load_binary_file(L"pixel_shader.cso");
-
-	auto desc = pipeline_state::description
-	{
-		bs::opaque,
-		ds::read_write,
-		rs::cull_anti_clockwise,
-		ss::anisotropic_clamp,
-		vertex_elements,
-		vso,
-		pso,
-		D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST
-	};
-	pipeline_states[ps_default] = std::make_unique<pipeline_state>(device, desc);
+	model_text = fmt::format(L"Welded: {} of {} vertices, {} of {} triangles removed\nInstanced: {} meshes, {} instances",
+	                         weld.vertices_removed, weld.vertices_before, weld.triangles_removed, weld.triangles_before,
+	                         model_instance_buffers.size(), instance_count);
 }
 
-void model_loading::make_text_ps()
+void model_loading::create_pipeline_state_object()
 {
-	if (not object_futures[text_vso]._Is_ready())
+	pipeline_states.resize(5);
+
+	add_object(*loads, *progress, *assets, "default pipeline", pipeline_files(ps_default), [&]
 	{
-		object_futures[text_vso].wait();
-	}
-	if (not object_futures[basic_pso]._Is_ready())
+		make_default_ps();
+	});
+	add_object(*loads, *progress, *assets, "text pipeline", pipeline_files(ps_text), [&]
 	{
-		object_futures[basic_pso].wait();
-	}
+		make_text_ps();
+	});
+	add_object(*loads, *progress, *assets, "sky pipeline", pipeline_files(ps_sky), [&]
+	{
+		make_sky_dome_ps();
+	});
+	add_object(*loads, *progress, *assets, "instances pipeline", pipeline_files(ps_instances), [&]
+	{
+		make_model_instances_ps();
+	});
+}
 
-	auto device = d3d->get_device();
-	auto &vso = files_loaded[text_vso], // load_binary_file(L"screen_space_text.vs.cso"),
-	     &pso = files_loaded[basic_pso]; // load_binary_file(L"pixel_shader.cso");
-
-	auto screen_text_desc = pipeline_state::description
-	{
-		bs::non_premultipled,
-		ds::read_write,
-		rs::cull_anti_clockwise,
-		ss::anisotropic_clamp,
-		vertex_elements,
-		vso,
-		pso,
-		D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST
-	};
-	pipeline_states[ps_text]= std::make_unique<pipeline_state>(device, screen_text_desc);
+void model_loading::make_default_ps()
+{
+	auto &source = pipeline_sources[ps_default];
+	pipeline_states[ps_default] = make_pipeline(d3d->get_device(), source, files_loaded[source.vso], files_loaded[source.pso]);
 }
 
-void model_loading::make_sky_dome_ps()
+void model_loading::make_text_ps()
 {
-	if (not object_futures[sky_vso]._Is_ready())
-	{
-		object_futures[sky_vso].wait();
-	}
-	if (not object_futures[sky_pso]._Is_ready())
-	{
-		object_futures[sky_pso].wait();
-	}
+	auto &source = pipeline_sources[ps_text];
+	pipeline_states[ps_text] = make_pipeline(d3d->get_device(), source, files_loaded[source.vso], files_loaded[source.pso]);
+}
 
-	auto device = d3d->get_device();
-	auto &vso = files_loaded[sky_vso], // load_binary_file(L"sky_dome.vs.cso"),
-	     &pso = files_loaded[sky_pso]; // load_binary_file(L"sky_dome.ps.cso");
-
-	auto sky_dome_desc = pipeline_state::description
-	{
-		bs::opaque,
-		ds::read_write,
-		rs::cull_clockwise,
-		ss::anisotropic_clamp,
-		vertex_elements,
-		vso,
-		pso,
-		D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST
-	};
+void model_loading::make_sky_dome_ps()
+{
+	auto &source = pipeline_sources[ps_sky];
+	pipeline_states[ps_sky] = make_pipeline(d3d->get_device(), source, files_loaded[source.vso], files_loaded[source.pso]);
+}
 
-	pipeline_states[ps_sky] = std::make_unique<pipeline_state>(device, sky_dome_desc);
+void model_loading::make_model_instances_ps()
+{
+	auto &source = pipeline_sources[ps_instances];
+	pipeline_states[ps_instances] = make_pipeline(d3d->get_device(), source, files_loaded[source.vso], files_loaded[source.pso]);
 }
 
 void model_loading::create_mesh_buffers()
 {
 	mesh_buffers.resize(4);
 
-	make_text_mesh();
-
-	object_futures.emplace_back(
-		std::async(std::launch::async, [&]
+	add_object(*loads, *progress, *assets, "text mesh", {}, [&]
+	{
+		make_text_mesh();
+	});
+	add_object(*loads, *progress, *assets, "sky mesh", { sky_mesh }, [&]
 	{
 		make_sky_dome_mesh();
-		return true;
-	}));
+	});
 }
 
 void model_loading::make_text_mesh()
 {
 	auto device = d3d->get_device();
-	auto [width, height] = get_window_size(hWnd);
-	auto l = width / 2.0f,
-	     w = height / 2.0f;
-	auto rect_mesh = mesh{
-		// Vertex List
-		{
-			{ { -l, +w, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f } },
-			{ { +l, +w, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 1.0f, 0.0f } },
-			{ { +l, -w, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f } },
-			{ { -l, -w, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 1.0f } },
-		},
-
-		// Index List
-		{
-			0, 1, 2,
-			0, 2, 3
-		}
-	};
+	constexpr auto text_quad = primitives::quad<vertex>();
 
-	mesh_buffers[mb_text] = std::make_unique<mesh_buffer>(device, rect_mesh);
+	mesh_buffers[mb_text] = std::make_unique<mesh_buffer>(device, mesh_view{ text_quad.vertices, text_quad.indicies });
 }
 
 void model_loading::make_sky_dome_mesh()
 {
 	auto device = d3d->get_device();
-	auto dome = spherify_and_invert(cube_base, 2);
-	mesh_buffers[mb_sky] = std::make_unique<mesh_buffer>(device, dome);
+	// Baked by Tools.Asset_Cook, vertices are already in gpu_datatypes vertex layout
+	static_assert(sizeof(vertex) == sizeof(cooked_vertex_full));
+	auto dome = read_cooked_mesh(files_loaded[sky_mesh]);
+	assert(dome.has_value() and dome->format == cooked_vertex_format::p32n32t32);
+
+	auto dome_vertices = std::span(reinterpret_cast<const vertex *>(dome->vertices.data()), dome->vertices.size() / sizeof(vertex));
+	mesh_buffers[mb_sky] = std::make_unique<mesh_buffer>(device, mesh_view{ dome_vertices, dome->indicies });
 }
 
 void model_loading::create_contant_buffers()
 {
 	constant_buffers.resize(6);
 
-	make_orthographic_cb();
-	make_text_transform_cb();
-
-	object_futures.emplace_back(
-		std::async(std::launch::async, [&]
+	add_object(*loads, *progress, *assets, "prespective cb", {}, [&]
 	{
 		make_prespective_cb();
-		return true;
-	}));
-	object_futures.emplace_back(
-		std::async(std::launch::async, [&]
+	});
+	add_object(*loads, *progress, *assets, "orthographic cb", {}, [&]
+	{
+		make_orthographic_cb();
+	});
+	add_object(*loads, *progress, *assets, "view cb", {}, [&]
 	{
 		make_view_cb();
-		return true;
-	}));
+	});
+	add_object(*loads, *progress, *assets, "text transform cb", {}, [&]
+	{
+		make_text_transform_cb();
+	});
 }
 
 void model_loading::make_prespective_cb()
@@ -545,12 +639,8 @@ void model_loading::make_prespective_cb()
 	auto device = d3d->get_device();
 	auto [width, height] = get_window_size(hWnd);
 
-	constexpr auto h_fov = XMConvertToRadians(field_of_view);
-	auto aspect_ratio = width / static_cast<float>(height);
-	auto v_fov = 2.0f * std::atan(std::tan(h_fov / 2.0f) * aspect_ratio);
-
 	auto projection = matrix{};
-	projection.data = XMMatrixPerspectiveFovLH(v_fov, aspect_ratio, near_z, far_z);
+	projection.data = make_projection(width, height);
 	projection.data = XMMatrixTranspose(projection.data);
 	constant_buffers[cb_prespective] = std::make_unique<constant_buffer>(device, stage::vertex, slot::projection, projection);
 }
@@ -558,10 +648,10 @@ void model_loading::make_prespective_cb()
 void model_loading::make_orthographic_cb()
 {
 	auto device = d3d->get_device();
-	auto [width, height] = get_window_size(hWnd);
 
 	auto projection = matrix{};
-	projection.data = XMMatrixOrthographicLH(width, height, -1.0f, 1.0f);
+	// text quad spans -1 to +1, so it covers the whole window
+	projection.data = XMMatrixOrthographicLH(2.0f, 2.0f, -1.0f, 1.0f);
 	projection.data = XMMatrixTranspose(projection.data);
 	constant_buffers[cb_orthographic] = std::make_unique<constant_buffer>(device, stage::vertex, slot::projection, projection);
 }
@@ -591,15 +681,17 @@ void model_loading::make_text_transform_cb()
 void model_loading::create_shader_resources()
 {
 	shader_resources.resize(3);
+	texture_streams.resize(shader_resources.size());
+	streamer = std::make_unique<texture_streamer>(stream_tail_size, texture_memory_budget);
 
-	make_text_texture();
-
-	object_futures.emplace_back(
-		std::async(std::launch::async, [&]
+	add_object(*loads, *progress, *assets, "text texture", {}, [&]
+	{
+		make_text_texture();
+	});
+	add_object(*loads, *progress, *assets, "sky texture", { sky_tex }, [&]
 	{
 		make_sky_dome_texture();
-		return true;
-	}));
+	});
 }
 
 void model_loading::make_text_texture()
@@ -629,32 +721,17 @@ void model_loading::make_text_texture()
 
 void model_loading::make_sky_dome_texture()
 {
-	auto textures = std::vector<std::vector<uint8_t>>{};
-
-	auto copy_loaded_file = [&](uint16_t file_idx)
-	{
-		if (not object_futures[file_idx]._Is_ready())
-		{
-			object_futures[file_idx].wait();
-		}
-
-		textures.push_back(files_loaded[file_idx]);
-	};
-
-	
-	copy_loaded_file(left_tex);
-	copy_loaded_file(right_tex);
-	copy_loaded_file(top_tex);
-	copy_loaded_file(bottom_tex);
-	copy_loaded_file(back_tex);
-	copy_loaded_file(front_tex);
-
+	// Six faces and their mips were put in one cube dds by Tools.Asset_Cook.
+	// stream_update fills in its mips and makes its view from the first frame on.
 	auto device = d3d->get_device();
 
-	shader_resources[sr_sky] = 
-	    std::make_unique<shader_resource>(device,
-	                                      shader_stage::pixel, shader_slot::texture,
-	                                      textures);
+	// Served from the pack's mapping, or a buffer of its own when it was unpacked, the stream keeps either
+	auto owner = std::shared_ptr<const void>{ assets };
+	if (not unpacked_files[sky_tex].empty())
+	{
+		owner = std::make_shared<std::vector<std::byte>>(std::move(unpacked_files[sky_tex]));
+	}
+	texture_streams[sr_sky] = std::make_unique<texture_stream>(device, files_loaded[sky_tex], std::move(owner));
 }
 
 void model_loading::input_update(const game_clock &clk, const raw_input &input)
@@ -681,6 +758,43 @@ void model_loading::input_update(const game_clock &clk, const raw_input &input)
 	auto yaw = -rotation_speed * input.get_axis_value(axis::x);
 
 	fp_cam->rotate(roll, pitch, yaw);
+
+	if (input.is_button_down(btn::left_button))
+	{
+		pick_update();
+	}
+}
+
+void model_loading::pick_update()
+{
+	// No model, e.g. the open dialog was cancelled
+	if (model_bvh == nullptr)
+	{
+		pick_text.clear();
+		return;
+	}
+
+	auto cursor = POINT{};
+	::GetCursorPos(&cursor);
+	::ScreenToClient(hWnd, &cursor);
+
+	auto [width, height] = get_window_size(hWnd);
+	auto pick_ray = make_picking_ray(fp_cam->get_position(),
+	                                 fp_cam->get_view(), make_projection(width, height),
+	                                 static_cast<float>(cursor.x), static_cast<float>(cursor.y),
+	                                 width, height);
+
+	auto hit = model_bvh->intersect(pick_ray);
+	if (not hit)
+	{
+		pick_text.clear();
+		return;
+	}
+
+	auto &group_name = model_group_names.at(hit->group);
+	pick_text = fmt::format(L"Pick: {} triangle {} at {:.2f}",
+	                        std::wstring(group_name.begin(), group_name.end()),
+	                        hit->triangle, hit->distance);
 }
 
 void model_loading::camera_update()
@@ -696,6 +810,65 @@ void model_loading::camera_update()
 	constant_buffers[cb_camera]->update(context, view);
 }
 
+void model_loading::stream_update()
+{
+	auto context = d3d->get_context();
+	auto [width, height] = get_window_size(hWnd);
+
+	for (auto id = 0u; id < texture_streams.size(); id++)
+	{
+		if (texture_streams[id] == nullptr)
+		{
+			continue;
+		}
+		if (not streamer->contains(id))
+		{
+			streamer->add(id, texture_streams[id]->info());
+		}
+	}
+
+	// A cube face covers 90 degrees, so it spans the window width over tan of half the field of view
+	if (streamer->contains(sr_sky))
+	{
+		auto face_pixels = width / std::tan(XMConvertToRadians(field_of_view) / 2.0f);
+		streamer->set_screen_size(sr_sky, face_pixels);
+	}
+
+	auto schedule = streamer->schedule(stream_bytes_per_frame);
+	auto remade = std::vector<bool>(texture_streams.size());
+	for (auto &request : schedule.evictions)
+	{
+		texture_streams[request.texture]->evict_mip(context, request.mip);
+	}
+	// Evicted mips are given back once per texture, however many went
+	for (auto &request : schedule.evictions)
+	{
+		if (texture_streams[request.texture]->trim(context))
+		{
+			remade[request.texture] = true;
+		}
+	}
+	for (auto &request : schedule.uploads)
+	{
+		auto wanted = streamer->wanted_mip(request.texture);
+		if (texture_streams[request.texture]->upload_mip(context, request.mip, wanted))
+		{
+			remade[request.texture] = true;
+		}
+	}
+
+	// A texture that was made again needs a view of its own
+	for (auto id = 0u; id < texture_streams.size(); id++)
+	{
+		if (remade[id])
+		{
+			shader_resources[id] = std::make_unique<shader_resource>(d3d->get_device(),
+			                                                         shader_stage::pixel, shader_slot::texture,
+			                                                         texture_streams[id]->get_texture());
+		}
+	}
+}
+
 void model_loading::text_update(const game_clock &clk)
 {
 	static long frame_count = 0;
@@ -714,7 +887,11 @@ void model_loading::text_update(const game_clock &clk)
 	frame_count = 0;
 	total_time = 0.0;
 
-	auto fps_text = fmt::format(L"FPS: {:.2f}\n", fps);
+	auto &streaming = streamer->stats();
+	auto fps_text = fmt::format(L"FPS: {:.2f}\n{}\n{}\nTextures: {:.1f} MiB, {} evictions, {} refetches\n{}",
+	                            fps, startup_text, model_text,
+	                            streaming.resident_bytes / (1024.0 * 1024.0), streaming.evictions, streaming.refetches,
+	                            pick_text);
 
 	auto format = d2d->make_text_format(L"Consolas", 12.0f);
 	auto brush = d2d->make_solid_color_brush(D2D1::ColorF(D2D1::ColorF::Yellow));
@@ -750,36 +927,48 @@ void model_loading::draw_sky()
 	mesh_buffers[mb_sky]->draw(context);
 }
 
-void model_loading::update_load_status()
+// Each set of repeated groups is one draw, whatever the number of copies
+void model_loading::draw_model_instances()
 {
-	auto loaded_items = std::count_if(pipeline_states.begin(), pipeline_states.end(),
-								  [](const std::unique_ptr<pipeline_state> &ptr)
-	{
-		return ptr != nullptr;
-	});
-	loaded_items += std::count_if(constant_buffers.begin(), constant_buffers.end(),
-								  [](const std::unique_ptr<constant_buffer> &ptr)
+	auto context = d3d->get_context();
+
+	pipeline_states[ps_instances]->activate(context);
+	for (auto &instances : model_instance_buffers)
 	{
-		return ptr != nullptr;
-	});
-	loaded_items += std::count_if(mesh_buffers.begin(), mesh_buffers.end(),
-								  [](const std::unique_ptr<mesh_buffer> &ptr)
+		instances->activate(context);
+		instances->draw(context);
+	}
+}
+
+void model_loading::update_load_status()
+{
+	if (not loads->is_done(load_status_node))
 	{
-		return ptr != nullptr;
-	});
-	loaded_items += std::count_if(shader_resources.begin(), shader_resources.end(),
-								  [](const std::unique_ptr<shader_resource> &ptr)
+		return;
+	}
+
+	auto status = progress->snapshot();
+	auto &objects = status.stages[static_cast<uint32_t>(load_stage::create)];
+	auto bytes_done = uint64_t{}, bytes_expected = uint64_t{};
+	for (auto &stage : status.stages)
 	{
-		return ptr != nullptr;
-	});
-	loaded_items += std::count_if(files_loaded.begin(), files_loaded.end(),
-								  [](const std::vector<uint8_t> &ptr)
+		bytes_done += stage.bytes_done;
+		bytes_expected += stage.bytes_expected;
+	}
+	auto remaining = status.remaining ? fmt::format(L", about {:.1f} s left", std::chrono::duration<double>(*status.remaining).count())
+	                                  : std::wstring{};
+	auto text = fmt::format(L"Loading: {:.0f}%{}\n{:.1f} of {:.1f} MiB, {} of {} objects",
+	                        status.fraction * 100.0, remaining,
+	                        bytes_done / (1024.0 * 1024.0), bytes_expected / (1024.0 * 1024.0),
+	                        objects.items_done, objects.items_expected);
+
+	// Drawn again only when it reads differently
+	if (text == load_status_text)
 	{
-		return not ptr.empty();
-	});
-	loaded_items -= 5;
+		return;
+	}
+	load_status_text = text;
 
-	auto text = fmt::format(L"Loaded: {} of {}", loaded_items, object_futures.size());
 	auto [width, height] = get_window_size(hWnd);
 	auto format = d2d->make_text_format(L"Consolas", 20.0f);
 	auto brush = d2d->make_solid_color_brush(D2D1::ColorF(D2D1::ColorF::Yellow));
@@ -794,7 +983,101 @@ void model_loading::update_load_status()
 
 void model_loading::draw_load_status()
 {
+	if (not loads->is_done(load_status_node))
+	{
+		return;
+	}
+
 	auto context = d3d->get_context();
 	constant_buffers[cb_orthographic]->activate(context);
 	draw_text();
 }
+
+void model_loading::reload_update()
+{
+	// Replacements are handed over in main_thread.run_pending, between frames when nothing is bound mid draw
+	std::erase_if(reloads, [](const task<> &reload)
+	{
+		return reload.is_done();
+	});
+
+	auto recook_sky = false;
+	for (auto &path : asset_watcher->poll())
+	{
+		auto name = path.filename().string();
+		recook_sky = recook_sky or std::find(sky_faces.begin(), sky_faces.end(), name) != sky_faces.end();
+
+		for (auto id = 0u; id < pipeline_sources.size(); id++)
+		{
+			auto &source = pipeline_sources[id];
+			if (list_of_files_to_load[source.vso] == name or list_of_files_to_load[source.pso] == name)
+			{
+				start_reload(reload_pipeline_state(id));
+			}
+		}
+
+		if (list_of_files_to_load[sky_tex] == name)
+		{
+			start_reload(reload_sky_texture());
+		}
+	}
+
+	if (recook_sky)
+	{
+		start_reload(cook_sky());
+	}
+}
+
+void model_loading::start_reload(task<> reload)
+{
+	reloads.push_back(std::move(reload));
+	reloads.back().start();
+}
+
+auto model_loading::reload_pipeline_state(std::size_t id) -> task<>
+{
+	auto device = d3d->get_device();
+	co_await resume_on(job_system::shared());
+
+	auto &source = pipeline_sources[id];
+	auto vso = load_binary_file(list_of_files_to_load[source.vso]),
+	     pso = load_binary_file(list_of_files_to_load[source.pso]);
+	if (vso.empty() or pso.empty())
+	{
+		co_return;   // e.g. caught mid save, the one there is kept
+	}
+	auto pipeline = make_pipeline(device, source, vso, pso);
+	if (pipeline == nullptr)
+	{
+		co_return;
+	}
+
+	co_await main_thread.resume();
+	pipeline_states[id] = std::move(pipeline);
+}
+
+auto model_loading::reload_sky_texture() -> task<>
+{
+	auto device = d3d->get_device();
+	co_await resume_on(job_system::shared());
+
+	// Read rather than mapped, the stream keeps it and a mapping would stop the next re-cook writing it
+	auto sky = std::make_shared<mapped_file>(list_of_files_to_load[sky_tex], file_access::read);
+	if (sky->empty() or not read_dds(sky->bytes()).has_value())
+	{
+		co_return;   // missing, truncated or not a dds, the one there is kept
+	}
+	auto stream = std::make_unique<texture_stream>(device, sky->bytes(), sky);
+
+	// Starts over from the smallest mips, the old view is drawn until stream_update replaces it
+	co_await main_thread.resume();
+	texture_streams[sr_sky] = std::move(stream);
+	streamer->remove(static_cast<uint32_t>(sr_sky));
+}
+
+// The sky.dds it writes is seen by a later poll and reloaded like any other change
+auto model_loading::cook_sky() -> task<>
+{
+	co_await resume_on(job_system::shared());
+	run_process(std::wstring(sky_cook_command));
+}
\ No newline at end of file
@@ -1,9 +1,15 @@
 #pragma once
 
+#include "load_graph.h"
+#include "async_task.h"
+
 #include <Windows.h>
 #include <memory>
 #include <vector>
-#include <future>
+#include <span>
+#include <cstddef>
+#include <string>
+#include <utility>
 
 namespace dx11_lessons
 {
@@ -17,6 +23,13 @@ namespace dx11_lessons
 	class mesh_buffer;
 	class constant_buffer;
 	class shader_resource;
+	class texture_stream;
+	class texture_streamer;
+	class asset_pack;
+	class triangle_bvh;
+	class file_watcher;
+	class load_progress;
+	struct mtl_data;
 
 	class model_loading
 	{
@@ -33,11 +46,13 @@ namespace dx11_lessons
 
 	private:
 		void load_files();
+		auto load_model(std::filesystem::path obj_file) -> task<>;
 
 		void create_pipeline_state_object();
 		void make_default_ps();
 		void make_text_ps();
 		void make_sky_dome_ps();
+		void make_model_instances_ps();
 
 		void create_mesh_buffers();
 		void make_text_mesh();
@@ -54,15 +69,24 @@ namespace dx11_lessons
 		void make_sky_dome_texture();
 
 		void input_update(const game_clock &clk, const raw_input &input);
+		void pick_update();
 		void camera_update();
 		void text_update(const game_clock &clk);
+		void stream_update();
 
 		void draw_text();
 		void draw_sky();
+		void draw_model_instances();
 
 		void update_load_status();
 		void draw_load_status();
 
+		void reload_update();
+		void start_reload(task<> reload);
+		auto reload_pipeline_state(std::size_t id) -> task<>;
+		auto reload_sky_texture() -> task<>;
+		auto cook_sky() -> task<>;
+
 	private:
 		HWND hWnd;
 		bool stop_drawing{ false };
@@ -76,9 +100,33 @@ namespace dx11_lessons
 		std::vector<std::unique_ptr<constant_buffer>> constant_buffers{};
 		std::vector<std::unique_ptr<shader_resource>> shader_resources{};
 
+		// Indexed like shader_resources, their views are made again when a stream's texture is
+		std::unique_ptr<texture_streamer> streamer{};
+		std::vector<std::unique_ptr<texture_stream>> texture_streams{};
+
 		std::unique_ptr<camera> fp_cam{};
+
+		std::unique_ptr<triangle_bvh> model_bvh{};
+		std::vector<std::string> model_group_names{};
+		std::vector<mtl_data> model_materials{};   // as the MTL files list them, for binding their maps
+		std::wstring pick_text{};
+		std::vector<std::unique_ptr<mesh_buffer>> model_instance_buffers{};
+		std::wstring model_text{};
 		
-		std::vector<std::future<bool>> object_futures;
-		std::vector<std::vector<uint8_t>> files_loaded;
+		// Everything loading makes, and what from, and how far along it is. Released once it's all done.
+		std::unique_ptr<load_progress> progress{};
+		std::unique_ptr<load_graph> loads{};
+		load_graph::node_id load_status_node{};
+		std::wstring load_status_text{};
+		std::wstring startup_text{};
+		main_thread_queue main_thread{};
+		task<> model_task{};
+		std::shared_ptr<asset_pack> assets;   // shared with the sky stream when it's served from the mapping
+		std::vector<std::span<const std::byte>> files_loaded;
+		std::vector<std::vector<std::byte>> unpacked_files;
+
+		// Live reload, replacements are built as jobs and swapped in between frames
+		std::unique_ptr<file_watcher> asset_watcher{};
+		std::vector<task<>> reloads{};
 	};
 }
\ No newline at end of file
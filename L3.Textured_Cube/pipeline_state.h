@@ -5,6 +5,7 @@
 #include <atlbase.h>
 #include <d3d11_4.h>
 #include <vector>
+#include <span>
 #include <cstddef>
 
 namespace dx11_lessons
@@ -70,8 +71,8 @@ namespace dx11_lessons
 			sampler_type sampler;
 
 			const std::vector<input_element_type> &input_element_layout;
-			const std::vector<uint8_t> &vertex_shader_bytecode;
-			const std::vector<uint8_t> &pixel_shader_bytecode;
+			std::span<const std::byte> vertex_shader_bytecode;
+			std::span<const std::byte> pixel_shader_bytecode;
 
 			D3D11_PRIMITIVE_TOPOLOGY primitive_topology;
 		};
@@ -91,9 +92,9 @@ namespace dx11_lessons
 
 		void create_input_layout(device_t device, 
 		                         const std::vector<input_element_type> &input_layout,
-		                         const std::vector<byte> &vso);
-		void create_vertex_shader(device_t device, const std::vector<uint8_t> &vso);
-		void create_pixel_shader(device_t device, const std::vector<uint8_t> &pso);
+		                         std::span<const std::byte> vso);
+		void create_vertex_shader(device_t device, std::span<const std::byte> vso);
+		void create_pixel_shader(device_t device, std::span<const std::byte> pso);
 
 	private:
 		blend_state_t blend_state{};
@@ -128,11 +128,11 @@ void constant_buffer::create_set_function()
 #pragma endregion
 
 #pragma region Shader Resource
-shader_resource::shader_resource(device_t device, shader_stage stage_, shader_slot slot_, const std::vector<uint8_t> &data) :
+shader_resource::shader_resource(device_t device, shader_stage stage_, shader_slot slot_, std::span<const std::byte> data) :
 	stage{ stage_ }, slot{ slot_ }
 {
 	auto hr = DirectX::CreateDDSTextureFromMemory(device,
-	                                              data.data(),
+	                                              reinterpret_cast<const uint8_t *>(data.data()),
 	                                              data.size(),
 	                                              &resource, &resource_view);
 	assert(SUCCEEDED(hr));
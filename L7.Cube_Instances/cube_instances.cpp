@@ -6,6 +6,7 @@
 #include "pipeline_state.h"
 #include "gpu_buffers.h"
 #include "gpu_datatypes.h"
+#include "primitives.h"
 
 #include "camera.h"
 #include "raw_input.h"
@@ -31,66 +32,7 @@ namespace
 	constexpr auto near_z = 0.1f;
 	constexpr auto far_z = 100.0f;
 
-	constexpr auto front_normal = XMFLOAT3{ 0.0f, 0.0f, 1.0f }, back_normal = XMFLOAT3{ 0.0f,  0.0f, -1.0f };
-	constexpr auto left_normal = XMFLOAT3{ -1.0f, 0.0f, 0.0f }, right_normal = XMFLOAT3{ 1.0f,  0.0f,  0.0f };
-	constexpr auto top_normal = XMFLOAT3{ 0.0f, 1.0f, 0.0f }, bottom_normal = XMFLOAT3{ 0.0f, -1.0f,  0.0f };
-
-	const auto cube_base = mesh{
-		// Vertex List
-		{
-			// Front
-			{ { -1.0f, -1.0f, +1.0f }, front_normal, { 0.0f, 0.0f } },
-			{ { +1.0f, -1.0f, +1.0f }, front_normal, { 1.0f, 0.0f } },
-			{ { +1.0f, +1.0f, +1.0f }, front_normal, { 1.0f, 1.0f } },
-			{ { -1.0f, +1.0f, +1.0f }, front_normal, { 0.0f, 1.0f } },
-
-			// Bottom
-			{ { -1.0f, -1.0f, -1.0f }, bottom_normal, { 0.0f, 0.0f } },
-			{ { +1.0f, -1.0f, -1.0f }, bottom_normal, { 1.0f, 0.0f } },
-			{ { +1.0f, -1.0f, +1.0f }, bottom_normal, { 1.0f, 1.0f } },
-			{ { -1.0f, -1.0f, +1.0f }, bottom_normal, { 0.0f, 1.0f } },
-
-			// right
-			{ { +1.0f, -1.0f, -1.0f }, right_normal, { 0.0f, 0.0f } },
-			{ { +1.0f, +1.0f, -1.0f }, right_normal, { 1.0f, 0.0f } },
-			{ { +1.0f, +1.0f, +1.0f }, right_normal, { 1.0f, 1.0f } },
-			{ { +1.0f, -1.0f, +1.0f }, right_normal, { 0.0f, 1.0f } },
-
-			// left
-			{ { -1.0f, -1.0f, -1.0f }, left_normal, { 0.0f, 0.0f } },
-			{ { -1.0f, -1.0f, +1.0f }, left_normal, { 1.0f, 0.0f } },
-			{ { -1.0f, +1.0f, +1.0f }, left_normal, { 1.0f, 1.0f } },
-			{ { -1.0f, +1.0f, -1.0f }, left_normal, { 0.0f, 1.0f } },
-
-			// Back
-			{ { -1.0f, -1.0f, -1.0f }, back_normal, { 0.0f, 0.0f } },
-			{ { -1.0f, +1.0f, -1.0f }, back_normal, { 1.0f, 0.0f } },
-			{ { +1.0f, +1.0f, -1.0f }, back_normal, { 1.0f, 1.0f } },
-			{ { +1.0f, -1.0f, -1.0f }, back_normal, { 0.0f, 1.0f } },
-
-			// Top
-			{ { -1.0f, +1.0f, -1.0f }, top_normal, { 0.0f, 0.0f } },
-			{ { -1.0f, +1.0f, +1.0f }, top_normal, { 1.0f, 0.0f } },
-			{ { +1.0f, +1.0f, +1.0f }, top_normal, { 1.0f, 1.0f } },
-			{ { +1.0f, +1.0f, -1.0f }, top_normal, { 0.0f, 1.0f } },
-		},
-
-		// Index List
-		{
-			// Front
-			0, 1, 2, 0, 2, 3,
-			// Bottom
-			4, 5, 6, 4, 6, 7,
-			// Right
-			8, 9, 10, 8, 10, 11,
-			// Left
-			12, 13, 14, 12, 14, 15,
-			// Back
-			16, 17, 18, 16, 18, 19,
-			// Top
-			20, 21, 22, 20, 22, 23,
-		}
-	};
+	constexpr auto cube_base = primitives::cube<vertex>();
 
 	using bs = pipeline_state::blend_type;
 	using ds = pipeline_state::depth_stencil_type;
@@ -275,26 +217,15 @@ void cube_instances::create_mesh_buffers()
 void cube_instances::make_cube_mesh()
 {
 	auto device = d3d->get_device();
-	
-	auto cube_mesh = cube_base;
-
-	cube_mb = std::make_unique<mesh_buffer>(device, cube_mesh);
+	cube_mb = std::make_unique<mesh_buffer>(device, mesh_view{ cube_base.vertices, cube_base.indicies });
 }
 
 void cube_instances::make_cube_instance_mesh()
 {
 	auto device = d3d->get_device();
-	auto l = 1.0f,
-		w = 1.0f,
-		h = 1.0f;
-
-	auto front_normal = XMFLOAT3{ 0.0f, 0.0f, 1.0f }, back_normal = XMFLOAT3{ 0.0f,  0.0f, -1.0f },
-		left_normal = XMFLOAT3{ -1.0f, 0.0f, 0.0f }, right_normal = XMFLOAT3{ 1.0f,  0.0f,  0.0f },
-		top_normal = XMFLOAT3{ 0.0f, 1.0f, 0.0f }, bottom_normal = XMFLOAT3{ 0.0f, -1.0f,  0.0f };
-
 	auto cube_mesh = instanced_mesh{
-		cube_base.vertices, 
-		cube_base.indicies
+		{ cube_base.vertices.begin(), cube_base.vertices.end() },
+		{ cube_base.indicies.begin(), cube_base.indicies.end() }
 	};
 
 	cube_mesh.instance_transforms.resize(100);
@@ -315,26 +246,9 @@ void cube_instances::make_cube_instance_mesh()
 void cube_instances::make_text_mesh()
 {
 	auto device = d3d->get_device();
-	auto [width, height] = get_window_size(hWnd);
-	auto l = width / 2.0f,
-	     w = height / 2.0f;
-	auto rect_mesh = mesh{
-		// Vertex List
-		{
-			{ { -l, +w, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f } },
-			{ { +l, +w, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 1.0f, 0.0f } },
-			{ { +l, -w, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f } },
-			{ { -l, -w, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 1.0f } },
-		},
-
-		// Index List
-		{
-			0, 1, 2,
-			0, 2, 3
-		}
-	};
+	constexpr auto text_quad = primitives::quad<vertex>();
 
-	text_mb = std::make_unique<mesh_buffer>(device, rect_mesh);
+	text_mb = std::make_unique<mesh_buffer>(device, mesh_view{ text_quad.vertices, text_quad.indicies });
 }
 
 void cube_instances::create_contant_buffers()
@@ -374,10 +288,10 @@ void cube_instances::make_prespective_cb()
 void cube_instances::make_orthographic_cb()
 {
 	auto device = d3d->get_device();
-	auto [width, height] = get_window_size(hWnd);
 
 	auto projection = matrix{};
-	projection.data = XMMatrixOrthographicLH(width, height, -1.0f, 1.0f);
+	// text quad spans -1 to +1, so it covers the whole window
+	projection.data = XMMatrixOrthographicLH(2.0f, 2.0f, -1.0f, 1.0f);
 	projection.data = XMMatrixTranspose(projection.data);
 	orthographic_proj_cb = std::make_unique<constant_buffer>(device, stage::vertex, slot::projection, projection);
 }
@@ -24,15 +24,19 @@ namespace
 
 #pragma region Mesh Buffer
 mesh_buffer::mesh_buffer(device_t device, const mesh &data) :
+	mesh_buffer(device, mesh_view{ data.vertices, data.indicies })
+{ }
+
+mesh_buffer::mesh_buffer(device_t device, const mesh_view &data) :
 	index_count{ static_cast<uint32_t>(data.indicies.size()) },
-	buffer_strides{ sizeof(data.vertices.back()) }, 
+	buffer_strides{ sizeof(vertex) }, 
 	buffer_offsets{ 0 }
 {
 	auto &vertices = data.vertices;
 	auto &indicies = data.indicies;
 
 	auto desc = D3D11_BUFFER_DESC{};
-	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
 	desc.CPUAccessFlags = NULL;
 	
 	auto srd = D3D11_SUBRESOURCE_DATA{};
@@ -49,7 +53,7 @@ mesh_buffer::mesh_buffer(device_t device, const mesh &data) :
 }
 
 mesh_buffer::mesh_buffer(direct3d11::device_t device, const instanced_mesh &data) :
-	mesh_buffer(device, mesh{ data.vertices, data.indicies })
+	mesh_buffer(device, mesh_view{ data.vertices, data.indicies })
 {
 	buffer_strides.push_back(sizeof(data.instance_transforms.back()));
 	buffer_offsets.push_back(0);
@@ -184,11 +188,11 @@ void constant_buffer::create_set_function()
 #pragma endregion
 
 #pragma region Shader Resource
-shader_resource::shader_resource(device_t device, shader_stage stage_, shader_slot slot_, const std::vector<uint8_t> &data) :
+shader_resource::shader_resource(device_t device, shader_stage stage_, shader_slot slot_, std::span<const std::byte> data) :
 	stage{ stage_ }, slot{ slot_ }
 {
 	auto hr = DirectX::CreateDDSTextureFromMemory(device,
-	                                              data.data(),
+	                                              reinterpret_cast<const uint8_t *>(data.data()),
 	                                              data.size(),
 	                                              &resource, &resource_view);
 	assert(SUCCEEDED(hr));
@@ -5,6 +5,8 @@
 
 #include <functional>
 #include <vector>
+#include <span>
+#include <cstddef>
 #include <cstdint>
 
 namespace dx11_lessons
@@ -29,6 +31,7 @@ namespace dx11_lessons
 	public:
 		mesh_buffer() = delete;
 		mesh_buffer(direct3d11::device_t device, const mesh &data);
+		mesh_buffer(direct3d11::device_t device, const mesh_view &data);
 		mesh_buffer(direct3d11::device_t device, const instanced_mesh &data);
 		~mesh_buffer();
 
@@ -92,7 +95,7 @@ namespace dx11_lessons
 	public:
 		shader_resource() = delete;
 		shader_resource(direct3d11::device_t device, shader_stage stage, shader_slot slot, 
-		                const std::vector<uint8_t> &data);
+		                std::span<const std::byte> data);
 		shader_resource(direct3d11::device_t device, shader_stage stage, shader_slot slot,
 		                const CComPtr<ID3D11Texture2D> texture);
 		~shader_resource();
@@ -6,10 +6,12 @@
 #include "pipeline_state.h"
 #include "gpu_buffers.h"
 #include "gpu_datatypes.h"
+#include "primitives.h"
 
 #include "camera.h"
 #include "raw_input.h"
 #include "clock.h"
+#include "procedural_sphere.h"
 #include "helpers.h"
 
 #include <cppitertools\enumerate.hpp>
@@ -31,66 +33,7 @@ namespace
 	constexpr auto near_z = 0.1f;
 	constexpr auto far_z = 100.0f;
 
-	constexpr auto front_normal = XMFLOAT3{ 0.0f, 0.0f, 1.0f }, back_normal = XMFLOAT3{ 0.0f,  0.0f, -1.0f };
-	constexpr auto left_normal = XMFLOAT3{ -1.0f, 0.0f, 0.0f }, right_normal = XMFLOAT3{ 1.0f,  0.0f,  0.0f };
-	constexpr auto top_normal = XMFLOAT3{ 0.0f, 1.0f, 0.0f }, bottom_normal = XMFLOAT3{ 0.0f, -1.0f,  0.0f };
-
-	const auto cube_base = mesh{
-		// Vertex List
-		{
-			// Front
-			{ { -1.0f, -1.0f, +1.0f }, front_normal, { 0.0f, 0.0f } },
-			{ { +1.0f, -1.0f, +1.0f }, front_normal, { 1.0f, 0.0f } },
-			{ { +1.0f, +1.0f, +1.0f }, front_normal, { 1.0f, 1.0f } },
-			{ { -1.0f, +1.0f, +1.0f }, front_normal, { 0.0f, 1.0f } },
-
-			// Bottom
-			{ { -1.0f, -1.0f, -1.0f }, bottom_normal, { 0.0f, 0.0f } },
-			{ { +1.0f, -1.0f, -1.0f }, bottom_normal, { 1.0f, 0.0f } },
-			{ { +1.0f, -1.0f, +1.0f }, bottom_normal, { 1.0f, 1.0f } },
-			{ { -1.0f, -1.0f, +1.0f }, bottom_normal, { 0.0f, 1.0f } },
-
-			// right
-			{ { +1.0f, -1.0f, -1.0f }, right_normal, { 0.0f, 0.0f } },
-			{ { +1.0f, +1.0f, -1.0f }, right_normal, { 1.0f, 0.0f } },
-			{ { +1.0f, +1.0f, +1.0f }, right_normal, { 1.0f, 1.0f } },
-			{ { +1.0f, -1.0f, +1.0f }, right_normal, { 0.0f, 1.0f } },
-
-			// left
-			{ { -1.0f, -1.0f, -1.0f }, left_normal, { 0.0f, 0.0f } },
-			{ { -1.0f, -1.0f, +1.0f }, left_normal, { 1.0f, 0.0f } },
-			{ { -1.0f, +1.0f, +1.0f }, left_normal, { 1.0f, 1.0f } },
-			{ { -1.0f, +1.0f, -1.0f }, left_normal, { 0.0f, 1.0f } },
-
-			// Back
-			{ { -1.0f, -1.0f, -1.0f }, back_normal, { 0.0f, 0.0f } },
-			{ { -1.0f, +1.0f, -1.0f }, back_normal, { 1.0f, 0.0f } },
-			{ { +1.0f, +1.0f, -1.0f }, back_normal, { 1.0f, 1.0f } },
-			{ { +1.0f, -1.0f, -1.0f }, back_normal, { 0.0f, 1.0f } },
-
-			// Top
-			{ { -1.0f, +1.0f, -1.0f }, top_normal, { 0.0f, 0.0f } },
-			{ { -1.0f, +1.0f, +1.0f }, top_normal, { 1.0f, 0.0f } },
-			{ { +1.0f, +1.0f, +1.0f }, top_normal, { 1.0f, 1.0f } },
-			{ { +1.0f, +1.0f, -1.0f }, top_normal, { 0.0f, 1.0f } },
-		},
-
-		// Index List
-		{
-			// Front
-			0, 1, 2, 0, 2, 3,
-			// Bottom
-			4, 5, 6, 4, 6, 7,
-			// Right
-			8, 9, 10, 8, 10, 11,
-			// Left
-			12, 13, 14, 12, 14, 15,
-			// Back
-			16, 17, 18, 16, 18, 19,
-			// Top
-			20, 21, 22, 20, 22, 23,
-		}
-	};
+	constexpr auto cube_base = primitives::cube<vertex>();
 
 	using bs = pipeline_state::blend_type;
 	using ds = pipeline_state::depth_stencil_type;
@@ -101,86 +44,6 @@ namespace
 	using slot = shader_slot;
 	using stage = shader_stage;
 
-	auto spherify_and_invert(const mesh &cube, uint32_t subdivide_count) -> mesh
-	{
-		auto divide_edge = [](vertex v0, vertex v1) -> vertex
-		{
-			auto mp = vertex{};
-			mp.position = XMFLOAT3{
-				0.5f * (v0.position.x + v1.position.x),
-				0.5f * (v0.position.y + v1.position.y),
-				0.5f * (v0.position.z + v1.position.z),
-			};
-			mp.normal = v0.normal;
-			mp.texcoord = XMFLOAT2{
-				0.5f * (v0.texcoord.x + v1.texcoord.x),
-				0.5f * (v0.texcoord.y + v1.texcoord.y),
-			};
-
-			return mp;
-		};
-
-		auto sub_divide_triangle = [&](const vertex &v0, const vertex &v1, const vertex &v2, const uint32_t index) -> mesh
-		{
-			auto m0 = divide_edge(v0, v1),
-				m1 = divide_edge(v1, v2),
-				m2 = divide_edge(v2, v0);
-
-			return mesh
-			{
-				{ v0, m0, v1, m1, v2, m2 },
-				{
-					index + 0, index + 1, index + 5,
-					index + 1, index + 2, index + 3,
-					index + 3, index + 4, index + 5,
-					index + 1, index + 3, index + 5,
-				}
-			};
-		};
-
-		auto sub_divide_mesh = [&](const mesh &shape) -> mesh
-		{
-			auto result_mesh = mesh{};
-			auto &vertices = result_mesh.vertices;
-			auto &indicies = result_mesh.indicies;
-
-			auto number_of_triangles = shape.indicies.size() / 3u;
-			for (size_t i = 0; i < number_of_triangles; i++)
-			{
-				auto triangle = sub_divide_triangle(shape.vertices[shape.indicies[i * 3]],
-				                                    shape.vertices[shape.indicies[i * 3 + 1]],
-				                                    shape.vertices[shape.indicies[i * 3 + 2]],
-				                                    static_cast<uint32_t>(i) * 6);
-
-				vertices.insert(vertices.end(), triangle.vertices.begin(), triangle.vertices.end());
-				indicies.insert(indicies.end(), triangle.indicies.begin(), triangle.indicies.end());
-			}
-
-			return result_mesh;
-		};
-
-		auto result_mesh = mesh{};
-
-		for (uint16_t i = 0; i < subdivide_count; i++)
-		{
-			auto &msh = (i == 0) ? cube : result_mesh;
-
-			result_mesh = sub_divide_mesh(msh);
-		}
-
-		for (auto &v : result_mesh.vertices)
-		{
-			auto n = XMLoadFloat3(&v.normal);
-			n = -1.0f * n;
-			XMStoreFloat3(&v.normal, n);
-
-			auto p = XMLoadFloat3(&v.position);
-			p = XMVector3Normalize(p);
-			XMStoreFloat3(&v.position, p);
-		}
-
-		return result_mesh;
-	}
 }
 
 sky_dome::sky_dome(HWND hwnd) :
@@ -362,7 +225,7 @@ void sky_dome::make_sky_dome_ps()
 	{
 		bs::opaque,
 		ds::read_write,
-		rs::cull_clockwise,
+		rs::cull_anti_clockwise,
 		ss::anisotropic_clamp,
 		vertex_elements,
 		vso, pso,
@@ -383,24 +246,16 @@ void sky_dome::create_mesh_buffers()
 void sky_dome::make_cube_mesh()
 {
 	auto device = d3d->get_device();
-	auto cube_mesh = spherify_and_invert(cube_base, 2);
+	auto cube_mesh = make_sphere_mesh<mesh>({ sphere_topology::cube, 2 });
 	cube_mb = std::make_unique<mesh_buffer>(device, cube_mesh);
 }
 
 void sky_dome::make_cube_instance_mesh()
 {
 	auto device = d3d->get_device();
-	auto l = 1.0f,
-		w = 1.0f,
-		h = 1.0f;
-
-	auto front_normal = XMFLOAT3{ 0.0f, 0.0f, 1.0f }, back_normal = XMFLOAT3{ 0.0f,  0.0f, -1.0f },
-		left_normal = XMFLOAT3{ -1.0f, 0.0f, 0.0f }, right_normal = XMFLOAT3{ 1.0f,  0.0f,  0.0f },
-		top_normal = XMFLOAT3{ 0.0f, 1.0f, 0.0f }, bottom_normal = XMFLOAT3{ 0.0f, -1.0f,  0.0f };
-
 	auto cube_mesh = instanced_mesh{
-		cube_base.vertices, 
-		cube_base.indicies
+		{ cube_base.vertices.begin(), cube_base.vertices.end() },
+		{ cube_base.indicies.begin(), cube_base.indicies.end() }
 	};
 
 	cube_mesh.instance_transforms.resize(100);
@@ -421,32 +276,15 @@ void sky_dome::make_cube_instance_mesh()
 void sky_dome::make_text_mesh()
 {
 	auto device = d3d->get_device();
-	auto [width, height] = get_window_size(hWnd);
-	auto l = width / 2.0f,
-	     w = height / 2.0f;
-	auto rect_mesh = mesh{
-		// Vertex List
-		{
-			{ { -l, +w, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f } },
-			{ { +l, +w, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 1.0f, 0.0f } },
-			{ { +l, -w, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f } },
-			{ { -l, -w, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 1.0f } },
-		},
-
-		// Index List
-		{
-			0, 1, 2,
-			0, 2, 3
-		}
-	};
+	constexpr auto text_quad = primitives::quad<vertex>();
 
-	text_mb = std::make_unique<mesh_buffer>(device, rect_mesh);
+	text_mb = std::make_unique<mesh_buffer>(device, mesh_view{ text_quad.vertices, text_quad.indicies });
 }
 
 void sky_dome::make_sky_dome_mesh()
 {
 	auto device = d3d->get_device();
-	auto dome = spherify_and_invert(cube_base, 4);
+	auto dome = make_sphere_mesh<mesh>({ sphere_topology::icosahedron, 4, sphere_facing::inward });
 	sky_dome_mb = std::make_unique<mesh_buffer>(device, dome);
 }
 
@@ -487,10 +325,10 @@ void sky_dome::make_prespective_cb()
 void sky_dome::make_orthographic_cb()
 {
 	auto device = d3d->get_device();
-	auto [width, height] = get_window_size(hWnd);
 
 	auto projection = matrix{};
-	projection.data = XMMatrixOrthographicLH(width, height, -1.0f, 1.0f);
+	// text quad spans -1 to +1, so it covers the whole window
+	projection.data = XMMatrixOrthographicLH(2.0f, 2.0f, -1.0f, 1.0f);
 	projection.data = XMMatrixTranspose(projection.data);
 	orthographic_proj_cb = std::make_unique<constant_buffer>(device, stage::vertex, slot::projection, projection);
 }
@@ -585,13 +423,20 @@ void sky_dome::make_sky_dome_texture()
 {
 	auto device = d3d->get_device();
 
-	auto textures = std::vector<std::vector<uint8_t>>{};
-	textures.emplace_back(load_binary_file(L"left.dds"));
-	textures.emplace_back(load_binary_file(L"right.dds"));
-	textures.emplace_back(load_binary_file(L"top.dds"));
-	textures.emplace_back(load_binary_file(L"bottom.dds"));
-	textures.emplace_back(load_binary_file(L"back.dds"));
-	textures.emplace_back(load_binary_file(L"front.dds"));
+	auto files = std::array{
+		load_binary_file(L"left.dds"),
+		load_binary_file(L"right.dds"),
+		load_binary_file(L"top.dds"),
+		load_binary_file(L"bottom.dds"),
+		load_binary_file(L"back.dds"),
+		load_binary_file(L"front.dds"),
+	};
+
+	auto textures = std::vector<std::span<const std::byte>>{};
+	for (auto &file : files)
+	{
+		textures.push_back(file.bytes());
+	}
 	
 	sky_dome_sr = std::make_unique<shader_resource>(device, 
 	                                                shader_stage::pixel, shader_slot::texture,
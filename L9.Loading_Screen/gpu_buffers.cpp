@@ -1,8 +1,9 @@
 #include "gpu_buffers.h"
+#include "dds_file.h"
+#include "mip_generator.h"
 
-#include <DirectXTex.h>
-#include <DirectXTK\DDSTextureLoader.h>
 #include <array>
+#include <vector>
 #include <cassert>
 
 using namespace dx11_lessons;
@@ -21,19 +22,53 @@ namespace
 
 		return buffer;
 	}
+
+	auto make_view_desc(const dds_texture &texture) -> D3D11_SHADER_RESOURCE_VIEW_DESC
+	{
+		auto desc = D3D11_SHADER_RESOURCE_VIEW_DESC{};
+		desc.Format = static_cast<DXGI_FORMAT>(texture.format);
+
+		if (texture.is_cube and texture.array_size > 6)
+		{
+			desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBEARRAY;
+			desc.TextureCubeArray.MipLevels = texture.mip_count;
+			desc.TextureCubeArray.NumCubes = texture.array_size / 6;
+		}
+		else if (texture.is_cube)
+		{
+			desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+			desc.TextureCube.MipLevels = texture.mip_count;
+		}
+		else if (texture.array_size > 1)
+		{
+			desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+			desc.Texture2DArray.MipLevels = texture.mip_count;
+			desc.Texture2DArray.ArraySize = texture.array_size;
+		}
+		else
+		{
+			desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+			desc.Texture2D.MipLevels = texture.mip_count;
+		}
+		return desc;
+	}
 }
 
 #pragma region Mesh Buffer
 mesh_buffer::mesh_buffer(device_t device, const mesh &data) :
+	mesh_buffer(device, mesh_view{ data.vertices, data.indicies })
+{ }
+
+mesh_buffer::mesh_buffer(device_t device, const mesh_view &data) :
 	index_count{ static_cast<uint32_t>(data.indicies.size()) },
-	buffer_strides{ sizeof(data.vertices.back()) }, 
+	buffer_strides{ sizeof(vertex) }, 
 	buffer_offsets{ 0 }
 {
 	auto &vertices = data.vertices;
 	auto &indicies = data.indicies;
 
 	auto desc = D3D11_BUFFER_DESC{};
-	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
 	desc.CPUAccessFlags = NULL;
 	
 	auto srd = D3D11_SUBRESOURCE_DATA{};
@@ -50,7 +85,7 @@ mesh_buffer::mesh_buffer(device_t device, const mesh &data) :
 }
 
 mesh_buffer::mesh_buffer(direct3d11::device_t device, const instanced_mesh &data) :
-	mesh_buffer(device, mesh{ data.vertices, data.indicies })
+	mesh_buffer(device, mesh_view{ data.vertices, data.indicies })
 {
 	buffer_strides.push_back(sizeof(data.instance_transforms.back()));
 	buffer_offsets.push_back(0);
@@ -185,73 +220,55 @@ void constant_buffer::create_set_function()
 #pragma endregion
 
 #pragma region Shader Resource
-shader_resource::shader_resource(device_t device, shader_stage stage_, shader_slot slot_, const std::vector<uint8_t> &data) :
+shader_resource::shader_resource(device_t device, shader_stage stage_, shader_slot slot_, std::span<const std::byte> data) :
 	stage{ stage_ }, slot{ slot_ }, resource{ }
 {
-	auto hr = DirectX::CreateDDSTextureFromMemory(device,
-	                                              data.data(),
-	                                              data.size(),
-	                                              &resource, &resource_view);
-	assert(SUCCEEDED(hr));
-	
-	create_set_function();
-}
-
-shader_resource::shader_resource(direct3d11::device_t device, shader_stage stage_, shader_slot slot_, const texture_t texture) :
-	stage{ stage_ }, slot{ slot_ }, resource{ texture }
-{
-	auto hr = device->CreateShaderResourceView(resource, nullptr, &resource_view);
-	assert(SUCCEEDED(hr));
+	// Subresources point into data, so the texture is made straight from the file bytes
+	auto dds = read_dds(data);
+	assert(dds.has_value());
 
-	create_set_function();
-}
-
-shader_resource::shader_resource(direct3d11::device_t device, shader_stage stage_, shader_slot slot_, 
-                                 const std::vector<std::vector<uint8_t>> &data) :
-	stage{ stage_ }, slot{ slot_ }
-{
-	auto texture_images = std::vector<DirectX::ScratchImage>{};
-	for (auto &tex_data : data)
+	// Unless it came without mips, then they are made here. Cooked textures already have them.
+	auto generated_mips = std::vector<std::byte>{};
+	if (dds->mip_count == 1 and can_generate_mips(dds->format) and (dds->width > 1 or dds->height > 1))
 	{
-		auto info = DirectX::TexMetadata{};
-		auto &image = texture_images.emplace_back(DirectX::ScratchImage{});
-		DirectX::LoadFromDDSMemory(tex_data.data(), tex_data.size(), DirectX::DDS_FLAGS_NONE, &info, image);
+		generated_mips = generate_mips(*dds, mip_settings{});
+		dds->mip_count = full_mip_count(dds->width, dds->height);
+		dds->data = generated_mips;
 	}
 
-	auto srds = std::vector<D3D11_SUBRESOURCE_DATA>{};
-	for (auto &image : texture_images)
-	{
-		auto &srd = srds.emplace_back(D3D11_SUBRESOURCE_DATA{});
-		srd.pSysMem = image.GetPixels();
-		srd.SysMemPitch = static_cast<uint32_t>(image.GetImages()->rowPitch);
-		srd.SysMemSlicePitch = 0;
-	}
-
-	auto metadata = texture_images.front().GetMetadata();
 	auto td = D3D11_TEXTURE2D_DESC{};
-	td.Width = static_cast<uint32_t>(metadata.width);
-	td.Height = static_cast<uint32_t>(metadata.height);
-	td.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-	td.Usage = D3D11_USAGE_DEFAULT;
-	td.Format = metadata.format;
+	td.Width = dds->width;
+	td.Height = dds->height;
+	td.MipLevels = dds->mip_count;
+	td.ArraySize = dds->array_size;
+	td.Format = static_cast<DXGI_FORMAT>(dds->format);
 	td.SampleDesc = { 1, 0 };
-	td.ArraySize = static_cast<uint32_t>(texture_images.size());
-	td.MipLevels = 1;
-	td.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE;
+	td.Usage = D3D11_USAGE_IMMUTABLE;
+	td.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	td.MiscFlags = dds->is_cube ? D3D11_RESOURCE_MISC_TEXTURECUBE : 0;
 
-	auto tex_array = texture_t{};
-	auto hr = device->CreateTexture2D(&td, &srds[0], &tex_array);
+	auto subresources = std::vector<D3D11_SUBRESOURCE_DATA>{};
+	for (auto &sub : dds_subresources(*dds))
+	{
+		subresources.push_back({ sub.data, sub.row_pitch, sub.slice_pitch });
+	}
+
+	auto texture = CComPtr<ID3D11Texture2D>{};
+	auto hr = device->CreateTexture2D(&td, subresources.data(), &texture);
 	assert(SUCCEEDED(hr));
+	resource = texture;
 
-	resource = tex_array;
+	auto srvd = make_view_desc(*dds);
+	hr = device->CreateShaderResourceView(resource, &srvd, &resource_view);
+	assert(SUCCEEDED(hr));
 
-	auto srvd = D3D11_SHADER_RESOURCE_VIEW_DESC{};
-	srvd.Format = td.Format;
-	srvd.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
-	srvd.TextureCube.MipLevels = td.MipLevels;
-	srvd.TextureCube.MostDetailedMip = 0;
+	create_set_function();
+}
 
-	hr = device->CreateShaderResourceView(resource, &srvd, &resource_view);
+shader_resource::shader_resource(direct3d11::device_t device, shader_stage stage_, shader_slot slot_, const texture_t texture) :
+	stage{ stage_ }, slot{ slot_ }, resource{ texture }
+{
+	auto hr = device->CreateShaderResourceView(resource, nullptr, &resource_view);
 	assert(SUCCEEDED(hr));
 
 	create_set_function();
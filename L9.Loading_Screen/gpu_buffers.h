@@ -5,6 +5,8 @@
 
 #include <functional>
 #include <vector>
+#include <span>
+#include <cstddef>
 #include <cstdint>
 
 namespace dx11_lessons
@@ -21,6 +23,8 @@ namespace dx11_lessons
 		view = 1,
 		transform = 2,
 		texture = 0,
+		irradiance = 1,
+		specular = 2,
 		light = 0,
 	};
 
@@ -29,6 +33,7 @@ namespace dx11_lessons
 	public:
 		mesh_buffer() = delete;
 		mesh_buffer(direct3d11::device_t device, const mesh &data);
+		mesh_buffer(direct3d11::device_t device, const mesh_view &data);
 		mesh_buffer(direct3d11::device_t device, const instanced_mesh &data);
 		~mesh_buffer();
 
@@ -94,11 +99,9 @@ namespace dx11_lessons
 
 		shader_resource() = delete;
 		shader_resource(direct3d11::device_t device, shader_stage stage, shader_slot slot, 
-		                const std::vector<uint8_t> &data);
+		                std::span<const std::byte> data);
 		shader_resource(direct3d11::device_t device, shader_stage stage, shader_slot slot,
 		                const texture_t texture);
-		shader_resource(direct3d11::device_t device, shader_stage stage, shader_slot slot,
-		                const std::vector<std::vector<uint8_t>> &data);
 		~shader_resource();
 
 		void activate(direct3d11::context_t context);
@@ -4,6 +4,7 @@
 
 #include <DirectXMath.h>
 #include <vector>
+#include <span>
 
 namespace dx11_lessons
 {
@@ -27,6 +28,13 @@ namespace dx11_lessons
 		std::vector<uint32_t> indicies;
 	};
 
+	// Read-only mesh data, e.g. constexpr primitives, uploaded without copying into a mesh
+	struct mesh_view
+	{
+		std::span<const vertex> vertices;
+		std::span<const uint32_t> indicies;
+	};
+
 	struct matrix
 	{
 		DirectX::XMMATRIX data;
@@ -57,12 +65,11 @@ namespace dx11_lessons
 		DirectX::XMVECTOR position;
 	};
 
+	// Surface lit by the prefiltered sky, the sky itself is bound as the irradiance and specular cubes
 	struct light
 	{
-		DirectX::XMFLOAT4 diffuse;
-		DirectX::XMFLOAT4 ambient;
-		DirectX::XMFLOAT3 light_pos;
-		float specular_power;
-		DirectX::XMFLOAT4 specular;
+		DirectX::XMFLOAT4 specular;   // reflectance looking straight on
+		float roughness;              // picks the specular cube's mip
+		DirectX::XMFLOAT3 padding;
 	};
 }
\ No newline at end of file
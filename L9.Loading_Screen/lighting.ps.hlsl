@@ -1,13 +1,13 @@
-Texture2D textureObj;
+Texture2D textureObj : register(t0);
+TextureCube irradianceObj : register(t1);
+TextureCube specularObj : register(t2);
 SamplerState sampleState;
 
+// Sky is the light, prefiltered by Tools.Asset_Cook irradiance and specular
 cbuffer light_buffer : register (b0)
 {
-	float4 diffuse;
-	float4 ambient;
-	float3 light_pos;
-	float specular_power;
 	float4 specular;
+	float roughness;
 };
 
 struct PS_INPUT
@@ -18,21 +18,31 @@ struct PS_INPUT
 	float3 eye_pos : TEXCOORD1;
 };
 
+// Karis' fit of the split sum's BRDF half, so there's no lookup texture
+float2 environment_brdf(float n_dot_v)
+{
+	const float4 c0 = { -1.0f, -0.0275f, -0.572f, 0.022f };
+	const float4 c1 = { 1.0f, 0.0425f, 1.04f, -0.04f };
+	float4 r = roughness * c0 + c1;
+	float a004 = min(r.x * r.x, exp2(-9.28f * n_dot_v)) * r.x + r.y;
+	return float2(-1.04f, 1.04f) * a004 + r.zw;
+}
+
 float4 main(PS_INPUT input) : SV_TARGET
 {
-	float light_intensity = saturate(dot(input.nor, light_pos));
+	float3 normal = normalize(input.nor);
+	float3 view_dir = normalize(input.eye_pos);
+	float3 reflection = reflect(-view_dir, normal);
 
-	float3 reflection = normalize(2 * light_intensity * input.nor - light_pos);
-	float3 view_dir = normalize(input.eye_pos - (float3)input.pos);
-	float4 spec_col = specular * pow(saturate(dot(reflection, view_dir)), specular_power);
+	uint width, height, mip_count;
+	specularObj.GetDimensions(0, width, height, mip_count);
 
 	float4 tex_color = textureObj.Sample(sampleState, input.uv);
+	float3 diffuse = irradianceObj.Sample(sampleState, normal).rgb;
+	float3 reflected = specularObj.SampleLevel(sampleState, reflection, roughness * (mip_count - 1)).rgb;
 
-	float4 color = tex_color * ambient;
-	color += saturate(light_intensity * diffuse * tex_color);
-	color.w = tex_color.w;
-
-	color = saturate(color + spec_col);
+	float2 brdf = environment_brdf(saturate(dot(normal, view_dir)));
+	float3 color = tex_color.rgb * diffuse + reflected * (specular.rgb * brdf.x + brdf.y);
 
-	return color;
+	return float4(color, tex_color.w);
 }
\ No newline at end of file
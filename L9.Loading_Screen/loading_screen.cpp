@@ -6,11 +6,16 @@
 #include "pipeline_state.h"
 #include "gpu_buffers.h"
 #include "gpu_datatypes.h"
+#include "primitives.h"
 
 #include "camera.h"
 #include "raw_input.h"
 #include "clock.h"
+#include "procedural_sphere.h"
 #include "helpers.h"
+#include "asset_pack.h"
+#include "load_progress.h"
+#include "cooked_mesh.h"
 
 #include <cppitertools\enumerate.hpp>
 #include <fmt/core.h>
@@ -18,9 +23,10 @@
 #include <array>
 #include <cmath>
 #include <thread>
-#include <future>
 #include <string_view>
 #include <functional>
+#include <chrono>
+#include <stdexcept>
 
 using namespace dx11_lessons;
 using namespace DirectX;
@@ -35,66 +41,7 @@ namespace
 	constexpr auto near_z = 0.1f;
 	constexpr auto far_z = 100.0f;
 
-	constexpr auto front_normal = XMFLOAT3{ 0.0f, 0.0f, 1.0f }, back_normal = XMFLOAT3{ 0.0f,  0.0f, -1.0f };
-	constexpr auto left_normal = XMFLOAT3{ -1.0f, 0.0f, 0.0f }, right_normal = XMFLOAT3{ 1.0f,  0.0f,  0.0f };
-	constexpr auto top_normal = XMFLOAT3{ 0.0f, 1.0f, 0.0f }, bottom_normal = XMFLOAT3{ 0.0f, -1.0f,  0.0f };
-
-	const auto cube_base = mesh{
-		// Vertex List
-		{
-			// Front
-			{ { -1.0f, -1.0f, +1.0f }, front_normal, { 0.0f, 0.0f } },
-			{ { +1.0f, -1.0f, +1.0f }, front_normal, { 1.0f, 0.0f } },
-			{ { +1.0f, +1.0f, +1.0f }, front_normal, { 1.0f, 1.0f } },
-			{ { -1.0f, +1.0f, +1.0f }, front_normal, { 0.0f, 1.0f } },
-
-			// Bottom
-			{ { -1.0f, -1.0f, -1.0f }, bottom_normal, { 0.0f, 0.0f } },
-			{ { +1.0f, -1.0f, -1.0f }, bottom_normal, { 1.0f, 0.0f } },
-			{ { +1.0f, -1.0f, +1.0f }, bottom_normal, { 1.0f, 1.0f } },
-			{ { -1.0f, -1.0f, +1.0f }, bottom_normal, { 0.0f, 1.0f } },
-
-			// right
-			{ { +1.0f, -1.0f, -1.0f }, right_normal, { 0.0f, 0.0f } },
-			{ { +1.0f, +1.0f, -1.0f }, right_normal, { 1.0f, 0.0f } },
-			{ { +1.0f, +1.0f, +1.0f }, right_normal, { 1.0f, 1.0f } },
-			{ { +1.0f, -1.0f, +1.0f }, right_normal, { 0.0f, 1.0f } },
-
-			// left
-			{ { -1.0f, -1.0f, -1.0f }, left_normal, { 0.0f, 0.0f } },
-			{ { -1.0f, -1.0f, +1.0f }, left_normal, { 1.0f, 0.0f } },
-			{ { -1.0f, +1.0f, +1.0f }, left_normal, { 1.0f, 1.0f } },
-			{ { -1.0f, +1.0f, -1.0f }, left_normal, { 0.0f, 1.0f } },
-
-			// Back
-			{ { -1.0f, -1.0f, -1.0f }, back_normal, { 0.0f, 0.0f } },
-			{ { -1.0f, +1.0f, -1.0f }, back_normal, { 1.0f, 0.0f } },
-			{ { +1.0f, +1.0f, -1.0f }, back_normal, { 1.0f, 1.0f } },
-			{ { +1.0f, -1.0f, -1.0f }, back_normal, { 0.0f, 1.0f } },
-
-			// Top
-			{ { -1.0f, +1.0f, -1.0f }, top_normal, { 0.0f, 0.0f } },
-			{ { -1.0f, +1.0f, +1.0f }, top_normal, { 1.0f, 0.0f } },
-			{ { +1.0f, +1.0f, +1.0f }, top_normal, { 1.0f, 1.0f } },
-			{ { +1.0f, +1.0f, -1.0f }, top_normal, { 0.0f, 1.0f } },
-		},
-
-		// Index List
-		{
-			// Front
-			0, 1, 2, 0, 2, 3,
-			// Bottom
-			4, 5, 6, 4, 6, 7,
-			// Right
-			8, 9, 10, 8, 10, 11,
-			// Left
-			12, 13, 14, 12, 14, 15,
-			// Back
-			16, 17, 18, 16, 18, 19,
-			// Top
-			20, 21, 22, 20, 22, 23,
-		}
-	};
+	constexpr auto cube_base = primitives::cube<vertex>();
 
 	using bs = pipeline_state::blend_type;
 	using ds = pipeline_state::depth_stencil_type;
@@ -105,92 +52,6 @@ namespace
 	using slot = shader_slot;
 	using stage = shader_stage;
 
-	auto spherify_and_invert(const mesh &cube, uint32_t subdivide_count) -> mesh
-	{
-		auto divide_edge = [](vertex v0, vertex v1) -> vertex
-		{
-			auto mp = vertex{};
-			mp.position = XMFLOAT3{
-				0.5f * (v0.position.x + v1.position.x),
-				0.5f * (v0.position.y + v1.position.y),
-				0.5f * (v0.position.z + v1.position.z),
-			};
-			mp.normal = v0.normal;
-			mp.texcoord = XMFLOAT2{
-				0.5f * (v0.texcoord.x + v1.texcoord.x),
-				0.5f * (v0.texcoord.y + v1.texcoord.y),
-			};
-
-			return mp;
-		};
-
-		auto sub_divide_triangle = [&](const vertex &v0, const vertex &v1, const vertex &v2, const uint32_t index) -> mesh
-		{
-			auto m0 = divide_edge(v0, v1),
-				m1 = divide_edge(v1, v2),
-				m2 = divide_edge(v2, v0);
-
-			return mesh
-			{
-				{ v0, m0, v1, m1, v2, m2 },
-				{
-					index + 0, index + 1, index + 5,
-					index + 1, index + 2, index + 3,
-					index + 3, index + 4, index + 5,
-					index + 1, index + 3, index + 5,
-				}
-			};
-		};
-
-		auto sub_divide_mesh = [&](const mesh &shape) -> mesh
-		{
-			auto result_mesh = mesh{};
-			auto &vertices = result_mesh.vertices;
-			auto &indicies = result_mesh.indicies;
-
-			auto number_of_triangles = shape.indicies.size() / 3u;
-			for (size_t i = 0; i < number_of_triangles; i++)
-			{
-				auto triangle = sub_divide_triangle(shape.vertices[shape.indicies[i * 3]],
-				                                    shape.vertices[shape.indicies[i * 3 + 1]],
-				                                    shape.vertices[shape.indicies[i * 3 + 2]],
-				                                    static_cast<uint32_t>(i) * 6);
-
-				vertices.insert(vertices.end(), triangle.vertices.begin(), triangle.vertices.end());
-				indicies.insert(indicies.end(), triangle.indicies.begin(), triangle.indicies.end());
-			}
-
-			return result_mesh;
-		};
-
-		auto result_mesh = mesh{};
-
-		for (uint16_t i = 0; i < subdivide_count; i++)
-		{
-			auto &msh = (i == 0) ? cube : result_mesh;
-
-			result_mesh = sub_divide_mesh(msh);
-		}
-
-		result_mesh.vertices.shrink_to_fit();
-		result_mesh.indicies.shrink_to_fit();
-
-		for (auto &v : result_mesh.vertices)
-		{
-			auto n = XMLoadFloat3(&v.normal);
-			n = -1.0f * n;
-			XMStoreFloat3(&v.normal, n);
-
-			auto p = XMLoadFloat3(&v.position);
-			p = XMVector3Normalize(p);
-			XMStoreFloat3(&v.position, p);
-		}
-
-
-
-		return result_mesh;
-	}
-
 	enum ps_ids
 	{
 		ps_default,
@@ -223,23 +84,25 @@ namespace
 		sr_text,
 		sr_cube,
 		sr_sky,
+		sr_irradiance,
+		sr_specular,
 	};
 
-	auto list_of_files_to_load = std::array{
-		L"vertex_shader.cso"sv,
-		L"pixel_shader.cso"sv,
-		L"lighting.ps.cso"sv,
-		L"screen_space_text.vs.cso"sv,
-		L"cube_instances.vs.cso"sv,
-		L"sky_dome.vs.cso"sv,
-		L"sky_dome.ps.cso"sv,
-		L"uv_grid.dds"sv,
-		L"left.dds"sv,
-		L"right.dds"sv,
-		L"top.dds"sv,
-		L"bottom.dds"sv,
-		L"back.dds"sv,
-		L"front.dds"sv,
+	constexpr auto asset_pack_file = L"loading_screen.pak"sv;
+
+	constexpr auto list_of_files_to_load = std::array{
+		"vertex_shader.cso"sv,
+		"pixel_shader.cso"sv,
+		"lighting.ps.cso"sv,
+		"screen_space_text.vs.cso"sv,
+		"cube_instances.vs.cso"sv,
+		"sky_dome.vs.cso"sv,
+		"sky_dome.ps.cso"sv,
+		"uv_grid.dds"sv,
+		"sky.dds"sv,
+		"sky_dome.mesh"sv,
+		"sky_irradiance.dds"sv,
+		"sky_specular.dds"sv,
 	};
 
 	enum file_list
@@ -252,13 +115,56 @@ namespace
 		sky_vso,
 		sky_pso,
 		uv_tex,
-		left_tex,
-		right_tex,
-		top_tex,
-		bottom_tex,
-		back_tex,
-		front_tex,
+		sky_tex,
+		sky_mesh,
+		irradiance_tex,
+		specular_tex,
 	};
+
+	// Load graph nodes reading files are named after them
+	auto file_inputs(const std::vector<file_list> &files) -> std::vector<std::string>
+	{
+		auto names = std::vector<std::string>{};
+		for (auto file : files)
+		{
+			names.emplace_back(list_of_files_to_load[file]);
+		}
+		return names;
+	}
+
+	// An object made from pack files, counted in the progress by their unpacked size
+	void add_object(load_graph &loads, load_progress &progress, const asset_pack &assets,
+	                std::string_view name, const std::vector<file_list> &files, load_graph::node_fn make)
+	{
+		auto bytes = uint64_t{};
+		for (auto file : files)
+		{
+			auto idx = assets.find(list_of_files_to_load[file]);
+			assert(idx.has_value());
+			bytes += assets.entry_size(*idx);
+		}
+
+		progress.expect(load_stage::create, bytes);
+		loads.add(name, file_inputs(files), [&progress, bytes, make = std::move(make)]
+		{
+			progress.measure(load_stage::create, bytes, make);
+		});
+	}
+
+	// How long loading took and the chain of nodes that kept it from being shorter
+	auto describe_startup(const load_graph &loads) -> std::wstring
+	{
+		using ms = std::chrono::duration<double, std::milli>;
+
+		auto path = std::wstring{};
+		for (auto id : loads.critical_path())
+		{
+			auto name = loads.node_name(id);
+			path += fmt::format(L"{}{} {:.0f} ms", path.empty() ? L"" : L" > ",
+			                    std::wstring(name.begin(), name.end()), ms(loads.node_time(id)).count());
+		}
+		return fmt::format(L"Loaded in {:.0f} ms: {}", ms(loads.elapsed()).count(), path);
+	}
 }
 
 loading_screen::loading_screen(HWND hwnd) :
@@ -268,17 +174,41 @@ loading_screen::loading_screen(HWND hwnd) :
 	d2d = std::make_unique<direct2d1>(d3d->get_dxgi_device());
 	rp = std::make_unique<render_pass>(d3d->get_device(), d3d->get_swapchain());
 
+	progress = std::make_unique<load_progress>();
+	loads = std::make_unique<load_graph>();
 	load_files();
 	create_pipeline_state_object();
 	create_mesh_buffers();
 	create_contant_buffers();
 	create_shader_resources();
+
+	// Nothing to make, it's done once what the load status is drawn with is
+	load_status_node = loads->add("load status", { "text pipeline", "text mesh", "orthographic cb", "text transform cb", "text texture" }, []
+	{
+	});
+	// A graph that can't start never finishes, stop here rather than sit on the loading screen forever
+	if (auto error = loads->start(job_system::shared()); error)
+	{
+		auto message = fmt::format("Load graph can't start, {}\n", describe(*error));
+		::OutputDebugStringA(message.c_str());
+		throw std::runtime_error(message);
+	}
 }
 
-loading_screen::~loading_screen() = default;
+loading_screen::~loading_screen()
+{
+	// Nodes still loading write into members
+	loads.reset();
+}
 
 auto loading_screen::on_resize(uintptr_t wParam, uintptr_t lParam) -> bool
 {
+	// Loading makes the objects remade here
+	if (loads != nullptr)
+	{
+		loads->wait();
+	}
+
 	rp.reset(nullptr);
 
 	d3d->resize();
@@ -298,21 +228,20 @@ auto loading_screen::exit() const -> bool
 
 void loading_screen::update(const game_clock &clk, const raw_input &input)
 {
-	auto all_good = true;
-	for (auto &f : object_futures)
-	{
-		all_good = all_good 
-		       and (f._Is_ready());
-	}
-	if (all_good
+	if (loads != nullptr
 		and
-		not object_futures.empty())
+		loads->is_done())
 	{
-		object_futures.clear();
+		startup_text = describe_startup(*loads);
+		::OutputDebugStringA(("Load time breakdown\n" + progress->breakdown()).c_str());
+		loads.reset();
+		progress.reset();
 		files_loaded.clear();
+		unpacked_files.clear();
+		assets.reset();
 	}
 
-	if (all_good)
+	if (loads == nullptr)
 	{
 		input_update(clk, input);
 		cube_update(clk);
@@ -332,7 +261,7 @@ void loading_screen::render()
 	rp->activate(context);
 	rp->clear(context, clear_color);
 
-	if (not object_futures.empty())
+	if (loads != nullptr)
 	{
 		draw_load_status();
 	}
@@ -353,18 +282,40 @@ void loading_screen::render()
 
 void loading_screen::load_files()
 {
-	files_loaded.resize(list_of_files_to_load.size());
+	// One open and map for all the files, uncompressed entries are used in place
+	assets = std::make_unique<asset_pack>(asset_pack_file);
+	assert(assets->is_valid());
 
-	auto load_file_async = [&](uint16_t idx, std::wstring_view file_name)
+	unpacked_files.resize(list_of_files_to_load.size());
+	files_loaded.resize(list_of_files_to_load.size());
+	for (auto i = 0u; i < list_of_files_to_load.size(); i++)
 	{
-		files_loaded[idx] = load_binary_file(file_name);
-		return true;
-	};
+		auto idx = assets->find(list_of_files_to_load[i]);
+		assert(idx.has_value());
+		auto stored_size = assets->entry_stored_size(*idx),
+		     size = assets->entry_size(*idx);
+		auto compressed = assets->entry_codec(*idx) != pack_codec::none;
 
-	for (auto &&[i, filename] : list_of_files_to_load | iter::enumerate)
-	{
-		object_futures.emplace_back(
-			std::async(std::launch::async, load_file_async, static_cast<uint16_t>(i), filename));
+		// A compressed entry is read as it's unpacked, so its time is all decode
+		progress->expect(load_stage::read, stored_size);
+		if (compressed)
+		{
+			progress->expect(load_stage::decode, size);
+		}
+
+		loads->add(list_of_files_to_load[i], {}, [&, i, stored_size, size, compressed]
+		{
+			progress->measure(compressed ? load_stage::decode : load_stage::read, compressed ? size : stored_size, [&]
+			{
+				auto data = assets->load(list_of_files_to_load[i], unpacked_files[i]);
+				assert(data.has_value());
+				files_loaded[i] = *data;
+			});
+			if (compressed)
+			{
+				progress->add(load_stage::read, stored_size, {});
+			}
+		});
 	}
 }
 
@@ -372,45 +323,30 @@ void loading_screen::create_pipeline_state_object()
 {
 	pipeline_states.resize(5);
 
-	make_text_ps();
-
-	object_futures.emplace_back(
-		std::async(std::launch::async, [&]
+	add_object(*loads, *progress, *assets, "default pipeline", { basic_vso, basic_pso }, [&]
 	{
 		make_default_ps();
-		return true;
-	}));
-	object_futures.emplace_back(
-		std::async(std::launch::async, [&]
+	});
+	add_object(*loads, *progress, *assets, "text pipeline", { text_vso, basic_pso }, [&]
+	{
+		make_text_ps();
+	});
+	add_object(*loads, *progress, *assets, "light pipeline", { basic_vso, light_pso }, [&]
 	{
 		make_light_ps();
-		return true;
-	}));
-	object_futures.emplace_back(
-		std::async(std::launch::async, [&]
+	});
+	add_object(*loads, *progress, *assets, "instancing pipeline", { instance_vso, basic_pso }, [&]
 	{
 		make_cube_instance_ps();
-		return true;
-	}));
-	object_futures.emplace_back(
-		std::async(std::launch::async, [&]
+	});
+	add_object(*loads, *progress, *assets, "sky pipeline", { sky_vso, sky_pso }, [&]
 	{
 		make_sky_dome_ps();
-		return true;
-	}));
+	});
 }
 
 void loading_screen::make_default_ps()
 {
-	if (not object_futures[basic_vso]._Is_ready())
-	{
-		object_futures[basic_vso].wait();
-	}
-	if (not object_futures[basic_pso]._Is_ready())
-	{
-		object_futures[basic_pso].wait();
-	}
-
 	auto device = d3d->get_device();
 	auto &vso = files_loaded[basic_vso], //load_binary_file(L"vertex_shader.cso"),
 	     &pso = files_loaded[basic_pso]; //load_binary_file(L"pixel_shader.cso");
@@ -431,15 +367,6 @@ void loading_screen::make_default_ps()
 
 void loading_screen::make_light_ps()
 {
-	if (not object_futures[basic_vso]._Is_ready())
-	{
-		object_futures[basic_vso].wait();
-	}
-	if (not object_futures[light_pso]._Is_ready())
-	{
-		object_futures[light_pso].wait();
-	}
-
 	auto device = d3d->get_device();
 	auto &vso = files_loaded[basic_vso], // load_binary_file(L"vertex_shader.cso"),
 	     &pso = files_loaded[light_pso]; // load_binary_file(L"lighting.ps.cso");
@@ -461,15 +388,6 @@ void loading_screen::make_light_ps()
 
 void loading_screen::make_text_ps()
 {
-	if (not object_futures[text_vso]._Is_ready())
-	{
-		object_futures[text_vso].wait();
-	}
-	if (not object_futures[basic_pso]._Is_ready())
-	{
-		object_futures[basic_pso].wait();
-	}
-
 	auto device = d3d->get_device();
 	auto &vso = files_loaded[text_vso], // load_binary_file(L"screen_space_text.vs.cso"),
 		&pso = files_loaded[basic_pso]; // load_binary_file(L"pixel_shader.cso");
@@ -490,15 +408,6 @@ void loading_screen::make_text_ps()
 
 void loading_screen::make_cube_instance_ps()
 {
-	if (not object_futures[instance_vso]._Is_ready())
-	{
-		object_futures[instance_vso].wait();
-	}
-	if (not object_futures[basic_pso]._Is_ready())
-	{
-		object_futures[basic_pso].wait();
-	}
-
 	auto device = d3d->get_device();
 	auto &vso = files_loaded[instance_vso], // load_binary_file(L"cube_instances.vs.cso"),
 	     &pso = files_loaded[basic_pso]; // load_binary_file(L"pixel_shader.cso");
@@ -519,15 +428,6 @@ void loading_screen::make_cube_instance_ps()
 
 void loading_screen::make_sky_dome_ps()
 {
-	if (not object_futures[sky_vso]._Is_ready())
-	{
-		object_futures[sky_vso].wait();
-	}
-	if (not object_futures[sky_pso]._Is_ready())
-	{
-		object_futures[sky_pso].wait();
-	}
-
 	auto device = d3d->get_device();
 	auto &vso = files_loaded[sky_vso], // load_binary_file(L"sky_dome.vs.cso"),
 		&pso = files_loaded[sky_pso]; // load_binary_file(L"sky_dome.ps.cso");
@@ -536,7 +436,7 @@ void loading_screen::make_sky_dome_ps()
 	{
 		bs::opaque,
 		ds::read_write,
-		rs::cull_clockwise,
+		rs::cull_anti_clockwise,
 		ss::anisotropic_clamp,
 		vertex_elements,
 		vso,
@@ -551,49 +451,37 @@ void loading_screen::create_mesh_buffers()
 {
 	mesh_buffers.resize(4);
 
-	make_text_mesh();
-
-	object_futures.emplace_back(
-		std::async(std::launch::async, [&]
+	add_object(*loads, *progress, *assets, "text mesh", {}, [&]
+	{
+		make_text_mesh();
+	});
+	add_object(*loads, *progress, *assets, "cube mesh", {}, [&]
 	{
 		make_cube_mesh();
-		return true;
-	}));
-	object_futures.emplace_back(
-		std::async(std::launch::async, [&]
+	});
+	add_object(*loads, *progress, *assets, "cube instance mesh", {}, [&]
 	{
 		make_cube_instance_mesh();
-		return true;
-	}));
-	object_futures.emplace_back(
-		std::async(std::launch::async, [&]
+	});
+	add_object(*loads, *progress, *assets, "sky mesh", { sky_mesh }, [&]
 	{
 		make_sky_dome_mesh();
-		return true;
-	}));
+	});
 }
 
 void loading_screen::make_cube_mesh()
 {
 	auto device = d3d->get_device();
-	auto cube_mesh = spherify_and_invert(cube_base, 2);
+	auto cube_mesh = make_sphere_mesh<mesh>({ sphere_topology::cube, 2 });
 	mesh_buffers[mb_cube] = std::make_unique<mesh_buffer>(device, cube_mesh);
 }
 
 void loading_screen::make_cube_instance_mesh()
 {
 	auto device = d3d->get_device();
-	auto l = 1.0f,
-		w = 1.0f,
-		h = 1.0f;
-
-	auto front_normal = XMFLOAT3{ 0.0f, 0.0f, 1.0f }, back_normal = XMFLOAT3{ 0.0f,  0.0f, -1.0f },
-		left_normal = XMFLOAT3{ -1.0f, 0.0f, 0.0f }, right_normal = XMFLOAT3{ 1.0f,  0.0f,  0.0f },
-		top_normal = XMFLOAT3{ 0.0f, 1.0f, 0.0f }, bottom_normal = XMFLOAT3{ 0.0f, -1.0f,  0.0f };
-
 	auto cube_mesh = instanced_mesh{
-		cube_base.vertices, 
-		cube_base.indicies
+		{ cube_base.vertices.begin(), cube_base.vertices.end() },
+		{ cube_base.indicies.begin(), cube_base.indicies.end() }
 	};
 
 	cube_mesh.instance_transforms.resize(100);
@@ -614,66 +502,51 @@ void loading_screen::make_cube_instance_mesh()
 void loading_screen::make_text_mesh()
 {
 	auto device = d3d->get_device();
-	auto [width, height] = get_window_size(hWnd);
-	auto l = width / 2.0f,
-	     w = height / 2.0f;
-	auto rect_mesh = mesh{
-		// Vertex List
-		{
-			{ { -l, +w, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f } },
-			{ { +l, +w, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 1.0f, 0.0f } },
-			{ { +l, -w, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f } },
-			{ { -l, -w, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 1.0f } },
-		},
+	constexpr auto text_quad = primitives::quad<vertex>();
 
-		// Index List
-		{
-			0, 1, 2,
-			0, 2, 3
-		}
-	};
-
-	mesh_buffers[mb_text] = std::make_unique<mesh_buffer>(device, rect_mesh);
+	mesh_buffers[mb_text] = std::make_unique<mesh_buffer>(device, mesh_view{ text_quad.vertices, text_quad.indicies });
 }
 
 void loading_screen::make_sky_dome_mesh()
 {
 	auto device = d3d->get_device();
-	auto dome = spherify_and_invert(cube_base, 2);
-	mesh_buffers[mb_sky] = std::make_unique<mesh_buffer>(device, dome);
+	// Baked by Tools.Asset_Cook, vertices are already in gpu_datatypes vertex layout
+	static_assert(sizeof(vertex) == sizeof(cooked_vertex_full));
+	auto dome = read_cooked_mesh(files_loaded[sky_mesh]);
+	assert(dome.has_value() and dome->format == cooked_vertex_format::p32n32t32);
+
+	auto dome_vertices = std::span(reinterpret_cast<const vertex *>(dome->vertices.data()), dome->vertices.size() / sizeof(vertex));
+	mesh_buffers[mb_sky] = std::make_unique<mesh_buffer>(device, mesh_view{ dome_vertices, dome->indicies });
 }
 
 void loading_screen::create_contant_buffers()
 {
 	constant_buffers.resize(6);
 
-	make_orthographic_cb();
-	make_text_transform_cb();
-
-	object_futures.emplace_back(
-		std::async(std::launch::async, [&]
+	add_object(*loads, *progress, *assets, "prespective cb", {}, [&]
 	{
 		make_prespective_cb();
-		return true;
-	}));
-	object_futures.emplace_back(
-		std::async(std::launch::async, [&]
+	});
+	add_object(*loads, *progress, *assets, "orthographic cb", {}, [&]
+	{
+		make_orthographic_cb();
+	});
+	add_object(*loads, *progress, *assets, "view cb", {}, [&]
 	{
 		make_view_cb();
-		return true;
-	}));
-	object_futures.emplace_back(
-		std::async(std::launch::async, [&]
+	});
+	add_object(*loads, *progress, *assets, "cube transform cb", {}, [&]
 	{
 		make_cube_transform_cb();
-		return true;
-	}));
-	object_futures.emplace_back(
-		std::async(std::launch::async, [&]
+	});
+	add_object(*loads, *progress, *assets, "text transform cb", {}, [&]
+	{
+		make_text_transform_cb();
+	});
+	add_object(*loads, *progress, *assets, "light cb", {}, [&]
 	{
 		make_light_data_cb();
-		return true;
-	}));
+	});
 }
 
 void loading_screen::make_prespective_cb()
@@ -694,10 +567,10 @@ void loading_screen::make_prespective_cb()
 void loading_screen::make_orthographic_cb()
 {
 	auto device = d3d->get_device();
-	auto [width, height] = get_window_size(hWnd);
 
 	auto projection = matrix{};
-	projection.data = XMMatrixOrthographicLH(width, height, -1.0f, 1.0f);
+	// text quad spans -1 to +1, so it covers the whole window
+	projection.data = XMMatrixOrthographicLH(2.0f, 2.0f, -1.0f, 1.0f);
 	projection.data = XMMatrixTranspose(projection.data);
 	constant_buffers[cb_orthographic] = std::make_unique<constant_buffer>(device, stage::vertex, slot::projection, projection);
 }
@@ -739,40 +612,39 @@ void loading_screen::make_light_data_cb()
 	auto device = d3d->get_device();
 
 	auto light_data = light{};
-	light_data.diffuse = { 0.0f, 0.0f, 1.0f, 1.0f };
-	light_data.ambient = { 0.0f, 1.0f, 0.0f, 1.0f };
-	light_data.light_pos = { 0.0f, 3.0f, 5.0f };
-	light_data.specular_power = 32.0f;
-	light_data.specular = { 1.0f, 0.0f, 0.0f, 1.0f };
+	light_data.specular = { 0.04f, 0.04f, 0.04f, 1.0f };
+	light_data.roughness = 0.4f;
 	constant_buffers[cb_light] = std::make_unique<constant_buffer>(device, stage::pixel, slot::light, light_data);
 }
 
 void loading_screen::create_shader_resources()
 {
-	shader_resources.resize(3);
-
-	make_text_texture();
+	shader_resources.resize(5);
 
-	object_futures.emplace_back(
-		std::async(std::launch::async, [&]
+	add_object(*loads, *progress, *assets, "text texture", {}, [&]
+	{
+		make_text_texture();
+	});
+	add_object(*loads, *progress, *assets, "cube texture", { uv_tex }, [&]
 	{
 		make_cube_texture();
-		return true;
-	}));
-	object_futures.emplace_back(
-		std::async(std::launch::async, [&]
+	});
+	add_object(*loads, *progress, *assets, "sky texture", { sky_tex }, [&]
 	{
 		make_sky_dome_texture();
-		return true;
-	}));
+	});
+	add_object(*loads, *progress, *assets, "irradiance texture", { irradiance_tex }, [&]
+	{
+		make_irradiance_texture();
+	});
+	add_object(*loads, *progress, *assets, "specular texture", { specular_tex }, [&]
+	{
+		make_specular_texture();
+	});
 }
 
 void loading_screen::make_cube_texture()
 {
-	if (not object_futures[uv_tex]._Is_ready())
-	{
-		object_futures[uv_tex].wait();
-	}
 
 	auto &tex = files_loaded[uv_tex]; // load_binary_file(L"uv_grid.dds");
 
@@ -808,31 +680,32 @@ void loading_screen::make_text_texture()
 
 void loading_screen::make_sky_dome_texture()
 {
-	auto textures = std::vector<std::vector<uint8_t>>{};
+	// Six faces and their mips were put in one cube dds by Tools.Asset_Cook
+	auto device = d3d->get_device();
 
-	auto copy_loaded_file = [&](uint16_t file_idx)
-	{
-		if (not object_futures[file_idx]._Is_ready())
-		{
-			object_futures[file_idx].wait();
-		}
+	shader_resources[sr_sky] = std::make_unique<shader_resource>(device,
+	                                                shader_stage::pixel, shader_slot::texture,
+	                                                files_loaded[sky_tex]);
+}
 
-		textures.push_back(files_loaded[file_idx]);
-	};
+void loading_screen::make_irradiance_texture()
+{
+	// Sky convolved for diffuse lighting at build time, one sample per pixel instead of a loop over lights
+	auto device = d3d->get_device();
 
-	
-	copy_loaded_file(left_tex);
-	copy_loaded_file(right_tex);
-	copy_loaded_file(top_tex);
-	copy_loaded_file(bottom_tex);
-	copy_loaded_file(back_tex);
-	copy_loaded_file(front_tex);
+	shader_resources[sr_irradiance] = std::make_unique<shader_resource>(device,
+	                                                       shader_stage::pixel, shader_slot::irradiance,
+	                                                       files_loaded[irradiance_tex]);
+}
 
+void loading_screen::make_specular_texture()
+{
+	// Sky prefiltered for GGX at build time, a mip per roughness
 	auto device = d3d->get_device();
 
-	shader_resources[sr_sky] = std::make_unique<shader_resource>(device,
-	                                                shader_stage::pixel, shader_slot::texture,
-	                                                textures);
+	shader_resources[sr_specular] = std::make_unique<shader_resource>(device,
+	                                                     shader_stage::pixel, shader_slot::specular,
+	                                                     files_loaded[specular_tex]);
 }
 
 void loading_screen::input_update(const game_clock &clk, const raw_input &input)
@@ -912,7 +785,7 @@ void loading_screen::text_update(const game_clock &clk)
 	frame_count = 0;
 	total_time = 0.0;
 
-	auto fps_text = fmt::format(L"FPS: {:.2f}\nAngle: {:06.2f}", fps, cube_angle);
+	auto fps_text = fmt::format(L"FPS: {:.2f}\nAngle: {:06.2f}\n{}", fps, cube_angle, startup_text);
 
 	auto format = d2d->make_text_format(L"Consolas", 12.0f);
 	auto brush = d2d->make_solid_color_brush(D2D1::ColorF(D2D1::ColorF::Yellow));
@@ -953,6 +826,8 @@ void loading_screen::draw_cube()
 	constant_buffers[cb_light]->activate(context);
 	constant_buffers[cb_cube]->activate(context);
 	shader_resources[sr_cube]->activate(context);
+	shader_resources[sr_irradiance]->activate(context);
+	shader_resources[sr_specular]->activate(context);
 	mesh_buffers[mb_cube]->activate(context);
 
 	mesh_buffers[mb_cube]->draw(context);
@@ -994,34 +869,33 @@ void loading_screen::draw_sky()
 
 void loading_screen::update_load_status()
 {
-	auto loaded_items = std::count_if(pipeline_states.begin(), pipeline_states.end(),
-								  [](const std::unique_ptr<pipeline_state> &ptr)
-	{
-		return ptr != nullptr;
-	});
-	loaded_items += std::count_if(constant_buffers.begin(), constant_buffers.end(),
-								  [](const std::unique_ptr<constant_buffer> &ptr)
+	if (not loads->is_done(load_status_node))
 	{
-		return ptr != nullptr;
-	});
-	loaded_items += std::count_if(mesh_buffers.begin(), mesh_buffers.end(),
-								  [](const std::unique_ptr<mesh_buffer> &ptr)
-	{
-		return ptr != nullptr;
-	});
-	loaded_items += std::count_if(shader_resources.begin(), shader_resources.end(),
-								  [](const std::unique_ptr<shader_resource> &ptr)
+		return;
+	}
+
+	auto status = progress->snapshot();
+	auto &objects = status.stages[static_cast<uint32_t>(load_stage::create)];
+	auto bytes_done = uint64_t{}, bytes_expected = uint64_t{};
+	for (auto &stage : status.stages)
 	{
-		return ptr != nullptr;
-	});
-	loaded_items += std::count_if(files_loaded.begin(), files_loaded.end(),
-								  [](const std::vector<uint8_t> &ptr)
+		bytes_done += stage.bytes_done;
+		bytes_expected += stage.bytes_expected;
+	}
+	auto remaining = status.remaining ? fmt::format(L", about {:.1f} s left", std::chrono::duration<double>(*status.remaining).count())
+	                                  : std::wstring{};
+	auto text = fmt::format(L"Loading: {:.0f}%{}\n{:.1f} of {:.1f} MiB, {} of {} objects",
+	                        status.fraction * 100.0, remaining,
+	                        bytes_done / (1024.0 * 1024.0), bytes_expected / (1024.0 * 1024.0),
+	                        objects.items_done, objects.items_expected);
+
+	// Drawn again only when it reads differently
+	if (text == load_status_text)
 	{
-		return not ptr.empty();
-	});
-	loaded_items -= 5;
+		return;
+	}
+	load_status_text = text;
 
-	auto text = fmt::format(L"Loaded: {} of {}", loaded_items, object_futures.size());
 	auto [width, height] = get_window_size(hWnd);
 	auto format = d2d->make_text_format(L"Consolas", 20.0f);
 	auto brush = d2d->make_solid_color_brush(D2D1::ColorF(D2D1::ColorF::Yellow));
@@ -1036,6 +910,11 @@ void loading_screen::update_load_status()
 
 void loading_screen::draw_load_status()
 {
+	if (not loads->is_done(load_status_node))
+	{
+		return;
+	}
+
 	auto context = d3d->get_context();
 	constant_buffers[cb_orthographic]->activate(context);
 	draw_text();
@@ -1,9 +1,13 @@
 #pragma once
 
+#include "load_graph.h"
+
 #include <Windows.h>
 #include <memory>
 #include <vector>
-#include <future>
+#include <span>
+#include <cstddef>
+#include <string>
 
 namespace dx11_lessons
 {
@@ -17,6 +21,8 @@ namespace dx11_lessons
 	class mesh_buffer;
 	class constant_buffer;
 	class shader_resource;
+	class asset_pack;
+	class load_progress;
 
 	class loading_screen
 	{
@@ -59,6 +65,8 @@ namespace dx11_lessons
 		void make_cube_texture();
 		void make_text_texture();
 		void make_sky_dome_texture();
+		void make_irradiance_texture();
+		void make_specular_texture();
 
 		void input_update(const game_clock &clk, const raw_input &input);
 		void cube_update(const game_clock &clk);
@@ -91,7 +99,14 @@ namespace dx11_lessons
 		
 		float cube_angle{};
 
-		std::vector<std::future<bool>> object_futures;
-		std::vector<std::vector<uint8_t>> files_loaded;
+		// Everything loading makes, and what from, and how far along it is. Released once it's all done.
+		std::unique_ptr<load_progress> progress{};
+		std::unique_ptr<load_graph> loads{};
+		load_graph::node_id load_status_node{};
+		std::wstring load_status_text{};
+		std::wstring startup_text{};
+		std::unique_ptr<asset_pack> assets;
+		std::vector<std::span<const std::byte>> files_loaded;
+		std::vector<std::vector<std::byte>> unpacked_files;
 	};
 }
\ No newline at end of file
@@ -213,7 +213,7 @@ void pipeline_state::create_sampler_state(device_t device, sampler_type sampler)
 	assert(SUCCEEDED(hr));
 }
 
-void pipeline_state::create_input_layout(device_t device, const std::vector<input_element_type> &element_layout, const std::vector<byte> &vso)
+void pipeline_state::create_input_layout(device_t device, const std::vector<input_element_type> &element_layout, std::span<const std::byte> vso)
 {
 	constexpr auto position  = D3D11_INPUT_ELEMENT_DESC{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT,    0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 };
 	constexpr auto normal    = D3D11_INPUT_ELEMENT_DESC{ "NORMAL",   0, DXGI_FORMAT_R32G32B32_FLOAT,    0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 };
@@ -258,7 +258,7 @@ void pipeline_state::create_input_layout(device_t device, const std::vector<inpu
 	assert(SUCCEEDED(hr));
 }
 
-void pipeline_state::create_vertex_shader(device_t device, const std::vector<uint8_t> & vso)
+void pipeline_state::create_vertex_shader(device_t device, std::span<const std::byte> vso)
 {
 	auto hr = device->CreateVertexShader(vso.data(),
 	                                     vso.size(),
@@ -267,7 +267,7 @@ void pipeline_state::create_vertex_shader(device_t device, const std::vector<uin
 	assert(SUCCEEDED(hr));
 }
 
-void pipeline_state::create_pixel_shader(device_t device, const std::vector<uint8_t> & pso)
+void pipeline_state::create_pixel_shader(device_t device, std::span<const std::byte> pso)
 {
 	auto hr = device->CreatePixelShader(pso.data(),
 	                                    pso.size(),
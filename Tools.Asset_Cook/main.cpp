@@ -0,0 +1,1151 @@
+#include "obj_mtl_parser.h"
+#include "mesh_welding.h"
+#include "mesh_optimizer.h"
+#include "mesh_analysis.h"
+#include "procedural_sphere.h"
+#include "cooked_mesh.h"
+#include "dds_file.h"
+#include "image_decoder.h"
+#include "mip_generator.h"
+#include "block_compression.h"
+#include "ibl_prefilter.h"
+#include "texture_packer.h"
+#include "derived_data_cache.h"
+#include "helpers.h"
+
+#include <fmt/core.h>
+#include <array>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <utility>
+#include <charconv>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <tuple>
+#include <cassert>
+
+using namespace dx11_lessons;
+using namespace std::string_view_literals;
+namespace fs = std::filesystem;
+
+namespace
+{
+	using arguments = std::vector<std::string_view>;
+	using cook_cache = std::optional<derived_data_cache>;
+	using command_fn = auto (*)(const arguments &, cook_cache &) -> int;
+
+	// Exit codes
+	constexpr auto cook_ok = 0,
+	               cook_write_failed = 1,
+	               cook_bad_input = 2;
+
+	auto write_file(const fs::path &path, std::span<const std::byte> data) -> bool
+	{
+		auto file = std::ofstream(path, std::ios::out | std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+		return file.good();
+	}
+
+	auto finish(const fs::path &path, std::span<const std::byte> data) -> int
+	{
+		if (not write_file(path, data))
+		{
+			fmt::print(stderr, "{}: could not write\n", path.string());
+			return cook_write_failed;
+		}
+		return cook_ok;
+	}
+
+	// Part of every cache key, bump it when a cook writes different bytes for the same inputs and settings
+	constexpr auto cooker_version = uint64_t{ 2 };
+
+	using dependency_list = std::vector<fs::path>;
+	using cook_output = std::optional<std::vector<std::byte>>;   // nullopt on bad input, after printing why
+
+	struct cook_job
+	{
+		std::string settings;          // everything besides input bytes that changes the output
+		std::vector<fs::path> inputs;
+		fs::path output;
+	};
+
+	// Dependencies are relative to the first input's directory, that's where OBJ files look for them
+	auto dependency_key(uint64_t input_key, std::span<const fs::path> dependencies, const fs::path &base) -> uint64_t
+	{
+		auto hasher = content_hasher{};
+		hasher.add(input_key);
+		for (auto &dependency : dependencies)
+		{
+			auto path = base / dependency;
+			hasher.add(dependency.generic_string());
+			if (fs::is_regular_file(path))
+			{
+				hasher.add(load_binary_file(path).bytes());
+			}
+			else
+			{
+				hasher.add(std::numeric_limits<uint64_t>::max());
+			}
+		}
+		return hasher.digest();
+	}
+
+	// Inputs are keyed by their bytes, not their names, then the dependencies the last cook of those
+	// bytes read are hashed in. A changed dependency misses, and the new cook records its dependencies again.
+	template <typename cook_fn>
+	auto cook_cached(cook_cache &cache, const cook_job &job, cook_fn cook) -> int
+	{
+		for (auto &input : job.inputs)
+		{
+			if (not fs::is_regular_file(input))
+			{
+				fmt::print(stderr, "{}: file not found\n", input.string());
+				return cook_bad_input;
+			}
+		}
+
+		auto input_key = uint64_t{};
+		auto base = job.inputs.empty() ? fs::path{} : job.inputs.front().parent_path();
+		if (cache)
+		{
+			auto hasher = content_hasher{};
+			hasher.add(cooker_version).add(job.settings);
+			for (auto &input : job.inputs)
+			{
+				hasher.add(load_binary_file(input).bytes());
+			}
+			input_key = hasher.digest();
+
+			auto dependencies = cache->dependencies(input_key).value_or(dependency_list{});
+			if (cache->fetch(dependency_key(input_key, dependencies, base), job.output))
+			{
+				fmt::print("{}: cached\n", job.output.string());
+				return cook_ok;
+			}
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		auto dependencies = dependency_list{};
+		auto output = cook(dependencies);
+		if (not output)
+		{
+			return cook_bad_input;
+		}
+
+		if (cache)
+		{
+			cache->store_dependencies(input_key, dependencies);
+			cache->store(dependency_key(input_key, dependencies, base), *output, std::chrono::steady_clock::now() - start);
+		}
+		return finish(job.output, *output);
+	}
+
+	// A map used as both colour and normals is two textures, one per format
+	struct material_texture
+	{
+		fs::path path;   // relative to the OBJ's directory
+		block_format format;
+
+		auto operator==(const material_texture &) const -> bool = default;
+	};
+
+	// One map of one material
+	struct material_map_texture
+	{
+		std::string material;
+		material_map map;
+		material_texture texture;
+	};
+
+	// Every map an MTL material can name. Bump maps are tangent space normals, two channels are enough.
+	constexpr auto material_map_list = std::array
+	{
+		std::tuple{ material_map::ambient, &mtl_data::material::tex_ambient, block_format::bc7 },
+		std::tuple{ material_map::diffuse, &mtl_data::material::tex_diffuse, block_format::bc7 },
+		std::tuple{ material_map::specular, &mtl_data::material::tex_specular, block_format::bc7 },
+		std::tuple{ material_map::shininess, &mtl_data::material::tex_shininess, block_format::bc7 },
+		std::tuple{ material_map::transparency, &mtl_data::material::tex_transparency, block_format::bc7 },
+		std::tuple{ material_map::bump, &mtl_data::material::tex_bump, block_format::bc5 },
+	};
+
+	// Every map the OBJ's materials name, in MTL order
+	auto material_map_textures(const fs::path &obj_path, const obj_data &data) -> std::vector<material_map_texture>
+	{
+		auto maps = std::vector<material_map_texture>{};
+		for (auto &mtl : data.mtl_files)
+		{
+			auto mtl_path = obj_path.parent_path() / mtl;
+			if (not fs::is_regular_file(mtl_path))
+			{
+				continue;
+			}
+
+			for (auto &material : parse_mtl(load_binary_file(mtl_path)).materials)
+			{
+				for (auto [map, texture, format] : material_map_list)
+				{
+					if (not (material.*texture).empty())
+					{
+						maps.push_back({ material.name, map, { mtl.parent_path() / (material.*texture), format } });
+					}
+				}
+			}
+		}
+		return maps;
+	}
+
+	// Every texture the OBJ's materials name, once
+	auto material_textures(const fs::path &obj_path, const obj_data &data) -> std::vector<material_texture>
+	{
+		auto textures = std::vector<material_texture>{};
+		for (auto &[material, map, texture] : material_map_textures(obj_path, data))
+		{
+			if (std::find(textures.begin(), textures.end(), texture) == textures.end())
+			{
+				textures.push_back(texture);
+			}
+		}
+		return textures;
+	}
+
+	auto texture_index(const std::vector<material_texture> &textures, const material_texture &texture) -> uint32_t
+	{
+		auto found = std::find(textures.begin(), textures.end(), texture);
+		assert(found != textures.end());
+		return static_cast<uint32_t>(found - textures.begin());
+	}
+
+	// MTL files named by the OBJ, and the textures they name, relative to the OBJ's directory
+	auto material_dependencies(const fs::path &obj_path, const obj_data &data) -> dependency_list
+	{
+		auto dependencies = dependency_list(data.mtl_files.begin(), data.mtl_files.end());
+		for (auto &texture : material_textures(obj_path, data))
+		{
+			dependencies.push_back(texture.path);
+		}
+		return dependencies;
+	}
+
+	// Splits arguments into --flag [value] options and positional ones
+	struct parsed_arguments
+	{
+		std::vector<std::string_view> positional;
+		std::vector<std::pair<std::string_view, std::string_view>> options;
+
+		auto has(std::string_view name) const -> bool
+		{
+			return std::any_of(options.begin(), options.end(), [&](auto &opt)
+			{
+				return opt.first == name;
+			});
+		}
+
+		auto value(std::string_view name) const -> std::optional<std::string_view>
+		{
+			for (auto &[opt, val] : options)
+			{
+				if (opt == name)
+				{
+					return val;
+				}
+			}
+			return std::nullopt;
+		}
+	};
+
+	auto split_arguments(const arguments &args, std::span<const std::string_view> valued_options) -> parsed_arguments
+	{
+		auto result = parsed_arguments{};
+		for (auto i = 0u; i < args.size(); i++)
+		{
+			if (not args[i].starts_with("--"))
+			{
+				result.positional.push_back(args[i]);
+				continue;
+			}
+
+			auto name = args[i];
+			auto takes_value = std::find(valued_options.begin(), valued_options.end(), name) != valued_options.end();
+			auto value = (takes_value and i + 1 < args.size()) ? args[++i] : std::string_view{};
+			result.options.emplace_back(name, value);
+		}
+		return result;
+	}
+
+	// OBJ -> welded, cache optimised, quantised (unless --full) mesh
+	auto cook_obj(const arguments &args, cook_cache &cache) -> int
+	{
+		auto parsed = split_arguments(args, {});
+		if (parsed.positional.size() != 2)
+		{
+			fmt::print(stderr, "usage: mesh [--full] <model.obj> <output.mesh>\n");
+			return cook_bad_input;
+		}
+
+		auto input = fs::path(parsed.positional[0]);
+		auto format = parsed.has("--full") ? cooked_vertex_format::p32n32t32 : cooked_vertex_format::p16n8t16;
+		auto job = cook_job{ fmt::format("mesh {} {}", cooked_mesh_version, static_cast<uint32_t>(format)),
+		                     { input }, parsed.positional[1] };
+
+		return cook_cached(cache, job, [&](dependency_list &dependencies) -> cook_output
+		{
+			auto data = parse_obj(load_binary_file(input));
+			dependencies = material_dependencies(input, data);
+
+			auto weld = weld_vertices(data);
+			auto before = analyze_mesh(data).total;
+			optimize_mesh(data);
+			auto after = analyze_mesh(data).total;
+
+			auto cooked = cook_mesh(data, format);
+
+			fmt::print("{}: {} -> {} vertices, {} triangles, {} groups\n",
+			           input.string(), weld.vertices_before, data.vertices.size(),
+			           data.indicies.size() / 3, data.groups.size());
+			fmt::print("  acmr {:.3f} -> {:.3f}, fetch efficiency {:.3f} -> {:.3f}\n",
+			           before.acmr, after.acmr, before.fetch_efficiency, after.fetch_efficiency);
+			fmt::print("  {} bytes of obj -> {} bytes cooked\n", fs::file_size(input), cooked.size());
+			return cooked;
+		});
+	}
+
+	constexpr auto mip_options = std::array{ "--filter"sv };
+	constexpr auto cube_options = std::array{ "--filter"sv, "--compress"sv, "--quality"sv };
+	constexpr auto compress_options = std::array{ "--format"sv, "--quality"sv };
+
+	// --filter box|kaiser, --srgb, --alpha and --wrap
+	auto read_mip_settings(const parsed_arguments &parsed) -> std::optional<mip_settings>
+	{
+		auto settings = mip_settings{};
+		if (auto filter = parsed.value("--filter"))
+		{
+			if (*filter != "box" and *filter != "kaiser")
+			{
+				fmt::print(stderr, "bad value for --filter: {}\n", *filter);
+				return std::nullopt;
+			}
+			settings.filter = (*filter == "kaiser") ? mip_filter::kaiser : mip_filter::box;
+		}
+		settings.srgb = parsed.has("--srgb");
+		settings.alpha_weighted = parsed.has("--alpha");
+		settings.wrap = parsed.has("--wrap");
+		return settings;
+	}
+
+	auto mip_settings_key(const mip_settings &settings) -> std::string
+	{
+		return fmt::format("{} {} {} {}", static_cast<int>(settings.filter), settings.srgb, settings.alpha_weighted, settings.wrap);
+	}
+
+	// Texture with one mip gets a full chain when its format allows, data is kept in storage
+	auto with_mips(dds_texture texture, const mip_settings &settings, std::vector<std::byte> &storage) -> dds_texture
+	{
+		if (texture.mip_count != 1 or not can_generate_mips(texture.format))
+		{
+			if (texture.mip_count == 1)
+			{
+				fmt::print("format can't be filtered here, texture will have one mip\n");
+			}
+			return texture;
+		}
+
+		storage = generate_mips(texture, settings);
+		texture.mip_count = full_mip_count(texture.width, texture.height);
+		texture.data = storage;
+		return texture;
+	}
+
+	constexpr auto block_format_names = std::array
+	{
+		std::pair{ "bc1"sv, block_format::bc1 },
+		std::pair{ "bc3"sv, block_format::bc3 },
+		std::pair{ "bc5"sv, block_format::bc5 },
+		std::pair{ "bc7"sv, block_format::bc7 },
+	};
+
+	constexpr auto block_quality_names = std::array
+	{
+		std::pair{ "fast"sv, block_quality::fast },
+		std::pair{ "normal"sv, block_quality::normal },
+		std::pair{ "high"sv, block_quality::high },
+	};
+
+	template <typename value_t, std::size_t count>
+	auto find_name(const std::array<std::pair<std::string_view, value_t>, count> &names, std::string_view option,
+	               std::string_view name) -> std::optional<value_t>
+	{
+		auto found = std::find_if(names.begin(), names.end(), [&](auto &entry)
+		{
+			return entry.first == name;
+		});
+		if (found == names.end())
+		{
+			fmt::print(stderr, "bad value for {}: {}\n", option, name);
+			return std::nullopt;
+		}
+		return found->second;
+	}
+
+	template <typename value_t, std::size_t count>
+	auto name_of(const std::array<std::pair<std::string_view, value_t>, count> &names, value_t value) -> std::string_view
+	{
+		auto found = std::find_if(names.begin(), names.end(), [&](auto &entry)
+		{
+			return entry.second == value;
+		});
+		return found->first;
+	}
+
+	using compress_option = std::optional<block_settings>;   // nullopt leaves the texture uncompressed
+
+	// format_option bc1|bc3|bc5|bc7 and --quality fast|normal|high.
+	// nullopt on a bad value, an empty compress_option when format_option isn't given.
+	auto read_block_settings(const parsed_arguments &parsed, std::string_view format_option) -> std::optional<compress_option>
+	{
+		auto settings = block_settings{};
+		auto format = parsed.value(format_option);
+		if (format)
+		{
+			auto found = find_name(block_format_names, format_option, *format);
+			if (not found)
+			{
+				return std::nullopt;
+			}
+			settings.format = *found;
+		}
+		if (auto quality = parsed.value("--quality"))
+		{
+			auto found = find_name(block_quality_names, "--quality", *quality);
+			if (not found)
+			{
+				return std::nullopt;
+			}
+			settings.quality = *found;
+		}
+		return format ? compress_option{ settings } : compress_option{};
+	}
+
+	auto block_settings_key(const compress_option &settings) -> std::string
+	{
+		if (not settings)
+		{
+			return "uncompressed";
+		}
+		return fmt::format("{} {}", static_cast<int>(settings->format), static_cast<int>(settings->quality));
+	}
+
+	// Every mip block compressed, reports PSNR so a preset can be judged per texture. Data is kept in storage.
+	auto with_compression(dds_texture texture, const block_settings &settings, std::vector<std::byte> &storage) -> std::optional<dds_texture>
+	{
+		if (not can_block_compress(texture.format))
+		{
+			fmt::print(stderr, "format can't be block compressed here\n");
+			return std::nullopt;
+		}
+		if (texture.width % 4 != 0 or texture.height % 4 != 0)
+		{
+			fmt::print(stderr, "block compressed textures need a width and height that are multiples of 4\n");
+			return std::nullopt;
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		auto compressed = compress_blocks(texture, settings);
+		auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+		fmt::print("{} {}: {:.2f} dB PSNR, {} -> {} bytes, {:.1f} ms\n",
+		           name_of(block_format_names, settings.format), name_of(block_quality_names, settings.quality),
+		           compressed.psnr, texture.data.size(), compressed.data.size(), elapsed.count());
+
+		storage = std::move(compressed.data);
+		texture.format = compressed.format;
+		texture.data = storage;
+		return texture;
+	}
+
+	// Six face DDS files as one cube, mips of each face kept. Data is kept in storage.
+	auto read_cube_faces(std::span<const fs::path> paths, std::vector<std::byte> &storage) -> std::optional<dds_texture>
+	{
+		auto files = std::vector<mapped_file>{};
+		auto faces = std::vector<dds_texture>{};
+		files.reserve(6);
+		for (auto &path : paths)
+		{
+			auto &file = files.emplace_back(load_binary_file(path));
+			auto face = read_dds(file.bytes());
+			if (not face or face->array_size != 1)
+			{
+				fmt::print(stderr, "{}: not a supported 2D dds\n", path.string());
+				return std::nullopt;
+			}
+			faces.push_back(*face);
+		}
+
+		auto &first = faces.front();
+		auto same_layout = std::all_of(faces.begin(), faces.end(), [&](const dds_texture &face)
+		{
+			return face.format == first.format and face.width == first.width
+			   and face.height == first.height and face.mip_count == first.mip_count;
+		});
+		if (not same_layout or first.width != first.height)
+		{
+			fmt::print(stderr, "cube faces must be square and share size, format and mip count\n");
+			return std::nullopt;
+		}
+
+		storage.clear();
+		for (auto &face : faces)
+		{
+			storage.insert(storage.end(), face.data.begin(), face.data.end());
+		}
+
+		auto cube = first;
+		cube.is_cube = true;
+		cube.array_size = 6;
+		cube.data = storage;
+		return cube;
+	}
+
+	// Block compressed when asked for, data is kept in storage
+	auto with_optional_compression(dds_texture texture, const compress_option &settings, std::vector<std::byte> &storage) -> std::optional<dds_texture>
+	{
+		if (not settings)
+		{
+			return texture;
+		}
+		return with_compression(texture, *settings, storage);
+	}
+
+	// Six face DDS files -> one cube DDS with a full mip chain, faces in the order given.
+	// Mips are filtered across face edges, so the cube has no seams when minified.
+	// --compress block compresses the whole chain afterwards.
+	auto cook_cube(const arguments &args, cook_cache &cache) -> int
+	{
+		auto parsed = split_arguments(args, cube_options);
+		auto settings = read_mip_settings(parsed);
+		auto compression = read_block_settings(parsed, "--compress");
+		if (parsed.positional.size() != 7 or not settings or not compression)
+		{
+			fmt::print(stderr, "usage: cube [--filter box|kaiser] [--srgb] [--alpha] [--compress bc1|bc3|bc5|bc7] [--quality fast|normal|high]\n"
+			                   "            <output.dds> <+x> <-x> <+y> <-y> <+z> <-z>\n");
+			return cook_bad_input;
+		}
+
+		auto job = cook_job{ "cube " + mip_settings_key(*settings) + " " + block_settings_key(*compression),
+		                     { parsed.positional.begin() + 1, parsed.positional.end() }, parsed.positional[0] };
+		return cook_cached(cache, job, [&](dependency_list &) -> cook_output
+		{
+			auto face_storage = std::vector<std::byte>{};
+			auto faces = read_cube_faces(job.inputs, face_storage);
+			if (not faces)
+			{
+				return std::nullopt;
+			}
+
+			auto storage = std::vector<std::byte>{};
+			auto compressed_storage = std::vector<std::byte>{};
+			auto cube = with_optional_compression(with_mips(*faces, *settings, storage), *compression, compressed_storage);
+			if (not cube)
+			{
+				return std::nullopt;
+			}
+
+			auto cooked = write_dds(*cube);
+			fmt::print("cube: {}x{}, {} mips, {} bytes\n", cube->width, cube->height, cube->mip_count, cooked.size());
+			return cooked;
+		});
+	}
+
+	// --size n and such, a positive whole number
+	auto read_count(const parsed_arguments &parsed, std::string_view option, uint32_t &count) -> bool
+	{
+		auto text = parsed.value(option);
+		if (not text)
+		{
+			return true;
+		}
+		auto value = uint32_t{};
+		auto [p, ec] = std::from_chars(text->data(), text->data() + text->size(), value);
+		if (ec != std::errc() or p != text->data() + text->size() or value == 0)
+		{
+			fmt::print(stderr, "bad value for {}: {}\n", option, *text);
+			return false;
+		}
+		count = value;
+		return true;
+	}
+
+	// Six face DDS files -> sky irradiance for diffuse lighting, through 9 SH coefficients.
+	// A small cube without mips, looked up by normal.
+	auto cook_irradiance(const arguments &args, cook_cache &cache) -> int
+	{
+		constexpr auto valued_options = std::array{ "--size"sv, "--compress"sv, "--quality"sv };
+		auto parsed = split_arguments(args, valued_options);
+		auto size = 32u;
+		auto compression = read_block_settings(parsed, "--compress");
+		if (parsed.positional.size() != 7 or not read_count(parsed, "--size", size) or not compression)
+		{
+			fmt::print(stderr, "usage: irradiance [--size n] [--compress bc1|bc3|bc7] [--quality fast|normal|high]\n"
+			                   "                  <output.dds> <+x> <-x> <+y> <-y> <+z> <-z>\n");
+			return cook_bad_input;
+		}
+
+		auto job = cook_job{ fmt::format("irradiance {} {}", size, block_settings_key(*compression)),
+		                     { parsed.positional.begin() + 1, parsed.positional.end() }, parsed.positional[0] };
+		return cook_cached(cache, job, [&](dependency_list &) -> cook_output
+		{
+			auto face_storage = std::vector<std::byte>{};
+			auto sky = read_cube_faces(job.inputs, face_storage);
+			if (not sky or not can_prefilter(*sky))
+			{
+				fmt::print(stderr, "sky faces must be uncompressed 8 bit RGBA or BGRA\n");
+				return std::nullopt;
+			}
+
+			auto sh = project_sh9(*sky);
+			fmt::print("sh9 band 0: {:.3f} {:.3f} {:.3f}\n", sh[0][0], sh[0][1], sh[0][2]);
+
+			auto storage = irradiance_cube(sh, sky->format, size);
+			auto cube = dds_texture{ sky->format, size, size, 1, 6, true, storage };
+			auto compressed_storage = std::vector<std::byte>{};
+			auto cooked_cube = with_optional_compression(cube, *compression, compressed_storage);
+			if (not cooked_cube)
+			{
+				return std::nullopt;
+			}
+
+			auto cooked = write_dds(*cooked_cube);
+			fmt::print("irradiance: {}x{}, {} bytes\n", size, size, cooked.size());
+			return cooked;
+		});
+	}
+
+	// Six face DDS files -> GGX prefiltered sky for specular lighting, one mip per roughness step
+	auto cook_specular(const arguments &args, cook_cache &cache) -> int
+	{
+		constexpr auto valued_options = std::array{ "--size"sv, "--samples"sv, "--compress"sv, "--quality"sv };
+		auto parsed = split_arguments(args, valued_options);
+		auto settings = specular_settings{};
+		auto compression = read_block_settings(parsed, "--compress");
+		if (parsed.positional.size() != 7 or not read_count(parsed, "--size", settings.size)
+		    or not read_count(parsed, "--samples", settings.sample_count) or not compression)
+		{
+			fmt::print(stderr, "usage: specular [--size n] [--samples n] [--compress bc1|bc3|bc7] [--quality fast|normal|high]\n"
+			                   "                <output.dds> <+x> <-x> <+y> <-y> <+z> <-z>\n");
+			return cook_bad_input;
+		}
+
+		auto job = cook_job{ fmt::format("specular {} {} {}", settings.size, settings.sample_count, block_settings_key(*compression)),
+		                     { parsed.positional.begin() + 1, parsed.positional.end() }, parsed.positional[0] };
+		return cook_cached(cache, job, [&](dependency_list &) -> cook_output
+		{
+			auto face_storage = std::vector<std::byte>{};
+			auto sky = read_cube_faces(job.inputs, face_storage);
+			if (not sky or not can_prefilter(*sky))
+			{
+				fmt::print(stderr, "sky faces must be uncompressed 8 bit RGBA or BGRA\n");
+				return std::nullopt;
+			}
+
+			auto start = std::chrono::steady_clock::now();
+			auto storage = prefilter_specular(*sky, settings);
+			auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+
+			auto mip_count = full_mip_count(settings.size, settings.size);
+			auto cube = dds_texture{ sky->format, settings.size, settings.size, mip_count, 6, true, storage };
+			auto compressed_storage = std::vector<std::byte>{};
+			auto cooked_cube = with_optional_compression(cube, *compression, compressed_storage);
+			if (not cooked_cube)
+			{
+				return std::nullopt;
+			}
+
+			auto cooked = write_dds(*cooked_cube);
+			fmt::print("specular: {}x{}, {} mips, {} samples, {} bytes, {:.1f} ms\n",
+			           settings.size, settings.size, mip_count, settings.sample_count, cooked.size(), elapsed.count());
+			return cooked;
+		});
+	}
+
+	auto cook_mips(const arguments &args, cook_cache &cache) -> int
+	{
+		auto parsed = split_arguments(args, mip_options);
+		auto settings = read_mip_settings(parsed);
+		if (parsed.positional.size() != 2 or not settings)
+		{
+			fmt::print(stderr, "usage: mips [--filter box|kaiser] [--srgb] [--alpha] [--wrap] <input.dds> <output.dds>\n");
+			return cook_bad_input;
+		}
+
+		auto job = cook_job{ "mips " + mip_settings_key(*settings), { parsed.positional[0] }, parsed.positional[1] };
+		return cook_cached(cache, job, [&](dependency_list &) -> cook_output
+		{
+			auto file = load_binary_file(job.inputs.front());
+			auto texture = read_dds(file);
+			if (not texture)
+			{
+				fmt::print(stderr, "{}: not a supported dds\n", job.inputs.front().string());
+				return std::nullopt;
+			}
+
+			auto storage = std::vector<std::byte>{};
+			auto mipped = with_mips(*texture, *settings, storage);
+
+			auto cooked = write_dds(mipped);
+			fmt::print("mips: {}x{}, {} slices, {} mips, {} bytes\n",
+			           mipped.width, mipped.height, mipped.array_size, mipped.mip_count, cooked.size());
+			return cooked;
+		});
+	}
+
+	// Uncompressed 2D texture, array or cube -> the same block compressed, mips included
+	auto cook_compress(const arguments &args, cook_cache &cache) -> int
+	{
+		auto parsed = split_arguments(args, compress_options);
+		auto compression = read_block_settings(parsed, "--format");
+		if (parsed.positional.size() != 2 or not compression)
+		{
+			fmt::print(stderr, "usage: compress [--format bc1|bc3|bc5|bc7] [--quality fast|normal|high] <input.dds> <output.dds>\n");
+			return cook_bad_input;
+		}
+		auto settings = compression->value_or(block_settings{});
+
+		auto job = cook_job{ "compress " + block_settings_key(settings), { parsed.positional[0] }, parsed.positional[1] };
+		return cook_cached(cache, job, [&](dependency_list &) -> cook_output
+		{
+			auto file = load_binary_file(job.inputs.front());
+			auto texture = read_dds(file);
+			if (not texture)
+			{
+				fmt::print(stderr, "{}: not a supported dds\n", job.inputs.front().string());
+				return std::nullopt;
+			}
+
+			auto storage = std::vector<std::byte>{};
+			auto compressed = with_compression(*texture, settings, storage);
+			if (not compressed)
+			{
+				return std::nullopt;
+			}
+			return write_dds(*compressed);
+		});
+	}
+
+	// DDS as it is, PNG, TGA and JPEG decoded to RGBA8 in storage. Decoded colour is _srgb, data such as normals isn't.
+	auto read_texture(std::span<const std::byte> file, bool is_colour, std::vector<std::byte> &storage) -> std::optional<dds_texture>
+	{
+		if (not find_image_format(file))
+		{
+			return read_dds(file);
+		}
+
+		auto image = decode_image(file);
+		if (not image)
+		{
+			return std::nullopt;
+		}
+
+		// Moving the texels keeps their address, so the texture's view of them stays valid
+		auto texture = image_texture(*image, is_colour);
+		storage = std::move(image->texels);
+		return texture;
+	}
+
+	// Textures named by an OBJ's materials -> block compressed DDS files with wrapped mips, in the output directory.
+	// Bump maps go to BC5, everything else to BC7. PNG, TGA and JPEG maps are decoded first, colour ones as sRGB.
+	// Where a texture cooks to, from its path and format, so tex.png and tex.tga, or a map used
+	// both as colour and normals, don't overwrite each other: maps/tex.png as BC7 is maps_tex_png_bc7.dds
+	auto cooked_texture_name(const material_texture &texture) -> std::string
+	{
+		auto name = texture.path.generic_string();
+		std::replace_if(name.begin(), name.end(), [](char c)
+		{
+			return c == '/' or c == '.' or c == ':';
+		}, '_');
+		return fmt::format("{}_{}.dds", name, name_of(block_format_names, texture.format));
+	}
+
+	auto cook_textures(const arguments &args, cook_cache &cache) -> int
+	{
+		constexpr auto valued_options = std::array{ "--quality"sv };
+		auto parsed = split_arguments(args, valued_options);
+		auto quality = std::optional{ block_quality::normal };
+		if (auto name = parsed.value("--quality"))
+		{
+			quality = find_name(block_quality_names, "--quality", *name);
+		}
+		if (parsed.positional.size() != 2 or not quality)
+		{
+			fmt::print(stderr, "usage: textures [--quality fast|normal|high] <model.obj> <output directory>\n");
+			return cook_bad_input;
+		}
+
+		auto obj_path = fs::path(parsed.positional[0]);
+		auto output_directory = fs::path(parsed.positional[1]);
+		if (not fs::is_regular_file(obj_path))
+		{
+			fmt::print(stderr, "{}: file not found\n", obj_path.string());
+			return cook_bad_input;
+		}
+
+		auto ec = std::error_code{};
+		fs::create_directories(output_directory, ec);
+
+		auto mips = mip_settings{};
+		mips.filter = mip_filter::kaiser;
+		mips.wrap = true;
+
+		auto data = parse_obj(load_binary_file(obj_path));
+		auto textures = material_textures(obj_path, data);
+		auto names = std::vector<std::string>{};
+		for (auto &texture : textures)
+		{
+			names.push_back(cooked_texture_name(texture));
+			if (std::count(names.begin(), names.end(), names.back()) > 1)
+			{
+				fmt::print(stderr, "{}: cooks to {}, same as another texture\n", texture.path.string(), names.back());
+				return cook_bad_input;
+			}
+		}
+
+		auto result = cook_ok;
+		for (auto i = 0u; i < textures.size(); i++)
+		{
+			auto &texture = textures[i];
+			auto settings = block_settings{ texture.format, *quality };
+			auto job = cook_job{ "texture " + mip_settings_key(mips) + " " + block_settings_key(settings),
+			                     { obj_path.parent_path() / texture.path }, output_directory / names[i] };
+			auto status = cook_cached(cache, job, [&](dependency_list &) -> cook_output
+			{
+				fmt::print("{}\n", texture.path.string());
+				auto file = load_binary_file(job.inputs.front());
+				auto decoded = std::vector<std::byte>{};
+				auto image = read_texture(file.bytes(), texture.format != block_format::bc5, decoded);
+				if (not image)
+				{
+					fmt::print(stderr, "{}: not a supported dds, png, tga or jpeg\n", job.inputs.front().string());
+					return std::nullopt;
+				}
+
+				auto mip_storage = std::vector<std::byte>{};
+				auto storage = std::vector<std::byte>{};
+				auto compressed = with_compression(with_mips(*image, mips, mip_storage), settings, storage);
+				if (not compressed)
+				{
+					return std::nullopt;
+				}
+				return write_dds(*compressed);
+			});
+			result = std::max(result, status);
+		}
+
+		// Each map of each material names its own cooked file, whole, as texture_pack's table does for its slices
+		auto refs = std::vector<material_map_ref>{};
+		for (auto &[material, map, texture] : material_map_textures(obj_path, data))
+		{
+			refs.push_back({ material, map, { texture_index(textures, texture), 0, { 0.0f, 0.0f }, { 1.0f, 1.0f } } });
+		}
+
+		// A table naming a texture that isn't there would only fail later, when the model loads
+		auto table_path = output_directory / obj_path.filename().replace_extension(".materials");
+		if (result != cook_ok)
+		{
+			fmt::print(stderr, "{}: not written, a texture failed to cook\n", table_path.string());
+			return result;
+		}
+		return finish(table_path, write_material_table(names, refs));
+	}
+
+	// First mip_count mips of every slice, data is kept in storage
+	auto with_mip_limit(dds_texture texture, uint32_t mip_count, std::vector<std::byte> &storage) -> dds_texture
+	{
+		if (texture.mip_count <= mip_count)
+		{
+			return texture;
+		}
+
+		storage.clear();
+		for (auto slice = 0u; slice < texture.array_size; slice++)
+		{
+			for (auto mip = 0u; mip < mip_count; mip++)
+			{
+				auto subresource = dds_subresource(texture, slice, mip);
+				storage.insert(storage.end(), subresource.begin(), subresource.end());
+			}
+		}
+		texture.mip_count = mip_count;
+		texture.data = storage;
+		return texture;
+	}
+
+	// Textures named by an OBJ's materials -> a few texture arrays and atlas pages, plus <model>.materials saying
+	// which texture, slice and UV rect each material's maps went to, so groups draw without rebinding textures.
+	// Mips and compression as textures, colour and bump maps are never packed together.
+	// Every texture is read to plan the pack, the cache saves the mips and compression.
+	auto cook_texture_pack(const arguments &args, cook_cache &cache) -> int
+	{
+		constexpr auto valued_options = std::array{ "--quality"sv, "--atlas-max"sv };
+		auto parsed = split_arguments(args, valued_options);
+		auto quality = std::optional{ block_quality::normal };
+		if (auto name = parsed.value("--quality"))
+		{
+			quality = find_name(block_quality_names, "--quality", *name);
+		}
+		auto settings = texture_pack_settings{};
+		if (parsed.positional.size() != 2 or not quality or not read_count(parsed, "--atlas-max", settings.atlas_max))
+		{
+			fmt::print(stderr, "usage: texture_pack [--quality fast|normal|high] [--atlas-max n] <model.obj> <output directory>\n");
+			return cook_bad_input;
+		}
+
+		auto obj_path = fs::path(parsed.positional[0]);
+		auto output_directory = fs::path(parsed.positional[1]);
+		if (not fs::is_regular_file(obj_path))
+		{
+			fmt::print(stderr, "{}: file not found\n", obj_path.string());
+			return cook_bad_input;
+		}
+
+		auto ec = std::error_code{};
+		fs::create_directories(output_directory, ec);
+
+		auto data = parse_obj(load_binary_file(obj_path));
+		auto maps = material_map_textures(obj_path, data);
+		auto textures = material_textures(obj_path, data);
+		auto files = std::vector<mapped_file>{};
+		auto storage = std::vector<std::vector<std::byte>>(textures.size());
+		auto images = std::vector<dds_texture>{};
+		files.reserve(textures.size());
+		for (auto i = 0u; i < textures.size(); i++)
+		{
+			auto path = obj_path.parent_path() / textures[i].path;
+			if (not fs::is_regular_file(path))
+			{
+				fmt::print(stderr, "{}: file not found\n", path.string());
+				return cook_bad_input;
+			}
+			auto &file = files.emplace_back(load_binary_file(path));
+			auto image = read_texture(file.bytes(), textures[i].format != block_format::bc5, storage[i]);
+			if (not image)
+			{
+				fmt::print(stderr, "{}: not a supported dds, png, tga or jpeg\n", path.string());
+				return cook_bad_input;
+			}
+			images.push_back(*image);
+		}
+
+		// Planned per block format, so a colour map and a normal map never share an array
+		auto placements = std::vector<texture_placement>(textures.size());
+		auto packed_names = std::vector<std::string>{};
+		auto result = cook_ok;
+		for (auto format : { block_format::bc7, block_format::bc5 })
+		{
+			auto members = std::vector<uint32_t>{};
+			auto sources = std::vector<dds_texture>{};
+			for (auto i = 0u; i < textures.size(); i++)
+			{
+				if (textures[i].format == format)
+				{
+					members.push_back(i);
+					sources.push_back(images[i]);
+				}
+			}
+
+			auto pack = plan_texture_pack(sources, settings);
+			auto first_texture = static_cast<uint32_t>(packed_names.size());
+			for (auto i = 0u; i < members.size(); i++)
+			{
+				placements[members[i]] = pack.placements[i];
+				placements[members[i]].texture += first_texture;
+			}
+
+			auto mips = mip_settings{};
+			mips.filter = mip_filter::kaiser;
+			auto block = block_settings{ format, *quality };
+			for (auto index = 0u; index < pack.textures.size(); index++)
+			{
+				auto &packed = pack.textures[index];
+				packed_names.push_back(fmt::format("{}_textures_{}.dds", obj_path.stem().string(), packed_names.size()));
+				mips.wrap = not packed.is_atlas;
+
+				auto job = cook_job{ fmt::format("texture_pack {} {} {} {} {}", mip_settings_key(mips), block_settings_key(block),
+				                                 packed.is_atlas, settings.atlas_size, settings.gutter),
+				                     {}, output_directory / packed_names.back() };
+				for (auto source : packed.sources)
+				{
+					job.inputs.push_back(obj_path.parent_path() / textures[members[source]].path);
+				}
+
+				auto status = cook_cached(cache, job, [&](dependency_list &) -> cook_output
+				{
+					auto texels = build_packed_texture(pack, index, sources, settings);
+					auto texture = dds_texture{ packed.format, packed.width, packed.height, packed.mip_count, packed.array_size, false, texels };
+
+					auto mip_storage = std::vector<std::byte>{};
+					auto limit_storage = std::vector<std::byte>{};
+					auto compressed_storage = std::vector<std::byte>{};
+					texture = with_mips(texture, mips, mip_storage);
+					if (packed.is_atlas)
+					{
+						texture = with_mip_limit(texture, packed.mip_limit, limit_storage);
+					}
+					auto compressed = with_compression(texture, block, compressed_storage);
+					if (not compressed)
+					{
+						return std::nullopt;
+					}
+
+					fmt::print("{}: {} {}x{}, {} slices, {} mips\n", packed_names[first_texture + index],
+					           packed.is_atlas ? "atlas" : "array", packed.width, packed.height, packed.array_size, compressed->mip_count);
+					return write_dds(*compressed);
+				});
+				result = std::max(result, status);
+			}
+		}
+
+		auto refs = std::vector<material_map_ref>{};
+		for (auto &[material, map, texture] : maps)
+		{
+			refs.push_back({ material, map, placements[texture_index(textures, texture)] });
+		}
+
+		auto table_path = output_directory / obj_path.filename().replace_extension(".materials");
+		if (result != cook_ok)
+		{
+			fmt::print(stderr, "{}: not written, a packed texture failed to cook\n", table_path.string());
+			return result;
+		}
+		fmt::print("{}: {} maps of {} textures in {} packed textures\n",
+		           table_path.string(), refs.size(), textures.size(), packed_names.size());
+		return finish(table_path, write_material_table(packed_names, refs));
+	}
+
+	// Generated sphere baked to a full precision mesh, for sky domes
+	auto cook_sphere(const arguments &args, cook_cache &cache) -> int
+	{
+		constexpr auto valued_options = std::array{ "--level"sv, "--topology"sv };
+		auto parsed = split_arguments(args, valued_options);
+		if (parsed.positional.size() != 1)
+		{
+			fmt::print(stderr, "usage: sphere [--level 0-8] [--topology icosahedron|cube] [--inward] <output.mesh>\n");
+			return cook_bad_input;
+		}
+
+		// Triangles go up 4 times a level, 8 is already over a million
+		constexpr auto max_level = 8u;
+
+		auto settings = sphere_settings{};
+		if (auto level = parsed.value("--level"))
+		{
+			auto [p, ec] = std::from_chars(level->data(), level->data() + level->size(), settings.subdivide_count);
+			if (ec != std::errc() or p != level->data() + level->size() or settings.subdivide_count > max_level)
+			{
+				fmt::print(stderr, "bad value for --level: {}, 0 to {}\n", *level, max_level);
+				return cook_bad_input;
+			}
+		}
+		if (auto topology = parsed.value("--topology"))
+		{
+			if (*topology != "icosahedron" and *topology != "cube")
+			{
+				fmt::print(stderr, "bad value for --topology: {}\n", *topology);
+				return cook_bad_input;
+			}
+			settings.topology = (*topology == "cube") ? sphere_topology::cube : sphere_topology::icosahedron;
+		}
+		settings.facing = parsed.has("--inward") ? sphere_facing::inward : sphere_facing::outward;
+
+		auto job = cook_job{ fmt::format("sphere {} {} {} {}", cooked_mesh_version, settings.subdivide_count,
+		                                 static_cast<int>(settings.topology), static_cast<int>(settings.facing)),
+		                     {}, parsed.positional[0] };
+
+		return cook_cached(cache, job, [&](dependency_list &) -> cook_output
+		{
+			auto sphere = make_sphere(settings);
+			auto data = obj_data{};
+			data.vertices = std::move(sphere.positions);
+			data.normals = std::move(sphere.normals);
+			data.uv_coords = std::move(sphere.uv_coords);
+			data.indicies = std::move(sphere.indicies);
+			optimize_mesh(data);
+
+			auto cooked = cook_mesh(data, cooked_vertex_format::p32n32t32);
+			fmt::print("sphere: {} vertices, {} triangles, {} bytes\n",
+			           data.vertices.size(), data.indicies.size() / 3, cooked.size());
+			return cooked;
+		});
+	}
+
+	constexpr auto command_list = std::array
+	{
+		std::pair{ "mesh"sv, static_cast<command_fn>(cook_obj) },
+		std::pair{ "cube"sv, static_cast<command_fn>(cook_cube) },
+		std::pair{ "irradiance"sv, static_cast<command_fn>(cook_irradiance) },
+		std::pair{ "specular"sv, static_cast<command_fn>(cook_specular) },
+		std::pair{ "mips"sv, static_cast<command_fn>(cook_mips) },
+		std::pair{ "compress"sv, static_cast<command_fn>(cook_compress) },
+		std::pair{ "textures"sv, static_cast<command_fn>(cook_textures) },
+		std::pair{ "texture_pack"sv, static_cast<command_fn>(cook_texture_pack) },
+		std::pair{ "sphere"sv, static_cast<command_fn>(cook_sphere) },
+	};
+}
+
+// Exit code is 0 on success, 1 when the output can't be written, 2 on bad input
+auto main(int argc, char *argv[]) -> int
+{
+	auto args = arguments(argv + 1, argv + argc);
+
+	auto cache = cook_cache{};
+	if (args.size() >= 2 and args[0] == "--cache")
+	{
+		cache.emplace(fs::path(args[1]));
+		args.erase(args.begin(), args.begin() + 2);
+	}
+
+	if (args.empty())
+	{
+		fmt::print("usage: {} [--cache <directory>] <command> [options]\n"
+		           "commands:\n"
+		           "  mesh [--full] <model.obj> <output.mesh>\n"
+		           "  cube [--filter box|kaiser] [--srgb] [--alpha] [--compress bc1|bc3|bc5|bc7] [--quality fast|normal|high]\n"
+		           "       <output.dds> <+x> <-x> <+y> <-y> <+z> <-z>\n"
+		           "  irradiance [--size n] [--compress bc1|bc3|bc7] [--quality fast|normal|high] <output.dds> <+x> <-x> <+y> <-y> <+z> <-z>\n"
+		           "  specular [--size n] [--samples n] [--compress bc1|bc3|bc7] [--quality fast|normal|high]\n"
+		           "           <output.dds> <+x> <-x> <+y> <-y> <+z> <-z>\n"
+		           "  mips [--filter box|kaiser] [--srgb] [--alpha] [--wrap] <input.dds> <output.dds>\n"
+		           "  compress [--format bc1|bc3|bc5|bc7] [--quality fast|normal|high] <input.dds> <output.dds>\n"
+		           "  textures [--quality fast|normal|high] <model.obj> <output directory>\n"
+		           "  texture_pack [--quality fast|normal|high] [--atlas-max n] <model.obj> <output directory>\n"
+		           "  sphere [--level 0-8] [--topology icosahedron|cube] [--inward] <output.mesh>\n",
+		           argv[0]);
+		return cook_bad_input;
+	}
+
+	auto name = args.front();
+	args.erase(args.begin());
+
+	auto command = std::find_if(command_list.begin(), command_list.end(), [&](auto &cmd)
+	{
+		return cmd.first == name;
+	});
+	if (command == command_list.end())
+	{
+		fmt::print(stderr, "unknown command: {}\n", name);
+		return cook_bad_input;
+	}
+
+	auto result = command->second(args, cache);
+
+	if (cache)
+	{
+		auto &stats = cache->stats();
+		auto lookups = stats.hits + stats.misses;
+		fmt::print("cache: {} of {} hit ({:.0f}%), {:.1f} ms saved, {:.1f} ms cooking\n",
+		           stats.hits, lookups, lookups ? 100.0 * stats.hits / lookups : 0.0,
+		           stats.saved_time.count() * 1000.0, stats.cook_time.count() * 1000.0);
+	}
+	return result;
+}
@@ -0,0 +1,182 @@
+#include "asset_pack.h"
+#include "helpers.h"
+
+#include <fmt/core.h>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <filesystem>
+#include <optional>
+#include <algorithm>
+
+using namespace dx11_lessons;
+namespace fs = std::filesystem;
+
+namespace
+{
+	struct options
+	{
+		fs::path output{};
+		fs::path root{ "." };
+		std::vector<fs::path> inputs{};
+		bool list = false;
+		bool compress = true;
+	};
+
+	void print_usage(std::string_view exe)
+	{
+		fmt::print("usage: {} <output pack> [--root <dir>] [--no-compress] <file or directory>...\n"
+		           "       {} --list <pack>\n"
+		           "inputs are relative to --root (default current directory),\n"
+		           "entry names are the input paths relative to --root, with / separators,\n"
+		           "entries are compressed when it saves enough space, unless --no-compress\n",
+		           exe, exe);
+	}
+
+	auto parse_arguments(int argc, char *argv[]) -> std::optional<options>
+	{
+		auto opts = options{};
+		auto args = std::vector<std::string_view>(argv + 1, argv + argc);
+
+		for (auto i = 0u; i < args.size(); i++)
+		{
+			auto arg = args[i];
+			if (arg == "--no-compress")
+			{
+				opts.compress = false;
+			}
+			else if (arg == "--list" or arg == "--root")
+			{
+				if (i + 1 == args.size())
+				{
+					fmt::print(stderr, "missing value for {}\n", arg);
+					return std::nullopt;
+				}
+				auto value = fs::path(args[++i]);
+				if (arg == "--list")
+				{
+					opts.list = true;
+					opts.output = value;
+				}
+				else
+				{
+					opts.root = value;
+				}
+			}
+			else if (opts.output.empty())
+			{
+				opts.output = arg;
+			}
+			else
+			{
+				opts.inputs.emplace_back(arg);
+			}
+		}
+
+		if (opts.output.empty() or (not opts.list and opts.inputs.empty()))
+		{
+			return std::nullopt;
+		}
+		return opts;
+	}
+
+	// Expands directories into the files below them, sorted so packs are reproducible
+	auto collect_files(const options &opts) -> std::optional<std::vector<fs::path>>
+	{
+		auto files = std::vector<fs::path>{};
+		for (auto &input : opts.inputs)
+		{
+			auto path = opts.root / input;
+			if (fs::is_directory(path))
+			{
+				auto dir_files = std::vector<fs::path>{};
+				for (auto &item : fs::recursive_directory_iterator(path))
+				{
+					if (item.is_regular_file())
+					{
+						dir_files.push_back(item.path());
+					}
+				}
+				std::sort(dir_files.begin(), dir_files.end());
+				files.insert(files.end(), dir_files.begin(), dir_files.end());
+			}
+			else if (fs::is_regular_file(path))
+			{
+				files.push_back(path);
+			}
+			else
+			{
+				fmt::print(stderr, "{}: file not found\n", path.string());
+				return std::nullopt;
+			}
+		}
+		return files;
+	}
+
+	auto list_pack(const fs::path &path) -> int
+	{
+		auto pack = asset_pack(path);
+		if (not pack.is_valid())
+		{
+			fmt::print(stderr, "{}: not a valid pack\n", path.string());
+			return 2;
+		}
+
+		fmt::print("{:>12} {:>12} {:>5} {}\n", "size", "stored", "codec", "name");
+		for (auto i = 0u; i < pack.entry_count(); i++)
+		{
+			auto codec = (pack.entry_codec(i) == pack_codec::lz) ? "lz" : "none";
+			fmt::print("{:>12} {:>12} {:>5} {}\n", pack.entry_size(i), pack.entry_stored_size(i), codec, pack.entry_name(i));
+		}
+		return 0;
+	}
+}
+
+// Exit code is 0 on success, 1 when the pack can't be written, 2 on bad input
+auto main(int argc, char *argv[]) -> int
+{
+	auto opts = parse_arguments(argc, argv);
+	if (not opts)
+	{
+		print_usage(argv[0]);
+		return 2;
+	}
+
+	if (opts->list)
+	{
+		return list_pack(opts->output);
+	}
+
+	auto files = collect_files(*opts);
+	if (not files)
+	{
+		return 2;
+	}
+
+	auto builder = asset_pack_builder(opts->compress ? asset_pack_builder::compression::automatic
+	                                                 : asset_pack_builder::compression::none);
+	auto total_bytes = std::size_t{};
+	for (auto &path : *files)
+	{
+		auto name = fs::relative(path, opts->root).generic_string();
+		auto file = load_binary_file(path);
+		total_bytes += file.size();
+
+		if (not builder.add(name, { file.begin(), file.end() }))
+		{
+			fmt::print(stderr, "{}: duplicate entry name\n", name);
+			return 2;
+		}
+	}
+
+	if (not builder.write(opts->output))
+	{
+		fmt::print(stderr, "{}: could not write pack\n", opts->output.string());
+		return 1;
+	}
+
+	fmt::print("{}: {} entries ({} compressed), {} bytes of data, {} bytes on disk\n",
+	           opts->output.string(), builder.entry_count(), builder.compressed_count(),
+	           total_bytes, fs::file_size(opts->output));
+	return 0;
+}
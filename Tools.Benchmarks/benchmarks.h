@@ -0,0 +1,16 @@
+#pragma once
+
+#include <vector>
+#include <string_view>
+
+namespace dx11_lessons::benchmarks
+{
+	using arguments = std::vector<std::string_view>;
+
+	auto bvh(const arguments &args) -> int;
+	auto sphere(const arguments &args) -> int;
+	auto pack(const arguments &args) -> int;
+	auto streaming(const arguments &args) -> int;
+	auto decode(const arguments &args) -> int;
+	auto jobs(const arguments &args) -> int;
+}
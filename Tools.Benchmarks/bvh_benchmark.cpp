@@ -0,0 +1,153 @@
+#include "benchmarks.h"
+
+#include "obj_mtl_parser.h"
+#include "triangle_bvh.h"
+#include "helpers.h"
+
+#include <fmt/core.h>
+#include <DirectXMath.h>
+#include <chrono>
+#include <string>
+#include <future>
+#include <thread>
+#include <vector>
+#include <cmath>
+
+using namespace dx11_lessons;
+using namespace DirectX;
+
+namespace
+{
+	using hrc = std::chrono::high_resolution_clock;
+	using ms = std::chrono::duration<double, std::milli>;
+	using s = std::chrono::duration<double>;
+
+	constexpr auto build_runs = 3;
+	constexpr auto terrain_size = 1000u;
+	constexpr auto image_width = 1280u,
+	               image_height = 800u;
+
+	// Height field with a couple of groups, used when no obj file is given
+	auto make_terrain(uint32_t size) -> obj_data
+	{
+		auto data = obj_data{};
+		for (auto y = 0u; y <= size; y++)
+		{
+			for (auto x = 0u; x <= size; x++)
+			{
+				auto fx = static_cast<float>(x) / size,
+				     fy = static_cast<float>(y) / size;
+				data.vertices.push_back({ fx * 10.0f - 5.0f,
+				                          0.5f * std::sin(fx * 31.0f) * std::cos(fy * 23.0f),
+				                          fy * 10.0f - 5.0f });
+			}
+		}
+
+		for (auto y = 0u; y < size; y++)
+		{
+			if (y % (size / 4) == 0)
+			{
+				auto &grp = data.groups.emplace_back();
+				grp.name = fmt::format("band_{}", data.groups.size());
+				grp.index_start = static_cast<uint32_t>(data.indicies.size());
+			}
+
+			for (auto x = 0u; x < size; x++)
+			{
+				auto a = y * (size + 1) + x, b = a + 1,
+				     c = a + size + 1, d = c + 1;
+				data.indicies.insert(data.indicies.end(), { a, c, b, b, c, d });
+			}
+			data.groups.back().index_count = static_cast<uint32_t>(data.indicies.size()) - data.groups.back().index_start;
+		}
+
+		data.bounding_obb = fit_oriented_box(data.vertices);
+		return data;
+	}
+
+	auto make_rays(const obj_data &model) -> std::vector<ray>
+	{
+		auto &box = model.bounding_obb;
+		auto center = XMLoadFloat3(&box.center);
+		auto radius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&box.extents)));
+
+		auto eye = center + XMVectorSet(0.0f, 0.6f, -1.0f, 0.0f) * radius;
+		auto view = XMMatrixLookAtLH(eye, center, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		auto projection = XMMatrixPerspectiveFovLH(XMConvertToRadians(60.0f),
+		                                           static_cast<float>(image_width) / image_height,
+		                                           0.1f, 100.0f);
+
+		auto rays = std::vector<ray>{};
+		rays.reserve(image_width * image_height);
+		for (auto y = 0u; y < image_height; y++)
+		{
+			for (auto x = 0u; x < image_width; x++)
+			{
+				rays.push_back(make_picking_ray(eye, view, projection,
+				                                x + 0.5f, y + 0.5f,
+				                                image_width, image_height));
+			}
+		}
+		return rays;
+	}
+
+	auto trace(const triangle_bvh &bvh, const std::vector<ray> &rays, std::size_t first, std::size_t last) -> std::size_t
+	{
+		auto hits = std::size_t{};
+		for (auto i = first; i < last; i++)
+		{
+			if (bvh.intersect(rays[i]))
+			{
+				hits++;
+			}
+		}
+		return hits;
+	}
+}
+
+auto dx11_lessons::benchmarks::bvh(const arguments &args) -> int
+{
+	auto model = args.empty() ? make_terrain(terrain_size)
+	                          : parse_obj(load_binary_file(std::string(args.front())));
+	fmt::print("bvh: {} triangles, {} groups\n", model.indicies.size() / 3, model.groups.size());
+
+	auto best_build = ms::max();
+	auto node_count = std::size_t{};
+	for (auto run = 0; run < build_runs; run++)
+	{
+		auto start = hrc::now();
+		auto bvh = triangle_bvh(model);
+		best_build = std::min(best_build, ms(hrc::now() - start));
+		node_count = bvh.node_count();
+	}
+	fmt::print("build: {:.2f} ms (best of {}), {} nodes\n", best_build.count(), build_runs, node_count);
+
+	auto bvh = triangle_bvh(model);
+	auto rays = make_rays(model);
+
+	auto start = hrc::now();
+	auto hits = trace(bvh, rays, 0, rays.size());
+	auto single = s(hrc::now() - start);
+	fmt::print("1 thread: {:.2f} Mrays/s, {} of {} rays hit\n",
+	           rays.size() / single.count() / 1.0e6, hits, rays.size());
+
+	auto thread_count = std::max(1u, std::thread::hardware_concurrency());
+	auto chunk = (rays.size() + thread_count - 1) / thread_count;
+	auto tasks = std::vector<std::future<std::size_t>>{};
+
+	start = hrc::now();
+	for (auto t = 0u; t < thread_count; t++)
+	{
+		auto first = std::min(rays.size(), t * chunk),
+		     last = std::min(rays.size(), first + chunk);
+		tasks.emplace_back(std::async(std::launch::async, trace, std::cref(bvh), std::cref(rays), first, last));
+	}
+	for (auto &task : tasks)
+	{
+		task.wait();
+	}
+	auto multi = s(hrc::now() - start);
+	fmt::print("{} threads: {:.2f} Mrays/s\n", thread_count, rays.size() / multi.count() / 1.0e6);
+
+	return 0;
+}
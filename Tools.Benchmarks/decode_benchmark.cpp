@@ -0,0 +1,917 @@
+#include "benchmarks.h"
+
+#include "image_decoder.h"
+#include "helpers.h"
+
+#include <fmt/core.h>
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <random>
+#include <filesystem>
+#include <algorithm>
+#include <optional>
+#include <limits>
+#include <span>
+#include <queue>
+#include <functional>
+#include <cmath>
+#include <cstdlib>
+
+using namespace dx11_lessons;
+namespace fs = std::filesystem;
+
+namespace
+{
+	using hrc = std::chrono::high_resolution_clock;
+	using ms = std::chrono::duration<double, std::milli>;
+
+	constexpr auto decode_runs = 5;
+	constexpr auto image_size = 1024u;
+	constexpr auto image_count = 4u;
+
+	struct input_file
+	{
+		std::string name;
+		std::vector<std::byte> data;
+	};
+
+	void put(std::vector<std::byte> &out, std::initializer_list<uint32_t> bytes)
+	{
+		for (auto b : bytes)
+		{
+			out.push_back(static_cast<std::byte>(b));
+		}
+	}
+
+	void put_u32_be(std::vector<std::byte> &out, uint32_t value)
+	{
+		put(out, { value >> 24, (value >> 16) & 0xFF, (value >> 8) & 0xFF, value & 0xFF });
+	}
+
+	auto crc32(const std::byte *data, std::size_t size) -> uint32_t
+	{
+		auto crc = 0xFFFFFFFFu;
+		for (auto i = std::size_t{}; i < size; i++)
+		{
+			crc ^= static_cast<uint32_t>(data[i]);
+			for (auto bit = 0; bit < 8; bit++)
+			{
+				crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+			}
+		}
+		return ~crc;
+	}
+
+	auto adler32(std::span<const uint8_t> data) -> uint32_t
+	{
+		auto a = 1u, b = 0u;
+		for (auto value : data)
+		{
+			a = (a + value) % 65521;
+			b = (b + a) % 65521;
+		}
+		return (b << 16) | a;
+	}
+
+	// Code lengths of no more than max_length bits for the symbols used, at least two so there's a code.
+	// Frequencies are halved until the tree is shallow enough, a little larger than optimal and a lot shorter.
+	auto huffman_lengths(std::vector<uint32_t> frequencies, uint32_t max_length) -> std::vector<uint8_t>
+	{
+		auto used = std::count_if(frequencies.begin(), frequencies.end(), [](auto f) { return f > 0; });
+		for (auto i = 0u; used < 2 and i < frequencies.size(); i++)
+		{
+			if (frequencies[i] == 0)
+			{
+				frequencies[i] = 1;
+				used++;
+			}
+		}
+
+		auto symbol_count = static_cast<uint32_t>(frequencies.size());
+		while (true)
+		{
+			using entry = std::pair<uint64_t, uint32_t>;   // weight and node, leaves are nodes 0 to symbol_count - 1
+			auto queue = std::priority_queue<entry, std::vector<entry>, std::greater<>>{};
+			auto parents = std::vector<uint32_t>(symbol_count, 0);
+			for (auto i = 0u; i < symbol_count; i++)
+			{
+				if (frequencies[i] > 0)
+				{
+					queue.push({ frequencies[i], i });
+				}
+			}
+			while (queue.size() > 1)
+			{
+				auto a = queue.top();
+				queue.pop();
+				auto b = queue.top();
+				queue.pop();
+				auto node = static_cast<uint32_t>(parents.size());
+				parents.push_back(0);
+				parents[a.second] = parents[b.second] = node;
+				queue.push({ a.first + b.first, node });
+			}
+
+			auto root = static_cast<uint32_t>(parents.size() - 1);
+			auto lengths = std::vector<uint8_t>(symbol_count, 0);
+			auto longest = 0u;
+			for (auto i = 0u; i < symbol_count; i++)
+			{
+				if (frequencies[i] == 0)
+				{
+					continue;
+				}
+				auto length = 0u;
+				for (auto node = i; node != root; node = parents[node])
+				{
+					length++;
+				}
+				lengths[i] = static_cast<uint8_t>(length);
+				longest = std::max(longest, length);
+			}
+			if (longest <= max_length)
+			{
+				return lengths;
+			}
+
+			for (auto &f : frequencies)
+			{
+				f = (f + 1) / 2;
+			}
+		}
+	}
+
+	// Codes counting up within each length, shorter lengths first, the same in deflate and JPEG
+	auto canonical_codes(const std::vector<uint8_t> &lengths) -> std::vector<uint32_t>
+	{
+		auto counts = std::array<uint32_t, 17>{};
+		for (auto length : lengths)
+		{
+			counts[length]++;
+		}
+		counts[0] = 0;
+
+		auto next = std::array<uint32_t, 17>{};
+		for (auto length = 1u, code = 0u; length < next.size(); length++)
+		{
+			code = (code + counts[length - 1]) << 1;
+			next[length] = code;
+		}
+
+		auto codes = std::vector<uint32_t>(lengths.size());
+		for (auto i = 0u; i < lengths.size(); i++)
+		{
+			if (lengths[i] > 0)
+			{
+				codes[i] = next[lengths[i]]++;
+			}
+		}
+		return codes;
+	}
+
+	// RGBA texel of a texture with smooth gradients, flat patches and a little noise
+	auto texel(uint32_t x, uint32_t y, std::mt19937 &rng) -> std::array<uint32_t, 4>
+	{
+		auto patch = ((x / 64) ^ (y / 64)) & 1;
+		return { x / 4 & 0xFF, y / 4 & 0xFF, patch ? 200u : 40u + static_cast<uint32_t>(rng() % 4), patch ? 255u : 128u };
+	}
+
+	// Uncompressed or RLE true colour TGA, bottom row first like most tools write them
+	auto make_tga(bool rle, bool alpha) -> std::vector<std::byte>
+	{
+		auto rng = std::mt19937{ 1 };
+		auto out = std::vector<std::byte>{};
+		put(out, { 0, 0, rle ? 10u : 2u, 0, 0, 0, 0, 0, 0, 0, 0, 0 });
+		put(out, { image_size & 0xFF, image_size >> 8, image_size & 0xFF, image_size >> 8, alpha ? 32u : 24u, alpha ? 8u : 0u });
+
+		for (auto y = 0u; y < image_size; y++)
+		{
+			for (auto x = 0u; x < image_size;)
+			{
+				auto t = texel(x, image_size - 1 - y, rng);
+				auto run = 1u;
+				while (rle and x + run < image_size and run < 128 and texel(x + run, image_size - 1 - y, rng) == t)
+				{
+					run++;
+				}
+				if (rle)
+				{
+					put(out, { 0x80 | (run - 1) });
+				}
+				put(out, { t[2], t[1], t[0] });
+				if (alpha)
+				{
+					put(out, { t[3] });
+				}
+				x += rle ? run : 1;
+			}
+		}
+		return out;
+	}
+
+	// Deflate writes bits from the least significant up, Huffman codes from their first bit
+	struct deflate_writer
+	{
+		std::vector<std::byte> out{};
+		uint64_t bits{};
+		uint32_t count{};
+
+		void put(uint32_t value, uint32_t length)
+		{
+			bits |= static_cast<uint64_t>(value) << count;
+			count += length;
+			while (count >= 8)
+			{
+				out.push_back(static_cast<std::byte>(bits & 0xFF));
+				bits >>= 8;
+				count -= 8;
+			}
+		}
+
+		void put_code(uint32_t code, uint32_t length)
+		{
+			auto reversed = 0u;
+			for (auto i = 0u; i < length; i++)
+			{
+				reversed |= ((code >> i) & 1) << (length - 1 - i);
+			}
+			put(reversed, length);
+		}
+
+		void flush()
+		{
+			if (count > 0)
+			{
+				put(0, 8 - count);
+			}
+		}
+	};
+
+	constexpr auto length_bases = std::array<uint32_t, 29>{ 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	                                                         35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	constexpr auto length_extra_bits = std::array<uint32_t, 29>{ 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	                                                              3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	constexpr auto distance_bases = std::array<uint32_t, 30>{ 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385,
+	                                                           513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	constexpr auto distance_extra_bits = std::array<uint32_t, 30>{ 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7,
+	                                                                8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+	constexpr auto code_length_order = std::array<uint32_t, 19>{ 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	// A literal when length is 0
+	struct lz_match
+	{
+		uint16_t length;
+		uint16_t distance;
+		uint8_t literal;
+	};
+
+	template <std::size_t size>
+	auto find_base(const std::array<uint32_t, size> &bases, uint32_t value) -> uint32_t
+	{
+		return static_cast<uint32_t>(std::upper_bound(bases.begin(), bases.end(), value) - bases.begin() - 1);
+	}
+
+	// Greedy matches over the last 32 KB, through hash chains of 3 byte prefixes cut short like zlib's faster levels
+	auto find_matches(const std::vector<uint8_t> &data) -> std::vector<lz_match>
+	{
+		constexpr auto hash_bits = 15u;
+		constexpr auto window = 32768u;
+		constexpr auto max_chain = 32u;
+
+		auto head = std::vector<int32_t>(1u << hash_bits, -1);
+		auto previous = std::vector<int32_t>(data.size(), -1);
+		auto hash_at = [&](std::size_t at)
+		{
+			auto prefix = (uint32_t{ data[at] } << 16) | (uint32_t{ data[at + 1] } << 8) | data[at + 2];
+			return (prefix * 2654435761u) >> (32 - hash_bits);
+		};
+		auto insert = [&](std::size_t at)
+		{
+			if (at + 3 <= data.size())
+			{
+				auto hash = hash_at(at);
+				previous[at] = head[hash];
+				head[hash] = static_cast<int32_t>(at);
+			}
+		};
+
+		auto matches = std::vector<lz_match>{};
+		for (auto at = std::size_t{}; at < data.size();)
+		{
+			auto best_length = 0u, best_distance = 0u;
+			if (at + 3 <= data.size())
+			{
+				auto longest = static_cast<uint32_t>(std::min<std::size_t>(258, data.size() - at));
+				auto chain = max_chain;
+				for (auto candidate = head[hash_at(at)]; candidate >= 0 and at - candidate <= window and chain > 0;
+				     candidate = previous[candidate], chain--)
+				{
+					auto length = 0u;
+					while (length < longest and data[candidate + length] == data[at + length])
+					{
+						length++;
+					}
+					if (length > best_length)
+					{
+						best_length = length;
+						best_distance = static_cast<uint32_t>(at - candidate);
+					}
+				}
+			}
+
+			if (best_length >= 3)
+			{
+				matches.push_back({ static_cast<uint16_t>(best_length), static_cast<uint16_t>(best_distance), 0 });
+				for (auto i = 0u; i < best_length; i++)
+				{
+					insert(at + i);
+				}
+				at += best_length;
+			}
+			else
+			{
+				matches.push_back({ 0, 0, data[at] });
+				insert(at);
+				at++;
+			}
+		}
+		return matches;
+	}
+
+	// One dynamic Huffman block, code lengths run length coded the way zlib writes them
+	void write_deflate_block(deflate_writer &writer, std::span<const lz_match> matches, bool last)
+	{
+		auto literal_frequencies = std::vector<uint32_t>(286), distance_frequencies = std::vector<uint32_t>(30);
+		for (auto &m : matches)
+		{
+			if (m.length == 0)
+			{
+				literal_frequencies[m.literal]++;
+				continue;
+			}
+			literal_frequencies[257 + find_base(length_bases, m.length)]++;
+			distance_frequencies[find_base(distance_bases, m.distance)]++;
+		}
+		literal_frequencies[256]++;
+
+		auto literal_lengths = huffman_lengths(literal_frequencies, 15),
+		     distance_lengths = huffman_lengths(distance_frequencies, 15);
+		auto literal_codes = canonical_codes(literal_lengths),
+		     distance_codes = canonical_codes(distance_lengths);
+
+		auto literal_count = 286u, distance_count = 30u;
+		while (literal_count > 257 and literal_lengths[literal_count - 1] == 0)
+		{
+			literal_count--;
+		}
+		while (distance_count > 1 and distance_lengths[distance_count - 1] == 0)
+		{
+			distance_count--;
+		}
+
+		auto lengths = std::vector<uint8_t>(literal_lengths.begin(), literal_lengths.begin() + literal_count);
+		lengths.insert(lengths.end(), distance_lengths.begin(), distance_lengths.begin() + distance_count);
+
+		// 16 repeats the previous length 3 to 6 times, 17 and 18 are 3 to 10 and 11 to 138 zeros
+		struct length_symbol
+		{
+			uint32_t symbol;
+			uint32_t extra;
+		};
+		auto symbols = std::vector<length_symbol>{};
+		for (auto i = 0u; i < lengths.size();)
+		{
+			auto run = 1u;
+			while (i + run < lengths.size() and lengths[i + run] == lengths[i])
+			{
+				run++;
+			}
+
+			if (lengths[i] == 0 and run >= 3)
+			{
+				run = std::min(run, 138u);
+				symbols.push_back(run >= 11 ? length_symbol{ 18, run - 11 } : length_symbol{ 17, run - 3 });
+				i += run;
+			}
+			else if (lengths[i] != 0 and run >= 4)
+			{
+				auto repeats = std::min(run - 1, 6u);
+				symbols.push_back({ lengths[i], 0 });
+				symbols.push_back({ 16, repeats - 3 });
+				i += 1 + repeats;
+			}
+			else
+			{
+				symbols.push_back({ lengths[i], 0 });
+				i++;
+			}
+		}
+
+		auto length_frequencies = std::vector<uint32_t>(19);
+		for (auto &ls : symbols)
+		{
+			length_frequencies[ls.symbol]++;
+		}
+		auto length_lengths = huffman_lengths(length_frequencies, 7);
+		auto length_codes = canonical_codes(length_lengths);
+		auto length_count = 19u;
+		while (length_count > 4 and length_lengths[code_length_order[length_count - 1]] == 0)
+		{
+			length_count--;
+		}
+
+		writer.put(last ? 1 : 0, 1);
+		writer.put(2, 2);
+		writer.put(literal_count - 257, 5);
+		writer.put(distance_count - 1, 5);
+		writer.put(length_count - 4, 4);
+		for (auto i = 0u; i < length_count; i++)
+		{
+			writer.put(length_lengths[code_length_order[i]], 3);
+		}
+		constexpr auto repeat_bits = std::array<uint32_t, 3>{ 2, 3, 7 };
+		for (auto &ls : symbols)
+		{
+			writer.put_code(length_codes[ls.symbol], length_lengths[ls.symbol]);
+			if (ls.symbol >= 16)
+			{
+				writer.put(ls.extra, repeat_bits[ls.symbol - 16]);
+			}
+		}
+
+		for (auto &m : matches)
+		{
+			if (m.length == 0)
+			{
+				writer.put_code(literal_codes[m.literal], literal_lengths[m.literal]);
+				continue;
+			}
+			auto l = find_base(length_bases, m.length);
+			writer.put_code(literal_codes[257 + l], literal_lengths[257 + l]);
+			writer.put(m.length - length_bases[l], length_extra_bits[l]);
+			auto d = find_base(distance_bases, m.distance);
+			writer.put_code(distance_codes[d], distance_lengths[d]);
+			writer.put(m.distance - distance_bases[d], distance_extra_bits[d]);
+		}
+		writer.put_code(literal_codes[256], literal_lengths[256]);
+	}
+
+	// zlib stream in dynamic Huffman blocks, as image editors write PNGs
+	auto deflate(const std::vector<uint8_t> &data) -> std::vector<std::byte>
+	{
+		constexpr auto block_matches = std::size_t{ 1 } << 15;
+
+		auto writer = deflate_writer{};
+		writer.put(0x78, 8);
+		writer.put(0x9C, 8);
+		auto matches = find_matches(data);
+		for (auto offset = std::size_t{}; offset < matches.size(); offset += block_matches)
+		{
+			auto count = std::min(block_matches, matches.size() - offset);
+			write_deflate_block(writer, std::span(matches).subspan(offset, count), offset + count == matches.size());
+		}
+		writer.flush();
+		put_u32_be(writer.out, adler32(data));
+		return writer.out;
+	}
+
+	// zlib stream in stored blocks, what a PNG writer without a compressor makes
+	auto store(const std::vector<uint8_t> &data) -> std::vector<std::byte>
+	{
+		auto zlib = std::vector<std::byte>{};
+		put(zlib, { 0x78, 0x01 });
+		for (auto offset = std::size_t{}; offset < data.size(); offset += 0xFFFF)
+		{
+			auto length = static_cast<uint32_t>(std::min<std::size_t>(0xFFFF, data.size() - offset));
+			put(zlib, { offset + length == data.size() ? 1u : 0u, length & 0xFF, length >> 8, ~length & 0xFF, (~length >> 8) & 0xFF });
+			for (auto i = offset; i < offset + length; i++)
+			{
+				zlib.push_back(static_cast<std::byte>(data[i]));
+			}
+		}
+		put_u32_be(zlib, adler32(data));
+		return zlib;
+	}
+
+	// RGBA PNG with every row Paeth filtered, its pixels deflated or in stored blocks
+	auto make_png(bool compress) -> std::vector<std::byte>
+	{
+		auto rng = std::mt19937{ 1 };
+		auto row_size = image_size * 4;
+		auto raw = std::vector<uint8_t>{};
+		auto above = std::vector<uint8_t>(row_size), row = std::vector<uint8_t>(row_size);
+		for (auto y = 0u; y < image_size; y++)
+		{
+			for (auto x = 0u; x < image_size; x++)
+			{
+				auto t = texel(x, y, rng);
+				std::copy(t.begin(), t.end(), row.begin() + x * 4);
+			}
+
+			raw.push_back(4);
+			for (auto i = 0u; i < row_size; i++)
+			{
+				int a = i >= 4 ? row[i - 4] : 0, b = above[i], c = i >= 4 ? above[i - 4] : 0;
+				auto p = a + b - c;
+				auto pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+				auto predicted = (pa <= pb and pa <= pc) ? a : (pb <= pc ? b : c);
+				raw.push_back(static_cast<uint8_t>(row[i] - predicted));
+			}
+			std::swap(above, row);
+		}
+
+		auto zlib = compress ? deflate(raw) : store(raw);
+
+		auto out = std::vector<std::byte>{};
+		put(out, { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' });
+		auto chunk = [&](const char *type, const std::vector<std::byte> &data)
+		{
+			put_u32_be(out, static_cast<uint32_t>(data.size()));
+			auto start = out.size();
+			put(out, { uint32_t(type[0]), uint32_t(type[1]), uint32_t(type[2]), uint32_t(type[3]) });
+			out.insert(out.end(), data.begin(), data.end());
+			put_u32_be(out, crc32(out.data() + start, out.size() - start));
+		};
+
+		auto header = std::vector<std::byte>{};
+		put_u32_be(header, image_size);
+		put_u32_be(header, image_size);
+		put(header, { 8, 6, 0, 0, 0 });
+		chunk("IHDR", header);
+		chunk("IDAT", zlib);
+		chunk("IEND", {});
+		return out;
+	}
+
+	// JPEG writes bits from the most significant down, a 0xFF byte is followed by 0 so it isn't taken for a marker
+	struct jpeg_writer
+	{
+		std::vector<std::byte> out{};
+		uint32_t bits{};
+		uint32_t count{};
+
+		void put(uint32_t value, uint32_t length)
+		{
+			bits = (bits << length) | (value & ((1u << length) - 1));
+			count += length;
+			while (count >= 8)
+			{
+				auto b = (bits >> (count - 8)) & 0xFF;
+				out.push_back(static_cast<std::byte>(b));
+				if (b == 0xFF)
+				{
+					out.push_back(std::byte{ 0 });
+				}
+				count -= 8;
+			}
+			bits &= (1u << count) - 1;
+		}
+
+		void flush()
+		{
+			if (count > 0)
+			{
+				put((1u << (8 - count)) - 1, 8 - count);
+			}
+		}
+	};
+
+	// Annex K tables, natural order
+	constexpr auto luma_quantisation = std::array<uint32_t, 64>{
+		16, 11, 10, 16, 24, 40, 51, 61,     12, 12, 14, 19, 26, 58, 60, 55,
+		14, 13, 16, 24, 40, 57, 69, 56,     14, 17, 22, 29, 51, 87, 80, 62,
+		18, 22, 37, 56, 68, 109, 103, 77,   24, 35, 55, 64, 81, 104, 113, 92,
+		49, 64, 78, 87, 103, 121, 120, 101, 72, 92, 95, 98, 112, 100, 103, 99,
+	};
+	constexpr auto chroma_quantisation = std::array<uint32_t, 64>{
+		17, 18, 24, 47, 99, 99, 99, 99, 18, 21, 26, 66, 99, 99, 99, 99,
+		24, 26, 56, 99, 99, 99, 99, 99, 47, 66, 99, 99, 99, 99, 99, 99,
+		99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+		99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+	};
+	constexpr auto zigzag = std::array<uint32_t, 64>{
+		0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+		12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+		35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+		58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+	};
+
+	// A Huffman symbol and the bits that follow it, table is DC then AC, luma then chroma
+	struct jpeg_symbol
+	{
+		uint8_t table;
+		uint8_t symbol;
+		uint8_t extra_length;
+		uint16_t extra;
+	};
+
+	// Bits of a coefficient's magnitude, and the coefficient as those bits, one less than it when negative
+	auto magnitude(int32_t value) -> std::pair<uint32_t, uint32_t>
+	{
+		auto size = 0u;
+		for (auto a = static_cast<uint32_t>(std::abs(value)); a > 0; a >>= 1)
+		{
+			size++;
+		}
+		auto bits = value >= 0 ? static_cast<uint32_t>(value) : static_cast<uint32_t>(value + (1 << size) - 1);
+		return { size, bits };
+	}
+
+	// Baseline JPEG, YCbCr with chroma halved both ways as cameras and editors write it, at quality 90.
+	// Huffman tables are fitted to the image like jpegtran -optimize writes them.
+	auto make_jpeg() -> std::vector<std::byte>
+	{
+		constexpr auto quality_scale = 20u;   // 200 - 2 * quality
+		constexpr auto pi = 3.14159265358979;
+
+		auto rng = std::mt19937{ 1 };
+		auto half = image_size / 2;
+		auto luma = std::vector<float>(image_size * image_size);
+		auto chroma = std::array{ std::vector<float>(half * half), std::vector<float>(half * half) };
+		for (auto y = 0u; y < image_size; y++)
+		{
+			for (auto x = 0u; x < image_size; x++)
+			{
+				auto t = texel(x, y, rng);
+				auto r = static_cast<float>(t[0]), g = static_cast<float>(t[1]), b = static_cast<float>(t[2]);
+				luma[y * image_size + x] = 0.299f * r + 0.587f * g + 0.114f * b;
+				chroma[0][(y / 2) * half + x / 2] += 0.25f * (-0.168736f * r - 0.331264f * g + 0.5f * b + 128.0f);
+				chroma[1][(y / 2) * half + x / 2] += 0.25f * (0.5f * r - 0.418688f * g - 0.081312f * b + 128.0f);
+			}
+		}
+
+		auto quantisation = std::array<std::array<uint32_t, 64>, 2>{};
+		for (auto i = 0u; i < 64; i++)
+		{
+			quantisation[0][i] = std::clamp((luma_quantisation[i] * quality_scale + 50) / 100, 1u, 255u);
+			quantisation[1][i] = std::clamp((chroma_quantisation[i] * quality_scale + 50) / 100, 1u, 255u);
+		}
+
+		auto cosines = std::array<float, 64>{};   // [x * 8 + u]
+		for (auto x = 0u; x < 8; x++)
+		{
+			for (auto u = 0u; u < 8; u++)
+			{
+				auto scale = u == 0 ? std::sqrt(0.125) : 0.5;
+				cosines[x * 8 + u] = static_cast<float>(scale * std::cos((2 * x + 1) * u * pi / 16));
+			}
+		}
+
+		// Forward DCT of one block, quantised and coded as symbols
+		auto symbols = std::vector<jpeg_symbol>{};
+		auto previous_dc = std::array<int32_t, 3>{};
+		auto code_block = [&](const std::vector<float> &plane, uint32_t width, uint32_t bx, uint32_t by, uint32_t component)
+		{
+			auto table = component == 0 ? 0u : 1u;
+			auto rows = std::array<float, 64>{};   // [y * 8 + u]
+			for (auto y = 0u; y < 8; y++)
+			{
+				for (auto u = 0u; u < 8; u++)
+				{
+					auto sum = 0.0f;
+					for (auto x = 0u; x < 8; x++)
+					{
+						sum += (plane[(by + y) * width + bx + x] - 128.0f) * cosines[x * 8 + u];
+					}
+					rows[y * 8 + u] = sum;
+				}
+			}
+
+			auto coefficients = std::array<int32_t, 64>{};   // zigzag order
+			for (auto i = 0u; i < 64; i++)
+			{
+				auto u = zigzag[i] % 8, v = zigzag[i] / 8;
+				auto sum = 0.0f;
+				for (auto y = 0u; y < 8; y++)
+				{
+					sum += rows[y * 8 + u] * cosines[y * 8 + v];
+				}
+				coefficients[i] = static_cast<int32_t>(std::lround(sum / quantisation[table][zigzag[i]]));
+			}
+
+			auto [dc_size, dc_bits] = magnitude(coefficients[0] - previous_dc[component]);
+			previous_dc[component] = coefficients[0];
+			symbols.push_back({ static_cast<uint8_t>(table * 2), static_cast<uint8_t>(dc_size), static_cast<uint8_t>(dc_size), static_cast<uint16_t>(dc_bits) });
+
+			auto zeros = 0u;
+			for (auto i = 1u; i < 64; i++)
+			{
+				if (coefficients[i] == 0)
+				{
+					zeros++;
+					continue;
+				}
+				for (; zeros > 15; zeros -= 16)
+				{
+					symbols.push_back({ static_cast<uint8_t>(table * 2 + 1), 0xF0, 0, 0 });
+				}
+				auto [size, bits] = magnitude(coefficients[i]);
+				symbols.push_back({ static_cast<uint8_t>(table * 2 + 1), static_cast<uint8_t>((zeros << 4) | size), static_cast<uint8_t>(size), static_cast<uint16_t>(bits) });
+				zeros = 0;
+			}
+			if (zeros > 0)
+			{
+				symbols.push_back({ static_cast<uint8_t>(table * 2 + 1), 0x00, 0, 0 });
+			}
+		};
+
+		// Each 16x16 unit is four luma blocks then one of each chroma
+		for (auto my = 0u; my < image_size; my += 16)
+		{
+			for (auto mx = 0u; mx < image_size; mx += 16)
+			{
+				code_block(luma, image_size, mx, my, 0);
+				code_block(luma, image_size, mx + 8, my, 0);
+				code_block(luma, image_size, mx, my + 8, 0);
+				code_block(luma, image_size, mx + 8, my + 8, 0);
+				code_block(chroma[0], half, mx / 2, my / 2, 1);
+				code_block(chroma[1], half, mx / 2, my / 2, 2);
+			}
+		}
+
+		// Symbol 256 stands in for the code of all ones, which JPEG doesn't allow, so it must be the last of the longest
+		auto lengths = std::array<std::vector<uint8_t>, 4>{};
+		auto codes = std::array<std::vector<uint32_t>, 4>{};
+		for (auto t = 0u; t < 4; t++)
+		{
+			auto frequencies = std::vector<uint32_t>(257);
+			for (auto &sym : symbols)
+			{
+				frequencies[sym.symbol] += sym.table == t ? 1 : 0;
+			}
+			frequencies[256] = 1;
+			lengths[t] = huffman_lengths(frequencies, 16);
+
+			auto longest = *std::max_element(lengths[t].begin(), lengths[t].end());
+			if (lengths[t][256] != longest)
+			{
+				auto last = std::find(lengths[t].rbegin() + 1, lengths[t].rend(), longest);
+				std::swap(*last, lengths[t][256]);
+			}
+			codes[t] = canonical_codes(lengths[t]);
+		}
+
+		auto out = std::vector<std::byte>{};
+		auto put_u16 = [&](uint32_t value)
+		{
+			put(out, { value >> 8, value & 0xFF });
+		};
+		put(out, { 0xFF, 0xD8 });
+
+		put(out, { 0xFF, 0xDB });
+		put_u16(2 + 2 * 65);
+		for (auto t = 0u; t < 2; t++)
+		{
+			put(out, { t });
+			for (auto i = 0u; i < 64; i++)
+			{
+				put(out, { quantisation[t][zigzag[i]] });
+			}
+		}
+
+		put(out, { 0xFF, 0xC0 });
+		put_u16(8 + 3 * 3);
+		put(out, { 8 });
+		put_u16(image_size);
+		put_u16(image_size);
+		put(out, { 3, 1, 0x22, 0, 2, 0x11, 1, 3, 0x11, 1 });
+
+		constexpr auto table_ids = std::array<uint32_t, 4>{ 0x00, 0x10, 0x01, 0x11 };
+		for (auto t = 0u; t < 4; t++)
+		{
+			auto counts = std::array<uint32_t, 17>{};
+			auto values = std::vector<uint32_t>{};
+			for (auto length = 1u; length <= 16; length++)
+			{
+				for (auto sym = 0u; sym < 256; sym++)
+				{
+					if (lengths[t][sym] == length)
+					{
+						counts[length]++;
+						values.push_back(sym);
+					}
+				}
+			}
+
+			put(out, { 0xFF, 0xC4 });
+			put_u16(2 + 1 + 16 + static_cast<uint32_t>(values.size()));
+			put(out, { table_ids[t] });
+			for (auto length = 1u; length <= 16; length++)
+			{
+				put(out, { counts[length] });
+			}
+			for (auto value : values)
+			{
+				put(out, { value });
+			}
+		}
+
+		put(out, { 0xFF, 0xDA });
+		put_u16(6 + 2 * 3);
+		put(out, { 3, 1, 0x00, 2, 0x11, 3, 0x11, 0, 63, 0 });
+
+		auto writer = jpeg_writer{};
+		for (auto &sym : symbols)
+		{
+			writer.put(codes[sym.table][sym.symbol], lengths[sym.table][sym.symbol]);
+			if (sym.extra_length > 0)
+			{
+				writer.put(sym.extra, sym.extra_length);
+			}
+		}
+		writer.flush();
+		out.insert(out.end(), writer.out.begin(), writer.out.end());
+
+		put(out, { 0xFF, 0xD9 });
+		return out;
+	}
+
+	auto make_inputs() -> std::vector<input_file>
+	{
+		auto inputs = std::vector<input_file>{};
+		for (auto i = 0u; i < image_count; i++)
+		{
+			inputs.push_back({ fmt::format("tga_rgb_{}", i), make_tga(false, false) });
+			inputs.push_back({ fmt::format("tga_rgba_rle_{}", i), make_tga(true, true) });
+			inputs.push_back({ fmt::format("png_rgba_stored_{}", i), make_png(false) });
+			inputs.push_back({ fmt::format("png_rgba_deflate_{}", i), make_png(true) });
+			inputs.push_back({ fmt::format("jpeg_420_{}", i), make_jpeg() });
+		}
+		return inputs;
+	}
+
+	auto load_inputs(const benchmarks::arguments &args) -> std::vector<input_file>
+	{
+		auto inputs = std::vector<input_file>{};
+		for (auto arg : args)
+		{
+			auto path = fs::path(arg);
+			auto file = load_binary_file(path);
+			auto bytes = file.bytes();
+			inputs.push_back({ path.filename().string(), { bytes.begin(), bytes.end() } });
+		}
+		return inputs;
+	}
+
+	auto megabytes_per_second(std::size_t bytes, ms time) -> double
+	{
+		return bytes / (1024.0 * 1024.0) / (time.count() / 1000.0);
+	}
+}
+
+auto dx11_lessons::benchmarks::decode(const arguments &args) -> int
+{
+	auto inputs = args.empty() ? make_inputs() : load_inputs(args);
+
+	auto files = std::vector<std::span<const std::byte>>{};
+	for (auto &input : inputs)
+	{
+		files.push_back(input.data);
+	}
+
+	// Best of a few runs, each file on its own with its rows spread over the threads
+	fmt::print("{:<24} {:>10} {:>12} {:>10} {:>10}\n", "file", "KB", "size", "ms", "MB/s out");
+	auto decoded_bytes = std::size_t{};
+	auto serial_time = ms{};
+	auto all_decoded = true;
+	for (auto &input : inputs)
+	{
+		auto best = ms{ std::numeric_limits<double>::max() };
+		auto image = std::optional<decoded_image>{};
+		for (auto run = 0; run < decode_runs; run++)
+		{
+			auto start = hrc::now();
+			image = decode_image(input.data);
+			best = std::min(best, ms{ hrc::now() - start });
+		}
+
+		if (not image)
+		{
+			fmt::print("{:<24} {:>10} {:>12}\n", input.name, input.data.size() / 1024, "FAILED");
+			all_decoded = false;
+			continue;
+		}
+		decoded_bytes += image->texels.size();
+		serial_time += best;
+		fmt::print("{:<24} {:>10} {:>12} {:>10.2f} {:>10.0f}\n", input.name, input.data.size() / 1024,
+		           fmt::format("{}x{}", image->width, image->height), best.count(),
+		           megabytes_per_second(image->texels.size(), best));
+	}
+
+	// Then every file at once, spread over the threads as well
+	auto batch_time = ms{ std::numeric_limits<double>::max() };
+	for (auto run = 0; run < decode_runs; run++)
+	{
+		auto start = hrc::now();
+		auto images = decode_images(files);
+		batch_time = std::min(batch_time, ms{ hrc::now() - start });
+		all_decoded = all_decoded and std::all_of(images.begin(), images.end(), [](auto &image) { return image.has_value(); });
+	}
+
+	fmt::print("one at a time: {:.2f} ms, {:.0f} MB/s\n", serial_time.count(), megabytes_per_second(decoded_bytes, serial_time));
+	fmt::print("all at once:   {:.2f} ms, {:.0f} MB/s, {:.2f}x\n", batch_time.count(),
+	           megabytes_per_second(decoded_bytes, batch_time), serial_time / batch_time);
+	return all_decoded ? 0 : 1;
+}
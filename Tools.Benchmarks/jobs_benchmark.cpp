@@ -0,0 +1,227 @@
+#include "benchmarks.h"
+
+#include "job_system.h"
+
+#include <fmt/core.h>
+#include <array>
+#include <chrono>
+#include <future>
+#include <string>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <thread>
+#include <cstdlib>
+
+using namespace dx11_lessons;
+
+namespace
+{
+	using hrc = std::chrono::high_resolution_clock;
+	using ms = std::chrono::duration<double, std::milli>;
+
+	constexpr auto runs = 5;
+	constexpr auto default_job_count = 100'000u;
+	constexpr auto async_job_limit = 2'000u;   // a thread each, more only measures the OS
+	constexpr auto item_count = 1u << 20;
+	constexpr auto item_grain = 1'024u;
+	constexpr auto outer_count = 64u;
+
+	auto to_number(std::string_view text, uint32_t fallback) -> uint32_t
+	{
+		auto number = std::strtoul(std::string(text).c_str(), nullptr, 10);
+		return number > 0 ? static_cast<uint32_t>(number) : fallback;
+	}
+
+	// A few hundred ns of integer work, iterations scale it, the result keeps it from being optimised out
+	auto work(uint32_t seed, uint32_t iterations) -> uint32_t
+	{
+		auto x = seed * 2'654'435'761u + 1;
+		for (auto i = 0u; i < iterations; i++)
+		{
+			x ^= x << 13;
+			x ^= x >> 17;
+			x ^= x << 5;
+		}
+		return x;
+	}
+
+	template <typename fn_t>
+	auto best_of(fn_t fn) -> double
+	{
+		auto best = ms::max();
+		for (auto run = 0; run < runs; run++)
+		{
+			auto start = hrc::now();
+			fn();
+			best = std::min(best, ms(hrc::now() - start));
+		}
+		return best.count();
+	}
+
+	void print_throughput(std::string_view name, uint32_t count, double time)
+	{
+		fmt::print("{:<24} {:>9} {:>10.3f} {:>10.1f} {:>12.0f}\n",
+		           name, count, time, time * 1e6 / count, count / time * 1e3);
+	}
+
+	// Many tiny jobs from one thread, the cost is all scheduling
+	void throughput(uint32_t job_count)
+	{
+		auto &jobs = job_system::shared();
+		auto results = std::vector<uint32_t>(job_count);
+
+		fmt::print("{:<24} {:>9} {:>10} {:>10} {:>12}\n", "scheduler", "jobs", "ms (best)", "ns / job", "jobs / s");
+
+		auto time = best_of([&]
+		{
+			auto group = task_group{};
+			for (auto i = 0u; i < job_count; i++)
+			{
+				jobs.run(group, [&results, i]
+				{
+					results[i] = work(i, 16);
+				});
+			}
+			jobs.wait(group);
+		});
+		print_throughput("job_system run", job_count, time);
+
+		time = best_of([&]
+		{
+			jobs.parallel_for(job_count, 1, [&](uint32_t first, uint32_t last)
+			{
+				for (auto i = first; i < last; i++)
+				{
+					results[i] = work(i, 16);
+				}
+			});
+		});
+		print_throughput("job_system parallel_for", job_count, time);
+
+		auto async_count = std::min(job_count, async_job_limit);
+		time = best_of([&]
+		{
+			auto futures = std::vector<std::future<void>>{};
+			futures.reserve(async_count);
+			for (auto i = 0u; i < async_count; i++)
+			{
+				futures.emplace_back(std::async(std::launch::async, [&results, i]
+				{
+					results[i] = work(i, 16);
+				}));
+			}
+			for (auto &f : futures)
+			{
+				f.get();
+			}
+		});
+		print_throughput("std::async", async_count, time);
+	}
+
+	// Same work on systems of more and more workers. Uneven items cost up to 8 times the cheapest,
+	// the late ranges are the slow ones so stealing is what keeps threads busy to the end.
+	void scaling()
+	{
+		auto thread_counts = std::vector<uint32_t>{};
+		auto hardware = std::max(std::thread::hardware_concurrency(), 1u);
+		for (auto threads = 1u; threads < hardware; threads *= 2)
+		{
+			thread_counts.push_back(threads);
+		}
+		thread_counts.push_back(hardware);
+
+		auto results = std::vector<uint32_t>(item_count);
+		auto uneven_cost = [](uint32_t i)
+		{
+			return 8 + 56 * i / item_count;
+		};
+		auto checksum = [&]
+		{
+			return std::accumulate(results.begin(), results.end(), uint32_t{}, [](uint32_t a, uint32_t b)
+			{
+				return a ^ b;
+			});
+		};
+
+		for (auto i = 0u; i < item_count; i++)
+		{
+			results[i] = work(i, uneven_cost(i));
+		}
+		auto expected = checksum();
+
+		fmt::print("\n{:<10} {:>12} {:>8} {:>12} {:>8} {:>12} {:>8}\n",
+		           "threads", "even ms", "speedup", "uneven ms", "speedup", "nested ms", "speedup");
+
+		auto base = std::array<double, 3>{};
+		for (auto threads : thread_counts)
+		{
+			// The thread calling parallel_for helps, so one less worker
+			auto jobs = job_system(threads - 1);
+
+			auto even = best_of([&]
+			{
+				jobs.parallel_for(item_count, item_grain, [&](uint32_t first, uint32_t last)
+				{
+					for (auto i = first; i < last; i++)
+					{
+						results[i] = work(i, 32);
+					}
+				});
+			});
+
+			auto uneven = best_of([&]
+			{
+				jobs.parallel_for(item_count, item_grain, [&](uint32_t first, uint32_t last)
+				{
+					for (auto i = first; i < last; i++)
+					{
+						results[i] = work(i, uneven_cost(i));
+					}
+				});
+			});
+			auto uneven_ok = checksum() == expected;
+
+			// Outer ranges wait on inner ones from inside jobs, waits help rather than block
+			auto nested = best_of([&]
+			{
+				jobs.parallel_for(outer_count, 1, [&](uint32_t outer_first, uint32_t outer_last)
+				{
+					for (auto outer = outer_first; outer < outer_last; outer++)
+					{
+						auto begin = outer * (item_count / outer_count);
+						jobs.parallel_for(item_count / outer_count, item_grain, [&](uint32_t first, uint32_t last)
+						{
+							for (auto i = begin + first; i < begin + last; i++)
+							{
+								results[i] = work(i, uneven_cost(i));
+							}
+						});
+					}
+				});
+			});
+			auto nested_ok = checksum() == expected;
+
+			if (threads == 1)
+			{
+				base = { even, uneven, nested };
+			}
+			fmt::print("{:<10} {:>12.3f} {:>8.2f} {:>12.3f} {:>8.2f} {:>12.3f} {:>8.2f}{}\n",
+			           threads, even, base[0] / even, uneven, base[1] / uneven, nested, base[2] / nested,
+			           (uneven_ok and nested_ok) ? "" : "  MISMATCH");
+		}
+	}
+}
+
+auto dx11_lessons::benchmarks::jobs(const arguments &args) -> int
+{
+	auto job_count = args.empty() ? default_job_count : to_number(args[0], default_job_count);
+
+	fmt::print("{} hardware threads, shared system has {} workers\n\n",
+	           std::thread::hardware_concurrency(), job_system::shared().worker_count());
+
+	throughput(job_count);
+	scaling();
+
+	return 0;
+}
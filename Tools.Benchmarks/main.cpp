@@ -0,0 +1,51 @@
+#include "benchmarks.h"
+
+#include <fmt/core.h>
+#include <array>
+#include <utility>
+#include <string_view>
+
+using namespace dx11_lessons;
+using namespace std::string_view_literals;
+
+namespace
+{
+	using benchmark_fn = auto (*)(const benchmarks::arguments &) -> int;
+
+	constexpr auto benchmark_list = std::array
+	{
+		std::pair{ "bvh"sv, static_cast<benchmark_fn>(benchmarks::bvh) },
+		std::pair{ "sphere"sv, static_cast<benchmark_fn>(benchmarks::sphere) },
+		std::pair{ "pack"sv, static_cast<benchmark_fn>(benchmarks::pack) },
+		std::pair{ "streaming"sv, static_cast<benchmark_fn>(benchmarks::streaming) },
+		std::pair{ "decode"sv, static_cast<benchmark_fn>(benchmarks::decode) },
+		std::pair{ "jobs"sv, static_cast<benchmark_fn>(benchmarks::jobs) },
+	};
+}
+
+auto main(int argc, char *argv[]) -> int
+{
+	if (argc < 2)
+	{
+		fmt::print("usage: {} <benchmark> [options]\nbenchmarks:\n", argv[0]);
+		for (auto &[name, fn] : benchmark_list)
+		{
+			fmt::print("  {}\n", name);
+		}
+		return 1;
+	}
+
+	auto name = std::string_view{ argv[1] };
+	auto args = benchmarks::arguments(argv + 2, argv + argc);
+
+	for (auto &[bm_name, fn] : benchmark_list)
+	{
+		if (bm_name == name)
+		{
+			return fn(args);
+		}
+	}
+
+	fmt::print("unknown benchmark: {}\n", name);
+	return 1;
+}
@@ -0,0 +1,226 @@
+#include "benchmarks.h"
+
+#include "asset_pack.h"
+#include "helpers.h"
+
+#include <fmt/core.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <random>
+#include <filesystem>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace dx11_lessons;
+namespace fs = std::filesystem;
+
+namespace
+{
+	using hrc = std::chrono::high_resolution_clock;
+	using ms = std::chrono::duration<double, std::milli>;
+
+	constexpr auto load_runs = 5;
+	constexpr auto texture_size = 2048u;
+	constexpr auto vertex_count = 1u << 20;
+	constexpr auto noise_size = 8u << 20;
+
+	struct input_file
+	{
+		std::string name;
+		std::vector<std::byte> data;
+	};
+
+	// RGBA8 image with smooth gradients and a little noise, like an uncompressed dds
+	auto make_texture() -> std::vector<std::byte>
+	{
+		auto rng = std::mt19937{ 1 };
+		auto data = std::vector<std::byte>(texture_size * texture_size * 4);
+		for (auto y = 0u; y < texture_size; y++)
+		{
+			for (auto x = 0u; x < texture_size; x++)
+			{
+				auto p = &data[(y * texture_size + x) * 4];
+				p[0] = static_cast<std::byte>(x / 8);
+				p[1] = static_cast<std::byte>(y / 8);
+				p[2] = static_cast<std::byte>(((x / 64) ^ (y / 64)) & 1 ? 200 : 40 + rng() % 4);
+				p[3] = std::byte{ 255 };
+			}
+		}
+		return data;
+	}
+
+	// Position, normal, texcoord floats of a wavy grid
+	auto make_vertices() -> std::vector<std::byte>
+	{
+		auto floats = std::vector<float>{};
+		floats.reserve(vertex_count * 8);
+		auto side = static_cast<uint32_t>(std::sqrt(vertex_count));
+		for (auto i = 0u; i < vertex_count; i++)
+		{
+			auto u = static_cast<float>(i % side) / side,
+			     v = static_cast<float>(i / side) / side;
+			floats.insert(floats.end(), { u * 10.0f, 0.5f * std::sin(u * 31.0f), v * 10.0f,
+			                              0.0f, 1.0f, 0.0f,
+			                              u, v });
+		}
+
+		auto data = std::vector<std::byte>(floats.size() * sizeof(float));
+		std::memcpy(data.data(), floats.data(), data.size());
+		return data;
+	}
+
+	// Doesn't compress, the builder should store it raw
+	auto make_noise() -> std::vector<std::byte>
+	{
+		auto rng = std::mt19937{ 2 };
+		auto data = std::vector<std::byte>(noise_size);
+		std::generate(data.begin(), data.end(), [&]
+		{
+			return static_cast<std::byte>(rng());
+		});
+		return data;
+	}
+
+	auto collect_inputs(const benchmarks::arguments &args) -> std::vector<input_file>
+	{
+		auto inputs = std::vector<input_file>{};
+		if (args.empty())
+		{
+			inputs.push_back({ "texture.dds", make_texture() });
+			inputs.push_back({ "vertices.bin", make_vertices() });
+			inputs.push_back({ "noise.bin", make_noise() });
+			return inputs;
+		}
+
+		for (auto arg : args)
+		{
+			auto file = load_binary_file(std::string(arg));
+			inputs.push_back({ fs::path(arg).generic_string(), { file.begin(), file.end() } });
+		}
+		return inputs;
+	}
+
+	// Drops the file from the OS cache so loads come from disk, only done where it's easy
+	auto evict_from_cache(const fs::path &path) -> bool
+	{
+#ifdef _WIN32
+		(void)path;
+		return false;
+#else
+		auto fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+		{
+			return false;
+		}
+		auto evicted = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+		close(fd);
+		return evicted;
+#endif
+	}
+
+	// Open the pack and unpack every entry into buffers allocated up front, as staging buffers would be
+	auto load_all(const fs::path &path, std::vector<std::vector<std::byte>> &destinations) -> bool
+	{
+		auto pack = asset_pack(path);
+		auto all_good = pack.is_valid();
+		for (auto i = 0u; all_good and i < pack.entry_count(); i++)
+		{
+			all_good = pack.read_entry(i, destinations[i]);
+		}
+		return all_good;
+	}
+
+	void measure(std::string_view label, const fs::path &path, const std::vector<input_file> &inputs, bool cold)
+	{
+		auto destinations = std::vector<std::vector<std::byte>>{};
+		auto names = std::vector<std::string>{};
+		auto total_size = std::size_t{};
+		{
+			// Closed again before timing, a live mapping would keep the pages cached
+			auto pack = asset_pack(path);
+			for (auto i = 0u; i < pack.entry_count(); i++)
+			{
+				destinations.emplace_back(pack.entry_size(i));
+				names.emplace_back(pack.entry_name(i));
+				total_size += pack.entry_size(i);
+			}
+		}
+
+		auto best = ms::max();
+		auto all_good = true;
+		for (auto run = 0; run < load_runs; run++)
+		{
+			if (cold)
+			{
+				evict_from_cache(path);
+			}
+			auto start = hrc::now();
+			all_good = load_all(path, destinations) and all_good;
+			best = std::min(best, ms(hrc::now() - start));
+		}
+
+		// Destinations are in pack order, which is by name hash
+		for (auto i = 0u; all_good and i < destinations.size(); i++)
+		{
+			auto input = std::find_if(inputs.begin(), inputs.end(), [&](const input_file &f)
+			{
+				return f.name == names[i];
+			});
+			all_good = input != inputs.end() and input->data == destinations[i];
+		}
+
+		fmt::print("{:<16} {:>5} {:>12} {:>10.2f} {:>10.0f} {}\n",
+		           label, cold ? "cold" : "warm", fs::file_size(path), best.count(),
+		           total_size / (best.count() / 1000.0) / (1024.0 * 1024.0),
+		           all_good ? "" : "MISMATCH");
+	}
+}
+
+auto dx11_lessons::benchmarks::pack(const arguments &args) -> int
+{
+	auto inputs = collect_inputs(args);
+	auto directory = fs::temp_directory_path();
+	auto raw_path = directory / "pack_benchmark_raw.pak",
+	     lz_path = directory / "pack_benchmark_lz.pak";
+
+	auto build = [&](asset_pack_builder::compression mode, const fs::path &path)
+	{
+		auto start = hrc::now();
+		auto builder = asset_pack_builder(mode);
+		for (auto &input : inputs)
+		{
+			builder.add(input.name, input.data);
+		}
+		builder.write(path);
+		fmt::print("built {} in {:.1f} ms, {} of {} entries compressed\n",
+		           path.filename().string(), ms(hrc::now() - start).count(),
+		           builder.compressed_count(), builder.entry_count());
+	};
+	build(asset_pack_builder::compression::none, raw_path);
+	build(asset_pack_builder::compression::automatic, lz_path);
+
+	// Cold loads only differ from warm ones where the cache can be dropped
+	auto cold = evict_from_cache(raw_path);
+
+	fmt::print("{:<16} {:>5} {:>12} {:>10} {:>10}\n", "pack", "cache", "file bytes", "ms (best)", "MB/s");
+	for (auto is_cold : { false, true })
+	{
+		if (is_cold and not cold)
+		{
+			continue;
+		}
+		measure("raw", raw_path, inputs, is_cold);
+		measure("compressed", lz_path, inputs, is_cold);
+	}
+
+	fs::remove(raw_path);
+	fs::remove(lz_path);
+	return 0;
+}
@@ -0,0 +1,177 @@
+#include "benchmarks.h"
+
+#include "procedural_sphere.h"
+
+#include <fmt/core.h>
+#include <DirectXMath.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <charconv>
+#include <algorithm>
+
+using namespace dx11_lessons;
+using namespace DirectX;
+
+namespace
+{
+	using hrc = std::chrono::high_resolution_clock;
+	using ms = std::chrono::duration<double, std::milli>;
+
+	constexpr auto runs = 5;
+	constexpr auto default_max_level = 5u;
+
+	struct vertex
+	{
+		XMFLOAT3 position;
+		XMFLOAT3 normal;
+		XMFLOAT2 texcoord;
+	};
+
+	struct mesh
+	{
+		std::vector<vertex> vertices;
+		std::vector<uint32_t> indicies;
+	};
+
+	auto make_cube_base() -> mesh
+	{
+		auto cube = make_sphere_mesh<mesh>({ sphere_topology::cube, 0 });
+		for (auto &v : cube.vertices)
+		{
+			XMStoreFloat3(&v.position, XMLoadFloat3(&v.position) * std::sqrt(3.0f));
+		}
+		return cube;
+	}
+
+	// spherify_and_invert as it was in L8 - L10, kept to compare against
+	auto spherify_and_invert(const mesh &cube, uint32_t subdivide_count) -> mesh
+	{
+		auto divide_edge = [](vertex v0, vertex v1) -> vertex
+		{
+			auto mp = vertex{};
+			mp.position = XMFLOAT3{
+				0.5f * (v0.position.x + v1.position.x),
+				0.5f * (v0.position.y + v1.position.y),
+				0.5f * (v0.position.z + v1.position.z),
+			};
+			mp.normal = v0.normal;
+			mp.texcoord = XMFLOAT2{
+				0.5f * (v0.texcoord.x + v1.texcoord.x),
+				0.5f * (v0.texcoord.y + v1.texcoord.y),
+			};
+
+			return mp;
+		};
+
+		auto sub_divide_triangle = [&](const vertex &v0, const vertex &v1, const vertex &v2, const uint32_t index) -> mesh
+		{
+			auto m0 = divide_edge(v0, v1),
+			     m1 = divide_edge(v1, v2),
+			     m2 = divide_edge(v2, v0);
+
+			return mesh
+			{
+				{ v0, m0, v1, m1, v2, m2 },
+				{
+					index + 0, index + 1, index + 5,
+					index + 1, index + 2, index + 3,
+					index + 3, index + 4, index + 5,
+					index + 1, index + 3, index + 5,
+				}
+			};
+		};
+
+		auto sub_divide_mesh = [&](const mesh &shape) -> mesh
+		{
+			auto result_mesh = mesh{};
+			auto &vertices = result_mesh.vertices;
+			auto &indicies = result_mesh.indicies;
+
+			auto number_of_triangles = shape.indicies.size() / 3u;
+			for (size_t i = 0; i < number_of_triangles; i++)
+			{
+				auto triangle = sub_divide_triangle(shape.vertices[shape.indicies[i * 3]],
+				                                    shape.vertices[shape.indicies[i * 3 + 1]],
+				                                    shape.vertices[shape.indicies[i * 3 + 2]],
+				                                    static_cast<uint32_t>(i) * 6);
+
+				vertices.insert(vertices.end(), triangle.vertices.begin(), triangle.vertices.end());
+				indicies.insert(indicies.end(), triangle.indicies.begin(), triangle.indicies.end());
+			}
+
+			return result_mesh;
+		};
+
+		auto result_mesh = mesh{};
+
+		for (uint16_t i = 0; i < subdivide_count; i++)
+		{
+			auto &msh = (i == 0) ? cube : result_mesh;
+
+			result_mesh = sub_divide_mesh(msh);
+		}
+
+		result_mesh.vertices.shrink_to_fit();
+		result_mesh.indicies.shrink_to_fit();
+
+		for (auto &v : result_mesh.vertices)
+		{
+			auto n = XMLoadFloat3(&v.normal);
+			n = -1.0f * n;
+			XMStoreFloat3(&v.normal, n);
+
+			auto p = XMLoadFloat3(&v.position);
+			p = XMVector3Normalize(p);
+			XMStoreFloat3(&v.position, p);
+		}
+
+		return result_mesh;
+	}
+
+	template <typename fn_t>
+	void measure(std::string_view name, uint32_t level, fn_t generate)
+	{
+		auto best = ms::max();
+		auto result = mesh{};
+		for (auto run = 0; run < runs; run++)
+		{
+			auto start = hrc::now();
+			result = generate();
+			best = std::min(best, ms(hrc::now() - start));
+		}
+
+		fmt::print("{:<20} {:>5} {:>10} {:>10} {:>10.3f}\n",
+		           name, level, result.vertices.size(), result.indicies.size() / 3, best.count());
+	}
+}
+
+auto dx11_lessons::benchmarks::sphere(const arguments &args) -> int
+{
+	auto max_level = default_max_level;
+	if (not args.empty())
+	{
+		std::from_chars(args.front().data(), args.front().data() + args.front().size(), max_level);
+	}
+
+	auto cube_base = make_cube_base();
+
+	fmt::print("{:<20} {:>5} {:>10} {:>10} {:>10}\n", "generator", "level", "vertices", "triangles", "ms (best)");
+	for (auto level = 1u; level <= max_level; level++)
+	{
+		measure("spherify_and_invert", level, [&]
+		{
+			return spherify_and_invert(cube_base, level);
+		});
+		measure("cube sphere", level, [&]
+		{
+			return make_sphere_mesh<mesh>({ sphere_topology::cube, level, sphere_facing::inward });
+		});
+		measure("icosphere", level, [&]
+		{
+			return make_sphere_mesh<mesh>({ sphere_topology::icosahedron, level, sphere_facing::inward });
+		});
+	}
+
+	return 0;
+}
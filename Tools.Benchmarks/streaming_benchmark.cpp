@@ -0,0 +1,169 @@
+#include "benchmarks.h"
+
+#include "texture_streamer.h"
+
+#include <fmt/core.h>
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+using namespace dx11_lessons;
+
+namespace
+{
+	using hrc = std::chrono::high_resolution_clock;
+	using ms = std::chrono::duration<double, std::milli>;
+
+	constexpr auto default_texture_count = 500u;
+	constexpr auto default_upload_kib = 2048u;
+	constexpr auto default_memory_mib = 192u;
+	constexpr auto tail_size = 16u;
+	constexpr auto frame_limit = 10'000u;
+	constexpr auto camera_cut_frames = std::array{ 60u, 120u };
+
+	// Square BC7 textures of 256 to 4096 texels, one byte a texel, a sixth of them cubes
+	auto make_texture(std::mt19937 &rng) -> streamed_texture_info
+	{
+		auto size = 256u << (rng() % 5);
+		auto slices = rng() % 6 == 0 ? 6u : 1u;
+
+		auto info = streamed_texture_info{ size, {} };
+		for (auto mip_size = size; mip_size > 0; mip_size /= 2)
+		{
+			auto blocks = std::max(1u, mip_size / 4);
+			info.mip_bytes.push_back(std::size_t{ blocks } * blocks * 16 * slices);
+		}
+		return info;
+	}
+
+	// Half the textures are off screen, most others are small and a few are right in front of the camera
+	auto make_view(std::mt19937 &rng, uint32_t texture_count) -> std::vector<float>
+	{
+		auto dist = std::uniform_real_distribution<float>{ 0.0f, 1.0f };
+		auto view = std::vector<float>(texture_count);
+		for (auto &pixels : view)
+		{
+			auto visible = dist(rng) < 0.5f;
+			pixels = visible ? 16.0f * std::pow(2.0f, 8.0f * dist(rng) * dist(rng)) : 0.0f;
+		}
+		return view;
+	}
+
+	void set_view(texture_streamer &streamer, const std::vector<float> &view)
+	{
+		for (auto id = 0u; id < view.size(); id++)
+		{
+			streamer.set_screen_size(id, view[id]);
+		}
+	}
+
+	auto to_number(std::string_view text, uint32_t fallback) -> uint32_t
+	{
+		auto number = std::strtoul(std::string(text).c_str(), nullptr, 10);
+		return number > 0 ? static_cast<uint32_t>(number) : fallback;
+	}
+
+	// Mips still missing over every texture, 0 when each is as sharp as it is drawn
+	auto blur(const texture_streamer &streamer, uint32_t texture_count) -> double
+	{
+		auto total = 0.0;
+		for (auto id = 0u; id < texture_count; id++)
+		{
+			auto missing = static_cast<int>(streamer.resident_mip(id)) - static_cast<int>(streamer.wanted_mip(id));
+			total += std::max(0, missing);
+		}
+		return total;
+	}
+}
+
+auto dx11_lessons::benchmarks::streaming(const arguments &args) -> int
+{
+	auto texture_count = args.size() > 0 ? to_number(args[0], default_texture_count) : default_texture_count;
+	auto upload_budget = std::size_t{ args.size() > 1 ? to_number(args[1], default_upload_kib) : default_upload_kib } * 1024;
+	auto memory_budget = std::size_t{ args.size() > 2 ? to_number(args[2], default_memory_mib) : default_memory_mib } * 1024 * 1024;
+
+	auto rng = std::mt19937{ 1 };
+	auto streamer = texture_streamer(tail_size, memory_budget);
+	auto total_bytes = std::size_t{},
+	     tail_bytes = std::size_t{};
+	auto tail_mips = std::vector<uint32_t>{};
+	for (auto id = 0u; id < texture_count; id++)
+	{
+		auto info = make_texture(rng);
+		auto tail_mip = 0u;
+		while ((info.size >> tail_mip) > tail_size)
+		{
+			tail_mip++;
+		}
+		for (auto mip = 0u; mip < info.mip_bytes.size(); mip++)
+		{
+			total_bytes += info.mip_bytes[mip];
+			tail_bytes += mip >= tail_mip ? info.mip_bytes[mip] : 0;
+		}
+		tail_mips.push_back(tail_mip);
+		streamer.add(id, std::move(info));
+	}
+
+	// Away and back again, textures seen in the first view and evicted in the second are refetched
+	auto first_view = make_view(rng, texture_count),
+	     second_view = make_view(rng, texture_count);
+	set_view(streamer, first_view);
+
+	fmt::print("{} textures, {:.1f} MiB of mips, {} KiB a frame, {} MiB budget\n",
+	           texture_count, total_bytes / (1024.0 * 1024.0), upload_budget / 1024, memory_budget / (1024 * 1024));
+	fmt::print("{:>8} {:>10} {:>12} {:>12} {:>10} {:>10} {:>8}\n",
+	           "frame", "uploads", "MiB resident", "MiB pending", "evictions", "refetches", "blur");
+
+	auto schedule_time = ms{};
+	auto all_drawable = true,
+	     within_budget = true;
+	auto frame = 0u;
+	auto report = 1u;
+	for (; frame < frame_limit; frame++)
+	{
+		if (frame == camera_cut_frames[0] or frame == camera_cut_frames[1])
+		{
+			set_view(streamer, frame == camera_cut_frames[0] ? second_view : first_view);
+			fmt::print("{:>8} camera cut\n", frame);
+			report = frame + 1;
+		}
+
+		auto start = hrc::now();
+		auto schedule = streamer.schedule(upload_budget);
+		schedule_time += hrc::now() - start;
+
+		// Every texture has at least its tail after the first frame, and only tails go over the budget
+		for (auto id = 0u; frame == 0 and id < texture_count; id++)
+		{
+			all_drawable = all_drawable and streamer.resident_mip(id) <= tail_mips[id];
+		}
+		auto &stats = streamer.stats();
+		within_budget = within_budget and stats.resident_bytes <= std::max(memory_budget, tail_bytes);
+
+		// Done once nothing more can be uploaded after the last cut, everything wanted or the budget full
+		auto settled = frame >= camera_cut_frames[1] and schedule.uploads.empty();
+		if (frame + 1 == report or settled)
+		{
+			fmt::print("{:>8} {:>10} {:>12.1f} {:>12.1f} {:>10} {:>10} {:>8.0f}\n",
+			           frame + 1, stats.uploads, stats.resident_bytes / (1024.0 * 1024.0),
+			           stats.pending_bytes / (1024.0 * 1024.0), stats.evictions, stats.refetches,
+			           blur(streamer, texture_count));
+			report = 2 * report;
+		}
+		if (settled)
+		{
+			break;
+		}
+	}
+
+	fmt::print("settled after {} frames, {:.3f} ms a frame scheduling, {}, {}\n",
+	           frame + 1, schedule_time.count() / (frame + 1),
+	           all_drawable ? "all drawable after the first" : "SOME NOT DRAWABLE AFTER THE FIRST",
+	           within_budget ? "within budget" : "OVER BUDGET");
+	return all_drawable and within_budget ? 0 : 1;
+}
@@ -0,0 +1,375 @@
+#include "obj_mtl_parser.h"
+#include "mesh_analysis.h"
+#include "helpers.h"
+
+#include <fmt/core.h>
+#include <array>
+#include <vector>
+#include <span>
+#include <string>
+#include <string_view>
+#include <filesystem>
+#include <optional>
+#include <utility>
+#include <charconv>
+#include <algorithm>
+#include <cctype>
+
+using namespace dx11_lessons;
+using namespace std::string_view_literals;
+
+namespace
+{
+	using loader_fn = auto (*)(std::span<const std::byte>) -> obj_data;
+
+	constexpr auto supported_formats = std::array
+	{
+		std::pair{ ".obj"sv, static_cast<loader_fn>(parse_obj) },
+	};
+
+	struct budget
+	{
+		std::optional<float> max_acmr;
+		std::optional<float> max_atvr;
+		std::optional<float> max_overdraw;
+		std::optional<float> min_fetch_efficiency;
+		std::optional<uint64_t> max_bytes;   // in the first candidate format
+	};
+
+	struct options
+	{
+		bool json = false;
+		analysis_settings settings{};
+		budget limits{};
+		std::vector<std::filesystem::path> files{};
+	};
+
+	struct file_report
+	{
+		std::string path;
+		mesh_report report;
+		std::vector<std::string> failures;
+	};
+
+	void print_usage(std::string_view exe)
+	{
+		fmt::print("usage: {} [options] <mesh file>...\n"
+		           "options:\n"
+		           "  --json                       print json instead of a table\n"
+		           "  --cache <entries>            post transform cache size (default 16)\n"
+		           "  --stride <bytes>             vertex stride for fetch simulation (default 32)\n"
+		           "  --max-acmr <value>           fail if any group is above\n"
+		           "  --max-atvr <value>\n"
+		           "  --max-overdraw <value>\n"
+		           "  --min-fetch-efficiency <value>\n"
+		           "  --max-bytes <bytes>          vertex + index bytes, {} format\n"
+		           "formats:",
+		           exe, candidate_vertex_formats[0].name);
+		for (auto &[ext, fn] : supported_formats)
+		{
+			fmt::print(" {}", ext);
+		}
+		fmt::print("\n");
+	}
+
+	template <typename T>
+	auto parse_number(std::string_view text) -> std::optional<T>
+	{
+		auto value = T{};
+		auto [p, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+		if (ec != std::errc() or p != text.data() + text.size())
+		{
+			return std::nullopt;
+		}
+		return value;
+	}
+
+	auto parse_arguments(int argc, char *argv[]) -> std::optional<options>
+	{
+		auto opts = options{};
+		auto args = std::vector<std::string_view>(argv + 1, argv + argc);
+
+		for (auto i = 0u; i < args.size(); i++)
+		{
+			auto arg = args[i];
+			if (not arg.starts_with("--"))
+			{
+				opts.files.emplace_back(arg);
+				continue;
+			}
+
+			if (arg == "--json")
+			{
+				opts.json = true;
+				continue;
+			}
+
+			if (i + 1 == args.size())
+			{
+				fmt::print(stderr, "missing value for {}\n", arg);
+				return std::nullopt;
+			}
+			auto value = args[++i];
+
+			auto ok = true;
+			auto set_float = [&](std::optional<float> &dest)
+			{
+				dest = parse_number<float>(value);
+				ok = dest.has_value();
+			};
+			auto set_count = [&](uint32_t &dest)
+			{
+				auto v = parse_number<uint32_t>(value);
+				ok = v.has_value();
+				dest = v.value_or(dest);
+			};
+			auto set_bytes = [&](std::optional<uint64_t> &dest)
+			{
+				dest = parse_number<uint64_t>(value);
+				ok = dest.has_value();
+			};
+
+			if (arg == "--cache")                        set_count(opts.settings.cache_size);
+			else if (arg == "--stride")                  set_count(opts.settings.vertex_stride);
+			else if (arg == "--max-acmr")                set_float(opts.limits.max_acmr);
+			else if (arg == "--max-atvr")                set_float(opts.limits.max_atvr);
+			else if (arg == "--max-overdraw")            set_float(opts.limits.max_overdraw);
+			else if (arg == "--min-fetch-efficiency")    set_float(opts.limits.min_fetch_efficiency);
+			else if (arg == "--max-bytes")               set_bytes(opts.limits.max_bytes);
+			else
+			{
+				fmt::print(stderr, "unknown option {}\n", arg);
+				return std::nullopt;
+			}
+
+			if (not ok)
+			{
+				fmt::print(stderr, "bad value for {}: {}\n", arg, value);
+				return std::nullopt;
+			}
+		}
+
+		if (opts.files.empty() or opts.settings.cache_size == 0 or opts.settings.vertex_stride == 0)
+		{
+			return std::nullopt;
+		}
+		return opts;
+	}
+
+	auto load_mesh(const std::filesystem::path &path) -> std::optional<obj_data>
+	{
+		if (not std::filesystem::is_regular_file(path))
+		{
+			fmt::print(stderr, "{}: file not found\n", path.string());
+			return std::nullopt;
+		}
+
+		auto ext = path.extension().string();
+		std::transform(ext.begin(), ext.end(), ext.begin(), [](char c)
+		{
+			return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+		});
+
+		for (auto &[format, loader] : supported_formats)
+		{
+			if (format == ext)
+			{
+				return loader(load_binary_file(path));
+			}
+		}
+
+		fmt::print(stderr, "{}: unsupported format\n", path.string());
+		return std::nullopt;
+	}
+
+	auto check_budget(const mesh_stats &stats, const budget &limits) -> std::vector<std::string>
+	{
+		auto failures = std::vector<std::string>{};
+		auto check = [&](std::string_view metric, auto value, auto limit, bool above)
+		{
+			if (above ? value > limit : value < limit)
+			{
+				failures.push_back(fmt::format("{}: {} {} {} {}", stats.name, metric, value, above ? ">" : "<", limit));
+			}
+		};
+
+		if (limits.max_acmr)             check("acmr", stats.acmr, *limits.max_acmr, true);
+		if (limits.max_atvr)             check("atvr", stats.atvr, *limits.max_atvr, true);
+		if (limits.max_overdraw)         check("overdraw", stats.overdraw, *limits.max_overdraw, true);
+		if (limits.min_fetch_efficiency) check("fetch_efficiency", stats.fetch_efficiency, *limits.min_fetch_efficiency, false);
+		if (limits.max_bytes)            check("bytes", stats.memory[0], *limits.max_bytes, true);
+
+		return failures;
+	}
+
+	void print_table(const file_report &file)
+	{
+		fmt::print("{}\n", file.path);
+		fmt::print("{:<24} {:>9} {:>9} {:>6} {:>6} {:>6} {:>8} {:>6} {:>26}",
+		           "group", "vertices", "triangles", "dup%", "acmr", "atvr", "overdraw", "fetch", "size");
+		for (auto &format : candidate_vertex_formats)
+		{
+			fmt::print(" {:>11}", format.name);
+		}
+		fmt::print("\n");
+
+		auto print_row = [](const mesh_stats &s)
+		{
+			auto size = fmt::format("{:.3g} x {:.3g} x {:.3g}",
+			                        s.bounds_max.x - s.bounds_min.x,
+			                        s.bounds_max.y - s.bounds_min.y,
+			                        s.bounds_max.z - s.bounds_min.z);
+			fmt::print("{:<24.24} {:>9} {:>9} {:>6.1f} {:>6.3f} {:>6.3f} {:>8.3f} {:>6.3f} {:>26}",
+			           s.name, s.vertex_count, s.triangle_count, s.duplicate_ratio * 100.0f,
+			           s.acmr, s.atvr, s.overdraw, s.fetch_efficiency, size);
+			for (auto bytes : s.memory)
+			{
+				fmt::print(" {:>11}", bytes);
+			}
+			fmt::print("\n");
+		};
+
+		for (auto &grp : file.report.groups)
+		{
+			print_row(grp);
+		}
+		print_row(file.report.total);
+
+		for (auto &failure : file.failures)
+		{
+			fmt::print("over budget, {}\n", failure);
+		}
+		fmt::print("\n");
+	}
+
+	auto json_string(std::string_view text) -> std::string
+	{
+		auto out = std::string{ "\"" };
+		for (auto c : text)
+		{
+			switch (c)
+			{
+				case '"':  out += "\\\""; break;
+				case '\\': out += "\\\\"; break;
+				case '\n': out += "\\n"; break;
+				case '\r': out += "\\r"; break;
+				case '\t': out += "\\t"; break;
+				default:
+					if (static_cast<unsigned char>(c) < 0x20)
+					{
+						out += fmt::format("\\u{:04x}", static_cast<int>(c));
+					}
+					else
+					{
+						out += c;
+					}
+			}
+		}
+		return out + "\"";
+	}
+
+	auto json_float3(const DirectX::XMFLOAT3 &v) -> std::string
+	{
+		return fmt::format("[{}, {}, {}]", v.x, v.y, v.z);
+	}
+
+	auto json_stats(const mesh_stats &s, std::string_view indent) -> std::string
+	{
+		auto memory = std::string{};
+		for (auto f = 0u; f < candidate_vertex_formats.size(); f++)
+		{
+			memory += fmt::format("{}{}: {}", f == 0 ? "" : ", ", json_string(candidate_vertex_formats[f].name), s.memory[f]);
+		}
+
+		auto &obb = s.bounding_obb;
+		return fmt::format("{{\n"
+		                   "{0}  \"name\": {1},\n"
+		                   "{0}  \"material\": {2},\n"
+		                   "{0}  \"vertices\": {3},\n"
+		                   "{0}  \"triangles\": {4},\n"
+		                   "{0}  \"duplicate_ratio\": {5},\n"
+		                   "{0}  \"acmr\": {6},\n"
+		                   "{0}  \"atvr\": {7},\n"
+		                   "{0}  \"overdraw\": {8},\n"
+		                   "{0}  \"fetch_efficiency\": {9},\n"
+		                   "{0}  \"bounds\": {{ \"min\": {10}, \"max\": {11} }},\n"
+		                   "{0}  \"oriented_bounds\": {{ \"center\": {12}, \"extents\": {13}, \"axes\": [{14}, {15}, {16}] }},\n"
+		                   "{0}  \"memory\": {{ {17} }}\n"
+		                   "{0}}}",
+		                   indent, json_string(s.name), json_string(s.material_name),
+		                   s.vertex_count, s.triangle_count, s.duplicate_ratio,
+		                   s.acmr, s.atvr, s.overdraw, s.fetch_efficiency,
+		                   json_float3(s.bounds_min), json_float3(s.bounds_max),
+		                   json_float3(obb.center), json_float3(obb.extents),
+		                   json_float3(obb.axes[0]), json_float3(obb.axes[1]), json_float3(obb.axes[2]),
+		                   memory);
+	}
+
+	void print_json(const std::vector<file_report> &files)
+	{
+		fmt::print("[\n");
+		for (auto f = 0u; f < files.size(); f++)
+		{
+			auto &file = files[f];
+			fmt::print("  {{\n    \"path\": {},\n    \"total\": {},\n    \"groups\": [",
+			           json_string(file.path), json_stats(file.report.total, "    "));
+			for (auto g = 0u; g < file.report.groups.size(); g++)
+			{
+				fmt::print("{}\n      {}", g == 0 ? "" : ",", json_stats(file.report.groups[g], "      "));
+			}
+			fmt::print("\n    ],\n    \"budget_failures\": [");
+			for (auto i = 0u; i < file.failures.size(); i++)
+			{
+				fmt::print("{}{}", i == 0 ? "" : ", ", json_string(file.failures[i]));
+			}
+			fmt::print("]\n  }}{}\n", f + 1 == files.size() ? "" : ",");
+		}
+		fmt::print("]\n");
+	}
+}
+
+// Exit code is 0 when all files are within budget, 1 when over budget, 2 on bad input
+auto main(int argc, char *argv[]) -> int
+{
+	auto opts = parse_arguments(argc, argv);
+	if (not opts)
+	{
+		print_usage(argv[0]);
+		return 2;
+	}
+
+	auto reports = std::vector<file_report>{};
+	auto over_budget = false;
+	for (auto &path : opts->files)
+	{
+		auto data = load_mesh(path);
+		if (not data)
+		{
+			return 2;
+		}
+
+		auto &file = reports.emplace_back(file_report{ path.string(), analyze_mesh(*data, opts->settings), {} });
+		for (auto &grp : file.report.groups)
+		{
+			auto failures = check_budget(grp, opts->limits);
+			file.failures.insert(file.failures.end(), failures.begin(), failures.end());
+		}
+		auto failures = check_budget(file.report.total, opts->limits);
+		file.failures.insert(file.failures.end(), failures.begin(), failures.end());
+		over_budget = over_budget or not file.failures.empty();
+	}
+
+	if (opts->json)
+	{
+		print_json(reports);
+	}
+	else
+	{
+		for (auto &file : reports)
+		{
+			print_table(file);
+		}
+	}
+
+	return over_budget ? 1 : 0;
+}
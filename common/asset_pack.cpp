@@ -0,0 +1,361 @@
+#include "asset_pack.h"
+#include "lz_codec.h"
+#include "parallel_range.h"
+
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+
+using namespace dx11_lessons;
+
+namespace
+{
+	auto align_up(uint64_t value, uint64_t alignment) -> uint64_t
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	auto entries_end(uint32_t entry_count) -> uint64_t
+	{
+		return sizeof(pack_header) + uint64_t{ entry_count } * sizeof(pack_entry);
+	}
+
+	auto block_count_for(uint64_t size) -> uint64_t
+	{
+		return (size + pack_block_size - 1) / pack_block_size;
+	}
+
+	auto is_consistent(const pack_entry &e) -> bool
+	{
+		switch (e.codec)
+		{
+			case pack_codec::none:
+				return e.stored_size == e.size and e.block_count == 0;
+			case pack_codec::lz:
+				return e.block_count == block_count_for(e.size)
+				   and e.stored_size >= uint64_t{ e.block_count } * sizeof(uint32_t);
+		}
+		return false;
+	}
+
+	auto lower_bound_hash(std::span<const pack_entry> entries, uint64_t name_hash) -> std::span<const pack_entry>::iterator
+	{
+		return std::lower_bound(entries.begin(), entries.end(), name_hash, [](const pack_entry &e, uint64_t hash)
+		{
+			return e.name_hash < hash;
+		});
+	}
+
+	// Blocks are spread over the hardware threads, each unpacking straight into its part of destination
+	auto unpack_blocks(std::span<const std::byte> stored, uint32_t block_count, std::span<std::byte> destination) -> bool
+	{
+		auto block_sizes = std::vector<uint32_t>(block_count);
+		std::memcpy(block_sizes.data(), stored.data(), block_sizes.size() * sizeof(uint32_t));
+
+		auto block_offsets = std::vector<uint64_t>(block_count + 1);
+		block_offsets[0] = block_sizes.size() * sizeof(uint32_t);
+		for (auto i = 0u; i < block_count; i++)
+		{
+			block_offsets[i + 1] = block_offsets[i] + block_sizes[i];
+		}
+		if (block_offsets.back() > stored.size())
+		{
+			return false;
+		}
+
+		auto unpack_range = [&](uint32_t first, uint32_t last) -> bool
+		{
+			for (auto i = first; i < last; i++)
+			{
+				auto src = stored.subspan(block_offsets[i], block_sizes[i]);
+				auto dst_offset = i * pack_block_size;
+				auto dst = destination.subspan(dst_offset, std::min(pack_block_size, destination.size() - dst_offset));
+				if (src.size() == dst.size())
+				{
+					std::memcpy(dst.data(), src.data(), dst.size());
+				}
+				else if (not lz_decompress(src, dst))
+				{
+					return false;
+				}
+			}
+			return true;
+		};
+
+		return for_each_range(block_count, unpack_range);
+	}
+
+	// Compressed form of data, or nullopt when it doesn't save enough to be worth unpacking at load
+	auto compress_blocks(std::span<const std::byte> data) -> std::optional<std::vector<std::byte>>
+	{
+		auto block_count = block_count_for(data.size());
+		auto blocks = std::vector<std::vector<std::byte>>(block_count);
+
+		for_each_range(static_cast<uint32_t>(block_count), [&](uint32_t first, uint32_t last)
+		{
+			for (auto i = first; i < last; i++)
+			{
+				auto raw = data.subspan(i * pack_block_size, std::min(pack_block_size, data.size() - i * pack_block_size));
+				blocks[i] = lz_compress(raw);
+				// Blocks that don't shrink are kept raw, so unpacking them is a copy
+				if (blocks[i].size() >= raw.size())
+				{
+					blocks[i].assign(raw.begin(), raw.end());
+				}
+			}
+			return true;
+		});
+
+		auto stored = std::vector<std::byte>(block_count * sizeof(uint32_t));
+		for (auto i = 0u; i < block_count; i++)
+		{
+			auto block_size = static_cast<uint32_t>(blocks[i].size());
+			std::memcpy(stored.data() + i * sizeof(uint32_t), &block_size, sizeof(block_size));
+			stored.insert(stored.end(), blocks[i].begin(), blocks[i].end());
+		}
+
+		// Entries are page aligned, so savings have to free at least a page, and an eighth of the entry
+		auto saves_pages = align_up(stored.size(), pack_alignment) < align_up(data.size(), pack_alignment);
+		auto saves_enough = stored.size() <= data.size() - data.size() / 8;
+		if (not saves_pages or not saves_enough)
+		{
+			return std::nullopt;
+		}
+		return stored;
+	}
+}
+
+asset_pack::asset_pack(const std::filesystem::path &path) :
+	file{ path }
+{
+	auto bytes = file.bytes();
+	if (bytes.size() < sizeof(pack_header))
+	{
+		return;
+	}
+
+	auto header = pack_header{};
+	std::memcpy(&header, bytes.data(), sizeof(header));
+	if (header.magic != pack_magic or header.version != pack_version
+	    or entries_end(header.entry_count) + header.names_size > bytes.size())
+	{
+		return;
+	}
+
+	auto first = reinterpret_cast<const pack_entry *>(bytes.data() + sizeof(pack_header));
+	auto all_entries = std::span<const pack_entry>(first, header.entry_count);
+	auto all_names = std::string_view(reinterpret_cast<const char *>(bytes.data() + entries_end(header.entry_count)),
+	                                  header.names_size);
+
+	auto in_bounds = std::all_of(all_entries.begin(), all_entries.end(), [&](const pack_entry &e)
+	{
+		return e.offset <= bytes.size() and e.stored_size <= bytes.size() - e.offset
+		   and uint64_t{ e.name_offset } + e.name_size <= all_names.size()
+		   and is_consistent(e);
+	});
+	auto sorted = std::is_sorted(all_entries.begin(), all_entries.end(), [](const pack_entry &a, const pack_entry &b)
+	{
+		return a.name_hash < b.name_hash;
+	});
+	if (not in_bounds or not sorted)
+	{
+		return;
+	}
+
+	entries = all_entries;
+	names = all_names;
+	valid = true;
+}
+
+asset_pack::~asset_pack() = default;
+
+auto asset_pack::is_valid() const -> bool
+{
+	return valid;
+}
+
+auto asset_pack::find(std::string_view name) const -> std::optional<std::size_t>
+{
+	auto idx = find_hash(hash_asset_name(name));
+	if (not idx or entry_name(*idx) != name)
+	{
+		return std::nullopt;
+	}
+	return idx;
+}
+
+auto asset_pack::find_hash(uint64_t name_hash) const -> std::optional<std::size_t>
+{
+	auto it = lower_bound_hash(entries, name_hash);
+	if (it == entries.end() or it->name_hash != name_hash)
+	{
+		return std::nullopt;
+	}
+	return static_cast<std::size_t>(it - entries.begin());
+}
+
+auto asset_pack::load(std::string_view name, std::vector<std::byte> &storage) const -> std::optional<std::span<const std::byte>>
+{
+	auto idx = find(name);
+	if (not idx)
+	{
+		return std::nullopt;
+	}
+
+	auto &e = entries[*idx];
+	if (e.codec == pack_codec::none)
+	{
+		return file.bytes().subspan(e.offset, e.size);
+	}
+
+	storage.resize(e.size);
+	if (not read_entry(*idx, storage))
+	{
+		return std::nullopt;
+	}
+	return storage;
+}
+
+auto asset_pack::entry_count() const -> std::size_t
+{
+	return entries.size();
+}
+
+auto asset_pack::entry_name(std::size_t idx) const -> std::string_view
+{
+	auto &e = entries[idx];
+	return names.substr(e.name_offset, e.name_size);
+}
+
+auto asset_pack::entry_size(std::size_t idx) const -> std::size_t
+{
+	return entries[idx].size;
+}
+
+auto asset_pack::entry_stored_size(std::size_t idx) const -> std::size_t
+{
+	return entries[idx].stored_size;
+}
+
+auto asset_pack::entry_codec(std::size_t idx) const -> pack_codec
+{
+	return entries[idx].codec;
+}
+
+auto asset_pack::read_entry(std::size_t idx, std::span<std::byte> destination) const -> bool
+{
+	auto &e = entries[idx];
+	if (destination.size() != e.size)
+	{
+		return false;
+	}
+
+	auto stored = file.bytes().subspan(e.offset, e.stored_size);
+	if (e.codec == pack_codec::none)
+	{
+		std::memcpy(destination.data(), stored.data(), stored.size());
+		return true;
+	}
+	return unpack_blocks(stored, e.block_count, destination);
+}
+
+asset_pack_builder::asset_pack_builder(compression mode_) :
+	mode{ mode_ }
+{ }
+
+auto asset_pack_builder::add(std::string name, std::vector<std::byte> data) -> bool
+{
+	auto name_hash = hash_asset_name(name);
+	auto it = std::lower_bound(entries.begin(), entries.end(), name_hash, [](const entry &e, uint64_t hash)
+	{
+		return e.name_hash < hash;
+	});
+	if (it != entries.end() and it->name_hash == name_hash)
+	{
+		return false;
+	}
+
+	auto e = entry{ name_hash, std::move(name), data.size(), pack_codec::none, 0, {} };
+	auto compressed = (mode == compression::automatic) ? compress_blocks(data) : std::nullopt;
+	if (compressed)
+	{
+		e.codec = pack_codec::lz;
+		e.block_count = static_cast<uint32_t>(block_count_for(data.size()));
+		e.data = std::move(*compressed);
+	}
+	else
+	{
+		e.data = std::move(data);
+	}
+
+	entries.insert(it, std::move(e));
+	return true;
+}
+
+auto asset_pack_builder::write(const std::filesystem::path &path) const -> bool
+{
+	auto header = pack_header{};
+	header.magic = pack_magic;
+	header.version = pack_version;
+	header.entry_count = static_cast<uint32_t>(entries.size());
+
+	auto toc = std::vector<pack_entry>(entries.size());
+	auto names = std::string{};
+	for (auto i = 0u; i < entries.size(); i++)
+	{
+		toc[i].name_hash = entries[i].name_hash;
+		toc[i].name_offset = static_cast<uint32_t>(names.size());
+		toc[i].name_size = static_cast<uint32_t>(entries[i].name.size());
+		toc[i].codec = entries[i].codec;
+		toc[i].block_count = entries[i].block_count;
+		names += entries[i].name;
+	}
+	header.names_size = static_cast<uint32_t>(names.size());
+
+	auto offset = align_up(entries_end(header.entry_count) + names.size(), pack_alignment);
+	for (auto i = 0u; i < entries.size(); i++)
+	{
+		toc[i].offset = offset;
+		toc[i].size = entries[i].size;
+		toc[i].stored_size = entries[i].data.size();
+		offset = align_up(offset + toc[i].stored_size, pack_alignment);
+	}
+	auto file = std::ofstream(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (not file.is_open())
+	{
+		return false;
+	}
+
+	auto padding = std::vector<char>(pack_alignment);
+	auto pad_to = [&](uint64_t position)
+	{
+		auto current = static_cast<uint64_t>(file.tellp());
+		file.write(padding.data(), static_cast<std::streamsize>(position - current));
+	};
+
+	file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char *>(toc.data()), static_cast<std::streamsize>(toc.size() * sizeof(pack_entry)));
+	file.write(names.data(), static_cast<std::streamsize>(names.size()));
+
+	for (auto i = 0u; i < entries.size(); i++)
+	{
+		pad_to(toc[i].offset);
+		file.write(reinterpret_cast<const char *>(entries[i].data.data()),
+		           static_cast<std::streamsize>(entries[i].data.size()));
+	}
+
+	return file.good();
+}
+
+auto asset_pack_builder::entry_count() const -> std::size_t
+{
+	return entries.size();
+}
+
+auto asset_pack_builder::compressed_count() const -> std::size_t
+{
+	return std::count_if(entries.begin(), entries.end(), [](const entry &e)
+	{
+		return e.codec != pack_codec::none;
+	});
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "mapped_file.h"
+
+#include <array>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <cstddef>
+#include <cstdint>
+
+namespace dx11_lessons
+{
+	// Pack file layout, little endian:
+	//   pack_header
+	//   pack_entry[entry_count], sorted by name_hash
+	//   entry names, not null terminated
+	//   entry data, each entry starting on a pack_alignment boundary
+	//
+	// Compressed entry data is uint32_t stored_block_size[block_count] followed by the blocks.
+	// Every block is pack_block_size bytes unpacked, except the last one, and is compressed on its own
+	// so blocks can be unpacked in parallel. A block whose stored size equals its unpacked size is stored raw.
+	constexpr auto pack_magic = std::array{ 'D', 'X', 'P', 'K' };
+	constexpr auto pack_version = uint32_t{ 2 };
+	constexpr auto pack_alignment = uint64_t{ 4096 };
+	constexpr auto pack_block_size = uint64_t{ 128 * 1024 };
+
+	enum class pack_codec : uint32_t
+	{
+		none,
+		lz,
+	};
+
+	struct pack_header
+	{
+		std::array<char, 4> magic;
+		uint32_t version;
+		uint32_t entry_count;
+		uint32_t names_size;
+	};
+
+	struct pack_entry
+	{
+		uint64_t name_hash;
+		uint64_t offset;        // from start of file
+		uint64_t size;          // unpacked
+		uint64_t stored_size;   // in file, including block table
+		uint32_t name_offset;   // from start of names
+		uint32_t name_size;
+		pack_codec codec;
+		uint32_t block_count;
+	};
+
+	static_assert(sizeof(pack_header) == 16);
+	static_assert(sizeof(pack_entry) == 48);
+
+	// FNV-1a, names use forward slashes and are case sensitive
+	constexpr auto hash_asset_name(std::string_view name) -> uint64_t
+	{
+		auto hash = uint64_t{ 0xcbf29ce484222325 };
+		for (auto c : name)
+		{
+			hash ^= static_cast<uint8_t>(c);
+			hash *= 0x100000001b3;
+		}
+		return hash;
+	}
+
+	// Maps the whole pack once. Uncompressed entries are served as spans into the mapping,
+	// compressed ones are unpacked block by block across worker threads into the caller's buffer.
+	class asset_pack
+	{
+	public:
+		asset_pack() = delete;
+		asset_pack(const std::filesystem::path &path);
+		~asset_pack();
+
+		auto is_valid() const -> bool;
+
+		auto find(std::string_view name) const -> std::optional<std::size_t>;
+		auto find_hash(uint64_t name_hash) const -> std::optional<std::size_t>;
+
+		// Entry bytes straight from the mapping, or unpacked into storage when compressed
+		auto load(std::string_view name, std::vector<std::byte> &storage) const -> std::optional<std::span<const std::byte>>;
+
+		auto entry_count() const -> std::size_t;
+		auto entry_name(std::size_t idx) const -> std::string_view;
+		auto entry_size(std::size_t idx) const -> std::size_t;
+		auto entry_stored_size(std::size_t idx) const -> std::size_t;
+		auto entry_codec(std::size_t idx) const -> pack_codec;
+
+		// Unpacks into destination, e.g. a mapped staging buffer. Destination must be entry_size bytes.
+		auto read_entry(std::size_t idx, std::span<std::byte> destination) const -> bool;
+
+	private:
+		mapped_file file;
+		std::span<const pack_entry> entries{};
+		std::string_view names{};
+		bool valid{};
+	};
+
+	class asset_pack_builder
+	{
+	public:
+		// automatic keeps the compressed form of an entry only when it saves enough to be worth unpacking
+		enum class compression
+		{
+			none,
+			automatic,
+		};
+
+		asset_pack_builder(compression mode = compression::automatic);
+
+		// false if the name, or its hash, is already in the pack
+		auto add(std::string name, std::vector<std::byte> data) -> bool;
+		auto write(const std::filesystem::path &path) const -> bool;
+
+		auto entry_count() const -> std::size_t;
+		auto compressed_count() const -> std::size_t;
+
+	private:
+		struct entry
+		{
+			uint64_t name_hash;
+			std::string name;
+			uint64_t size;
+			pack_codec codec;
+			uint32_t block_count;
+			std::vector<std::byte> data;    // as stored in the pack
+		};
+
+		compression mode;
+		std::vector<entry> entries{};
+	};
+}
@@ -0,0 +1,63 @@
+#include "async_task.h"
+
+using namespace dx11_lessons;
+
+namespace
+{
+	constexpr auto page_size = std::size_t{ 4096 };
+}
+
+main_thread_queue::~main_thread_queue()
+{
+	assert(waiting.empty());
+}
+
+auto main_thread_queue::resume() -> awaiter
+{
+	return { *this };
+}
+
+void main_thread_queue::run_pending()
+{
+	auto ready = std::vector<std::coroutine_handle<>>{};
+	{
+		auto lock = std::lock_guard{ mutex };
+		ready.swap(waiting);
+	}
+	for (auto handle : ready)
+	{
+		handle.resume();
+	}
+}
+
+void main_thread_queue::push(std::coroutine_handle<> handle)
+{
+	auto lock = std::lock_guard{ mutex };
+	waiting.push_back(handle);
+}
+
+auto dx11_lessons::when_all(job_system &jobs, std::vector<task<>> tasks) -> task<>
+{
+	co_await detail::join_awaiter<void>{ jobs, tasks };
+
+	for (auto &t : tasks)
+	{
+		t.get();
+	}
+}
+
+auto dx11_lessons::read_file_async(job_system &jobs, std::filesystem::path path) -> task<mapped_file>
+{
+	co_await resume_on(jobs);
+
+	// A mapping reads nothing until it's touched, a byte a page faults it all in
+	auto file = mapped_file(path);
+	auto sum = uint8_t{};
+	for (auto offset = std::size_t{}; offset < file.size(); offset += page_size)
+	{
+		sum ^= static_cast<uint8_t>(file.data()[offset]);
+	}
+	[[maybe_unused]] volatile auto kept = sum;   // or the reads are optimised out
+
+	co_return file;
+}
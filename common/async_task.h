@@ -0,0 +1,394 @@
+#pragma once
+
+#include "job_system.h"
+#include "mapped_file.h"
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <cassert>
+#include <cstdint>
+
+namespace dx11_lessons
+{
+	template <typename T = void>
+	class task;
+
+	namespace detail
+	{
+		// Tasks started by when_all, the last of them to finish resumes the coroutine waiting on them
+		struct join_state
+		{
+			std::atomic<uint32_t> left{};
+			std::coroutine_handle<> waiter{};
+		};
+
+		struct promise_base
+		{
+			// Hands over to whoever waits on the task. What's needed is read before done is set,
+			// from then on the task's owner may destroy it.
+			struct final_awaiter
+			{
+				auto await_ready() const noexcept -> bool
+				{
+					return false;
+				}
+
+				template <typename promise_t>
+				auto await_suspend(std::coroutine_handle<promise_t> handle) noexcept -> std::coroutine_handle<>
+				{
+					auto &promise = handle.promise();
+					auto continuation = promise.continuation;
+					auto join = promise.join;
+					promise.done.store(true, std::memory_order_release);
+
+					if (join != nullptr)
+					{
+						return (join->left.fetch_sub(1, std::memory_order_acq_rel) == 1) ? join->waiter : std::noop_coroutine();
+					}
+					return continuation ? continuation : std::noop_coroutine();
+				}
+
+				void await_resume() const noexcept
+				{}
+			};
+
+			auto initial_suspend() const noexcept -> std::suspend_always
+			{
+				return {};
+			}
+
+			auto final_suspend() const noexcept -> final_awaiter
+			{
+				return {};
+			}
+
+			void unhandled_exception() noexcept
+			{
+				exception = std::current_exception();
+			}
+
+			void rethrow_if_failed() const
+			{
+				if (exception)
+				{
+					std::rethrow_exception(exception);
+				}
+			}
+
+			std::coroutine_handle<> continuation{};
+			join_state *join{ nullptr };
+			std::exception_ptr exception{};
+			std::atomic<bool> done{ false };
+			bool started{ false };
+		};
+
+		template <typename T>
+		struct promise : promise_base
+		{
+			auto get_return_object() -> task<T>
+			{
+				return task<T>{ std::coroutine_handle<promise>::from_promise(*this) };
+			}
+
+			void return_value(T value_)
+			{
+				value.emplace(std::move(value_));
+			}
+
+			auto result() -> T
+			{
+				rethrow_if_failed();
+				return std::move(*value);
+			}
+
+			std::optional<T> value{};
+		};
+
+		template <>
+		struct promise<void> : promise_base
+		{
+			auto get_return_object() -> task<void>;
+
+			void return_void() const noexcept
+			{}
+
+			void result() const
+			{
+				rethrow_if_failed();
+			}
+		};
+
+		template <typename T>
+		struct join_awaiter;
+	}
+
+	// A coroutine that runs once it's awaited, or started if nothing awaits it, on whichever thread resumes it.
+	// co_await resume_on(jobs) moves it to the job system, co_await main_thread.resume() back to the window's thread.
+	// Nothing blocks, a thread a task leaves goes on to other work. A task must be done before it's destroyed.
+	template <typename T>
+	class task
+	{
+	public:
+		using promise_type = detail::promise<T>;
+
+		task() = default;   // no coroutine, is always done
+		explicit task(std::coroutine_handle<promise_type> handle_) :
+			handle{ handle_ }
+		{}
+
+		task(task &&other) noexcept :
+			handle{ std::exchange(other.handle, {}) }
+		{}
+
+		auto operator=(task &&other) noexcept -> task &
+		{
+			if (this != &other)
+			{
+				destroy();
+				handle = std::exchange(other.handle, {});
+			}
+			return *this;
+		}
+
+		task(const task &) = delete;
+		auto operator=(const task &) -> task & = delete;
+
+		~task()
+		{
+			destroy();
+		}
+
+		// Runs it on this thread up to where it first suspends, for a task nothing awaits
+		void start()
+		{
+			assert(handle and not handle.promise().started);
+			handle.promise().started = true;
+			handle.resume();
+		}
+
+		auto is_done() const -> bool
+		{
+			return not handle or handle.promise().done.load(std::memory_order_acquire);
+		}
+
+		// Once done, what it returned, or what it threw rethrown
+		auto get() -> T
+		{
+			assert(handle and is_done());
+			return handle.promise().result();
+		}
+
+		// Starts it, this coroutine carries on on the thread it finishes on
+		auto operator co_await() noexcept
+		{
+			struct awaiter
+			{
+				std::coroutine_handle<promise_type> handle;
+
+				auto await_ready() const noexcept -> bool
+				{
+					return false;
+				}
+
+				auto await_suspend(std::coroutine_handle<> waiting) noexcept -> std::coroutine_handle<>
+				{
+					auto &promise = handle.promise();
+					assert(not promise.started);
+					promise.continuation = waiting;
+					promise.started = true;
+					return handle;
+				}
+
+				auto await_resume() -> T
+				{
+					return handle.promise().result();
+				}
+			};
+
+			assert(handle);
+			return awaiter{ handle };
+		}
+
+	private:
+		template <typename>
+		friend struct detail::join_awaiter;
+
+		void start_joined(job_system &jobs, detail::join_state &join)
+		{
+			auto &promise = handle.promise();
+			promise.join = &join;
+			promise.started = true;
+			jobs.run([h = handle]
+			{
+				h.resume();
+			});
+		}
+
+		void destroy()
+		{
+			if (handle)
+			{
+				assert(not handle.promise().started or is_done());
+				handle.destroy();
+				handle = {};
+			}
+		}
+
+	private:
+		std::coroutine_handle<promise_type> handle{};
+	};
+
+	inline auto detail::promise<void>::get_return_object() -> task<void>
+	{
+		return task<void>{ std::coroutine_handle<promise>::from_promise(*this) };
+	}
+
+	namespace detail
+	{
+		struct job_awaiter
+		{
+			job_system &jobs;
+
+			auto await_ready() const noexcept -> bool
+			{
+				return false;
+			}
+
+			void await_suspend(std::coroutine_handle<> handle) const
+			{
+				jobs.run([handle]
+				{
+					handle.resume();
+				});
+			}
+
+			void await_resume() const noexcept
+			{}
+		};
+
+		// Every task as a job of its own, the waiting coroutine holds one count so none can resume it early
+		template <typename T>
+		struct join_awaiter
+		{
+			job_system &jobs;
+			std::vector<task<T>> &tasks;
+			join_state state{};
+
+			auto await_ready() const noexcept -> bool
+			{
+				return tasks.empty();
+			}
+
+			auto await_suspend(std::coroutine_handle<> handle) -> bool
+			{
+				state.waiter = handle;
+				state.left.store(static_cast<uint32_t>(tasks.size()) + 1, std::memory_order_relaxed);
+				for (auto &t : tasks)
+				{
+					t.start_joined(jobs, state);
+				}
+				return state.left.fetch_sub(1, std::memory_order_acq_rel) != 1;
+			}
+
+			void await_resume() const noexcept
+			{}
+		};
+	}
+
+	// co_await resume_on(jobs) carries on as a job, on a worker or a thread waiting on the system
+	inline auto resume_on(job_system &jobs) -> detail::job_awaiter
+	{
+		return { jobs };
+	}
+
+	// Coroutines waiting for the thread that owns the device context, e.g. to hand over what they've made.
+	// That thread resumes them when it calls run_pending, once a frame.
+	class main_thread_queue
+	{
+	public:
+		struct awaiter
+		{
+			main_thread_queue &queue;
+
+			auto await_ready() const noexcept -> bool
+			{
+				return false;
+			}
+
+			void await_suspend(std::coroutine_handle<> handle) const
+			{
+				queue.push(handle);
+			}
+
+			void await_resume() const noexcept
+			{}
+		};
+
+		main_thread_queue() = default;
+		main_thread_queue(const main_thread_queue &) = delete;
+		auto operator=(const main_thread_queue &) -> main_thread_queue & = delete;
+		~main_thread_queue();
+
+		auto resume() -> awaiter;
+
+		// Resumes what was waiting when it's called, what those queue again waits for the next call
+		void run_pending();
+
+		// Runs pending coroutines until t is done, for when what t uses is about to go
+		template <typename T>
+		void run_until_done(const task<T> &t)
+		{
+			while (not t.is_done())
+			{
+				run_pending();
+				std::this_thread::yield();
+			}
+		}
+
+	private:
+		void push(std::coroutine_handle<> handle);
+
+	private:
+		std::mutex mutex;
+		std::vector<std::coroutine_handle<>> waiting{};
+	};
+
+	// fn as a job, awaited where it's called: auto mesh = co_await run_on(jobs, [&] { return parse(file); });
+	template <typename fn_t>
+	auto run_on(job_system &jobs, fn_t fn) -> task<std::invoke_result_t<fn_t &>>
+	{
+		co_await resume_on(jobs);
+		co_return fn();
+	}
+
+	// Runs the tasks at the same time and carries on, on the thread of the last to finish, with their results in order.
+	// If any threw, the first of those rethrows once they're all done.
+	template <typename T>
+		requires (not std::is_void_v<T>)
+	auto when_all(job_system &jobs, std::vector<task<T>> tasks) -> task<std::vector<T>>
+	{
+		co_await detail::join_awaiter<T>{ jobs, tasks };
+
+		auto results = std::vector<T>{};
+		results.reserve(tasks.size());
+		for (auto &t : tasks)
+		{
+			results.push_back(t.get());
+		}
+		co_return results;
+	}
+
+	auto when_all(job_system &jobs, std::vector<task<>> tasks) -> task<>;
+
+	// The whole file, mapped and read through on a worker so what follows the co_await doesn't wait on the disk.
+	// Empty, like mapped_file, if the file is missing, empty or can't be read.
+	auto read_file_async(job_system &jobs, std::filesystem::path path) -> task<mapped_file>;
+}
@@ -0,0 +1,1095 @@
+#include "block_compression.h"
+#include "parallel_range.h"
+
+#include <DirectXMath.h>
+#include <array>
+#include <span>
+#include <optional>
+#include <utility>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <cmath>
+#include <bit>
+#include <cstring>
+#include <cassert>
+
+using namespace dx11_lessons;
+using namespace DirectX;
+
+namespace
+{
+	constexpr auto texels_per_block = 16u;
+	constexpr auto all_texels = uint16_t{ 0xffff };
+
+	// Texels of one 4x4 block, 0 - 255 per channel in RGBA order.
+	// Texels past the edge of a small mip repeat the edge, only the inside ones are measured.
+	struct block_texels
+	{
+		std::array<XMVECTOR, texels_per_block> texels;
+		uint16_t inside;
+	};
+
+	using block_indices = std::array<uint8_t, texels_per_block>;
+
+	struct endpoint_fit
+	{
+		XMVECTOR e0, e1;   // as the decoder will see them
+		block_indices indices;
+		float error;
+	};
+
+	struct quality_preset
+	{
+		uint32_t refine_iterations;
+		uint32_t partition_candidates;   // BC7 mode 1 partitions fully fitted, 0 skips mode 1
+	};
+
+	auto preset_for(block_quality quality) -> quality_preset
+	{
+		switch (quality)
+		{
+			case block_quality::fast:
+				return { 0, 0 };
+			case block_quality::normal:
+				return { 2, 0 };
+			case block_quality::high:
+				return { 6, 4 };
+		}
+		return { 2, 0 };
+	}
+
+	auto clamp_channels(FXMVECTOR v) -> XMVECTOR
+	{
+		return XMVectorClamp(v, XMVectorZero(), XMVectorReplicate(255.0f));
+	}
+
+	auto squared_length(FXMVECTOR v) -> float
+	{
+		return XMVectorGetX(XMVector4LengthSq(v));
+	}
+
+	// Mean and main direction of the subset's texels, by power iteration on their covariance.
+	// The direction is zero when every texel is the same.
+	auto principal_axis(const block_texels &block, uint16_t subset) -> std::pair<XMVECTOR, XMVECTOR>
+	{
+		auto mean = XMVectorZero();
+		for (auto i = 0u; i < texels_per_block; i++)
+		{
+			if (subset & (1u << i))
+			{
+				mean = XMVectorAdd(mean, block.texels[i]);
+			}
+		}
+		mean = XMVectorScale(mean, 1.0f / std::popcount(subset));
+
+		auto columns = std::array{ XMVectorZero(), XMVectorZero(), XMVectorZero(), XMVectorZero() };
+		for (auto i = 0u; i < texels_per_block; i++)
+		{
+			if (subset & (1u << i))
+			{
+				auto d = XMVectorSubtract(block.texels[i], mean);
+				columns[0] = XMVectorMultiplyAdd(d, XMVectorSplatX(d), columns[0]);
+				columns[1] = XMVectorMultiplyAdd(d, XMVectorSplatY(d), columns[1]);
+				columns[2] = XMVectorMultiplyAdd(d, XMVectorSplatZ(d), columns[2]);
+				columns[3] = XMVectorMultiplyAdd(d, XMVectorSplatW(d), columns[3]);
+			}
+		}
+
+		auto axis = *std::max_element(columns.begin(), columns.end(), [](FXMVECTOR a, FXMVECTOR b)
+		{
+			return squared_length(a) < squared_length(b);
+		});
+		for (auto i = 0; i < 6; i++)
+		{
+			if (squared_length(axis) < 1e-6f)
+			{
+				return { mean, XMVectorZero() };
+			}
+			axis = XMVector4Normalize(axis);
+			axis = XMVectorMultiplyAdd(columns[0], XMVectorSplatX(axis),
+			       XMVectorMultiplyAdd(columns[1], XMVectorSplatY(axis),
+			       XMVectorMultiplyAdd(columns[2], XMVectorSplatZ(axis),
+			       XMVectorMultiply(columns[3], XMVectorSplatW(axis)))));
+		}
+		return { mean, XMVector4Normalize(axis) };
+	}
+
+	// Nearest palette entry for each texel of the subset, weights are how far toward e1 each index is
+	auto assign_indices(const block_texels &block, uint16_t subset, FXMVECTOR e0, FXMVECTOR e1,
+	                    std::span<const float> weights) -> endpoint_fit
+	{
+		auto palette = std::array<XMVECTOR, 16>{};
+		for (auto k = 0u; k < weights.size(); k++)
+		{
+			palette[k] = XMVectorRound(XMVectorLerp(e0, e1, weights[k]));
+		}
+
+		auto fit = endpoint_fit{ e0, e1, {}, 0.0f };
+		for (auto i = 0u; i < texels_per_block; i++)
+		{
+			if (not (subset & (1u << i)))
+			{
+				continue;
+			}
+
+			auto best = std::numeric_limits<float>::max();
+			for (auto k = 0u; k < weights.size(); k++)
+			{
+				auto error = squared_length(XMVectorSubtract(block.texels[i], palette[k]));
+				if (error < best)
+				{
+					best = error;
+					fit.indices[i] = static_cast<uint8_t>(k);
+				}
+			}
+			fit.error += best;
+		}
+		return fit;
+	}
+
+	// Endpoints that best reproduce the subset with its current indices
+	auto least_squares(const block_texels &block, uint16_t subset, const block_indices &indices,
+	                   std::span<const float> weights) -> std::optional<std::pair<XMVECTOR, XMVECTOR>>
+	{
+		auto aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		auto ax = XMVectorZero(), bx = XMVectorZero();
+		for (auto i = 0u; i < texels_per_block; i++)
+		{
+			if (subset & (1u << i))
+			{
+				auto b = weights[indices[i]], a = 1.0f - b;
+				aa += a * a;
+				ab += a * b;
+				bb += b * b;
+				ax = XMVectorMultiplyAdd(block.texels[i], XMVectorReplicate(a), ax);
+				bx = XMVectorMultiplyAdd(block.texels[i], XMVectorReplicate(b), bx);
+			}
+		}
+
+		auto det = aa * bb - ab * ab;
+		if (std::abs(det) < 1e-6f)
+		{
+			return std::nullopt;
+		}
+		auto e0 = XMVectorScale(XMVectorSubtract(XMVectorScale(ax, bb), XMVectorScale(bx, ab)), 1.0f / det);
+		auto e1 = XMVectorScale(XMVectorSubtract(XMVectorScale(bx, aa), XMVectorScale(ax, ab)), 1.0f / det);
+		return std::pair{ clamp_channels(e0), clamp_channels(e1) };
+	}
+
+	// Principal axis extremes, then alternating index assignment and least squares while the error drops.
+	// quantize(e0, e1) -> pair snaps endpoints to values the format can store.
+	template <typename quantize_t>
+	auto fit_subset(const block_texels &block, uint16_t subset, std::span<const float> weights,
+	                uint32_t iterations, quantize_t quantize) -> endpoint_fit
+	{
+		auto [mean, axis] = principal_axis(block, subset);
+		auto low = 0.0f, high = 0.0f;
+		for (auto i = 0u; i < texels_per_block; i++)
+		{
+			if (subset & (1u << i))
+			{
+				auto t = XMVectorGetX(XMVector4Dot(XMVectorSubtract(block.texels[i], mean), axis));
+				low = std::min(low, t);
+				high = std::max(high, t);
+			}
+		}
+
+		auto [e0, e1] = quantize(clamp_channels(XMVectorMultiplyAdd(axis, XMVectorReplicate(low), mean)),
+		                         clamp_channels(XMVectorMultiplyAdd(axis, XMVectorReplicate(high), mean)));
+		auto best = assign_indices(block, subset, e0, e1, weights);
+		for (auto i = 0u; i < iterations and best.error > 0.0f; i++)
+		{
+			auto refined = least_squares(block, subset, best.indices, weights);
+			if (not refined)
+			{
+				break;
+			}
+			auto [r0, r1] = quantize(refined->first, refined->second);
+			auto candidate = assign_indices(block, subset, r0, r1, weights);
+			if (candidate.error >= best.error)
+			{
+				break;
+			}
+			best = candidate;
+		}
+		return best;
+	}
+
+	auto channels(FXMVECTOR v) -> std::array<uint32_t, 4>
+	{
+		auto f = XMFLOAT4{};
+		XMStoreFloat4(&f, v);
+		return { static_cast<uint32_t>(f.x), static_cast<uint32_t>(f.y), static_cast<uint32_t>(f.z), static_cast<uint32_t>(f.w) };
+	}
+
+	// BC1, 5:6:5 endpoints expanded to 8 bits by repeating the top bits
+	constexpr auto bc1_weights = std::array{ 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+	constexpr auto bc1_three_weights = std::array{ 0.0f, 1.0f, 0.5f };   // index 3 is transparent black
+
+	auto pack_565(FXMVECTOR colour) -> uint16_t
+	{
+		auto scale = XMVectorSet(31.0f / 255.0f, 63.0f / 255.0f, 31.0f / 255.0f, 0.0f);
+		auto [r, g, b, a] = channels(XMVectorRound(XMVectorMultiply(clamp_channels(colour), scale)));
+		return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	auto unpack_565(uint32_t colour) -> XMVECTOR
+	{
+		auto r = (colour >> 11) & 31, g = (colour >> 5) & 63, b = colour & 31;
+		return XMVectorSet(static_cast<float>((r << 3) | (r >> 2)),
+		                   static_cast<float>((g << 2) | (g >> 4)),
+		                   static_cast<float>((b << 3) | (b >> 2)), 0.0f);
+	}
+
+	auto quantize_565(FXMVECTOR e0, FXMVECTOR e1) -> std::pair<XMVECTOR, XMVECTOR>
+	{
+		return { unpack_565(pack_565(e0)), unpack_565(pack_565(e1)) };
+	}
+
+	// Texels with alpha under half use the three colour mode's transparent index, when allowed
+	auto encode_bc1(const block_texels &block, const quality_preset &preset, bool allow_transparent) -> uint64_t
+	{
+		auto colour = block;
+		auto transparent = uint16_t{};
+		for (auto i = 0u; i < texels_per_block; i++)
+		{
+			if (allow_transparent and XMVectorGetW(block.texels[i]) < 128.0f)
+			{
+				transparent |= static_cast<uint16_t>(1u << i);
+			}
+			colour.texels[i] = XMVectorSetW(block.texels[i], 0.0f);
+		}
+		if (transparent == all_texels)
+		{
+			return uint64_t{ 0xffffffff } << 32;
+		}
+
+		auto three_colour = transparent != 0;
+		auto weights = three_colour ? std::span<const float>(bc1_three_weights) : std::span<const float>(bc1_weights);
+		auto fit = fit_subset(colour, all_texels & ~transparent, weights, preset.refine_iterations, quantize_565);
+
+		auto c0 = pack_565(fit.e0), c1 = pack_565(fit.e1);
+		auto &indices = fit.indices;
+		if (three_colour)
+		{
+			// Three colour mode is c0 <= c1
+			if (c0 > c1)
+			{
+				std::swap(c0, c1);
+				for (auto &index : indices)
+				{
+					index = (index == 2) ? 2 : index ^ 1;
+				}
+			}
+			for (auto i = 0u; i < texels_per_block; i++)
+			{
+				if (transparent & (1u << i))
+				{
+					indices[i] = 3;
+				}
+			}
+		}
+		else if (c0 == c1)
+		{
+			indices.fill(0);
+		}
+		else if (c0 < c1)
+		{
+			// Four colour mode is c0 > c1, swapping the endpoints swaps 0 with 1 and 2 with 3
+			std::swap(c0, c1);
+			for (auto &index : indices)
+			{
+				index ^= 1;
+			}
+		}
+
+		auto bits = uint64_t{ c0 } | (uint64_t{ c1 } << 16);
+		for (auto i = 0u; i < texels_per_block; i++)
+		{
+			bits |= uint64_t{ indices[i] } << (32 + 2 * i);
+		}
+		return bits;
+	}
+
+	// BC4, one channel. 8 interpolated values when c0 > c1, otherwise 6 and the constants 0 and 255.
+	using channel_block = std::array<float, texels_per_block>;
+
+	auto bc4_palette(uint32_t c0, uint32_t c1) -> std::array<float, 8>
+	{
+		auto palette = std::array<float, 8>{ static_cast<float>(c0), static_cast<float>(c1) };
+		for (auto k = 2u; k < 8; k++)
+		{
+			palette[k] = (c0 > c1) ? std::round(((8 - k) * c0 + (k - 1) * c1) / 7.0f)
+			           : (k < 6)   ? std::round(((6 - k) * c0 + (k - 1) * c1) / 5.0f)
+			           : (k == 6)  ? 0.0f
+			           :             255.0f;
+		}
+		return palette;
+	}
+
+	struct channel_fit
+	{
+		uint32_t c0, c1;
+		block_indices indices;
+		float error;
+	};
+
+	auto assign_channel(const channel_block &values, uint32_t c0, uint32_t c1) -> channel_fit
+	{
+		auto palette = bc4_palette(c0, c1);
+		auto fit = channel_fit{ c0, c1, {}, 0.0f };
+		for (auto i = 0u; i < texels_per_block; i++)
+		{
+			auto best = std::numeric_limits<float>::max();
+			for (auto k = 0u; k < palette.size(); k++)
+			{
+				auto d = values[i] - palette[k];
+				if (d * d < best)
+				{
+					best = d * d;
+					fit.indices[i] = static_cast<uint8_t>(k);
+				}
+			}
+			fit.error += best;
+		}
+		return fit;
+	}
+
+	auto encode_bc4(const channel_block &values, const quality_preset &preset) -> uint64_t
+	{
+		auto [low, high] = std::minmax_element(values.begin(), values.end());
+		auto best = assign_channel(values, static_cast<uint32_t>(*high), static_cast<uint32_t>(*low));
+
+		if (preset.refine_iterations > 0 and best.error > 0.0f)
+		{
+			// Least squares on the 8 value mode, index k > 1 is (k - 1) / 7 of the way to c1
+			for (auto iteration = 0u; iteration < preset.refine_iterations; iteration++)
+			{
+				auto aa = 0.0f, ab = 0.0f, bb = 0.0f, ax = 0.0f, bx = 0.0f;
+				for (auto i = 0u; i < texels_per_block; i++)
+				{
+					auto k = best.indices[i];
+					auto b = (k == 0) ? 0.0f : (k == 1) ? 1.0f : (k - 1) / 7.0f, a = 1.0f - b;
+					aa += a * a;
+					ab += a * b;
+					bb += b * b;
+					ax += a * values[i];
+					bx += b * values[i];
+				}
+				auto det = aa * bb - ab * ab;
+				if (best.c0 <= best.c1 or std::abs(det) < 1e-6f)
+				{
+					break;
+				}
+				auto c0 = static_cast<uint32_t>(std::clamp(std::round((ax * bb - bx * ab) / det), 0.0f, 255.0f));
+				auto c1 = static_cast<uint32_t>(std::clamp(std::round((bx * aa - ax * ab) / det), 0.0f, 255.0f));
+				if (c0 <= c1)
+				{
+					break;
+				}
+				auto candidate = assign_channel(values, c0, c1);
+				if (candidate.error >= best.error)
+				{
+					break;
+				}
+				best = candidate;
+			}
+
+			// 6 value mode, 0 and 255 come free so the endpoints only span the values between
+			auto inner_low = 255.0f, inner_high = 0.0f;
+			for (auto v : values)
+			{
+				if (v > 0.0f and v < 255.0f)
+				{
+					inner_low = std::min(inner_low, v);
+					inner_high = std::max(inner_high, v);
+				}
+			}
+			if (inner_low > inner_high)
+			{
+				inner_low = inner_high = 0.0f;
+			}
+			auto candidate = assign_channel(values, static_cast<uint32_t>(inner_low), static_cast<uint32_t>(inner_high));
+			if (candidate.error < best.error)
+			{
+				best = candidate;
+			}
+		}
+
+		auto bits = uint64_t{ best.c0 } | (uint64_t{ best.c1 } << 8);
+		for (auto i = 0u; i < texels_per_block; i++)
+		{
+			bits |= uint64_t{ best.indices[i] } << (16 + 3 * i);
+		}
+		return bits;
+	}
+
+	auto channel_of(const block_texels &block, uint32_t channel) -> channel_block
+	{
+		auto values = channel_block{};
+		for (auto i = 0u; i < texels_per_block; i++)
+		{
+			auto f = XMFLOAT4{};
+			XMStoreFloat4(&f, block.texels[i]);
+			values[i] = std::array{ f.x, f.y, f.z, f.w }[channel];
+		}
+		return values;
+	}
+
+	// BC7 blocks are 128 bits, filled from the lowest bit of the first byte
+	using bc7_block = std::array<uint64_t, 2>;
+
+	struct bit_writer
+	{
+		bc7_block bits{};
+		uint32_t position = 0;
+
+		void write(uint32_t value, uint32_t count)
+		{
+			for (auto i = 0u; i < count; i++, position++)
+			{
+				bits[position / 64] |= uint64_t{ (value >> i) & 1 } << (position % 64);
+			}
+		}
+	};
+
+	struct bit_reader
+	{
+		const bc7_block &bits;
+		uint32_t position = 0;
+
+		auto read(uint32_t count) -> uint32_t
+		{
+			auto value = 0u;
+			for (auto i = 0u; i < count; i++, position++)
+			{
+				value |= static_cast<uint32_t>((bits[position / 64] >> (position % 64)) & 1) << i;
+			}
+			return value;
+		}
+	};
+
+	constexpr auto bc7_weights_2 = std::array{ 0, 21, 43, 64 };
+	constexpr auto bc7_weights_3 = std::array{ 0, 9, 18, 27, 37, 46, 55, 64 };
+	constexpr auto bc7_weights_4 = std::array{ 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	template <std::size_t count>
+	constexpr auto fractions(const std::array<int, count> &weights) -> std::array<float, count>
+	{
+		auto result = std::array<float, count>{};
+		std::transform(weights.begin(), weights.end(), result.begin(), [](int w) { return w / 64.0f; });
+		return result;
+	}
+	constexpr auto bc7_fractions_2 = fractions(bc7_weights_2);
+	constexpr auto bc7_fractions_3 = fractions(bc7_weights_3);
+	constexpr auto bc7_fractions_4 = fractions(bc7_weights_4);
+
+	// Two subset shapes, bit per texel set for subset 1
+	constexpr auto bc7_partitions = std::array<uint16_t, 64>
+	{
+		0xcccc, 0x8888, 0xeeee, 0xecc8, 0xc880, 0xfeec, 0xfec8, 0xec80,
+		0xc800, 0xffec, 0xfe80, 0xe800, 0xffe8, 0xff00, 0xfff0, 0xf000,
+		0xf710, 0x008e, 0x7100, 0x08ce, 0x008c, 0x7310, 0x3100, 0x8cce,
+		0x088c, 0x3110, 0x6666, 0x366c, 0x17e8, 0x0ff0, 0x718e, 0x399c,
+		0xaaaa, 0xf0f0, 0x5a5a, 0x33cc, 0x3c3c, 0x55aa, 0x9696, 0xa55a,
+		0x73ce, 0x13c8, 0x324c, 0x3bdc, 0x6996, 0xc33c, 0x9966, 0x0660,
+		0x0272, 0x04e4, 0x4e40, 0x2720, 0xc936, 0x936c, 0x39c6, 0x639c,
+		0x9336, 0x9cc6, 0x817e, 0xe718, 0xccf0, 0x0fcc, 0x7744, 0xee22,
+	};
+
+	// Texel whose index drops its top bit in subset 1, subset 0's is always texel 0
+	constexpr auto bc7_anchors = std::array<uint8_t, 64>
+	{
+		15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+		15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+		15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+		 6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15,
+	};
+
+	struct bc7_candidate
+	{
+		bc7_block bits;
+		float error;
+	};
+
+	// Mode 6, one subset, RGBA endpoints of 7 bits and a p bit each, so an endpoint's channels share parity
+	auto quantize_mode6_endpoint(FXMVECTOR endpoint) -> XMVECTOR
+	{
+		auto best = XMVectorZero();
+		auto best_error = std::numeric_limits<float>::max();
+		for (auto p : { 0.0f, 1.0f })
+		{
+			auto pv = XMVectorReplicate(p);
+			auto q = XMVectorClamp(XMVectorRound(XMVectorScale(XMVectorSubtract(endpoint, pv), 0.5f)),
+			                       XMVectorZero(), XMVectorReplicate(127.0f));
+			auto value = XMVectorMultiplyAdd(q, XMVectorReplicate(2.0f), pv);
+			auto error = squared_length(XMVectorSubtract(value, endpoint));
+			if (error < best_error)
+			{
+				best = value;
+				best_error = error;
+			}
+		}
+		return best;
+	}
+
+	auto encode_mode6(const block_texels &block, const quality_preset &preset) -> bc7_candidate
+	{
+		auto fit = fit_subset(block, all_texels, bc7_fractions_4, preset.refine_iterations, [](FXMVECTOR e0, FXMVECTOR e1)
+		{
+			return std::pair{ quantize_mode6_endpoint(e0), quantize_mode6_endpoint(e1) };
+		});
+
+		// Texel 0's index is stored without its top bit
+		if (fit.indices[0] >= 8)
+		{
+			std::swap(fit.e0, fit.e1);
+			for (auto &index : fit.indices)
+			{
+				index = static_cast<uint8_t>(15 - index);
+			}
+		}
+
+		auto e0 = channels(fit.e0), e1 = channels(fit.e1);
+		auto writer = bit_writer{};
+		writer.write(1u << 6, 7);
+		for (auto c = 0u; c < 4; c++)
+		{
+			writer.write(e0[c] >> 1, 7);
+			writer.write(e1[c] >> 1, 7);
+		}
+		writer.write(e0[0] & 1, 1);
+		writer.write(e1[0] & 1, 1);
+		for (auto i = 0u; i < texels_per_block; i++)
+		{
+			writer.write(fit.indices[i], (i == 0) ? 3 : 4);
+		}
+		return { writer.bits, fit.error };
+	}
+
+	// Mode 1, two subsets, RGB endpoints of 6 bits and a p bit shared by each subset's pair.
+	// The 7 bit values are expanded to 8 by repeating the top bit.
+	auto quantize_mode1(FXMVECTOR e0, FXMVECTOR e1) -> std::pair<XMVECTOR, XMVECTOR>
+	{
+		auto best = std::pair{ XMVectorZero(), XMVectorZero() };
+		auto best_error = std::numeric_limits<float>::max();
+		for (auto p : { 0.0f, 1.0f })
+		{
+			auto pv = XMVectorReplicate(p);
+			auto quantize = [&](FXMVECTOR endpoint)
+			{
+				auto v7 = XMVectorScale(endpoint, 127.0f / 255.0f);
+				auto q = XMVectorClamp(XMVectorRound(XMVectorScale(XMVectorSubtract(v7, pv), 0.5f)),
+				                       XMVectorZero(), XMVectorReplicate(63.0f));
+				v7 = XMVectorMultiplyAdd(q, XMVectorReplicate(2.0f), pv);
+				auto value = XMVectorAdd(XMVectorScale(v7, 2.0f), XMVectorFloor(XMVectorScale(v7, 1.0f / 64.0f)));
+				return XMVectorSetW(value, 0.0f);
+			};
+			auto q0 = quantize(e0), q1 = quantize(e1);
+			auto error = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(q0, e0)))
+			           + XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(q1, e1)));
+			if (error < best_error)
+			{
+				best = { q0, q1 };
+				best_error = error;
+			}
+		}
+		return best;
+	}
+
+	// Opaque blocks only, colour is fitted with alpha zeroed and decodes with alpha 255
+	auto encode_mode1(const block_texels &block, const quality_preset &preset) -> bc7_candidate
+	{
+		auto colour = block;
+		for (auto &texel : colour.texels)
+		{
+			texel = XMVectorSetW(texel, 0.0f);
+		}
+
+		// Rank every shape by an unquantized fit without refinement, then fit the best few properly
+		auto unquantized = [](FXMVECTOR e0, FXMVECTOR e1) { return std::pair{ e0, e1 }; };
+		auto estimates = std::array<std::pair<float, uint32_t>, bc7_partitions.size()>{};
+		for (auto p = 0u; p < bc7_partitions.size(); p++)
+		{
+			auto subset_1 = bc7_partitions[p];
+			auto subset_0 = static_cast<uint16_t>(~subset_1);
+			estimates[p] = { fit_subset(colour, subset_0, bc7_fractions_3, 0, unquantized).error
+			               + fit_subset(colour, subset_1, bc7_fractions_3, 0, unquantized).error, p };
+		}
+		auto candidates = std::min<std::size_t>(preset.partition_candidates, estimates.size());
+		std::partial_sort(estimates.begin(), estimates.begin() + candidates, estimates.end());
+
+		auto best = bc7_candidate{ {}, std::numeric_limits<float>::max() };
+		for (auto c = 0u; c < candidates; c++)
+		{
+			auto partition = estimates[c].second;
+			auto subsets = std::array{ static_cast<uint16_t>(~bc7_partitions[partition]), bc7_partitions[partition] };
+			auto anchors = std::array{ 0u, uint32_t{ bc7_anchors[partition] } };
+
+			auto fits = std::array<endpoint_fit, 2>{};
+			auto indices = block_indices{};
+			for (auto s = 0u; s < 2; s++)
+			{
+				fits[s] = fit_subset(colour, subsets[s], bc7_fractions_3, preset.refine_iterations, quantize_mode1);
+				auto flip = fits[s].indices[anchors[s]] >= 4;
+				if (flip)
+				{
+					std::swap(fits[s].e0, fits[s].e1);
+				}
+				for (auto i = 0u; i < texels_per_block; i++)
+				{
+					if (subsets[s] & (1u << i))
+					{
+						indices[i] = static_cast<uint8_t>(flip ? 7 - fits[s].indices[i] : fits[s].indices[i]);
+					}
+				}
+			}
+
+			auto error = fits[0].error + fits[1].error;
+			if (error >= best.error)
+			{
+				continue;
+			}
+
+			auto endpoints = std::array{ channels(fits[0].e0), channels(fits[0].e1), channels(fits[1].e0), channels(fits[1].e1) };
+			auto writer = bit_writer{};
+			writer.write(1u << 1, 2);
+			writer.write(partition, 6);
+			for (auto ch = 0u; ch < 3; ch++)
+			{
+				for (auto &endpoint : endpoints)
+				{
+					writer.write(endpoint[ch] >> 2, 6);
+				}
+			}
+			writer.write((endpoints[0][0] >> 1) & 1, 1);
+			writer.write((endpoints[2][0] >> 1) & 1, 1);
+			for (auto i = 0u; i < texels_per_block; i++)
+			{
+				writer.write(indices[i], (i == anchors[0] or i == anchors[1]) ? 2 : 3);
+			}
+			best = { writer.bits, error };
+		}
+		return best;
+	}
+
+	// Mode 5, one subset with colour and alpha fitted separately, for alpha that doesn't follow the colour.
+	// RGB endpoints of 7 bits expanded to 8, alpha endpoints of 8 bits, 2 bit indices for each.
+	auto encode_mode5(const block_texels &block, const quality_preset &preset) -> bc7_candidate
+	{
+		auto colour = block, alpha = block;
+		for (auto i = 0u; i < texels_per_block; i++)
+		{
+			colour.texels[i] = XMVectorSetW(block.texels[i], 0.0f);
+			alpha.texels[i] = XMVectorSet(XMVectorGetW(block.texels[i]), 0.0f, 0.0f, 0.0f);
+		}
+
+		auto quantize_7 = [](FXMVECTOR endpoint)
+		{
+			auto v7 = XMVectorRound(XMVectorScale(endpoint, 127.0f / 255.0f));
+			return XMVectorSetW(XMVectorAdd(XMVectorScale(v7, 2.0f), XMVectorFloor(XMVectorScale(v7, 1.0f / 64.0f))), 0.0f);
+		};
+		auto fits = std::array
+		{
+			fit_subset(colour, all_texels, bc7_fractions_2, preset.refine_iterations, [&](FXMVECTOR e0, FXMVECTOR e1)
+			{
+				return std::pair{ quantize_7(e0), quantize_7(e1) };
+			}),
+			fit_subset(alpha, all_texels, bc7_fractions_2, preset.refine_iterations, [](FXMVECTOR e0, FXMVECTOR e1)
+			{
+				return std::pair{ XMVectorRound(e0), XMVectorRound(e1) };
+			}),
+		};
+
+		// Texel 0's indices are stored without their top bit
+		for (auto &fit : fits)
+		{
+			if (fit.indices[0] >= 2)
+			{
+				std::swap(fit.e0, fit.e1);
+				for (auto &index : fit.indices)
+				{
+					index = static_cast<uint8_t>(3 - index);
+				}
+			}
+		}
+
+		auto c0 = channels(fits[0].e0), c1 = channels(fits[0].e1);
+		auto writer = bit_writer{};
+		writer.write(1u << 5, 6);
+		writer.write(0, 2);   // no channel rotation
+		for (auto c = 0u; c < 3; c++)
+		{
+			writer.write(c0[c] >> 1, 7);
+			writer.write(c1[c] >> 1, 7);
+		}
+		writer.write(channels(fits[1].e0)[0], 8);
+		writer.write(channels(fits[1].e1)[0], 8);
+		for (auto &fit : fits)
+		{
+			for (auto i = 0u; i < texels_per_block; i++)
+			{
+				writer.write(fit.indices[i], (i == 0) ? 1 : 2);
+			}
+		}
+		return { writer.bits, fits[0].error + fits[1].error };
+	}
+
+	auto encode_bc7(const block_texels &block, const quality_preset &preset) -> bc7_block
+	{
+		auto best = encode_mode6(block, preset);
+		auto opaque = std::all_of(block.texels.begin(), block.texels.end(), [](FXMVECTOR texel)
+		{
+			return XMVectorGetW(texel) == 255.0f;
+		});
+		if (opaque and preset.partition_candidates > 0 and best.error > 0.0f)
+		{
+			auto partitioned = encode_mode1(block, preset);
+			if (partitioned.error < best.error)
+			{
+				best = partitioned;
+			}
+		}
+		else if (not opaque and preset.refine_iterations > 0 and best.error > 0.0f)
+		{
+			auto separate_alpha = encode_mode5(block, preset);
+			if (separate_alpha.error < best.error)
+			{
+				best = separate_alpha;
+			}
+		}
+		return best.bits;
+	}
+
+	// Decoders, to measure what the GPU will sample
+	using decoded_block = std::array<std::array<uint32_t, 4>, texels_per_block>;
+
+	auto decode_bc1(uint64_t bits, bool four_colour_only) -> decoded_block
+	{
+		auto c0 = static_cast<uint32_t>(bits & 0xffff), c1 = static_cast<uint32_t>((bits >> 16) & 0xffff);
+		auto e0 = channels(unpack_565(c0)), e1 = channels(unpack_565(c1));
+		auto palette = std::array<std::array<uint32_t, 4>, 4>{ e0, e1 };
+		for (auto c = 0u; c < 3; c++)
+		{
+			if (four_colour_only or c0 > c1)
+			{
+				palette[2][c] = (2 * e0[c] + e1[c]) / 3;
+				palette[3][c] = (e0[c] + 2 * e1[c]) / 3;
+			}
+			else
+			{
+				palette[2][c] = (e0[c] + e1[c]) / 2;
+				palette[3][c] = 0;
+			}
+		}
+		palette[0][3] = palette[1][3] = palette[2][3] = 255;
+		palette[3][3] = (four_colour_only or c0 > c1) ? 255 : 0;
+
+		auto texels = decoded_block{};
+		for (auto i = 0u; i < texels_per_block; i++)
+		{
+			texels[i] = palette[(bits >> (32 + 2 * i)) & 3];
+		}
+		return texels;
+	}
+
+	auto decode_bc4(uint64_t bits) -> std::array<uint32_t, texels_per_block>
+	{
+		auto palette = bc4_palette(static_cast<uint32_t>(bits & 0xff), static_cast<uint32_t>((bits >> 8) & 0xff));
+		auto values = std::array<uint32_t, texels_per_block>{};
+		for (auto i = 0u; i < texels_per_block; i++)
+		{
+			values[i] = static_cast<uint32_t>(palette[(bits >> (16 + 3 * i)) & 7]);
+		}
+		return values;
+	}
+
+	// Only the modes encode_bc7 writes
+	auto decode_bc7(const bc7_block &bits) -> decoded_block
+	{
+		auto interpolate = [](uint32_t e0, uint32_t e1, int weight)
+		{
+			return static_cast<uint32_t>(((64 - weight) * e0 + weight * e1 + 32) >> 6);
+		};
+
+		auto texels = decoded_block{};
+		auto reader = bit_reader{ bits };
+		if (bits[0] & 0x40 and (bits[0] & 0x3f) == 0)
+		{
+			reader.read(7);
+			auto e = std::array<std::array<uint32_t, 4>, 2>{};
+			for (auto c = 0u; c < 4; c++)
+			{
+				e[0][c] = reader.read(7) << 1;
+				e[1][c] = reader.read(7) << 1;
+			}
+			auto p0 = reader.read(1), p1 = reader.read(1);
+			for (auto c = 0u; c < 4; c++)
+			{
+				e[0][c] |= p0;
+				e[1][c] |= p1;
+			}
+			for (auto i = 0u; i < texels_per_block; i++)
+			{
+				auto weight = bc7_weights_4[reader.read((i == 0) ? 3 : 4)];
+				for (auto c = 0u; c < 4; c++)
+				{
+					texels[i][c] = interpolate(e[0][c], e[1][c], weight);
+				}
+			}
+		}
+		else if (bits[0] & 0x20 and (bits[0] & 0x1f) == 0)
+		{
+			reader.read(8);
+			auto e = std::array<std::array<uint32_t, 4>, 2>{};
+			for (auto c = 0u; c < 3; c++)
+			{
+				for (auto &endpoint : e)
+				{
+					auto v7 = reader.read(7);
+					endpoint[c] = (v7 << 1) | (v7 >> 6);
+				}
+			}
+			e[0][3] = reader.read(8);
+			e[1][3] = reader.read(8);
+			for (auto i = 0u; i < texels_per_block; i++)
+			{
+				auto weight = bc7_weights_2[reader.read((i == 0) ? 1 : 2)];
+				for (auto c = 0u; c < 3; c++)
+				{
+					texels[i][c] = interpolate(e[0][c], e[1][c], weight);
+				}
+			}
+			for (auto i = 0u; i < texels_per_block; i++)
+			{
+				texels[i][3] = interpolate(e[0][3], e[1][3], bc7_weights_2[reader.read((i == 0) ? 1 : 2)]);
+			}
+		}
+		else if ((bits[0] & 3) == 2)
+		{
+			reader.read(2);
+			auto partition = reader.read(6);
+			auto e = std::array<std::array<uint32_t, 4>, 4>{};
+			for (auto c = 0u; c < 3; c++)
+			{
+				for (auto &endpoint : e)
+				{
+					endpoint[c] = reader.read(6) << 1;
+				}
+			}
+			auto p = std::array{ reader.read(1), reader.read(1) };
+			for (auto n = 0u; n < 4; n++)
+			{
+				for (auto c = 0u; c < 3; c++)
+				{
+					auto v7 = e[n][c] | p[n / 2];
+					e[n][c] = (v7 << 1) | (v7 >> 6);
+				}
+			}
+			for (auto i = 0u; i < texels_per_block; i++)
+			{
+				auto subset = (bc7_partitions[partition] >> i) & 1u;
+				auto anchor = (i == 0 or i == bc7_anchors[partition]);
+				auto weight = bc7_weights_3[reader.read(anchor ? 2 : 3)];
+				for (auto c = 0u; c < 3; c++)
+				{
+					texels[i][c] = interpolate(e[subset * 2][c], e[subset * 2 + 1][c], weight);
+				}
+				texels[i][3] = 255;
+			}
+		}
+		return texels;
+	}
+
+	struct block_error
+	{
+		double squared;
+		uint64_t samples;
+	};
+
+	// Inside texels only, over the channels in mask. BC1 transparent texels only need to stay transparent.
+	auto measure(const block_texels &block, const decoded_block &decoded, std::array<bool, 4> mask) -> block_error
+	{
+		auto error = block_error{};
+		for (auto i = 0u; i < texels_per_block; i++)
+		{
+			if (not (block.inside & (1u << i)) or (not mask[3] and decoded[i][3] == 0))
+			{
+				continue;
+			}
+			auto source = channels(block.texels[i]);
+			for (auto c = 0u; c < 4; c++)
+			{
+				if (mask[c])
+				{
+					auto d = static_cast<double>(source[c]) - decoded[i][c];
+					error.squared += d * d;
+					error.samples++;
+				}
+			}
+		}
+		return error;
+	}
+
+	auto encode_block(const block_texels &block, block_format format, const quality_preset &preset, std::byte *output) -> block_error
+	{
+		switch (format)
+		{
+			case block_format::bc1:
+			{
+				auto bits = encode_bc1(block, preset, true);
+				std::memcpy(output, &bits, sizeof(bits));
+				return measure(block, decode_bc1(bits, false), { true, true, true, false });
+			}
+			case block_format::bc3:
+			{
+				auto alpha = encode_bc4(channel_of(block, 3), preset);
+				auto colour = encode_bc1(block, preset, false);
+				std::memcpy(output, &alpha, sizeof(alpha));
+				std::memcpy(output + sizeof(alpha), &colour, sizeof(colour));
+
+				auto decoded = decode_bc1(colour, true);
+				auto decoded_alpha = decode_bc4(alpha);
+				for (auto i = 0u; i < texels_per_block; i++)
+				{
+					decoded[i][3] = decoded_alpha[i];
+				}
+				return measure(block, decoded, { true, true, true, true });
+			}
+			case block_format::bc5:
+			{
+				auto red = encode_bc4(channel_of(block, 0), preset);
+				auto green = encode_bc4(channel_of(block, 1), preset);
+				std::memcpy(output, &red, sizeof(red));
+				std::memcpy(output + sizeof(red), &green, sizeof(green));
+
+				auto decoded = decoded_block{};
+				auto decoded_red = decode_bc4(red), decoded_green = decode_bc4(green);
+				for (auto i = 0u; i < texels_per_block; i++)
+				{
+					decoded[i] = { decoded_red[i], decoded_green[i], 0, 255 };
+				}
+				return measure(block, decoded, { true, true, false, false });
+			}
+			case block_format::bc7:
+			{
+				auto bits = encode_bc7(block, preset);
+				std::memcpy(output, bits.data(), sizeof(bits));
+				return measure(block, decode_bc7(bits), { true, true, true, true });
+			}
+		}
+		return {};
+	}
+
+	// One mip of one slice
+	struct surface_job
+	{
+		std::span<const std::byte> source;
+		uint32_t width;
+		uint32_t height;
+		uint32_t blocks_wide;
+		uint32_t first_block;   // counted over the whole texture
+		std::size_t output_offset;
+	};
+
+	auto load_block(const surface_job &job, uint32_t block_x, uint32_t block_y, bool bgra, bool opaque) -> block_texels
+	{
+		auto block = block_texels{};
+		for (auto i = 0u; i < texels_per_block; i++)
+		{
+			auto x = block_x * 4 + i % 4, y = block_y * 4 + i / 4;
+			if (x < job.width and y < job.height)
+			{
+				block.inside |= static_cast<uint16_t>(1u << i);
+			}
+
+			auto texel = job.source.data() + (std::size_t{ std::min(y, job.height - 1) } * job.width + std::min(x, job.width - 1)) * 4;
+			auto channel = [&](uint32_t c) { return static_cast<float>(static_cast<uint8_t>(texel[c])); };
+			block.texels[i] = XMVectorSet(channel(bgra ? 2 : 0), channel(1), channel(bgra ? 0 : 2),
+			                              opaque ? 255.0f : channel(3));
+		}
+		return block;
+	}
+
+	auto compressed_format(dxgi_format source, block_format format) -> dxgi_format
+	{
+		auto srgb = source == dxgi_format::r8g8b8a8_unorm_srgb or source == dxgi_format::b8g8r8a8_unorm_srgb;
+		switch (format)
+		{
+			case block_format::bc1:
+				return srgb ? dxgi_format::bc1_unorm_srgb : dxgi_format::bc1_unorm;
+			case block_format::bc3:
+				return srgb ? dxgi_format::bc3_unorm_srgb : dxgi_format::bc3_unorm;
+			case block_format::bc5:
+				return dxgi_format::bc5_unorm;
+			case block_format::bc7:
+				return srgb ? dxgi_format::bc7_unorm_srgb : dxgi_format::bc7_unorm;
+		}
+		return dxgi_format::unknown;
+	}
+}
+
+auto dx11_lessons::can_block_compress(dxgi_format format) -> bool
+{
+	return format == dxgi_format::r8g8b8a8_unorm or format == dxgi_format::r8g8b8a8_unorm_srgb
+	    or format == dxgi_format::b8g8r8a8_unorm or format == dxgi_format::b8g8r8a8_unorm_srgb
+	    or format == dxgi_format::b8g8r8x8_unorm;
+}
+
+auto dx11_lessons::compress_blocks(const dds_texture &texture, const block_settings &settings) -> compressed_texture
+{
+	assert(can_block_compress(texture.format));
+
+	auto result = compressed_texture{ compressed_format(texture.format, settings.format), {}, 0.0 };
+	auto preset = preset_for(settings.quality);
+	auto bgra = texture.format == dxgi_format::b8g8r8a8_unorm or texture.format == dxgi_format::b8g8r8a8_unorm_srgb
+	         or texture.format == dxgi_format::b8g8r8x8_unorm;
+	auto opaque = texture.format == dxgi_format::b8g8r8x8_unorm;
+	auto block_size = (settings.format == block_format::bc1) ? 8u : 16u;
+
+	auto jobs = std::vector<surface_job>{};
+	auto block_count = 0u;
+	auto output_size = std::size_t{};
+	for (auto slice = 0u; slice < texture.array_size; slice++)
+	{
+		for (auto mip = 0u; mip < texture.mip_count; mip++)
+		{
+			auto width = std::max(1u, texture.width >> mip), height = std::max(1u, texture.height >> mip);
+			auto blocks_wide = (width + 3) / 4, blocks_high = (height + 3) / 4;
+			jobs.push_back({ dds_subresource(texture, slice, mip), width, height, blocks_wide, block_count, output_size });
+			block_count += blocks_wide * blocks_high;
+			output_size += dds_surface_size(result.format, width, height).size;
+		}
+	}
+	result.data.resize(output_size);
+
+	auto errors = std::vector<block_error>(block_count);
+	for_each_range(block_count, [&](uint32_t first, uint32_t last)
+	{
+		auto job = std::prev(std::upper_bound(jobs.begin(), jobs.end(), first, [](uint32_t block, const surface_job &j)
+		{
+			return block < j.first_block;
+		}));
+		for (auto b = first; b < last; b++)
+		{
+			while (std::next(job) != jobs.end() and std::next(job)->first_block <= b)
+			{
+				++job;
+			}
+			auto local = b - job->first_block;
+			auto block = load_block(*job, local % job->blocks_wide, local / job->blocks_wide, bgra, opaque);
+			errors[b] = encode_block(block, settings.format, preset, result.data.data() + job->output_offset + std::size_t{ local } * block_size);
+		}
+		return true;
+	});
+
+	// Summed in block order, so PSNR doesn't depend on the thread count either
+	auto total = std::accumulate(errors.begin(), errors.end(), block_error{}, [](block_error sum, const block_error &e)
+	{
+		return block_error{ sum.squared + e.squared, sum.samples + e.samples };
+	});
+	result.psnr = (total.squared == 0.0) ? std::numeric_limits<double>::infinity()
+	            : 10.0 * std::log10(255.0 * 255.0 * total.samples / total.squared);
+	return result;
+}
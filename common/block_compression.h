@@ -0,0 +1,47 @@
+#pragma once
+
+#include "dds_file.h"
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace dx11_lessons
+{
+	enum class block_format
+	{
+		bc1,   // RGB, texels with alpha under half become transparent black, 4 bits per texel
+		bc3,   // RGBA, 8 bits per texel
+		bc5,   // red and green only, for tangent space normal maps
+		bc7,   // RGBA, 8 bits per texel, best quality and slowest to encode
+	};
+
+	enum class block_quality
+	{
+		fast,     // principal axis endpoints, no refinement
+		normal,   // endpoints refined by least squares
+		high,     // more refinement, BC7 also searches two subset partitions for opaque blocks
+	};
+
+	struct block_settings
+	{
+		block_format format = block_format::bc1;
+		block_quality quality = block_quality::normal;
+	};
+
+	struct compressed_texture
+	{
+		dxgi_format format;            // _srgb if the source was
+		std::vector<std::byte> data;   // every subresource, in dds_texture data order
+		double psnr;                   // dB over every texel and the channels the format keeps, infinity if lossless
+	};
+
+	// 8 bit, 4 channel formats, the same ones mips can be generated for
+	auto can_block_compress(dxgi_format format) -> bool;
+
+	// Every mip of every slice, blocks are spread over the hardware threads and are independent,
+	// so the output is the same however many threads there are.
+	// Endpoint fitting works on 4 channel vectors. BC7 uses mode 6, mode 5 for blocks whose alpha
+	// doesn't follow the colour and, at high quality, two subset mode 1 for opaque blocks.
+	auto compress_blocks(const dds_texture &texture, const block_settings &settings) -> compressed_texture;
+}
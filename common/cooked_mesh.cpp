@@ -0,0 +1,241 @@
+#include "cooked_mesh.h"
+
+#include <algorithm>
+#include <limits>
+#include <cstring>
+#include <cmath>
+
+using namespace dx11_lessons;
+
+namespace
+{
+	constexpr auto data_alignment = uint64_t{ 16 };
+
+	auto align_up(uint64_t value, uint64_t alignment) -> uint64_t
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	// Round to nearest even, overflow goes to infinity, tiny values flush to zero
+	auto float_to_half(float value) -> uint16_t
+	{
+		auto bits = uint32_t{};
+		std::memcpy(&bits, &value, sizeof(bits));
+
+		auto sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+		auto exponent = static_cast<int32_t>((bits >> 23) & 0xff) - 127 + 15;
+		auto mantissa = bits & 0x7fffff;
+
+		if (((bits >> 23) & 0xff) == 0xff)
+		{
+			return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+		}
+		if (exponent >= 31)
+		{
+			return sign | 0x7c00;
+		}
+		if (exponent <= 0)
+		{
+			if (exponent < -10)
+			{
+				return sign;
+			}
+			mantissa |= 0x800000;
+			auto shift = static_cast<uint32_t>(14 - exponent);
+			auto half_mantissa = mantissa >> shift;
+			auto remainder = mantissa & ((1u << shift) - 1);
+			auto halfway = 1u << (shift - 1);
+			if (remainder > halfway or (remainder == halfway and (half_mantissa & 1)))
+			{
+				half_mantissa++;
+			}
+			return sign | static_cast<uint16_t>(half_mantissa);
+		}
+
+		auto half = static_cast<uint32_t>(exponent << 10) | (mantissa >> 13);
+		auto remainder = mantissa & 0x1fff;
+		if (remainder > 0x1000 or (remainder == 0x1000 and (half & 1)))
+		{
+			half++;   // may carry into the exponent, which is still correct
+		}
+		return sign | static_cast<uint16_t>(half);
+	}
+
+	auto to_snorm8(float value) -> int8_t
+	{
+		return static_cast<int8_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 127.0f));
+	}
+
+	auto to_unorm16(float value) -> uint16_t
+	{
+		return static_cast<uint16_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+	}
+
+	template <typename vertex_t, typename fn_t>
+	void write_vertices(std::byte *out, uint32_t vertex_count, fn_t make_vertex)
+	{
+		for (auto i = 0u; i < vertex_count; i++)
+		{
+			auto v = make_vertex(i);
+			std::memcpy(out + i * sizeof(vertex_t), &v, sizeof(v));
+		}
+	}
+}
+
+auto cooked_mesh::material_name(const cooked_mesh_group &group) const -> std::string_view
+{
+	return names.substr(group.material_offset, group.material_size);
+}
+
+auto dx11_lessons::cook_mesh(const obj_data &data, cooked_vertex_format format) -> std::vector<std::byte>
+{
+	auto vertex_count = static_cast<uint32_t>(data.vertices.size());
+	auto has_normals = data.normals.size() == data.vertices.size();
+	auto has_uvs = data.uv_coords.size() == data.vertices.size();
+
+	auto header = cooked_mesh_header{};
+	header.magic = cooked_mesh_magic;
+	header.version = cooked_mesh_version;
+	header.format = format;
+	header.vertex_stride = (format == cooked_vertex_format::p32n32t32) ? sizeof(cooked_vertex_full) : sizeof(cooked_vertex_quantized);
+	header.vertex_count = vertex_count;
+	header.index_count = static_cast<uint32_t>(data.indicies.size());
+	header.group_count = static_cast<uint32_t>(data.groups.size());
+	header.position_offset = { 0.0f, 0.0f, 0.0f };
+	header.position_scale = { 1.0f, 1.0f, 1.0f };
+
+	auto groups = std::vector<cooked_mesh_group>{};
+	auto names = std::string{};
+	for (auto &grp : data.groups)
+	{
+		groups.push_back({ grp.index_start, grp.index_count,
+		                   static_cast<uint32_t>(names.size()), static_cast<uint32_t>(grp.material_name.size()) });
+		names += grp.material_name;
+	}
+	header.names_size = static_cast<uint32_t>(names.size());
+
+	auto groups_offset = sizeof(cooked_mesh_header);
+	auto names_offset = groups_offset + groups.size() * sizeof(cooked_mesh_group);
+	header.vertex_offset = align_up(names_offset + names.size(), data_alignment);
+	header.index_offset = align_up(header.vertex_offset + uint64_t{ vertex_count } * header.vertex_stride, data_alignment);
+
+	auto file = std::vector<std::byte>(header.index_offset + data.indicies.size() * sizeof(uint32_t));
+	auto vertex_out = file.data() + header.vertex_offset;
+
+	if (format == cooked_vertex_format::p32n32t32)
+	{
+		write_vertices<cooked_vertex_full>(vertex_out, vertex_count, [&](uint32_t i)
+		{
+			auto v = cooked_vertex_full{};
+			v.position = { data.vertices[i].x, data.vertices[i].y, data.vertices[i].z };
+			if (has_normals)
+			{
+				v.normal = { data.normals[i].x, data.normals[i].y, data.normals[i].z };
+			}
+			if (has_uvs)
+			{
+				v.uv = { data.uv_coords[i].x, data.uv_coords[i].y };
+			}
+			return v;
+		});
+	}
+	else
+	{
+		auto lo = std::array{ std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+		auto hi = std::array{ std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+		for (auto &p : data.vertices)
+		{
+			auto xyz = std::array{ p.x, p.y, p.z };
+			for (auto a = 0u; a < 3; a++)
+			{
+				lo[a] = std::min(lo[a], xyz[a]);
+				hi[a] = std::max(hi[a], xyz[a]);
+			}
+		}
+		for (auto a = 0u; a < 3 and vertex_count > 0; a++)
+		{
+			header.position_offset[a] = lo[a];
+			header.position_scale[a] = std::max(hi[a] - lo[a], std::numeric_limits<float>::min());
+		}
+
+		write_vertices<cooked_vertex_quantized>(vertex_out, vertex_count, [&](uint32_t i)
+		{
+			auto v = cooked_vertex_quantized{};
+			auto xyz = std::array{ data.vertices[i].x, data.vertices[i].y, data.vertices[i].z };
+			for (auto a = 0u; a < 3; a++)
+			{
+				v.position[a] = to_unorm16((xyz[a] - header.position_offset[a]) / header.position_scale[a]);
+			}
+			if (has_normals)
+			{
+				v.normal = { to_snorm8(data.normals[i].x), to_snorm8(data.normals[i].y), to_snorm8(data.normals[i].z), 0 };
+			}
+			if (has_uvs)
+			{
+				v.uv = { float_to_half(data.uv_coords[i].x), float_to_half(data.uv_coords[i].y) };
+			}
+			return v;
+		});
+	}
+
+	std::memcpy(file.data(), &header, sizeof(header));
+	std::ranges::copy(std::as_bytes(std::span(groups)), file.begin() + groups_offset);
+	std::ranges::copy(std::as_bytes(std::span(names)), file.begin() + names_offset);
+	std::ranges::copy(std::as_bytes(std::span(data.indicies)), file.begin() + header.index_offset);
+
+	return file;
+}
+
+auto dx11_lessons::read_cooked_mesh(std::span<const std::byte> file_data) -> std::optional<cooked_mesh>
+{
+	auto header = cooked_mesh_header{};
+	if (file_data.size() < sizeof(header))
+	{
+		return std::nullopt;
+	}
+	std::memcpy(&header, file_data.data(), sizeof(header));
+
+	auto groups_offset = uint64_t{ sizeof(cooked_mesh_header) };
+	auto names_offset = groups_offset + uint64_t{ header.group_count } * sizeof(cooked_mesh_group);
+	auto vertex_size = uint64_t{ header.vertex_count } * header.vertex_stride;
+	auto index_size = uint64_t{ header.index_count } * sizeof(uint32_t);
+	auto expected_stride = (header.format == cooked_vertex_format::p32n32t32) ? sizeof(cooked_vertex_full)
+	                     : (header.format == cooked_vertex_format::p16n8t16) ? sizeof(cooked_vertex_quantized)
+	                     : 0;
+
+	if (header.magic != cooked_mesh_magic or header.version != cooked_mesh_version
+	    or header.vertex_stride != expected_stride
+	    or names_offset + header.names_size > header.vertex_offset
+	    or header.vertex_offset % data_alignment != 0 or header.index_offset % data_alignment != 0
+	    or header.vertex_offset + vertex_size > header.index_offset
+	    or header.index_offset > file_data.size() or index_size > file_data.size() - header.index_offset)
+	{
+		return std::nullopt;
+	}
+
+	auto mesh = cooked_mesh{};
+	mesh.format = header.format;
+	mesh.vertex_stride = header.vertex_stride;
+	mesh.position_offset = header.position_offset;
+	mesh.position_scale = header.position_scale;
+	mesh.vertices = file_data.subspan(header.vertex_offset, vertex_size);
+	mesh.indicies = { reinterpret_cast<const uint32_t *>(file_data.data() + header.index_offset), header.index_count };
+	mesh.groups = { reinterpret_cast<const cooked_mesh_group *>(file_data.data() + groups_offset), header.group_count };
+	mesh.names = { reinterpret_cast<const char *>(file_data.data() + names_offset), header.names_size };
+
+	auto groups_in_range = std::all_of(mesh.groups.begin(), mesh.groups.end(), [&](const cooked_mesh_group &grp)
+	{
+		return uint64_t{ grp.index_start } + grp.index_count <= header.index_count
+		   and uint64_t{ grp.material_offset } + grp.material_size <= header.names_size;
+	});
+	auto indicies_in_range = std::all_of(mesh.indicies.begin(), mesh.indicies.end(), [&](uint32_t idx)
+	{
+		return idx < header.vertex_count;
+	});
+	if (not groups_in_range or not indicies_in_range)
+	{
+		return std::nullopt;
+	}
+
+	return mesh;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "obj_mtl_parser.h"
+
+#include <array>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <optional>
+#include <span>
+#include <cstddef>
+#include <cstdint>
+
+namespace dx11_lessons
+{
+	// Cooked mesh layout, little endian:
+	//   cooked_mesh_header
+	//   cooked_mesh_group[group_count]
+	//   material names, not null terminated
+	//   vertices, at a 16 byte boundary
+	//   uint32_t indicies, at a 16 byte boundary
+	// Vertices and indicies are in upload order, so a mapped file is used as is.
+	constexpr auto cooked_mesh_magic = std::array{ 'D', 'X', 'M', 'S' };
+	constexpr auto cooked_mesh_version = uint32_t{ 1 };
+
+	enum class cooked_vertex_format : uint32_t
+	{
+		p32n32t32,   // float3 position, float3 normal, float2 uv, gpu_datatypes vertex
+		p16n8t16,    // unorm16x4 position within bounds, snorm8x4 normal, half2 uv
+	};
+
+	struct cooked_vertex_full
+	{
+		std::array<float, 3> position;
+		std::array<float, 3> normal;
+		std::array<float, 2> uv;
+	};
+
+	struct cooked_vertex_quantized
+	{
+		std::array<uint16_t, 4> position;   // position = offset + value / 65535 * scale
+		std::array<int8_t, 4> normal;
+		std::array<uint16_t, 2> uv;          // half floats
+	};
+
+	static_assert(sizeof(cooked_vertex_full) == 32);
+	static_assert(sizeof(cooked_vertex_quantized) == 16);
+
+	struct cooked_mesh_header
+	{
+		std::array<char, 4> magic;
+		uint32_t version;
+		cooked_vertex_format format;
+		uint32_t vertex_stride;
+		uint32_t vertex_count;
+		uint32_t index_count;
+		uint32_t group_count;
+		uint32_t names_size;
+		std::array<float, 3> position_offset;   // bounds min, zero for p32n32t32
+		std::array<float, 3> position_scale;    // bounds size, one for p32n32t32
+		uint64_t vertex_offset;                 // from start of file
+		uint64_t index_offset;
+	};
+
+	struct cooked_mesh_group
+	{
+		uint32_t index_start;
+		uint32_t index_count;
+		uint32_t material_offset;   // from start of names
+		uint32_t material_size;
+	};
+
+	static_assert(sizeof(cooked_mesh_header) == 72);
+	static_assert(sizeof(cooked_mesh_group) == 16);
+
+	// Views into the cooked file, valid while its bytes are
+	struct cooked_mesh
+	{
+		cooked_vertex_format format;
+		uint32_t vertex_stride;
+		std::array<float, 3> position_offset;
+		std::array<float, 3> position_scale;
+		std::span<const std::byte> vertices;
+		std::span<const uint32_t> indicies;
+		std::span<const cooked_mesh_group> groups;
+		std::string_view names;
+
+		auto material_name(const cooked_mesh_group &group) const -> std::string_view;
+	};
+
+	// Expects welded, optimised data. Missing normals or uvs are written as zero.
+	auto cook_mesh(const obj_data &data, cooked_vertex_format format) -> std::vector<std::byte>;
+
+	// nullopt if the header doesn't match or the data is out of bounds
+	auto read_cooked_mesh(std::span<const std::byte> file_data) -> std::optional<cooked_mesh>;
+}
@@ -0,0 +1,372 @@
+#include "dds_file.h"
+
+#include <array>
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+using namespace dx11_lessons;
+
+namespace
+{
+	constexpr auto dds_magic = uint32_t{ 0x20534444 };   // "DDS "
+
+	constexpr auto make_fourcc(char a, char b, char c, char d) -> uint32_t
+	{
+		return static_cast<uint32_t>(a) | static_cast<uint32_t>(b) << 8
+		     | static_cast<uint32_t>(c) << 16 | static_cast<uint32_t>(d) << 24;
+	}
+
+	struct dds_pixel_format
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t fourcc;
+		uint32_t rgb_bit_count;
+		uint32_t r_mask;
+		uint32_t g_mask;
+		uint32_t b_mask;
+		uint32_t a_mask;
+	};
+
+	struct dds_header
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t height;
+		uint32_t width;
+		uint32_t pitch_or_linear_size;
+		uint32_t depth;
+		uint32_t mip_map_count;
+		std::array<uint32_t, 11> reserved1;
+		dds_pixel_format pixel_format;
+		uint32_t caps;
+		uint32_t caps2;
+		uint32_t caps3;
+		uint32_t caps4;
+		uint32_t reserved2;
+	};
+
+	struct dds_header_dx10
+	{
+		dxgi_format format;
+		uint32_t resource_dimension;
+		uint32_t misc_flag;
+		uint32_t array_size;
+		uint32_t misc_flags2;
+	};
+
+	static_assert(sizeof(dds_pixel_format) == 32);
+	static_assert(sizeof(dds_header) == 124);
+	static_assert(sizeof(dds_header_dx10) == 20);
+
+	constexpr auto ddsd_caps = 0x1u, ddsd_height = 0x2u, ddsd_width = 0x4u,
+	               ddsd_pixel_format = 0x1000u, ddsd_mip_map_count = 0x20000u;
+	constexpr auto ddpf_alpha_pixels = 0x1u, ddpf_fourcc = 0x4u, ddpf_rgb = 0x40u, ddpf_luminance = 0x20000u;
+	constexpr auto ddscaps_complex = 0x8u, ddscaps_texture = 0x1000u, ddscaps_mip_map = 0x400000u;
+	constexpr auto ddscaps2_cubemap = 0x200u, ddscaps2_all_faces = 0xfc00u, ddscaps2_volume = 0x200000u;
+	constexpr auto dimension_texture2d = 3u;
+	constexpr auto misc_texture_cube = 0x4u;
+
+	// D3D11 feature level 11 limits
+	constexpr auto max_dimension = 16384u;
+	constexpr auto max_array_size = 2048u;
+
+	auto bits_per_pixel(dxgi_format format) -> uint32_t
+	{
+		switch (format)
+		{
+			case dxgi_format::r32g32b32a32_float:
+				return 128;
+			case dxgi_format::r16g16b16a16_float:
+				return 64;
+			case dxgi_format::r10g10b10a2_unorm:
+			case dxgi_format::r11g11b10_float:
+			case dxgi_format::r8g8b8a8_unorm:
+			case dxgi_format::r8g8b8a8_unorm_srgb:
+			case dxgi_format::r16g16_float:
+			case dxgi_format::r32_float:
+			case dxgi_format::b8g8r8a8_unorm:
+			case dxgi_format::b8g8r8x8_unorm:
+			case dxgi_format::b8g8r8a8_unorm_srgb:
+				return 32;
+			case dxgi_format::r8g8_unorm:
+			case dxgi_format::r16_float:
+			case dxgi_format::b5g6r5_unorm:
+				return 16;
+			case dxgi_format::r8_unorm:
+				return 8;
+			case dxgi_format::bc1_unorm:
+			case dxgi_format::bc1_unorm_srgb:
+			case dxgi_format::bc4_unorm:
+			case dxgi_format::bc4_snorm:
+				return 4;
+			case dxgi_format::bc2_unorm:
+			case dxgi_format::bc2_unorm_srgb:
+			case dxgi_format::bc3_unorm:
+			case dxgi_format::bc3_unorm_srgb:
+			case dxgi_format::bc5_unorm:
+			case dxgi_format::bc5_snorm:
+			case dxgi_format::bc6h_uf16:
+			case dxgi_format::bc6h_sf16:
+			case dxgi_format::bc7_unorm:
+			case dxgi_format::bc7_unorm_srgb:
+				return 8;
+			case dxgi_format::unknown:
+				break;
+		}
+		return 0;
+	}
+
+	// Only the common legacy layouts, anything else has to use a DX10 header
+	auto legacy_format(const dds_pixel_format &pf) -> dxgi_format
+	{
+		if (pf.flags & ddpf_fourcc)
+		{
+			switch (pf.fourcc)
+			{
+				case make_fourcc('D', 'X', 'T', '1'): return dxgi_format::bc1_unorm;
+				case make_fourcc('D', 'X', 'T', '2'):
+				case make_fourcc('D', 'X', 'T', '3'): return dxgi_format::bc2_unorm;
+				case make_fourcc('D', 'X', 'T', '4'):
+				case make_fourcc('D', 'X', 'T', '5'): return dxgi_format::bc3_unorm;
+				case make_fourcc('A', 'T', 'I', '1'):
+				case make_fourcc('B', 'C', '4', 'U'): return dxgi_format::bc4_unorm;
+				case make_fourcc('B', 'C', '4', 'S'): return dxgi_format::bc4_snorm;
+				case make_fourcc('A', 'T', 'I', '2'):
+				case make_fourcc('B', 'C', '5', 'U'): return dxgi_format::bc5_unorm;
+				case make_fourcc('B', 'C', '5', 'S'): return dxgi_format::bc5_snorm;
+				case 111: return dxgi_format::r16_float;            // D3DFMT_R16F
+				case 112: return dxgi_format::r16g16_float;         // D3DFMT_G16R16F
+				case 113: return dxgi_format::r16g16b16a16_float;   // D3DFMT_A16B16G16R16F
+				case 114: return dxgi_format::r32_float;            // D3DFMT_R32F
+				case 116: return dxgi_format::r32g32b32a32_float;   // D3DFMT_A32B32G32R32F
+			}
+			return dxgi_format::unknown;
+		}
+
+		if ((pf.flags & ddpf_rgb) and pf.rgb_bit_count == 32)
+		{
+			if (pf.r_mask == 0x000000ff and pf.g_mask == 0x0000ff00 and pf.b_mask == 0x00ff0000)
+			{
+				return dxgi_format::r8g8b8a8_unorm;
+			}
+			if (pf.r_mask == 0x00ff0000 and pf.g_mask == 0x0000ff00 and pf.b_mask == 0x000000ff)
+			{
+				return (pf.flags & ddpf_alpha_pixels) ? dxgi_format::b8g8r8a8_unorm : dxgi_format::b8g8r8x8_unorm;
+			}
+		}
+		if ((pf.flags & ddpf_rgb) and pf.rgb_bit_count == 16
+		    and pf.r_mask == 0xf800 and pf.g_mask == 0x07e0 and pf.b_mask == 0x001f)
+		{
+			return dxgi_format::b5g6r5_unorm;
+		}
+		if ((pf.flags & (ddpf_rgb | ddpf_luminance)) and pf.rgb_bit_count == 8 and pf.r_mask == 0xff)
+		{
+			return dxgi_format::r8_unorm;
+		}
+		return dxgi_format::unknown;
+	}
+
+	auto texture_size(const dds_texture &texture) -> std::size_t
+	{
+		auto size = std::size_t{};
+		for (auto mip = 0u; mip < texture.mip_count; mip++)
+		{
+			size += dds_surface_size(texture.format,
+			                         std::max(1u, texture.width >> mip),
+			                         std::max(1u, texture.height >> mip)).size;
+		}
+		return size * texture.array_size;
+	}
+}
+
+auto dx11_lessons::is_block_compressed(dxgi_format format) -> bool
+{
+	switch (format)
+	{
+		case dxgi_format::bc1_unorm:
+		case dxgi_format::bc1_unorm_srgb:
+		case dxgi_format::bc2_unorm:
+		case dxgi_format::bc2_unorm_srgb:
+		case dxgi_format::bc3_unorm:
+		case dxgi_format::bc3_unorm_srgb:
+		case dxgi_format::bc4_unorm:
+		case dxgi_format::bc4_snorm:
+		case dxgi_format::bc5_unorm:
+		case dxgi_format::bc5_snorm:
+		case dxgi_format::bc6h_uf16:
+		case dxgi_format::bc6h_sf16:
+		case dxgi_format::bc7_unorm:
+		case dxgi_format::bc7_unorm_srgb:
+			return true;
+		default:
+			return false;
+	}
+}
+
+auto dx11_lessons::dds_surface_size(dxgi_format format, uint32_t width, uint32_t height) -> dds_surface
+{
+	auto surface = dds_surface{};
+	if (is_block_compressed(format))
+	{
+		auto block_bytes = bits_per_pixel(format) * 16 / 8;
+		surface.row_pitch = std::max(1u, (width + 3) / 4) * block_bytes;
+		surface.row_count = std::max(1u, (height + 3) / 4);
+	}
+	else
+	{
+		surface.row_pitch = (width * bits_per_pixel(format) + 7) / 8;
+		surface.row_count = height;
+	}
+	surface.size = std::size_t{ surface.row_pitch } * surface.row_count;
+	return surface;
+}
+
+auto dx11_lessons::dds_subresource(const dds_texture &texture, uint32_t slice, uint32_t mip) -> std::span<const std::byte>
+{
+	auto slice_size = texture_size(texture) / texture.array_size;
+	auto offset = slice * slice_size;
+	for (auto m = 0u; m < mip; m++)
+	{
+		offset += dds_surface_size(texture.format,
+		                           std::max(1u, texture.width >> m),
+		                           std::max(1u, texture.height >> m)).size;
+	}
+
+	auto size = dds_surface_size(texture.format,
+	                             std::max(1u, texture.width >> mip),
+	                             std::max(1u, texture.height >> mip)).size;
+	return texture.data.subspan(offset, size);
+}
+
+auto dx11_lessons::dds_subresources(const dds_texture &texture) -> std::vector<dds_subresource_data>
+{
+	auto subresources = std::vector<dds_subresource_data>{};
+	subresources.reserve(std::size_t{ texture.array_size } * texture.mip_count);
+
+	auto offset = std::size_t{};
+	for (auto slice = 0u; slice < texture.array_size; slice++)
+	{
+		for (auto mip = 0u; mip < texture.mip_count; mip++)
+		{
+			auto surface = dds_surface_size(texture.format,
+			                                std::max(1u, texture.width >> mip),
+			                                std::max(1u, texture.height >> mip));
+			subresources.push_back({ texture.data.data() + offset, surface.row_pitch, static_cast<uint32_t>(surface.size) });
+			offset += surface.size;
+		}
+	}
+	return subresources;
+}
+
+auto dx11_lessons::read_dds(std::span<const std::byte> file_data) -> std::optional<dds_texture>
+{
+	auto magic = uint32_t{};
+	auto header = dds_header{};
+	if (file_data.size() < sizeof(magic) + sizeof(header))
+	{
+		return std::nullopt;
+	}
+	std::memcpy(&magic, file_data.data(), sizeof(magic));
+	std::memcpy(&header, file_data.data() + sizeof(magic), sizeof(header));
+	if (magic != dds_magic or header.size != sizeof(dds_header) or (header.caps2 & ddscaps2_volume))
+	{
+		return std::nullopt;
+	}
+
+	auto texture = dds_texture{};
+	texture.width = header.width;
+	texture.height = header.height;
+	texture.mip_count = std::max(1u, header.mip_map_count);
+	texture.array_size = 1;
+
+	auto data_offset = sizeof(magic) + sizeof(header);
+	auto &pf = header.pixel_format;
+	if ((pf.flags & ddpf_fourcc) and pf.fourcc == make_fourcc('D', 'X', '1', '0'))
+	{
+		auto dx10 = dds_header_dx10{};
+		if (file_data.size() < data_offset + sizeof(dx10))
+		{
+			return std::nullopt;
+		}
+		std::memcpy(&dx10, file_data.data() + data_offset, sizeof(dx10));
+		data_offset += sizeof(dx10);
+
+		if (dx10.resource_dimension != dimension_texture2d or dx10.array_size > max_array_size)
+		{
+			return std::nullopt;
+		}
+		texture.format = dx10.format;
+		texture.is_cube = (dx10.misc_flag & misc_texture_cube) != 0;
+		texture.array_size = std::max(1u, dx10.array_size) * (texture.is_cube ? 6 : 1);
+	}
+	else
+	{
+		texture.format = legacy_format(pf);
+		texture.is_cube = (header.caps2 & ddscaps2_cubemap) != 0;
+		if (texture.is_cube)
+		{
+			// Partial cubes aren't supported by D3D11 either
+			if ((header.caps2 & ddscaps2_all_faces) != ddscaps2_all_faces)
+			{
+				return std::nullopt;
+			}
+			texture.array_size = 6;
+		}
+	}
+
+	auto full_mip_count = static_cast<uint32_t>(std::bit_width(std::max(texture.width, texture.height)));
+	if (bits_per_pixel(texture.format) == 0
+	    or texture.width == 0 or texture.width > max_dimension
+	    or texture.height == 0 or texture.height > max_dimension
+	    or texture.array_size > max_array_size or texture.mip_count > full_mip_count)
+	{
+		return std::nullopt;
+	}
+
+	auto size = texture_size(texture);
+	if (file_data.size() - data_offset < size)
+	{
+		return std::nullopt;
+	}
+	texture.data = file_data.subspan(data_offset, size);
+	return texture;
+}
+
+auto dx11_lessons::write_dds(const dds_texture &texture) -> std::vector<std::byte>
+{
+	auto header = dds_header{};
+	header.size = sizeof(dds_header);
+	header.flags = ddsd_caps | ddsd_height | ddsd_width | ddsd_pixel_format | ddsd_mip_map_count;
+	header.height = texture.height;
+	header.width = texture.width;
+	header.pitch_or_linear_size = dds_surface_size(texture.format, texture.width, texture.height).row_pitch;
+	header.mip_map_count = texture.mip_count;
+	header.pixel_format.size = sizeof(dds_pixel_format);
+	header.pixel_format.flags = ddpf_fourcc;
+	header.pixel_format.fourcc = make_fourcc('D', 'X', '1', '0');
+	header.caps = ddscaps_texture
+	            | ((texture.mip_count > 1 or texture.array_size > 1) ? ddscaps_complex : 0)
+	            | (texture.mip_count > 1 ? ddscaps_mip_map : 0);
+	header.caps2 = texture.is_cube ? (ddscaps2_cubemap | ddscaps2_all_faces) : 0;
+
+	auto dx10 = dds_header_dx10{};
+	dx10.format = texture.format;
+	dx10.resource_dimension = dimension_texture2d;
+	dx10.misc_flag = texture.is_cube ? misc_texture_cube : 0;
+	dx10.array_size = texture.is_cube ? texture.array_size / 6 : texture.array_size;
+
+	auto size = texture_size(texture);
+	auto file = std::vector<std::byte>(sizeof(dds_magic) + sizeof(header) + sizeof(dx10) + size);
+	auto out = file.data();
+	std::memcpy(out, &dds_magic, sizeof(dds_magic));
+	out += sizeof(dds_magic);
+	std::memcpy(out, &header, sizeof(header));
+	out += sizeof(header);
+	std::memcpy(out, &dx10, sizeof(dx10));
+	out += sizeof(dx10);
+	std::memcpy(out, texture.data.data(), size);
+
+	return file;
+}
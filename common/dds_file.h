@@ -0,0 +1,89 @@
+#pragma once
+
+#include <vector>
+#include <span>
+#include <optional>
+#include <cstddef>
+#include <cstdint>
+
+namespace dx11_lessons
+{
+	// Same values as DXGI_FORMAT, so this builds without Windows headers.
+	// Only formats the tools know the size of are listed.
+	enum class dxgi_format : uint32_t
+	{
+		unknown = 0,
+		r32g32b32a32_float = 2,
+		r16g16b16a16_float = 10,
+		r10g10b10a2_unorm = 24,
+		r11g11b10_float = 26,
+		r8g8b8a8_unorm = 28,
+		r8g8b8a8_unorm_srgb = 29,
+		r16g16_float = 34,
+		r32_float = 41,
+		r8g8_unorm = 49,
+		r16_float = 54,
+		r8_unorm = 61,
+		bc1_unorm = 71,
+		bc1_unorm_srgb = 72,
+		bc2_unorm = 74,
+		bc2_unorm_srgb = 75,
+		bc3_unorm = 77,
+		bc3_unorm_srgb = 78,
+		bc4_unorm = 80,
+		bc4_snorm = 81,
+		bc5_unorm = 83,
+		bc5_snorm = 84,
+		b5g6r5_unorm = 85,
+		b8g8r8a8_unorm = 87,
+		b8g8r8x8_unorm = 88,
+		b8g8r8a8_unorm_srgb = 91,
+		bc6h_uf16 = 95,
+		bc6h_sf16 = 96,
+		bc7_unorm = 98,
+		bc7_unorm_srgb = 99,
+	};
+
+	struct dds_surface
+	{
+		uint32_t row_pitch;    // bytes per row of pixels, or of 4x4 blocks
+		uint32_t row_count;
+		std::size_t size;
+	};
+
+	// Same layout and meaning as D3D11_SUBRESOURCE_DATA
+	struct dds_subresource_data
+	{
+		const void *data;
+		uint32_t row_pitch;
+		uint32_t slice_pitch;
+	};
+
+	// Subresources are stored array slice (cube face) first, then mips largest to smallest
+	struct dds_texture
+	{
+		dxgi_format format;
+		uint32_t width;
+		uint32_t height;
+		uint32_t mip_count;
+		uint32_t array_size;   // faces for a cube, so always a multiple of 6
+		bool is_cube;
+		std::span<const std::byte> data;
+	};
+
+	auto is_block_compressed(dxgi_format format) -> bool;
+	auto dds_surface_size(dxgi_format format, uint32_t width, uint32_t height) -> dds_surface;
+	auto dds_subresource(const dds_texture &texture, uint32_t slice, uint32_t mip) -> std::span<const std::byte>;
+
+	// Every subresource in D3D11 order (mip + slice * mip_count), pointing into texture.data,
+	// ready to pass to CreateTexture2D without copying.
+	auto dds_subresources(const dds_texture &texture) -> std::vector<dds_subresource_data>;
+
+	// 2D textures, arrays and cubes, with legacy or DX10 headers. Data points into file_data.
+	// nullopt for volume textures, formats not in dxgi_format, sizes or mip counts D3D11 can't create,
+	// or files too short.
+	auto read_dds(std::span<const std::byte> file_data) -> std::optional<dds_texture>;
+
+	// Always writes a DX10 header. texture.data must hold every subresource, in read_dds order.
+	auto write_dds(const dds_texture &texture) -> std::vector<std::byte>;
+}
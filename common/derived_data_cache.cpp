@@ -0,0 +1,199 @@
+#include "derived_data_cache.h"
+
+#include <fstream>
+#include <array>
+#include <algorithm>
+#include <string>
+#include <random>
+#include <charconv>
+#include <bit>
+#include <cstring>
+
+using namespace dx11_lessons;
+
+namespace
+{
+	constexpr auto prime_1 = uint64_t{ 0x9e3779b185ebca87 },
+	               prime_2 = uint64_t{ 0xc2b2ae3d27d4eb4f };
+
+	auto mix(uint64_t state, uint64_t word) -> uint64_t
+	{
+		state ^= word * prime_2;
+		return std::rotl(state, 31) * prime_1;
+	}
+
+	auto to_hex(uint64_t value) -> std::string
+	{
+		auto text = std::string(16, '0');
+		auto digits = std::array<char, 16>{};
+		auto [end, ec] = std::to_chars(digits.data(), digits.data() + digits.size(), value, 16);
+		auto count = static_cast<std::size_t>(end - digits.data());
+		std::memcpy(text.data() + text.size() - count, digits.data(), count);
+		return text;
+	}
+
+	// Written beside the final name and renamed over it, readers never see a partial file
+	auto write_atomically(const std::filesystem::path &path, std::span<const std::byte> data) -> bool
+	{
+		static auto random = std::mt19937_64{ std::random_device{}() };
+		auto temp_path = path;
+		temp_path += ".tmp" + to_hex(random());
+
+		{
+			auto file = std::ofstream(temp_path, std::ios::out | std::ios::binary | std::ios::trunc);
+			file.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+			if (not file.good())
+			{
+				file.close();
+				auto ec = std::error_code{};
+				std::filesystem::remove(temp_path, ec);
+				return false;
+			}
+		}
+
+		auto ec = std::error_code{};
+		std::filesystem::rename(temp_path, path, ec);
+		if (ec)
+		{
+			std::filesystem::remove(temp_path, ec);
+			return false;
+		}
+		return true;
+	}
+
+	auto write_text_atomically(const std::filesystem::path &path, std::string_view text) -> bool
+	{
+		return write_atomically(path, std::as_bytes(std::span(text)));
+	}
+}
+
+auto content_hasher::add(std::span<const std::byte> data) -> content_hasher &
+{
+	state = mix(state, data.size());
+
+	auto full_words = data.size() / sizeof(uint64_t);
+	for (auto i = std::size_t{}; i < full_words; i++)
+	{
+		auto word = uint64_t{};
+		std::memcpy(&word, data.data() + i * sizeof(uint64_t), sizeof(word));
+		state = mix(state, word);
+	}
+
+	auto tail = data.subspan(full_words * sizeof(uint64_t));
+	if (not tail.empty())
+	{
+		auto word = uint64_t{};
+		std::memcpy(&word, tail.data(), tail.size());
+		state = mix(state, word);
+	}
+	return *this;
+}
+
+auto content_hasher::add(std::string_view text) -> content_hasher &
+{
+	return add(std::as_bytes(std::span(text)));
+}
+
+auto content_hasher::add(uint64_t value) -> content_hasher &
+{
+	state = mix(state, value);
+	return *this;
+}
+
+auto content_hasher::digest() const -> uint64_t
+{
+	// Murmur3 finaliser, spreads the last words into every bit
+	auto h = state;
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccd;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53;
+	h ^= h >> 33;
+	return h;
+}
+
+derived_data_cache::derived_data_cache(const std::filesystem::path &root_) :
+	root{ root_ }
+{
+	auto ec = std::error_code{};
+	std::filesystem::create_directories(root, ec);
+}
+
+derived_data_cache::~derived_data_cache() = default;
+
+auto derived_data_cache::fetch(uint64_t key, const std::filesystem::path &output) -> bool
+{
+	auto start = std::chrono::steady_clock::now();
+
+	auto ec = std::error_code{};
+	auto copied = std::filesystem::copy_file(entry_path(key, ".bin"), output,
+	                                         std::filesystem::copy_options::overwrite_existing, ec);
+	if (ec or not copied)
+	{
+		counters.misses++;
+		return false;
+	}
+
+	auto recorded = 0.0;
+	auto time_file = std::ifstream(entry_path(key, ".time"));
+	time_file >> recorded;
+
+	auto fetch_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+	counters.hits++;
+	counters.saved_time += std::max(std::chrono::duration<double>(recorded) - fetch_time, std::chrono::duration<double>{});
+	return true;
+}
+
+void derived_data_cache::store(uint64_t key, std::span<const std::byte> data, std::chrono::duration<double> cook_time)
+{
+	counters.cook_time += cook_time;
+
+	// Time first, an entry whose .bin exists is complete
+	if (write_text_atomically(entry_path(key, ".time"), std::to_string(cook_time.count())))
+	{
+		write_atomically(entry_path(key, ".bin"), data);
+	}
+}
+
+auto derived_data_cache::dependencies(uint64_t key) const -> std::optional<std::vector<std::filesystem::path>>
+{
+	auto file = std::ifstream(entry_path(key, ".deps"));
+	if (not file.is_open())
+	{
+		return std::nullopt;
+	}
+
+	auto files = std::vector<std::filesystem::path>{};
+	for (auto line = std::string{}; std::getline(file, line);)
+	{
+		if (not line.empty())
+		{
+			files.emplace_back(std::u8string(line.begin(), line.end()));
+		}
+	}
+	return files;
+}
+
+void derived_data_cache::store_dependencies(uint64_t key, std::span<const std::filesystem::path> files)
+{
+	auto text = std::string{};
+	for (auto &file : files)
+	{
+		auto name = file.generic_u8string();
+		text.append(name.begin(), name.end());
+		text += '\n';
+	}
+	write_text_atomically(entry_path(key, ".deps"), text);
+}
+
+auto derived_data_cache::stats() const -> const derived_data_stats &
+{
+	return counters;
+}
+
+auto derived_data_cache::entry_path(uint64_t key, std::string_view extension) const -> std::filesystem::path
+{
+	auto name = to_hex(key);
+	name += extension;
+	return root / name;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+#include <string_view>
+#include <optional>
+#include <chrono>
+#include <span>
+#include <cstddef>
+#include <cstdint>
+
+namespace dx11_lessons
+{
+	// Streaming 64 bit hash for cache keys, fast but not cryptographic.
+	// Every add is length prefixed, so add("ab") add("c") differs from add("a") add("bc").
+	class content_hasher
+	{
+	public:
+		auto add(std::span<const std::byte> data) -> content_hasher &;
+		auto add(std::string_view text) -> content_hasher &;
+		auto add(uint64_t value) -> content_hasher &;
+
+		auto digest() const -> uint64_t;
+
+	private:
+		uint64_t state{ 0x27d4eb2f165667c5 };
+	};
+
+	struct derived_data_stats
+	{
+		uint32_t hits;
+		uint32_t misses;
+		std::chrono::duration<double> cook_time;    // spent cooking the misses
+		std::chrono::duration<double> saved_time;   // recorded cook time of the hits, less the time to fetch them
+	};
+
+	// Content addressed store for cooked outputs. Keys hash everything an output depends on,
+	// so an edited input just misses and stale entries are never looked up again.
+	//   <root>/<key>.bin    output bytes
+	//   <root>/<key>.time   seconds it took to cook
+	//   <root>/<key>.deps   files a cook read besides its inputs, one per line
+	// Entries are written to a temporary name and renamed, so concurrent cookers can share a root.
+	class derived_data_cache
+	{
+	public:
+		derived_data_cache() = delete;
+		explicit derived_data_cache(const std::filesystem::path &root_);
+		~derived_data_cache();
+
+		// Copies the entry to output on a hit, counts a miss otherwise
+		auto fetch(uint64_t key, const std::filesystem::path &output) -> bool;
+		void store(uint64_t key, std::span<const std::byte> data, std::chrono::duration<double> cook_time);
+
+		// Dependencies recorded by the last cook of the same inputs, paths as they were stored
+		auto dependencies(uint64_t key) const -> std::optional<std::vector<std::filesystem::path>>;
+		void store_dependencies(uint64_t key, std::span<const std::filesystem::path> files);
+
+		auto stats() const -> const derived_data_stats &;
+
+	private:
+		auto entry_path(uint64_t key, std::string_view extension) const -> std::filesystem::path;
+
+		std::filesystem::path root;
+		derived_data_stats counters{};
+	};
+}
@@ -0,0 +1,89 @@
+#include "file_watcher.h"
+
+#include <iterator>
+
+using namespace dx11_lessons;
+
+file_watcher::file_watcher(std::vector<std::filesystem::path> directories_, clock::duration interval_) :
+	directories{ std::move(directories_) },
+	interval{ interval_ }
+{
+	// First scan is the baseline, files that exist now aren't changes
+	scan();
+	for (auto &[path, state] : files)
+	{
+		state.settling = false;
+	}
+	next_scan = clock::now() + interval;
+}
+
+file_watcher::~file_watcher() = default;
+
+auto file_watcher::poll() -> std::vector<std::filesystem::path>
+{
+	auto now = clock::now();
+	if (now < next_scan)
+	{
+		return {};
+	}
+	next_scan = now + interval;
+
+	return scan();
+}
+
+auto file_watcher::scan() -> std::vector<std::filesystem::path>
+{
+	namespace fs = std::filesystem;
+
+	for (auto &[path, state] : files)
+	{
+		state.seen = false;
+	}
+
+	auto settled = std::vector<fs::path>{};
+	for (auto &directory : directories)
+	{
+		// Files come and go while iterating, so nothing here throws, a file that errors is tried next scan
+		auto ec = std::error_code{};
+		for (auto it = fs::directory_iterator(directory, ec); not ec and it != fs::directory_iterator(); it.increment(ec))
+		{
+			if (not it->is_regular_file(ec))
+			{
+				continue;
+			}
+
+			auto write_time = it->last_write_time(ec);
+			auto size = it->file_size(ec);
+			if (ec)
+			{
+				ec.clear();
+				continue;
+			}
+
+			auto [entry, added] = files.try_emplace(it->path(), file_state{ write_time, size, true, true });
+			auto &state = entry->second;
+			state.seen = true;
+			if (added)
+			{
+				continue;
+			}
+
+			if (state.write_time != write_time or state.size != size)
+			{
+				state = { write_time, size, true, true };
+			}
+			else if (state.settling)
+			{
+				state.settling = false;
+				settled.push_back(it->path());
+			}
+		}
+	}
+
+	std::erase_if(files, [](const auto &file)
+	{
+		return not file.second.seen;
+	});
+
+	return settled;
+}
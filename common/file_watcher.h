@@ -0,0 +1,43 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <cstdint>
+
+namespace dx11_lessons
+{
+	// Polls the write time and size of the files directly inside some directories.
+	// A change is reported once the file has stopped changing for one poll, so files
+	// still being written by a compiler or cooker are not picked up half way.
+	class file_watcher
+	{
+	public:
+		using clock = std::chrono::steady_clock;
+
+		file_watcher() = delete;
+		file_watcher(std::vector<std::filesystem::path> directories_, clock::duration interval_);
+		~file_watcher();
+
+		// Files changed or created since they were last reported.
+		// Empty, without touching the file system, until interval has passed since the last scan.
+		auto poll() -> std::vector<std::filesystem::path>;
+
+	private:
+		struct file_state
+		{
+			std::filesystem::file_time_type write_time;
+			uintmax_t size;
+			bool settling;
+			bool seen;
+		};
+
+		auto scan() -> std::vector<std::filesystem::path>;
+
+		std::vector<std::filesystem::path> directories;
+		clock::duration interval;
+		clock::time_point next_scan;
+		std::map<std::filesystem::path, file_state> files;
+	};
+}
@@ -0,0 +1,481 @@
+#include "geometry_instancing.h"
+
+#include <array>
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <optional>
+#include <cmath>
+#include <cassert>
+
+using namespace dx11_lessons;
+using namespace DirectX;
+
+namespace
+{
+	constexpr auto invalid_index = std::numeric_limits<uint32_t>::max();
+
+	using vec3 = std::array<double, 3>;
+	using mat3 = std::array<vec3, 3>;
+	template <std::size_t N>
+	using matrix = std::array<std::array<double, N>, N>;
+
+	template <std::size_t N>
+	struct eigen_result
+	{
+		std::array<double, N> values;
+		matrix<N> vectors;   // eigen vectors are the columns
+	};
+
+	// Symmetric NxN eigen decomposition, cyclic Jacobi rotations
+	template <std::size_t N>
+	auto eigen_decompose(matrix<N> a) -> eigen_result<N>
+	{
+		auto v = matrix<N>{};
+		for (auto i = 0u; i < N; i++)
+		{
+			v[i][i] = 1.0;
+		}
+
+		for (auto sweep = 0; sweep < 50; sweep++)
+		{
+			auto off = 0.0, diag = 0.0;
+			for (auto p = 0u; p < N; p++)
+			{
+				diag += a[p][p] * a[p][p];
+				for (auto q = p + 1; q < N; q++)
+				{
+					off += a[p][q] * a[p][q];
+				}
+			}
+			if (off <= 1.0e-30 * diag or off < 1.0e-300)
+			{
+				break;
+			}
+
+			for (auto p = 0u; p < N; p++)
+			{
+				for (auto q = p + 1; q < N; q++)
+				{
+					if (std::abs(a[p][q]) < 1.0e-300)
+					{
+						continue;
+					}
+
+					auto theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+					auto t = (theta >= 0.0 ? 1.0 : -1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+					auto c = 1.0 / std::sqrt(t * t + 1.0),
+					     s = t * c;
+
+					for (auto k = 0u; k < N; k++)
+					{
+						auto akp = a[k][p], akq = a[k][q];
+						a[k][p] = c * akp - s * akq;
+						a[k][q] = s * akp + c * akq;
+					}
+					for (auto k = 0u; k < N; k++)
+					{
+						auto apk = a[p][k], aqk = a[q][k];
+						a[p][k] = c * apk - s * aqk;
+						a[q][k] = s * apk + c * aqk;
+					}
+					for (auto k = 0u; k < N; k++)
+					{
+						auto vkp = v[k][p], vkq = v[k][q];
+						v[k][p] = c * vkp - s * vkq;
+						v[k][q] = s * vkp + c * vkq;
+					}
+				}
+			}
+		}
+
+		auto result = eigen_result<N>{ {}, v };
+		for (auto i = 0u; i < N; i++)
+		{
+			result.values[i] = a[i][i];
+		}
+		return result;
+	}
+
+	auto to_vec3(const XMFLOAT3 &f) -> vec3
+	{
+		return { f.x, f.y, f.z };
+	}
+
+	auto mul(const mat3 &m, const vec3 &v) -> vec3
+	{
+		return { m[0][0] * v[0] + m[0][1] * v[1] + m[0][2] * v[2],
+		         m[1][0] * v[0] + m[1][1] * v[1] + m[1][2] * v[2],
+		         m[2][0] * v[0] + m[2][1] * v[1] + m[2][2] * v[2] };
+	}
+
+	auto distance_sq(const vec3 &a, const vec3 &b) -> double
+	{
+		auto dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+		return dx * dx + dy * dy + dz * dz;
+	}
+
+	auto hash_combine(uint64_t seed, uint64_t value) -> uint64_t
+	{
+		value += 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+		value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+		value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+		return seed ^ (value ^ (value >> 31));
+	}
+
+	// Shape is the principal moments over the radius, and the log of the radius. Copies within position tolerance
+	// differ by less than 2 tolerances in each, so cells 4 tolerances wide put them in the same or neighbouring cells.
+	constexpr auto shape_dimensions = 4u;
+	constexpr auto tolerances_per_cell = 4.0;
+	using shape_coords = std::array<double, shape_dimensions>;
+	constexpr auto neighbour_probes = 1u << shape_dimensions;
+
+	// Bucket of the cell offset by one toward the nearer edge in each dimension whose bit in probe is set.
+	// Copies either side of an edge are both in the half nearest it, so each probes the other's cell.
+	auto bucket_key(uint64_t topology_hash, const shape_coords &shape, uint32_t probe) -> uint64_t
+	{
+		auto key = topology_hash;
+		for (auto k = 0u; k < shape_dimensions; k++)
+		{
+			auto cell = std::floor(shape[k]);
+			if (probe & (1u << k))
+			{
+				cell += (shape[k] - cell < 0.5) ? -1.0 : 1.0;
+			}
+			key = hash_combine(key, static_cast<uint64_t>(static_cast<int64_t>(cell)));
+		}
+		return key;
+	}
+
+	// Group geometry with vertices renumbered in order of first use.
+	// Copies written out the same way share the same local index list.
+	struct local_group
+	{
+		uint32_t group_idx;
+		std::vector<uint32_t> vertex_ids;
+		std::vector<uint32_t> indicies;
+		vec3 centroid;
+		mat3 axes;     // rows are principal axes, largest moment first
+		double radius;
+		uint64_t topology_hash;   // material, vertex count and index list
+		shape_coords shape;       // in cells
+	};
+
+	auto make_local_group(const obj_data &data, const instancing_settings &settings,
+	                      uint32_t group_idx, std::vector<uint32_t> &remap) -> local_group
+	{
+		auto &grp = data.groups[group_idx];
+		auto lg = local_group{};
+		lg.group_idx = group_idx;
+		lg.indicies.reserve(grp.index_count);
+
+		for (auto i = grp.index_start; i < grp.index_start + grp.index_count; i++)
+		{
+			auto vi = data.indicies[i];
+			if (remap[vi] == invalid_index)
+			{
+				remap[vi] = static_cast<uint32_t>(lg.vertex_ids.size());
+				lg.vertex_ids.push_back(vi);
+			}
+			lg.indicies.push_back(remap[vi]);
+		}
+		for (auto vi : lg.vertex_ids)
+		{
+			remap[vi] = invalid_index;
+		}
+
+		auto n = static_cast<double>(lg.vertex_ids.size());
+		lg.centroid = {};
+		for (auto vi : lg.vertex_ids)
+		{
+			auto p = to_vec3(data.vertices[vi]);
+			for (auto k = 0; k < 3; k++)
+			{
+				lg.centroid[k] += p[k] / n;
+			}
+		}
+
+		auto cov = matrix<3>{};
+		lg.radius = 0.0;
+		for (auto vi : lg.vertex_ids)
+		{
+			auto p = to_vec3(data.vertices[vi]);
+			auto d = vec3{ p[0] - lg.centroid[0], p[1] - lg.centroid[1], p[2] - lg.centroid[2] };
+			for (auto r = 0; r < 3; r++)
+			{
+				for (auto c = 0; c < 3; c++)
+				{
+					cov[r][c] += d[r] * d[c] / n;
+				}
+			}
+			lg.radius = std::max(lg.radius, distance_sq(p, lg.centroid));
+		}
+		lg.radius = std::sqrt(lg.radius);
+
+		auto eig = eigen_decompose(cov);
+		auto order = std::array{ 0, 1, 2 };
+		std::sort(order.begin(), order.end(), [&](int a, int b)
+		{
+			return eig.values[a] > eig.values[b];
+		});
+		for (auto r = 0; r < 3; r++)
+		{
+			lg.axes[r] = { eig.vectors[0][order[r]], eig.vectors[1][order[r]], eig.vectors[2][order[r]] };
+		}
+		auto &[a0, a1, a2] = lg.axes;
+		a2 = { a0[1] * a1[2] - a0[2] * a1[1],
+		       a0[2] * a1[0] - a0[0] * a1[2],
+		       a0[0] * a1[1] - a0[1] * a1[0] };
+
+		lg.topology_hash = hash_combine(std::hash<std::string>{}(grp.material_name), lg.vertex_ids.size());
+		for (auto idx : lg.indicies)
+		{
+			lg.topology_hash = hash_combine(lg.topology_hash, idx);
+		}
+
+		auto radius = std::max(lg.radius, 1.0e-6);
+		auto cell_size = tolerances_per_cell * settings.position_tolerance;
+		for (auto r = 0u; r < 3; r++)
+		{
+			lg.shape[r] = std::sqrt(std::max(eig.values[order[r]], 0.0)) / radius / cell_size;
+		}
+		lg.shape[3] = std::log(radius) / cell_size;
+
+		return lg;
+	}
+
+	// Rotation taking the canonical points onto the target (centred) points,
+	// from Horn's closed form quaternion solution.
+	auto best_rotation(const std::vector<vec3> &canonical, const obj_data &data, const local_group &target) -> mat3
+	{
+		auto s = mat3{};
+		for (auto i = 0u; i < canonical.size(); i++)
+		{
+			auto &a = canonical[i];
+			auto b = to_vec3(data.vertices[target.vertex_ids[i]]);
+			for (auto r = 0; r < 3; r++)
+			{
+				for (auto c = 0; c < 3; c++)
+				{
+					s[r][c] += a[r] * (b[c] - target.centroid[c]);
+				}
+			}
+		}
+
+		auto &[sx, sy, sz] = s;
+		auto n = matrix<4>{ {
+			{ sx[0] + sy[1] + sz[2], sy[2] - sz[1],          sz[0] - sx[2],          sx[1] - sy[0] },
+			{ sy[2] - sz[1],         sx[0] - sy[1] - sz[2],  sx[1] + sy[0],          sz[0] + sx[2] },
+			{ sz[0] - sx[2],         sx[1] + sy[0],         -sx[0] + sy[1] - sz[2],  sy[2] + sz[1] },
+			{ sx[1] - sy[0],         sz[0] + sx[2],          sy[2] + sz[1],         -sx[0] - sy[1] + sz[2] },
+		} };
+
+		auto eig = eigen_decompose(n);
+		auto best = static_cast<int>(std::max_element(eig.values.begin(), eig.values.end()) - eig.values.begin());
+		auto w = eig.vectors[0][best], x = eig.vectors[1][best],
+		     y = eig.vectors[2][best], z = eig.vectors[3][best];
+
+		return { {
+			{ w * w + x * x - y * y - z * z, 2.0 * (x * y - w * z),         2.0 * (x * z + w * y) },
+			{ 2.0 * (x * y + w * z),         w * w - x * x + y * y - z * z, 2.0 * (y * z - w * x) },
+			{ 2.0 * (x * z - w * y),         2.0 * (y * z + w * x),         w * w - x * x - y * y + z * z },
+		} };
+	}
+
+	struct instance_set
+	{
+		uint32_t representative;   // index into local groups
+		std::vector<vec3> positions;
+		std::vector<vec3> normals;
+		std::vector<mat3> rotations;
+		std::vector<uint32_t> members;
+	};
+
+	auto make_instance_set(const obj_data &data, uint32_t lg_idx, const local_group &lg) -> instance_set
+	{
+		auto set = instance_set{};
+		set.representative = lg_idx;
+		set.positions.reserve(lg.vertex_ids.size());
+		set.normals.reserve(lg.vertex_ids.size());
+		for (auto vi : lg.vertex_ids)
+		{
+			auto p = to_vec3(data.vertices[vi]);
+			for (auto k = 0; k < 3; k++)
+			{
+				p[k] -= lg.centroid[k];
+			}
+			set.positions.push_back(mul(lg.axes, p));
+			set.normals.push_back(mul(lg.axes, to_vec3(data.normals[vi])));
+		}
+
+		// Local to model space is the transpose of axes
+		auto &a = lg.axes;
+		set.rotations.push_back({ { { a[0][0], a[1][0], a[2][0] },
+		                            { a[0][1], a[1][1], a[2][1] },
+		                            { a[0][2], a[1][2], a[2][2] } } });
+		set.members.push_back(lg_idx);
+		return set;
+	}
+
+	auto matches(const obj_data &data, const instancing_settings &settings,
+	             const instance_set &set, const local_group &rep, const local_group &candidate,
+	             mat3 &rotation) -> bool
+	{
+		if (candidate.indicies != rep.indicies
+		    or data.groups[candidate.group_idx].material_name != data.groups[rep.group_idx].material_name)
+		{
+			return false;
+		}
+
+		auto position_tolerance = settings.position_tolerance * std::max(rep.radius, 1.0e-6);
+		auto position_tolerance_sq = position_tolerance * position_tolerance,
+		     normal_tolerance_sq = static_cast<double>(settings.normal_tolerance) * settings.normal_tolerance,
+		     uv_tolerance_sq = static_cast<double>(settings.uv_tolerance) * settings.uv_tolerance;
+
+		if (std::abs(candidate.radius - rep.radius) > position_tolerance)
+		{
+			return false;
+		}
+
+		rotation = best_rotation(set.positions, data, candidate);
+
+		for (auto i = 0u; i < set.positions.size(); i++)
+		{
+			auto ci = candidate.vertex_ids[i],
+			     ri = rep.vertex_ids[i];
+
+			auto p = mul(rotation, set.positions[i]);
+			for (auto k = 0; k < 3; k++)
+			{
+				p[k] += candidate.centroid[k];
+			}
+			if (distance_sq(p, to_vec3(data.vertices[ci])) > position_tolerance_sq)
+			{
+				return false;
+			}
+
+			if (distance_sq(mul(rotation, set.normals[i]), to_vec3(data.normals[ci])) > normal_tolerance_sq)
+			{
+				return false;
+			}
+
+			auto &uv_a = data.uv_coords[ri], &uv_b = data.uv_coords[ci];
+			auto du = static_cast<double>(uv_a.x) - uv_b.x,
+			     dv = static_cast<double>(uv_a.y) - uv_b.y;
+			if (du * du + dv * dv > uv_tolerance_sq)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	auto to_transform(const mat3 &rotation, const vec3 &translation) -> XMFLOAT4X4
+	{
+		// Row vector convention, so the rotation goes in transposed
+		auto f = [](double v)
+		{
+			return static_cast<float>(v);
+		};
+		auto &r = rotation;
+		return XMFLOAT4X4{ f(r[0][0]), f(r[1][0]), f(r[2][0]), 0.0f,
+		                   f(r[0][1]), f(r[1][1]), f(r[2][1]), 0.0f,
+		                   f(r[0][2]), f(r[1][2]), f(r[2][2]), 0.0f,
+		                   f(translation[0]), f(translation[1]), f(translation[2]), 1.0f };
+	}
+}
+
+auto dx11_lessons::find_repeated_geometry(const obj_data &data, const instancing_settings &settings)
+	-> std::vector<instanced_geometry>
+{
+	assert(data.normals.size() == data.vertices.size());
+	assert(data.uv_coords.size() == data.vertices.size());
+
+	auto remap = std::vector<uint32_t>(data.vertices.size(), invalid_index);
+	auto local_groups = std::vector<local_group>{};
+	local_groups.reserve(data.groups.size());
+	for (auto g = 0u; g < data.groups.size(); g++)
+	{
+		if (data.groups[g].index_count >= 3)
+		{
+			local_groups.push_back(make_local_group(data, settings, g, remap));
+		}
+	}
+
+	auto sets = std::vector<instance_set>{};
+	auto buckets = std::unordered_map<uint64_t, std::vector<uint32_t>>{};
+	for (auto i = 0u; i < local_groups.size(); i++)
+	{
+		auto &candidate = local_groups[i];
+
+		// Sets are only added to their own cell, copies in a neighbouring one are found by probing it
+		auto rotation = mat3{};
+		auto found = std::optional<uint32_t>{};
+		for (auto probe = 0u; probe < neighbour_probes and not found; probe++)
+		{
+			auto bucket = buckets.find(bucket_key(candidate.topology_hash, candidate.shape, probe));
+			if (bucket == buckets.end())
+			{
+				continue;
+			}
+
+			auto match = std::find_if(bucket->second.begin(), bucket->second.end(), [&](uint32_t set_idx)
+			{
+				auto &set = sets[set_idx];
+				return matches(data, settings, set, local_groups[set.representative], candidate, rotation);
+			});
+			if (match != bucket->second.end())
+			{
+				found = *match;
+			}
+		}
+
+		if (found)
+		{
+			sets[*found].rotations.push_back(rotation);
+			sets[*found].members.push_back(i);
+		}
+		else
+		{
+			buckets[bucket_key(candidate.topology_hash, candidate.shape, 0)].push_back(static_cast<uint32_t>(sets.size()));
+			sets.push_back(make_instance_set(data, i, candidate));
+		}
+	}
+
+	auto output = std::vector<instanced_geometry>{};
+	for (auto &set : sets)
+	{
+		if (set.members.size() < std::max(settings.min_instances, 1u))
+		{
+			continue;
+		}
+
+		auto &rep = local_groups[set.representative];
+		auto &geo = output.emplace_back();
+		geo.material_name = data.groups[rep.group_idx].material_name;
+		geo.indicies = rep.indicies;
+
+		geo.vertices.reserve(set.positions.size());
+		geo.normals.reserve(set.normals.size());
+		geo.uv_coords.reserve(set.positions.size());
+		for (auto i = 0u; i < set.positions.size(); i++)
+		{
+			auto &p = set.positions[i];
+			auto &n = set.normals[i];
+			geo.vertices.push_back({ static_cast<float>(p[0]), static_cast<float>(p[1]), static_cast<float>(p[2]) });
+			geo.normals.push_back({ static_cast<float>(n[0]), static_cast<float>(n[1]), static_cast<float>(n[2]) });
+			geo.uv_coords.push_back(data.uv_coords[rep.vertex_ids[i]]);
+		}
+
+		for (auto m = 0u; m < set.members.size(); m++)
+		{
+			auto &member = local_groups[set.members[m]];
+			geo.instance_transforms.push_back(to_transform(set.rotations[m], member.centroid));
+			geo.source_groups.push_back(member.group_idx);
+		}
+	}
+
+	return output;
+}
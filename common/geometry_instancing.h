@@ -0,0 +1,40 @@
+#pragma once
+
+#include "obj_mtl_parser.h"
+
+#include <DirectXMath.h>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+namespace dx11_lessons
+{
+	struct instancing_settings
+	{
+		float position_tolerance = 1.0e-4f;  // relative to the radius of the group
+		float normal_tolerance = 1.0e-3f;
+		float uv_tolerance = 1.0e-5f;
+		uint32_t min_instances = 2;          // fewer copies than this are left as plain groups
+	};
+
+	// One mesh in its canonical frame (centroid at origin, principal axes along x, y, z)
+	// and the transforms that place each copy back into model space.
+	struct instanced_geometry
+	{
+		std::string material_name;
+
+		std::vector<obj_data::position> vertices;
+		std::vector<obj_data::normal> normals;
+		std::vector<obj_data::uv_coord> uv_coords;
+		std::vector<uint32_t> indicies;
+
+		std::vector<DirectX::XMFLOAT4X4> instance_transforms;  // row-vector, not transposed
+		std::vector<uint32_t> source_groups;                   // index into obj_data::groups, per instance
+	};
+
+	// Finds groups that are rigidly transformed copies of each other.
+	// Groups are bucketed by a hash of topology and material and a grid of principal moments, probing neighbouring cells,
+	// then each candidate is aligned to the bucket's representative and verified per vertex.
+	auto find_repeated_geometry(const obj_data &data, const instancing_settings &settings = {})
+		-> std::vector<instanced_geometry>;
+}
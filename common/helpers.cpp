@@ -1,16 +1,18 @@
 ﻿#include "helpers.h"
 
+#ifdef _WIN32
 #include <ShlObj.h>
 #include <atlbase.h>
+#endif
 
 #include <iostream>
-#include <fstream>
 #include <cassert>
 
 
 using namespace dx11_lessons;
 
 
+#ifdef _WIN32
 auto dx11_lessons::get_window_size(HWND window_handle) -> const std::array<uint16_t, 2>
 {
 	RECT rect{};
@@ -22,28 +24,14 @@ auto dx11_lessons::get_window_size(HWND window_handle) -> const std::array<uint1
 		static_cast<uint16_t>(rect.bottom - rect.top)
 	};
 }
+#endif
 
-auto dx11_lessons::load_binary_file(const std::filesystem::path &path) -> std::vector<uint8_t>
+auto dx11_lessons::load_binary_file(const std::filesystem::path &path) -> mapped_file
 {
-	auto buffer = std::vector<uint8_t>{};
-
-	auto file = std::ifstream(path, std::ios::in | std::ios::binary);
-	assert(file.is_open());
-	file.unsetf(std::ios::skipws);
-
-	file.seekg(0, std::ios::end);
-	buffer.reserve(file.tellg());
-	file.seekg(0, std::ios::beg);
-
-	std::copy(std::istream_iterator<uint8_t>(file),
-	          std::istream_iterator<uint8_t>(),
-	          std::back_inserter(buffer));
-
-	buffer.shrink_to_fit();
-
-	return buffer;
+	return mapped_file(path);
 }
 
+#ifdef _WIN32
 auto dx11_lessons::open_file_dialog(HWND hWnd) -> std::filesystem::path
 {
 	::CoInitialize(NULL);
@@ -85,6 +73,33 @@ auto dx11_lessons::open_file_dialog(HWND hWnd) -> std::filesystem::path
 	return file_name;
 }
 
+auto dx11_lessons::run_process(const std::wstring &command_line) -> std::optional<uint32_t>
+{
+	auto startup_info = STARTUPINFOW{};
+	startup_info.cb = sizeof(startup_info);
+	auto process_info = PROCESS_INFORMATION{};
+
+	// CreateProcessW may write to the command line, so it gets a copy
+	auto command = command_line;
+	auto started = ::CreateProcessW(nullptr, command.data(),
+	                                nullptr, nullptr, FALSE, CREATE_NO_WINDOW,
+	                                nullptr, nullptr,
+	                                &startup_info, &process_info);
+	if (not started)
+	{
+		return std::nullopt;
+	}
+
+	::WaitForSingleObject(process_info.hProcess, INFINITE);
+	auto exit_code = DWORD{};
+	::GetExitCodeProcess(process_info.hProcess, &exit_code);
+
+	::CloseHandle(process_info.hThread);
+	::CloseHandle(process_info.hProcess);
+	return exit_code;
+}
+#endif
+
 memory_stream::memory_stream(char const *base, size_t size) :
 	memory_buffer_stream(base, size), 
 	std::istream(static_cast<std::streambuf *>(this))
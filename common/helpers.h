@@ -1,17 +1,26 @@
 ﻿#pragma once
 
+#ifdef _WIN32
 #include <Windows.h>
+#endif
+#include "mapped_file.h"
+
 #include <array>
 #include <vector>
+#include <string>
+#include <algorithm>
 #include <filesystem>
+#include <optional>
 #include <cstdint>
 #include <iosfwd>
 #include <locale>
 
 namespace dx11_lessons
 {
+#ifdef _WIN32
 	auto get_window_size(HWND window_handle) -> const std::array<uint16_t, 2>;
-	auto load_binary_file(const std::filesystem::path &path) -> std::vector<uint8_t>;
+#endif
+	auto load_binary_file(const std::filesystem::path &path) -> mapped_file;
 
 	struct memory_buffer_stream : std::streambuf
 	{
@@ -51,5 +60,11 @@ namespace dx11_lessons
 		return ltrim(rtrim(str));
 	}
 
+#ifdef _WIN32
 	auto open_file_dialog(HWND hWnd) -> std::filesystem::path;
+
+	// Runs a console program without showing its window and waits for it.
+	// Returns its exit code, or nullopt if it couldn't be started.
+	auto run_process(const std::wstring &command_line) -> std::optional<uint32_t>;
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,477 @@
+#include "ibl_prefilter.h"
+#include "mip_generator.h"
+#include "parallel_range.h"
+
+#include <DirectXMath.h>
+#include <array>
+#include <span>
+#include <algorithm>
+#include <numbers>
+#include <cmath>
+#include <cassert>
+
+using namespace dx11_lessons;
+using namespace DirectX;
+
+namespace
+{
+	using image = std::vector<XMFLOAT4A>;
+	using cube_images = std::array<image, 6>;
+
+	constexpr auto pi = std::numbers::pi_v<float>;
+	constexpr auto sh_projection_size = 64u;
+
+	// Sky in float, linear light, mips box filtered from mip 0
+	struct sky_chain
+	{
+		uint32_t size;
+		std::vector<cube_images> mips;
+	};
+
+	// D3D face order +x -x +y -y +z -z, u right and v down, both -1 to 1 across a face
+	auto cube_direction(uint32_t face, float u, float v) -> XMVECTOR
+	{
+		switch (face)
+		{
+			case 0: return XMVectorSet(1.0f, -v, -u, 0.0f);
+			case 1: return XMVectorSet(-1.0f, -v, u, 0.0f);
+			case 2: return XMVectorSet(u, 1.0f, v, 0.0f);
+			case 3: return XMVectorSet(u, -1.0f, -v, 0.0f);
+			case 4: return XMVectorSet(u, -v, 1.0f, 0.0f);
+			default: return XMVectorSet(-u, -v, -1.0f, 0.0f);
+		}
+	}
+
+	struct cube_coord
+	{
+		uint32_t face;
+		float u, v;
+	};
+
+	auto cube_face_of(FXMVECTOR direction) -> cube_coord
+	{
+		auto d = XMFLOAT3{};
+		XMStoreFloat3(&d, direction);
+		auto [x, y, z] = d;
+		auto ax = std::abs(x), ay = std::abs(y), az = std::abs(z);
+		if (ax >= ay and ax >= az)
+		{
+			return (x > 0) ? cube_coord{ 0, -z / ax, -y / ax } : cube_coord{ 1, z / ax, -y / ax };
+		}
+		if (ay >= az)
+		{
+			return (y > 0) ? cube_coord{ 2, x / ay, z / ay } : cube_coord{ 3, x / ay, -z / ay };
+		}
+		return (z > 0) ? cube_coord{ 4, x / az, -y / az } : cube_coord{ 5, -x / az, -y / az };
+	}
+
+	auto is_srgb(dxgi_format format) -> bool
+	{
+		return format == dxgi_format::r8g8b8a8_unorm_srgb or format == dxgi_format::b8g8r8a8_unorm_srgb;
+	}
+
+	auto srgb_to_linear(float c) -> float
+	{
+		return (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+	auto srgb_decode_table() -> const std::array<float, 256> &
+	{
+		static const auto table = []
+		{
+			auto t = std::array<float, 256>{};
+			for (auto i = 0u; i < t.size(); i++)
+			{
+				t[i] = srgb_to_linear(i / 255.0f);
+			}
+			return t;
+		}();
+		return table;
+	}
+
+	// Linear values half way between neighbouring 8 bit sRGB codes, encoding finds the bracket
+	auto srgb_encode_table() -> const std::array<float, 255> &
+	{
+		static const auto table = []
+		{
+			auto t = std::array<float, 255>{};
+			for (auto i = 0u; i < t.size(); i++)
+			{
+				t[i] = srgb_to_linear((i + 0.5f) / 255.0f);
+			}
+			return t;
+		}();
+		return table;
+	}
+
+	void decode_texels(std::span<const std::byte> src, bool srgb, image &dst)
+	{
+		auto &decode_table = srgb_decode_table();
+		dst.resize(src.size() / 4);
+		for (auto i = std::size_t{}; i < dst.size(); i++)
+		{
+			auto channel = [&](uint32_t c)
+			{
+				auto value = static_cast<uint8_t>(src[i * 4 + c]);
+				return srgb ? decode_table[value] : value / 255.0f;
+			};
+			dst[i] = XMFLOAT4A{ channel(0), channel(1), channel(2), 1.0f };
+		}
+	}
+
+	// Alpha is always opaque, a sky has nothing behind it
+	void encode_texels(std::span<const XMFLOAT4A> src, bool srgb, std::byte *dst)
+	{
+		auto &encode_table = srgb_encode_table();
+		for (auto &texel : src)
+		{
+			for (auto c : { texel.x, texel.y, texel.z })
+			{
+				c = std::clamp(c, 0.0f, 1.0f);
+				auto code = srgb ? std::upper_bound(encode_table.begin(), encode_table.end(), c) - encode_table.begin()
+				                 : std::lround(c * 255.0f);
+				*dst++ = static_cast<std::byte>(code);
+			}
+			*dst++ = std::byte{ 0xFF };
+		}
+	}
+
+	// Mip 0 of every face to float, then 2x2 box mips down to one texel
+	auto make_sky_chain(const dds_texture &sky) -> sky_chain
+	{
+		auto chain = sky_chain{ sky.width, std::vector<cube_images>(full_mip_count(sky.width, sky.height)) };
+		auto srgb = is_srgb(sky.format);
+
+		for_each_range(6, [&](uint32_t first, uint32_t last)
+		{
+			for (auto face = first; face < last; face++)
+			{
+				decode_texels(dds_subresource(sky, face, 0), srgb, chain.mips[0][face]);
+			}
+			return true;
+		});
+
+		for (auto mip = 1u; mip < chain.mips.size(); mip++)
+		{
+			auto src_size = std::max(1u, chain.size >> (mip - 1)),
+			     dst_size = std::max(1u, chain.size >> mip);
+			for_each_range(6 * dst_size, [&](uint32_t first, uint32_t last)
+			{
+				for (auto row = first; row < last; row++)
+				{
+					auto face = row / dst_size, y = row % dst_size;
+					auto &src = chain.mips[mip - 1][face];
+					auto &dst = chain.mips[mip][face];
+					dst.resize(std::size_t{ dst_size } * dst_size);
+
+					auto y0 = std::min(2 * y, src_size - 1), y1 = std::min(2 * y + 1, src_size - 1);
+					for (auto x = 0u; x < dst_size; x++)
+					{
+						auto x0 = std::min(2 * x, src_size - 1), x1 = std::min(2 * x + 1, src_size - 1);
+						auto sum = XMVectorAdd(XMVectorAdd(XMLoadFloat4A(&src[std::size_t{ y0 } * src_size + x0]),
+						                                   XMLoadFloat4A(&src[std::size_t{ y0 } * src_size + x1])),
+						                       XMVectorAdd(XMLoadFloat4A(&src[std::size_t{ y1 } * src_size + x0]),
+						                                   XMLoadFloat4A(&src[std::size_t{ y1 } * src_size + x1])));
+						XMStoreFloat4A(&dst[std::size_t{ y } * dst_size + x], XMVectorScale(sum, 0.25f));
+					}
+				}
+				return true;
+			});
+		}
+		return chain;
+	}
+
+	// Bilinear inside one face, edges clamp. Seams are hidden by the many samples each output texel averages.
+	auto sample_face(const image &face, uint32_t size, float u, float v) -> XMVECTOR
+	{
+		auto x = (u + 1.0f) * 0.5f * size - 0.5f,
+		     y = (v + 1.0f) * 0.5f * size - 0.5f;
+		auto fx = std::floor(x), fy = std::floor(y);
+		auto tx = x - fx, ty = y - fy;
+
+		auto last = static_cast<int32_t>(size) - 1;
+		auto x0 = std::clamp(static_cast<int32_t>(fx), 0, last), x1 = std::clamp(static_cast<int32_t>(fx) + 1, 0, last),
+		     y0 = std::clamp(static_cast<int32_t>(fy), 0, last), y1 = std::clamp(static_cast<int32_t>(fy) + 1, 0, last);
+		auto texel = [&](int32_t tx_, int32_t ty_)
+		{
+			return XMLoadFloat4A(&face[static_cast<std::size_t>(ty_) * size + tx_]);
+		};
+
+		auto top = XMVectorLerp(texel(x0, y0), texel(x1, y0), tx),
+		     bottom = XMVectorLerp(texel(x0, y1), texel(x1, y1), tx);
+		return XMVectorLerp(top, bottom, ty);
+	}
+
+	// Trilinear, lod in mips of the sky
+	auto sample_sky(const sky_chain &chain, FXMVECTOR direction, float lod) -> XMVECTOR
+	{
+		auto [face, u, v] = cube_face_of(direction);
+		lod = std::clamp(lod, 0.0f, static_cast<float>(chain.mips.size() - 1));
+		auto mip = static_cast<uint32_t>(lod);
+		auto t = lod - mip;
+
+		auto sample = sample_face(chain.mips[mip][face], std::max(1u, chain.size >> mip), u, v);
+		if (t == 0.0f or mip + 1 == chain.mips.size())
+		{
+			return sample;
+		}
+		auto next = sample_face(chain.mips[mip + 1][face], std::max(1u, chain.size >> (mip + 1)), u, v);
+		return XMVectorLerp(sample, next, t);
+	}
+
+	// Real SH basis of band 0 to 2 at a unit direction
+	auto sh9_basis(FXMVECTOR direction) -> std::array<float, 9>
+	{
+		auto d = XMFLOAT3{};
+		XMStoreFloat3(&d, direction);
+		auto [x, y, z] = d;
+		return {
+			0.282095f,
+			0.488603f * y,
+			0.488603f * z,
+			0.488603f * x,
+			1.092548f * x * y,
+			1.092548f * y * z,
+			0.315392f * (3.0f * z * z - 1.0f),
+			1.092548f * x * z,
+			0.546274f * (x * x - y * y),
+		};
+	}
+
+	// Solid angle of a texel at u, v of a face size texels across, close enough for texels this small
+	auto texel_solid_angle(float u, float v, uint32_t size) -> float
+	{
+		auto texel = 2.0f / size;
+		auto d = 1.0f + u * u + v * v;
+		return texel * texel / (d * std::sqrt(d));
+	}
+
+	// A GGX sample around N = V = +z, with the sky mip its pdf wants and its N.L weight
+	struct specular_sample
+	{
+		XMFLOAT3 direction;
+		float weight;
+		float lod;
+	};
+
+	auto radical_inverse(uint32_t bits) -> float
+	{
+		bits = (bits << 16) | (bits >> 16);
+		bits = ((bits & 0x55555555u) << 1) | ((bits & 0xAAAAAAAAu) >> 1);
+		bits = ((bits & 0x33333333u) << 2) | ((bits & 0xCCCCCCCCu) >> 2);
+		bits = ((bits & 0x0F0F0F0Fu) << 4) | ((bits & 0xF0F0F0F0u) >> 4);
+		bits = ((bits & 0x00FF00FFu) << 8) | ((bits & 0xFF00FF00u) >> 8);
+		return bits * 0x1p-32f;
+	}
+
+	// Same for every texel as N = V, so they're made once per mip and rotated to each texel's normal
+	auto make_specular_samples(float roughness, uint32_t sample_count, uint32_t sky_size) -> std::vector<specular_sample>
+	{
+		if (roughness == 0.0f)
+		{
+			return { { { 0.0f, 0.0f, 1.0f }, 1.0f, 0.0f } };
+		}
+
+		auto alpha = roughness * roughness;
+		auto alpha2 = alpha * alpha;
+		auto texel_angle = 4.0f * pi / (6.0f * sky_size * sky_size);
+
+		auto samples = std::vector<specular_sample>{};
+		for (auto i = 0u; i < sample_count; i++)
+		{
+			auto xi_x = (i + 0.5f) / sample_count,
+			     xi_y = radical_inverse(i);
+			auto phi = 2.0f * pi * xi_x;
+			auto cos_theta = std::sqrt((1.0f - xi_y) / (1.0f + (alpha2 - 1.0f) * xi_y));
+			auto sin_theta = std::sqrt(1.0f - cos_theta * cos_theta);
+			auto h = XMFLOAT3{ sin_theta * std::cos(phi), sin_theta * std::sin(phi), cos_theta };
+
+			// L = reflect(-V, H) with V = +z
+			auto l = XMFLOAT3{ 2.0f * h.z * h.x, 2.0f * h.z * h.y, 2.0f * h.z * h.z - 1.0f };
+			if (l.z <= 0.0f)
+			{
+				continue;
+			}
+
+			// pdf of L is D * N.H / (4 V.H), and N.H = V.H here
+			auto denominator = cos_theta * cos_theta * (alpha2 - 1.0f) + 1.0f;
+			auto pdf = alpha2 / (pi * denominator * denominator) / 4.0f;
+			auto sample_angle = 1.0f / (sample_count * pdf);
+			auto lod = std::max(0.0f, 0.5f * std::log2(sample_angle / texel_angle) + 1.0f);
+			samples.push_back({ l, l.z, lod });
+		}
+		return samples;
+	}
+
+	auto prefilter_texel(const sky_chain &chain, const std::vector<specular_sample> &samples, FXMVECTOR normal,
+	                     float base_lod) -> XMVECTOR
+	{
+		auto up = std::abs(XMVectorGetZ(normal)) < 0.999f ? XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f) : XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f);
+		auto tangent = XMVector3Normalize(XMVector3Cross(up, normal));
+		auto bitangent = XMVector3Cross(normal, tangent);
+
+		auto sum = XMVectorZero();
+		auto weight = 0.0f;
+		for (auto &s : samples)
+		{
+			auto direction = XMVectorMultiplyAdd(tangent, XMVectorReplicate(s.direction.x),
+			                 XMVectorMultiplyAdd(bitangent, XMVectorReplicate(s.direction.y),
+			                                     XMVectorScale(normal, s.direction.z)));
+			sum = XMVectorMultiplyAdd(sample_sky(chain, direction, std::max(s.lod, base_lod)), XMVectorReplicate(s.weight), sum);
+			weight += s.weight;
+		}
+		return XMVectorScale(sum, 1.0f / weight);
+	}
+}
+
+auto dx11_lessons::can_prefilter(const dds_texture &sky) -> bool
+{
+	return sky.is_cube and sky.array_size == 6 and sky.width == sky.height and can_generate_mips(sky.format);
+}
+
+auto dx11_lessons::project_sh9(const dds_texture &sky) -> sh9_coefficients
+{
+	assert(can_prefilter(sky));
+
+	auto chain = make_sky_chain(sky);
+	auto mip = 0u;
+	while ((chain.size >> mip) > sh_projection_size)
+	{
+		mip++;
+	}
+	auto size = std::max(1u, chain.size >> mip);
+
+	// Each row sums on its own, then rows are added in order so the result doesn't depend on thread count
+	auto rows = std::vector<std::array<XMFLOAT4A, 9>>(6 * size);
+	for_each_range(6 * size, [&](uint32_t first, uint32_t last)
+	{
+		for (auto row = first; row < last; row++)
+		{
+			auto face = row / size, y = row % size;
+			auto v = 2.0f * (y + 0.5f) / size - 1.0f;
+			auto sums = std::array<XMVECTOR, 9>{};
+			sums.fill(XMVectorZero());
+
+			for (auto x = 0u; x < size; x++)
+			{
+				auto u = 2.0f * (x + 0.5f) / size - 1.0f;
+				auto radiance = XMLoadFloat4A(&chain.mips[mip][face][std::size_t{ y } * size + x]);
+				radiance = XMVectorScale(radiance, texel_solid_angle(u, v, size));
+
+				auto basis = sh9_basis(XMVector3Normalize(cube_direction(face, u, v)));
+				for (auto i = 0u; i < sums.size(); i++)
+				{
+					sums[i] = XMVectorMultiplyAdd(radiance, XMVectorReplicate(basis[i]), sums[i]);
+				}
+			}
+
+			for (auto i = 0u; i < sums.size(); i++)
+			{
+				XMStoreFloat4A(&rows[row][i], sums[i]);
+			}
+		}
+		return true;
+	});
+
+	auto sh = sh9_coefficients{};
+	for (auto &row : rows)
+	{
+		for (auto i = 0u; i < sh.size(); i++)
+		{
+			sh[i][0] += row[i].x;
+			sh[i][1] += row[i].y;
+			sh[i][2] += row[i].z;
+		}
+	}
+	return sh;
+}
+
+auto dx11_lessons::irradiance_cube(const sh9_coefficients &sh, dxgi_format format, uint32_t size) -> std::vector<std::byte>
+{
+	assert(can_generate_mips(format));
+
+	// Cosine lobe convolution per band, pi, 2pi/3 and pi/4, then over pi
+	constexpr auto band_scale = std::array{ 1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f,
+	                                        0.25f, 0.25f, 0.25f, 0.25f, 0.25f };
+	auto coefficients = std::array<XMVECTOR, 9>{};
+	for (auto i = 0u; i < coefficients.size(); i++)
+	{
+		coefficients[i] = XMVectorScale(XMVectorSet(sh[i][0], sh[i][1], sh[i][2], 0.0f), band_scale[i]);
+	}
+
+	auto face_size = std::size_t{ size } * size * 4;
+	auto output = std::vector<std::byte>(face_size * 6);
+	auto srgb = is_srgb(format);
+	for_each_range(6 * size, [&](uint32_t first, uint32_t last)
+	{
+		auto texels = image(size);
+		for (auto row = first; row < last; row++)
+		{
+			auto face = row / size, y = row % size;
+			auto v = 2.0f * (y + 0.5f) / size - 1.0f;
+			for (auto x = 0u; x < size; x++)
+			{
+				auto u = 2.0f * (x + 0.5f) / size - 1.0f;
+				auto basis = sh9_basis(XMVector3Normalize(cube_direction(face, u, v)));
+				auto irradiance = XMVectorZero();
+				for (auto i = 0u; i < coefficients.size(); i++)
+				{
+					irradiance = XMVectorMultiplyAdd(coefficients[i], XMVectorReplicate(basis[i]), irradiance);
+				}
+				XMStoreFloat4A(&texels[x], XMVectorMax(irradiance, XMVectorZero()));
+			}
+			encode_texels(texels, srgb, output.data() + face * face_size + std::size_t{ y } * size * 4);
+		}
+		return true;
+	});
+	return output;
+}
+
+auto dx11_lessons::prefilter_specular(const dds_texture &sky, const specular_settings &settings) -> std::vector<std::byte>
+{
+	assert(can_prefilter(sky) and settings.size > 0);
+
+	auto chain = make_sky_chain(sky);
+	auto mip_count = full_mip_count(settings.size, settings.size);
+	auto mip_size = [&](uint32_t mip) { return std::max(1u, settings.size >> mip); };
+
+	auto slice_size = std::size_t{};
+	for (auto mip = 0u; mip < mip_count; mip++)
+	{
+		slice_size += std::size_t{ mip_size(mip) } * mip_size(mip) * 4;
+	}
+	auto output = std::vector<std::byte>(slice_size * 6);
+	auto srgb = is_srgb(sky.format);
+
+	auto mip_offset = std::size_t{};
+	for (auto mip = 0u; mip < mip_count; mip++)
+	{
+		auto size = mip_size(mip);
+		auto roughness = mip_count > 1 ? static_cast<float>(mip) / (mip_count - 1) : 0.0f;
+		auto samples = make_specular_samples(roughness, settings.sample_count, chain.size);
+
+		// Never sharper than the sky minified to this mip
+		auto base_lod = std::max(0.0f, std::log2(static_cast<float>(chain.size) / size));
+
+		for_each_range(6 * size, [&](uint32_t first, uint32_t last)
+		{
+			auto texels = image(size);
+			for (auto row = first; row < last; row++)
+			{
+				auto face = row / size, y = row % size;
+				auto v = 2.0f * (y + 0.5f) / size - 1.0f;
+				for (auto x = 0u; x < size; x++)
+				{
+					auto u = 2.0f * (x + 0.5f) / size - 1.0f;
+					auto normal = XMVector3Normalize(cube_direction(face, u, v));
+					XMStoreFloat4A(&texels[x], prefilter_texel(chain, samples, normal, base_lod));
+				}
+				encode_texels(texels, srgb, output.data() + face * slice_size + mip_offset + std::size_t{ y } * size * 4);
+			}
+			return true;
+		});
+
+		mip_offset += std::size_t{ size } * size * 4;
+	}
+	return output;
+}
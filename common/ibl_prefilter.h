@@ -0,0 +1,36 @@
+#pragma once
+
+#include "dds_file.h"
+
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace dx11_lessons
+{
+	// Sky radiance projected on the first 9 real spherical harmonics, band 0 first.
+	// Linear light, in the channel order of the sky's format.
+	using sh9_coefficients = std::array<std::array<float, 3>, 9>;
+
+	struct specular_settings
+	{
+		uint32_t size = 128;            // faces of mip 0, every mip after it is for a rougher surface
+		uint32_t sample_count = 256;    // GGX samples per texel of each mip
+	};
+
+	// Cubes in the 8 bit, 4 channel formats mips can be generated for, any mip count
+	auto can_prefilter(const dds_texture &sky) -> bool;
+
+	// Every texel weighted by its solid angle. Read from the first mip of 64 texels or less, it's low frequency anyway.
+	auto project_sh9(const dds_texture &sky) -> sh9_coefficients;
+
+	// Cosine convolved irradiance over pi, so albedo * sample is the diffuse colour.
+	// Six faces of one mip, looked up by normal. Alpha is 1.
+	auto irradiance_cube(const sh9_coefficients &sh, dxgi_format format, uint32_t size) -> std::vector<std::byte>;
+
+	// GGX prefiltered radiance, split sum with N = V = R. Mip m is for roughness m / (mips - 1), full chain, sky's format.
+	// Samples are importance sampled and read from the sky mip matching their pdf, so few are needed for no fireflies.
+	// Faces and rows of each mip are spread over the hardware threads, texels are sampled 4 channels at a time.
+	auto prefilter_specular(const dds_texture &sky, const specular_settings &settings) -> std::vector<std::byte>;
+}
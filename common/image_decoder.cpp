@@ -0,0 +1,1904 @@
+#include "image_decoder.h"
+#include "parallel_range.h"
+
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <string_view>
+#include <cassert>
+
+// Every x64 CPU D3D11 runs on has SSSE3 and MSVC always allows its intrinsics, other compilers need -mssse3
+#if defined(_M_X64) || defined(__SSSE3__)
+#include <tmmintrin.h>
+#define IMAGE_DECODER_SSSE3
+#endif
+
+using namespace dx11_lessons;
+
+namespace
+{
+	constexpr auto max_image_size = 16384u;   // D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION
+
+	auto as_bytes(std::span<const std::byte> data) -> std::span<const uint8_t>
+	{
+		return { reinterpret_cast<const uint8_t *>(data.data()), data.size() };
+	}
+
+	auto read_u16_le(const uint8_t *p) -> uint32_t
+	{
+		return p[0] | (p[1] << 8);
+	}
+
+	auto read_u16_be(const uint8_t *p) -> uint32_t
+	{
+		return (p[0] << 8) | p[1];
+	}
+
+	auto read_u32_be(const uint8_t *p) -> uint32_t
+	{
+		return (uint32_t{ p[0] } << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+	}
+
+	auto make_image(uint32_t width, uint32_t height, bool has_alpha) -> decoded_image
+	{
+		return { width, height, has_alpha, std::vector<std::byte>(std::size_t{ width } * height * 4) };
+	}
+
+	auto image_row(decoded_image &image, uint32_t y) -> uint8_t *
+	{
+		return reinterpret_cast<uint8_t *>(image.texels.data()) + std::size_t{ y } * image.width * 4;
+	}
+
+#pragma region Swizzle
+	// How texels of a row are laid out in the file, every one goes to RGBA8
+	enum class texel_layout
+	{
+		grey,
+		grey_alpha,
+		rgb,
+		bgr,
+		rgba,
+		bgra,
+	};
+
+	constexpr auto layout_size(texel_layout layout) -> uint32_t
+	{
+		constexpr auto sizes = std::array{ 1u, 2u, 3u, 3u, 4u, 4u };
+		return sizes[static_cast<uint32_t>(layout)];
+	}
+
+	constexpr auto layout_has_alpha(texel_layout layout) -> bool
+	{
+		return layout == texel_layout::grey_alpha or layout == texel_layout::rgba or layout == texel_layout::bgra;
+	}
+
+	void to_rgba(const uint8_t *src, uint32_t count, texel_layout layout, uint8_t *dst)
+	{
+		auto size = layout_size(layout);
+		auto x = 0u;
+
+#ifdef IMAGE_DECODER_SSSE3
+		// Source byte of each destination byte for 4 texels, -1 for alpha, which is or-ed in afterwards
+		constexpr int8_t masks[][16] =
+		{
+			{ 0, 0, 0, -1,  1, 1, 1, -1,  2, 2, 2, -1,  3, 3, 3, -1 },     // grey
+			{ 0, 0, 0, 1,  2, 2, 2, 3,  4, 4, 4, 5,  6, 6, 6, 7 },         // grey_alpha
+			{ 0, 1, 2, -1,  3, 4, 5, -1,  6, 7, 8, -1,  9, 10, 11, -1 },   // rgb
+			{ 2, 1, 0, -1,  5, 4, 3, -1,  8, 7, 6, -1,  11, 10, 9, -1 },   // bgr
+			{ 0, 1, 2, 3,  4, 5, 6, 7,  8, 9, 10, 11,  12, 13, 14, 15 },   // rgba
+			{ 2, 1, 0, 3,  6, 5, 4, 7,  10, 9, 8, 11,  14, 13, 12, 15 },   // bgra
+		};
+		auto mask = _mm_loadu_si128(reinterpret_cast<const __m128i *>(masks[static_cast<uint32_t>(layout)]));
+		auto alpha = layout_has_alpha(layout) ? _mm_setzero_si128() : _mm_set1_epi32(static_cast<int>(0xFF000000));
+
+		// Loads are 16 bytes whatever the layout, so the last few texels are left to the scalar loop
+		for (; x + 4 <= count and std::size_t{ x } * size + 16 <= std::size_t{ count } * size; x += 4)
+		{
+			auto texels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + std::size_t{ x } * size));
+			texels = _mm_or_si128(_mm_shuffle_epi8(texels, mask), alpha);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + std::size_t{ x } * 4), texels);
+		}
+#endif
+
+		for (; x < count; x++)
+		{
+			auto s = src + std::size_t{ x } * size;
+			auto d = dst + std::size_t{ x } * 4;
+			switch (layout)
+			{
+				case texel_layout::grey:       d[0] = d[1] = d[2] = s[0]; d[3] = 255; break;
+				case texel_layout::grey_alpha: d[0] = d[1] = d[2] = s[0]; d[3] = s[1]; break;
+				case texel_layout::rgb:        d[0] = s[0]; d[1] = s[1]; d[2] = s[2]; d[3] = 255; break;
+				case texel_layout::bgr:        d[0] = s[2]; d[1] = s[1]; d[2] = s[0]; d[3] = 255; break;
+				case texel_layout::rgba:       d[0] = s[0]; d[1] = s[1]; d[2] = s[2]; d[3] = s[3]; break;
+				case texel_layout::bgra:       d[0] = s[2]; d[1] = s[1]; d[2] = s[0]; d[3] = s[3]; break;
+			}
+		}
+	}
+#pragma endregion
+
+#pragma region Inflate
+	// Deflate stream bits, least significant first. Reads past the end give zeros, overrun() tells.
+	class lsb_bit_reader
+	{
+	public:
+		explicit lsb_bit_reader(std::span<const uint8_t> data_) :
+			data{ data_ }
+		{}
+
+		auto peek(uint32_t count) -> uint32_t
+		{
+			refill();
+			return static_cast<uint32_t>(bits & ((uint64_t{ 1 } << count) - 1));
+		}
+
+		void drop(uint32_t count)
+		{
+			bits >>= count;
+			bit_count -= count;
+		}
+
+		auto read(uint32_t count) -> uint32_t
+		{
+			auto value = peek(count);
+			drop(count);
+			return value;
+		}
+
+		// Stored blocks start on a byte, buffered whole bytes are given back first
+		auto copy_bytes(uint8_t *dst, std::size_t count) -> bool
+		{
+			drop(bit_count % 8);
+			for (; count > 0 and bit_count > 0; count--)
+			{
+				*dst++ = static_cast<uint8_t>(bits);
+				drop(8);
+			}
+			if (count > 0 and position + count > data.size())
+			{
+				return false;
+			}
+			std::memcpy(dst, data.data() + position, count);
+			position += count;
+			return true;
+		}
+
+		auto overrun() const -> bool
+		{
+			return position > data.size() + sizeof(bits);
+		}
+
+	private:
+		void refill()
+		{
+			while (bit_count <= 56)
+			{
+				auto byte = position < data.size() ? data[position] : uint8_t{};
+				bits |= uint64_t{ byte } << bit_count;
+				position++;
+				bit_count += 8;
+			}
+		}
+
+		std::span<const uint8_t> data;
+		std::size_t position{};
+		uint64_t bits{};
+		uint32_t bit_count{};
+	};
+
+	// Canonical Huffman code, codes up to fast_bits long in one lookup, longer ones a bit at a time
+	class deflate_huffman
+	{
+	public:
+		static constexpr auto fast_bits = 10u;
+
+		auto build(std::span<const uint8_t> lengths) -> bool
+		{
+			counts.fill(0);
+			fast.fill(0);
+			for (auto length : lengths)
+			{
+				counts[length]++;
+			}
+			counts[0] = 0;
+
+			auto left = 1;
+			auto offsets = std::array<uint16_t, 16>{};
+			for (auto length = 1u; length < 16; length++)
+			{
+				left = (left << 1) - counts[length];
+				if (left < 0)
+				{
+					return false;
+				}
+				offsets[length] = static_cast<uint16_t>(offsets[length - 1] + counts[length - 1]);
+			}
+
+			// Codes of each length are consecutive, in symbol order
+			auto next_code = std::array<uint32_t, 16>{};
+			auto code = 0u;
+			for (auto length = 1u; length < 16; length++)
+			{
+				next_code[length] = code;
+				code = (code + counts[length]) << 1;
+			}
+
+			for (auto symbol = 0u; symbol < lengths.size(); symbol++)
+			{
+				auto length = lengths[symbol];
+				if (length == 0)
+				{
+					continue;
+				}
+				symbols[offsets[length]++] = static_cast<uint16_t>(symbol);
+
+				auto reversed = 0u;
+				for (auto c = next_code[length]++, i = 0u; i < length; i++, c >>= 1)
+				{
+					reversed = (reversed << 1) | (c & 1);
+				}
+				for (auto entry = reversed; length <= fast_bits and entry < fast.size(); entry += 1u << length)
+				{
+					fast[entry] = static_cast<uint16_t>((symbol << 4) | length);
+				}
+			}
+			return true;
+		}
+
+		// -1 for a code that isn't in the table
+		auto decode(lsb_bit_reader &reader) const -> int
+		{
+			auto bits = reader.peek(15);
+			auto entry = fast[bits & ((1u << fast_bits) - 1)];
+			if (entry != 0)
+			{
+				reader.drop(entry & 15);
+				return entry >> 4;
+			}
+
+			auto code = 0, first = 0, index = 0;
+			for (auto length = 1u; length < 16; length++)
+			{
+				code |= (bits >> (length - 1)) & 1;
+				auto count = counts[length];
+				if (code - first < count)
+				{
+					reader.drop(length);
+					return symbols[index + code - first];
+				}
+				index += count;
+				first = (first + count) << 1;
+				code <<= 1;
+			}
+			return -1;
+		}
+
+	private:
+		std::array<uint16_t, 16> counts{};
+		std::array<uint16_t, 288> symbols{};
+		std::array<uint16_t, 1 << fast_bits> fast{};
+	};
+
+	constexpr auto length_base = std::array<uint16_t, 29>{
+		3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	constexpr auto length_extra = std::array<uint8_t, 29>{
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	constexpr auto distance_base = std::array<uint16_t, 30>{
+		1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+		1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	constexpr auto distance_extra = std::array<uint8_t, 30>{
+		0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	auto inflate_codes(lsb_bit_reader &reader, const deflate_huffman &literals, const deflate_huffman &distances,
+	                   std::vector<uint8_t> &output) -> bool
+	{
+		while (not reader.overrun())
+		{
+			auto symbol = literals.decode(reader);
+			if (symbol < 0)
+			{
+				return false;
+			}
+			if (symbol < 256)
+			{
+				output.push_back(static_cast<uint8_t>(symbol));
+				continue;
+			}
+			if (symbol == 256)
+			{
+				return true;
+			}
+
+			symbol -= 257;
+			if (symbol >= static_cast<int>(length_base.size()))
+			{
+				return false;
+			}
+			auto length = length_base[symbol] + reader.read(length_extra[symbol]);
+
+			auto distance_symbol = distances.decode(reader);
+			if (distance_symbol < 0 or distance_symbol >= static_cast<int>(distance_base.size()))
+			{
+				return false;
+			}
+			auto distance = distance_base[distance_symbol] + reader.read(distance_extra[distance_symbol]);
+			if (distance > output.size())
+			{
+				return false;
+			}
+
+			// Byte at a time, the match may overlap what it writes
+			auto from = output.size() - distance;
+			for (auto i = 0u; i < length; i++)
+			{
+				output.push_back(output[from + i]);
+			}
+		}
+		return false;
+	}
+
+	auto read_dynamic_tables(lsb_bit_reader &reader, deflate_huffman &literals, deflate_huffman &distances) -> bool
+	{
+		constexpr auto length_order = std::array<uint8_t, 19>{ 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+		auto literal_count = reader.read(5) + 257,
+		     distance_count = reader.read(5) + 1,
+		     length_count = reader.read(4) + 4;
+
+		auto length_lengths = std::array<uint8_t, 19>{};
+		for (auto i = 0u; i < length_count; i++)
+		{
+			length_lengths[length_order[i]] = static_cast<uint8_t>(reader.read(3));
+		}
+		auto length_code = deflate_huffman{};
+		if (not length_code.build(length_lengths))
+		{
+			return false;
+		}
+
+		auto lengths = std::array<uint8_t, 288 + 32>{};
+		for (auto i = 0u; i < literal_count + distance_count;)
+		{
+			auto symbol = length_code.decode(reader);
+			if (symbol < 0)
+			{
+				return false;
+			}
+			if (symbol < 16)
+			{
+				lengths[i++] = static_cast<uint8_t>(symbol);
+				continue;
+			}
+
+			auto value = uint8_t{};
+			auto repeat = 0u;
+			switch (symbol)
+			{
+				case 16:
+					if (i == 0)
+					{
+						return false;
+					}
+					value = lengths[i - 1];
+					repeat = 3 + reader.read(2);
+					break;
+				case 17:
+					repeat = 3 + reader.read(3);
+					break;
+				default:
+					repeat = 11 + reader.read(7);
+					break;
+			}
+			if (i + repeat > literal_count + distance_count)
+			{
+				return false;
+			}
+			std::fill_n(lengths.begin() + i, repeat, value);
+			i += repeat;
+		}
+
+		return literals.build({ lengths.data(), literal_count })
+		   and distances.build({ lengths.data() + literal_count, distance_count });
+	}
+
+	// zlib stream -> its bytes, expected_size is only a hint
+	auto inflate(std::span<const uint8_t> data, std::size_t expected_size) -> std::optional<std::vector<uint8_t>>
+	{
+		if (data.size() < 2 or (data[0] & 0x0F) != 8 or (data[0] * 256 + data[1]) % 31 != 0 or (data[1] & 0x20) != 0)
+		{
+			return std::nullopt;
+		}
+
+		static const auto fixed_tables = []
+		{
+			auto lengths = std::array<uint8_t, 288 + 32>{};
+			std::fill_n(lengths.begin(), 144, uint8_t{ 8 });
+			std::fill_n(lengths.begin() + 144, 112, uint8_t{ 9 });
+			std::fill_n(lengths.begin() + 256, 24, uint8_t{ 7 });
+			std::fill_n(lengths.begin() + 280, 8, uint8_t{ 8 });
+			std::fill_n(lengths.begin() + 288, 32, uint8_t{ 5 });
+
+			auto tables = std::pair<deflate_huffman, deflate_huffman>{};
+			tables.first.build({ lengths.data(), 288 });
+			tables.second.build({ lengths.data() + 288, 32 });
+			return tables;
+		}();
+
+		auto output = std::vector<uint8_t>{};
+		output.reserve(expected_size);
+
+		auto reader = lsb_bit_reader(data.subspan(2));
+		auto last = false;
+		while (not last)
+		{
+			last = reader.read(1) == 1;
+			auto type = reader.read(2);
+			auto good = false;
+			if (type == 0)
+			{
+				auto header = std::array<uint8_t, 4>{};
+				good = reader.copy_bytes(header.data(), header.size());
+				auto length = read_u16_le(header.data());
+				good = good and (length ^ read_u16_le(header.data() + 2)) == 0xFFFF;
+				if (good)
+				{
+					output.resize(output.size() + length);
+					good = reader.copy_bytes(output.data() + output.size() - length, length);
+				}
+			}
+			else if (type == 1)
+			{
+				good = inflate_codes(reader, fixed_tables.first, fixed_tables.second, output);
+			}
+			else if (type == 2)
+			{
+				auto literals = deflate_huffman{}, distances = deflate_huffman{};
+				good = read_dynamic_tables(reader, literals, distances)
+				   and inflate_codes(reader, literals, distances, output);
+			}
+
+			if (not good or reader.overrun())
+			{
+				return std::nullopt;
+			}
+		}
+		return output;
+	}
+#pragma endregion
+
+#pragma region PNG
+	constexpr auto png_signature = std::array<uint8_t, 8>{ 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+	struct png_header
+	{
+		uint32_t width;
+		uint32_t height;
+		uint32_t depth;
+		uint32_t colour_type;   // 0 grey, 2 RGB, 3 palette, 4 grey and alpha, 6 RGBA
+		bool interlaced;
+		std::array<std::array<uint8_t, 4>, 256> palette;
+		std::optional<std::array<uint16_t, 3>> colour_key;   // tRNS for grey and RGB
+		bool palette_alpha;                                  // tRNS for palettes
+	};
+
+	auto png_channels(uint32_t colour_type) -> uint32_t
+	{
+		constexpr auto channels = std::array{ 1u, 0u, 3u, 1u, 2u, 0u, 4u };
+		return colour_type < channels.size() ? channels[colour_type] : 0u;
+	}
+
+	auto png_row_size(const png_header &header, uint32_t width) -> std::size_t
+	{
+		return (std::size_t{ width } * png_channels(header.colour_type) * header.depth + 7) / 8;
+	}
+
+	auto valid_depth(uint32_t colour_type, uint32_t depth) -> bool
+	{
+		switch (colour_type)
+		{
+			case 0: return depth == 1 or depth == 2 or depth == 4 or depth == 8 or depth == 16;
+			case 3: return depth == 1 or depth == 2 or depth == 4 or depth == 8;
+			case 2:
+			case 4:
+			case 6: return depth == 8 or depth == 16;
+		}
+		return false;
+	}
+
+	auto paeth(int a, int b, int c) -> uint8_t
+	{
+		auto p = a + b - c;
+		auto pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+		return static_cast<uint8_t>((pa <= pb and pa <= pc) ? a : (pb <= pc ? b : c));
+	}
+
+	// Rows are a filter byte then row_size bytes, undone in place. Each row needs the one above, so this is serial.
+	auto unfilter(uint8_t *rows, uint32_t height, std::size_t row_size, uint32_t texel_size) -> bool
+	{
+		auto zeros = std::vector<uint8_t>(row_size);
+		const uint8_t *above = zeros.data();
+		for (auto y = 0u; y < height; y++)
+		{
+			auto filter = rows[0];
+			auto row = rows + 1;
+			switch (filter)
+			{
+				case 0:
+					break;
+				case 1:
+					for (auto i = std::size_t{ texel_size }; i < row_size; i++)
+					{
+						row[i] = static_cast<uint8_t>(row[i] + row[i - texel_size]);
+					}
+					break;
+				case 2:
+					for (auto i = std::size_t{}; i < row_size; i++)
+					{
+						row[i] = static_cast<uint8_t>(row[i] + above[i]);
+					}
+					break;
+				case 3:
+					for (auto i = std::size_t{}; i < row_size; i++)
+					{
+						auto left = i >= texel_size ? row[i - texel_size] : 0;
+						row[i] = static_cast<uint8_t>(row[i] + ((left + above[i]) >> 1));
+					}
+					break;
+				case 4:
+					for (auto i = std::size_t{}; i < row_size; i++)
+					{
+						auto left = i >= texel_size ? row[i - texel_size] : 0,
+						     corner = i >= texel_size ? above[i - texel_size] : 0;
+						row[i] = static_cast<uint8_t>(row[i] + paeth(left, above[i], corner));
+					}
+					break;
+				default:
+					return false;
+			}
+			above = row;
+			rows += row_size + 1;
+		}
+		return true;
+	}
+
+	auto png_sample(const uint8_t *row, uint32_t index, uint32_t depth) -> uint32_t
+	{
+		switch (depth)
+		{
+			case 16: return read_u16_be(row + index * 2);
+			case 8: return row[index];
+		}
+		auto per_byte = 8 / depth;
+		auto shift = 8 - depth * (index % per_byte + 1);
+		return (row[index / per_byte] >> shift) & ((1u << depth) - 1);
+	}
+
+	// One unfiltered row of count texels to RGBA8
+	void png_to_rgba(const png_header &header, const uint8_t *row, uint32_t count, uint8_t *dst)
+	{
+		constexpr auto layouts = std::array{ texel_layout::grey, texel_layout::grey, texel_layout::rgb, texel_layout::grey,
+		                                     texel_layout::grey_alpha, texel_layout::grey, texel_layout::rgba };
+		if (header.depth == 8 and header.colour_type != 3 and not header.colour_key)
+		{
+			to_rgba(row, count, layouts[header.colour_type], dst);
+			return;
+		}
+
+		auto channels = png_channels(header.colour_type);
+		auto max_value = (1u << header.depth) - 1;
+		for (auto x = 0u; x < count; x++, dst += 4)
+		{
+			auto sample = [&](uint32_t channel)
+			{
+				return png_sample(row, x * channels + channel, header.depth);
+			};
+
+			if (header.colour_type == 3)
+			{
+				std::memcpy(dst, header.palette[sample(0)].data(), 4);
+				continue;
+			}
+
+			auto values = std::array<uint32_t, 4>{};
+			for (auto c = 0u; c < channels; c++)
+			{
+				values[c] = sample(c);
+			}
+			auto to_8_bits = [&](uint32_t value)
+			{
+				return static_cast<uint8_t>(header.depth == 16 ? value >> 8 : value * 255 / max_value);
+			};
+
+			auto is_grey = channels <= 2;
+			dst[0] = to_8_bits(values[0]);
+			dst[1] = to_8_bits(is_grey ? values[0] : values[1]);
+			dst[2] = to_8_bits(is_grey ? values[0] : values[2]);
+			dst[3] = (channels == 2 or channels == 4) ? to_8_bits(values[channels - 1]) : uint8_t{ 255 };
+
+			if (header.colour_key)
+			{
+				auto &key = *header.colour_key;
+				auto keyed = is_grey ? values[0] == key[0]
+				                     : (values[0] == key[0] and values[1] == key[1] and values[2] == key[2]);
+				dst[3] = keyed ? 0 : 255;
+			}
+		}
+	}
+
+	auto decode_png(std::span<const uint8_t> data) -> std::optional<decoded_image>
+	{
+		auto header = png_header{};
+		auto compressed = std::vector<uint8_t>{};
+		auto has_header = false, has_end = false;
+		auto palette_size = 0u;
+
+		for (auto position = png_signature.size(); not has_end and position + 12 <= data.size();)
+		{
+			auto length = read_u32_be(data.data() + position);
+			auto type = std::string_view(reinterpret_cast<const char *>(data.data() + position + 4), 4);
+			if (length > data.size() - position - 12)
+			{
+				return std::nullopt;
+			}
+			auto chunk = data.subspan(position + 8, length);
+			position += 12 + std::size_t{ length };
+
+			if (type == "IHDR" and length >= 13)
+			{
+				header.width = read_u32_be(chunk.data());
+				header.height = read_u32_be(chunk.data() + 4);
+				header.depth = chunk[8];
+				header.colour_type = chunk[9];
+				header.interlaced = chunk[12] == 1;
+				has_header = chunk[10] == 0 and chunk[11] == 0 and chunk[12] <= 1;
+			}
+			else if (type == "PLTE")
+			{
+				palette_size = std::min(length / 3, 256u);
+				for (auto i = 0u; i < palette_size; i++)
+				{
+					header.palette[i] = { chunk[i * 3], chunk[i * 3 + 1], chunk[i * 3 + 2], 255 };
+				}
+			}
+			else if (type == "tRNS" and header.colour_type == 3)
+			{
+				for (auto i = 0u; i < std::min(length, 256u); i++)
+				{
+					header.palette[i][3] = chunk[i];
+				}
+				header.palette_alpha = true;
+			}
+			else if (type == "tRNS" and header.colour_type == 0 and length >= 2)
+			{
+				auto grey = static_cast<uint16_t>(read_u16_be(chunk.data()));
+				header.colour_key = std::array{ grey, grey, grey };
+			}
+			else if (type == "tRNS" and header.colour_type == 2 and length >= 6)
+			{
+				header.colour_key = std::array{ static_cast<uint16_t>(read_u16_be(chunk.data())),
+				                                static_cast<uint16_t>(read_u16_be(chunk.data() + 2)),
+				                                static_cast<uint16_t>(read_u16_be(chunk.data() + 4)) };
+			}
+			else if (type == "IDAT")
+			{
+				compressed.insert(compressed.end(), chunk.begin(), chunk.end());
+			}
+			else if (type == "IEND")
+			{
+				has_end = true;
+			}
+		}
+
+		if (not has_header or not valid_depth(header.colour_type, header.depth)
+		    or header.width == 0 or header.height == 0 or header.width > max_image_size or header.height > max_image_size
+		    or (header.colour_type == 3 and palette_size == 0))
+		{
+			return std::nullopt;
+		}
+
+		// Adam7 passes, the whole image is one pass when it isn't interlaced
+		struct pass
+		{
+			uint32_t x, y, step_x, step_y;
+		};
+		constexpr auto adam7 = std::array<pass, 7>{ pass{ 0, 0, 8, 8 }, pass{ 4, 0, 8, 8 }, pass{ 0, 4, 4, 8 },
+		                                            pass{ 2, 0, 4, 4 }, pass{ 0, 2, 2, 4 }, pass{ 1, 0, 2, 2 },
+		                                            pass{ 0, 1, 1, 2 } };
+		constexpr auto whole = std::array{ pass{ 0, 0, 1, 1 } };
+		auto passes = header.interlaced ? std::span<const pass>(adam7) : std::span<const pass>(whole);
+
+		auto pass_size = [&](const pass &p)
+		{
+			auto width = header.width > p.x ? (header.width - p.x + p.step_x - 1) / p.step_x : 0u,
+			     height = header.height > p.y ? (header.height - p.y + p.step_y - 1) / p.step_y : 0u;
+			return std::pair{ width, height };
+		};
+
+		auto expected = std::size_t{};
+		for (auto &p : passes)
+		{
+			auto [width, height] = pass_size(p);
+			expected += width == 0 ? 0 : (png_row_size(header, width) + 1) * height;
+		}
+
+		auto raw = inflate(compressed, expected);
+		if (not raw or raw->size() < expected)
+		{
+			return std::nullopt;
+		}
+
+		auto texel_size = std::max(1u, png_channels(header.colour_type) * header.depth / 8);
+		auto has_alpha = header.colour_type == 4 or header.colour_type == 6 or header.colour_key or header.palette_alpha;
+		auto image = make_image(header.width, header.height, has_alpha);
+
+		auto rows = raw->data();
+		for (auto &p : passes)
+		{
+			auto [width, height] = pass_size(p);
+			if (width == 0 or height == 0)
+			{
+				continue;
+			}
+
+			auto row_size = png_row_size(header, width);
+			if (not unfilter(rows, height, row_size, texel_size))
+			{
+				return std::nullopt;
+			}
+
+			for_each_range(height, [&](uint32_t first, uint32_t last)
+			{
+				auto texels = std::vector<uint8_t>(std::size_t{ width } * 4);
+				for (auto y = first; y < last; y++)
+				{
+					auto row = rows + y * (row_size + 1) + 1;
+					auto dst = image_row(image, p.y + y * p.step_y);
+					if (p.step_x == 1)
+					{
+						png_to_rgba(header, row, width, dst);
+						continue;
+					}
+
+					png_to_rgba(header, row, width, texels.data());
+					for (auto x = 0u; x < width; x++)
+					{
+						std::memcpy(dst + (p.x + x * p.step_x) * 4, texels.data() + x * 4, 4);
+					}
+				}
+				return true;
+			});
+			rows += (row_size + 1) * height;
+		}
+		return image;
+	}
+#pragma endregion
+
+#pragma region TGA
+	struct tga_header
+	{
+		uint32_t id_length;
+		uint32_t map_type;
+		uint32_t image_type;   // 1 colour mapped, 2 true colour, 3 grey, +8 for RLE
+		uint32_t map_first;
+		uint32_t map_length;
+		uint32_t map_depth;
+		uint32_t width;
+		uint32_t height;
+		uint32_t depth;
+		uint32_t descriptor;   // bits 0-3 alpha bits, 4 right to left, 5 top to bottom
+	};
+
+	constexpr auto tga_header_size = 18u;
+
+	auto read_tga_header(std::span<const uint8_t> data) -> std::optional<tga_header>
+	{
+		if (data.size() < tga_header_size)
+		{
+			return std::nullopt;
+		}
+
+		auto p = data.data();
+		auto header = tga_header{ p[0], p[1], p[2], read_u16_le(p + 3), read_u16_le(p + 5), p[7],
+		                          read_u16_le(p + 12), read_u16_le(p + 14), p[16], p[17] };
+
+		auto base_type = header.image_type & ~8u;
+		auto valid_map = (header.map_type == 0 and header.map_length == 0) or (header.map_type == 1 and (header.map_depth == 15 or header.map_depth == 16
+		                                                                     or header.map_depth == 24 or header.map_depth == 32));
+		auto valid_depth = (base_type == 1 and header.map_type == 1 and (header.depth == 8 or header.depth == 16))
+		                or (base_type == 2 and (header.depth == 15 or header.depth == 16 or header.depth == 24 or header.depth == 32))
+		                or (base_type == 3 and (header.depth == 8 or header.depth == 16));
+		if (base_type < 1 or base_type > 3 or header.image_type > 11 or not valid_map or not valid_depth
+		    or header.width == 0 or header.height == 0 or header.width > max_image_size or header.height > max_image_size
+		    or (header.descriptor & 0xC0) != 0)
+		{
+			return std::nullopt;
+		}
+		return header;
+	}
+
+	// 15 and 16 bit texels are A1R5G5B5, little endian
+	void tga_16_to_rgba(const uint8_t *src, bool has_alpha, uint8_t *dst)
+	{
+		auto texel = read_u16_le(src);
+		auto expand = [](uint32_t five_bits)
+		{
+			return static_cast<uint8_t>((five_bits << 3) | (five_bits >> 2));
+		};
+		dst[0] = expand((texel >> 10) & 31);
+		dst[1] = expand((texel >> 5) & 31);
+		dst[2] = expand(texel & 31);
+		dst[3] = (not has_alpha or (texel & 0x8000)) ? 255 : 0;
+	}
+
+	auto decode_tga(std::span<const uint8_t> data) -> std::optional<decoded_image>
+	{
+		auto header = read_tga_header(data);
+		if (not header)
+		{
+			return std::nullopt;
+		}
+
+		auto texel_size = (header->depth + 7) / 8;
+		auto map_entry_size = (header->map_depth + 7) / 8;
+		auto position = std::size_t{ tga_header_size } + header->id_length;
+		auto map_size = std::size_t{ header->map_length } * map_entry_size;
+		if (position + map_size > data.size())
+		{
+			return std::nullopt;
+		}
+
+		auto alpha_bits = header->descriptor & 15;
+		auto base_type = header->image_type & ~8u;
+
+		// Colour map entries go to RGBA up front, indices then just copy them
+		auto palette = std::vector<std::array<uint8_t, 4>>(header->map_type == 1 ? header->map_first + header->map_length : 0);
+		for (auto i = 0u; i < header->map_length; i++)
+		{
+			auto entry = data.data() + position + std::size_t{ i } * map_entry_size;
+			auto &rgba = palette[header->map_first + i];
+			if (map_entry_size == 2)
+			{
+				tga_16_to_rgba(entry, alpha_bits > 0, rgba.data());
+			}
+			else
+			{
+				to_rgba(entry, 1, map_entry_size == 4 and alpha_bits > 0 ? texel_layout::bgra : texel_layout::bgr, rgba.data());
+			}
+		}
+		position += map_size;
+
+		// RLE packets can cross rows, so they are expanded first
+		auto texel_count = std::size_t{ header->width } * header->height;
+		auto pixels = data.subspan(position);
+		auto expanded = std::vector<uint8_t>{};
+		if (header->image_type & 8)
+		{
+			expanded.resize(texel_count * texel_size);
+			auto out = expanded.data(), end = expanded.data() + expanded.size();
+			auto in = std::size_t{};
+			while (out < end)
+			{
+				if (in >= pixels.size())
+				{
+					return std::nullopt;
+				}
+				auto packet = pixels[in++];
+				auto count = std::size_t{ (packet & 0x7Fu) + 1 } * texel_size;
+				auto run = (packet & 0x80) != 0;
+				auto read = run ? texel_size : count;
+				if (in + read > pixels.size() or out + count > end)
+				{
+					return std::nullopt;
+				}
+				std::memcpy(out, pixels.data() + in, read);
+				for (auto i = std::size_t{ read }; i < count; i += texel_size)
+				{
+					std::memcpy(out + i, out, texel_size);
+				}
+				in += read;
+				out += count;
+			}
+			pixels = expanded;
+		}
+		if (pixels.size() < texel_count * texel_size)
+		{
+			return std::nullopt;
+		}
+
+		// Without alpha bits a 32 bit texel's fourth byte is unused, not alpha
+		auto has_alpha = alpha_bits > 0 and (header->depth == 32 or header->depth == 16 or base_type == 1);
+		auto layout = texel_layout::bgr;
+		switch (header->depth)
+		{
+			case 8: layout = texel_layout::grey; break;
+			case 16: layout = texel_layout::grey_alpha; break;
+			case 32: layout = alpha_bits > 0 ? texel_layout::bgra : texel_layout::bgr; break;
+		}
+		if (base_type == 3)
+		{
+			has_alpha = header->depth == 16;
+		}
+
+		auto image = make_image(header->width, header->height, has_alpha);
+		auto bottom_up = (header->descriptor & 0x20) == 0,
+		     right_to_left = (header->descriptor & 0x10) != 0;
+		auto row_size = std::size_t{ header->width } * texel_size;
+		auto all_good = for_each_range(header->height, [&](uint32_t first, uint32_t last)
+		{
+			for (auto y = first; y < last; y++)
+			{
+				auto src = pixels.data() + (bottom_up ? header->height - 1 - y : y) * row_size;
+				auto dst = image_row(image, y);
+				if (base_type == 1)
+				{
+					for (auto x = 0u; x < header->width; x++)
+					{
+						auto index = texel_size == 1 ? src[x] : read_u16_le(src + x * 2);
+						if (index >= palette.size())
+						{
+							return false;
+						}
+						std::memcpy(dst + x * 4, palette[index].data(), 4);
+					}
+				}
+				else if (base_type == 2 and texel_size == 2)
+				{
+					for (auto x = 0u; x < header->width; x++)
+					{
+						tga_16_to_rgba(src + x * 2, has_alpha, dst + x * 4);
+					}
+				}
+				else if (layout == texel_layout::bgr and texel_size == 4)
+				{
+					// Fourth byte unused, shuffled as BGRA and made opaque
+					to_rgba(src, header->width, texel_layout::bgra, dst);
+					for (auto x = 0u; x < header->width; x++)
+					{
+						dst[x * 4 + 3] = 255;
+					}
+				}
+				else
+				{
+					to_rgba(src, header->width, layout, dst);
+				}
+
+				if (right_to_left)
+				{
+					auto texels = reinterpret_cast<uint32_t *>(dst);
+					std::reverse(texels, texels + header->width);
+				}
+			}
+			return true;
+		});
+
+		if (not all_good)
+		{
+			return std::nullopt;
+		}
+		return image;
+	}
+#pragma endregion
+
+#pragma region JPEG
+	constexpr auto zigzag = std::array<uint8_t, 64>{
+		0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+		12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+		35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+		58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63 };
+
+	// Entropy coded bits, most significant first, with stuffed zero bytes removed.
+	// Stops at a marker and gives zeros after it.
+	class msb_bit_reader
+	{
+	public:
+		msb_bit_reader(std::span<const uint8_t> data_, std::size_t position_) :
+			data{ data_ }, position{ position_ }
+		{}
+
+		auto peek(uint32_t count) -> uint32_t
+		{
+			refill();
+			return static_cast<uint32_t>(bits >> (64 - count));
+		}
+
+		void drop(uint32_t count)
+		{
+			bits <<= count;
+			bit_count -= count;
+		}
+
+		auto receive_bits(uint32_t count) -> uint32_t
+		{
+			if (count == 0)
+			{
+				return 0;
+			}
+			auto value = peek(count);
+			drop(count);
+			return value;
+		}
+
+		// Value of a coefficient's magnitude category, sign extended
+		auto receive_extend(uint32_t size) -> int
+		{
+			if (size == 0)
+			{
+				return 0;
+			}
+			auto value = static_cast<int>(receive_bits(size));
+			return value < (1 << (size - 1)) ? value - (1 << size) + 1 : value;
+		}
+
+		// Skips to after the next restart marker, false if another marker comes first
+		auto restart() -> bool
+		{
+			bits = 0;
+			bit_count = 0;
+			if (not marker_found)
+			{
+				while (position + 1 < data.size() and not (data[position] == 0xFF and data[position + 1] != 0 and data[position + 1] != 0xFF))
+				{
+					position++;
+				}
+				marker_found = position + 1 < data.size();
+			}
+
+			auto is_restart = marker_found and data[position + 1] >= 0xD0 and data[position + 1] <= 0xD7;
+			if (is_restart)
+			{
+				position += 2;
+				marker_found = false;
+			}
+			return is_restart;
+		}
+
+		// Where parsing markers carries on after the scan
+		auto marker_position() -> std::size_t
+		{
+			while (position + 1 < data.size() and not (data[position] == 0xFF and data[position + 1] != 0 and data[position + 1] != 0xFF))
+			{
+				position++;
+			}
+			return position;
+		}
+
+	private:
+		void refill()
+		{
+			while (bit_count <= 56)
+			{
+				auto byte = uint8_t{};
+				if (not marker_found and position < data.size())
+				{
+					byte = data[position];
+					if (byte != 0xFF)
+					{
+						position++;
+					}
+					else if (position + 1 < data.size() and data[position + 1] == 0)
+					{
+						position += 2;
+					}
+					else
+					{
+						marker_found = true;
+						byte = 0;
+					}
+				}
+				bits |= uint64_t{ byte } << (56 - bit_count);
+				bit_count += 8;
+			}
+		}
+
+		std::span<const uint8_t> data;
+		std::size_t position;
+		uint64_t bits{};
+		uint32_t bit_count{};
+		bool marker_found{};
+	};
+
+	class jpeg_huffman
+	{
+	public:
+		static constexpr auto fast_bits = 9u;
+
+		auto build(std::span<const uint8_t, 16> counts, std::span<const uint8_t> values_) -> bool
+		{
+			fast.fill(0);
+			std::copy(values_.begin(), values_.end(), values.begin());
+
+			auto code = 0u, index = 0u;
+			for (auto length = 1u; length <= 16; length++)
+			{
+				auto count = counts[length - 1];
+				first_index[length] = static_cast<int>(index) - static_cast<int>(code);
+				for (auto i = 0u; i < count; i++, code++, index++)
+				{
+					if (length <= fast_bits)
+					{
+						auto shift = fast_bits - length;
+						for (auto entry = code << shift; entry < (code + 1) << shift; entry++)
+						{
+							fast[entry] = static_cast<uint16_t>((values[index] << 8) | length);
+						}
+					}
+				}
+				max_code[length] = count == 0 ? -1 : static_cast<int>(code) - 1;
+				if (code > (1u << length))
+				{
+					return false;
+				}
+				code <<= 1;
+			}
+			return index <= values.size();
+		}
+
+		// -1 for a code that isn't in the table
+		auto decode(msb_bit_reader &reader) const -> int
+		{
+			auto entry = fast[reader.peek(fast_bits)];
+			if (entry != 0)
+			{
+				reader.drop(entry & 0xFF);
+				return entry >> 8;
+			}
+
+			for (auto length = fast_bits + 1; length <= 16; length++)
+			{
+				auto code = static_cast<int>(reader.peek(length));
+				if (code <= max_code[length])
+				{
+					reader.drop(length);
+					return values[first_index[length] + code];
+				}
+			}
+			return -1;
+		}
+
+	private:
+		std::array<uint16_t, 1 << fast_bits> fast{};
+		std::array<int, 17> max_code{};
+		std::array<int, 17> first_index{};
+		std::array<uint8_t, 256> values{};
+	};
+
+	struct jpeg_component
+	{
+		uint32_t id;
+		uint32_t h, v;           // sampling factors
+		uint32_t quant_table;
+		uint32_t dc_table, ac_table;
+		int dc_prediction;
+		uint32_t width, height;  // texels in this component, before upsampling
+		uint32_t stride;         // plane is whole MCUs of blocks, so stride / 8 blocks across
+		std::vector<int16_t> coefficients;   // 64 a block in natural order, quantised
+		std::vector<uint8_t> plane;
+	};
+
+	struct jpeg_state
+	{
+		uint32_t width, height;
+		uint32_t max_h, max_v;
+		uint32_t mcus_x, mcus_y;
+		uint32_t restart_interval;
+		bool progressive;
+		uint32_t eob_run;        // progressive AC scans, blocks left with nothing more in this band
+		std::array<std::array<uint16_t, 64>, 4> quant_tables;   // zigzag order
+		std::array<jpeg_huffman, 4> dc_tables, ac_tables;
+		std::vector<jpeg_component> components;
+		int adobe_transform = -1;
+	};
+
+	// Spectral band and successive approximation bits of a scan, all of a block at full precision for baseline
+	struct jpeg_scan
+	{
+		std::vector<uint32_t> components;
+		uint32_t start, end;
+		uint32_t high, low;
+	};
+
+	// Separable float IDCT, inverse of the JFIF forward DCT
+	const auto idct_table = []
+	{
+		auto table = std::array<float, 64>{};
+		for (auto x = 0; x < 8; x++)
+		{
+			for (auto u = 0; u < 8; u++)
+			{
+				auto scale = u == 0 ? 0.35355339f : 0.5f;
+				table[x * 8 + u] = scale * static_cast<float>(std::cos((2 * x + 1) * u * 3.14159265358979 / 16));
+			}
+		}
+		return table;
+	}();
+
+	void idct_block(const int16_t *coefficients, const std::array<uint16_t, 64> &quant, uint8_t *dst, uint32_t stride)
+	{
+		auto dequantised = std::array<float, 64>{};
+		for (auto k = 0u; k < 64; k++)
+		{
+			dequantised[zigzag[k]] = static_cast<float>(coefficients[zigzag[k]] * quant[k]);
+		}
+
+		auto rows = std::array<float, 64>{};
+		for (auto y = 0; y < 8; y++)
+		{
+			auto in = &dequantised[y * 8];
+			auto out = &rows[y * 8];
+			if (in[1] == 0 and in[2] == 0 and in[3] == 0 and in[4] == 0 and in[5] == 0 and in[6] == 0 and in[7] == 0)
+			{
+				std::fill_n(out, 8, in[0] * idct_table[0]);
+				continue;
+			}
+			for (auto x = 0; x < 8; x++)
+			{
+				auto sum = 0.0f;
+				for (auto u = 0; u < 8; u++)
+				{
+					sum += idct_table[x * 8 + u] * in[u];
+				}
+				out[x] = sum;
+			}
+		}
+
+		for (auto x = 0; x < 8; x++)
+		{
+			for (auto y = 0; y < 8; y++)
+			{
+				auto sum = 0.0f;
+				for (auto v = 0; v < 8; v++)
+				{
+					sum += idct_table[y * 8 + v] * rows[v * 8 + x];
+				}
+				auto value = static_cast<int>(std::lround(sum)) + 128;
+				dst[y * stride + x] = static_cast<uint8_t>(std::clamp(value, 0, 255));
+			}
+		}
+	}
+
+	auto decode_dc(msb_bit_reader &reader, const jpeg_state &state, jpeg_component &component, const jpeg_scan &scan,
+	               int16_t *block) -> bool
+	{
+		if (scan.high > 0)
+		{
+			block[0] = static_cast<int16_t>(block[0] | (reader.receive_bits(1) << scan.low));
+			return true;
+		}
+
+		auto size = state.dc_tables[component.dc_table].decode(reader);
+		if (size < 0 or size > 11)
+		{
+			return false;
+		}
+		component.dc_prediction += reader.receive_extend(size);
+		block[0] = static_cast<int16_t>(component.dc_prediction * (1 << scan.low));
+		return true;
+	}
+
+	// Baseline blocks and the first scan of a progressive band
+	auto decode_ac(msb_bit_reader &reader, jpeg_state &state, const jpeg_component &component, const jpeg_scan &scan,
+	               int16_t *block) -> bool
+	{
+		if (state.eob_run > 0)
+		{
+			state.eob_run--;
+			return true;
+		}
+
+		auto &table = state.ac_tables[component.ac_table];
+		for (auto k = scan.start; k <= scan.end;)
+		{
+			auto symbol = table.decode(reader);
+			if (symbol < 0)
+			{
+				return false;
+			}
+			auto run = static_cast<uint32_t>(symbol) >> 4, size = static_cast<uint32_t>(symbol) & 15;
+			if (size == 0)
+			{
+				if (run != 15)
+				{
+					state.eob_run = (1u << run) - 1 + reader.receive_bits(run);
+					break;
+				}
+				k += 16;
+				continue;
+			}
+			k += run;
+			if (k > scan.end)
+			{
+				return false;
+			}
+			block[zigzag[k]] = static_cast<int16_t>(reader.receive_extend(size) * (1 << scan.low));
+			k++;
+		}
+		return true;
+	}
+
+	// Later scans of a progressive band, a bit more of each coefficient already there and new ones of +-1
+	auto refine_ac(msb_bit_reader &reader, jpeg_state &state, const jpeg_component &component, const jpeg_scan &scan,
+	               int16_t *block) -> bool
+	{
+		auto bit = 1 << scan.low;
+		auto refine = [&](int16_t &coefficient)
+		{
+			if (reader.receive_bits(1) and (coefficient & bit) == 0)
+			{
+				coefficient = static_cast<int16_t>(coefficient + (coefficient > 0 ? bit : -bit));
+			}
+		};
+
+		auto k = scan.start;
+		if (state.eob_run == 0)
+		{
+			auto &table = state.ac_tables[component.ac_table];
+			while (k <= scan.end)
+			{
+				auto symbol = table.decode(reader);
+				if (symbol < 0)
+				{
+					return false;
+				}
+				auto zeros = static_cast<uint32_t>(symbol) >> 4, size = static_cast<uint32_t>(symbol) & 15;
+				auto value = 0;
+				if (size == 0 and zeros != 15)
+				{
+					state.eob_run = (1u << zeros) + reader.receive_bits(zeros);
+					break;
+				}
+				if (size != 0)
+				{
+					value = reader.receive_bits(1) ? bit : -bit;
+				}
+
+				// Skip that many coefficients still zero, refining the others on the way
+				for (; k <= scan.end; k++)
+				{
+					auto &coefficient = block[zigzag[k]];
+					if (coefficient != 0)
+					{
+						refine(coefficient);
+					}
+					else if (zeros == 0)
+					{
+						coefficient = static_cast<int16_t>(value);
+						k++;
+						break;
+					}
+					else
+					{
+						zeros--;
+					}
+				}
+			}
+			if (state.eob_run == 0)
+			{
+				return true;
+			}
+		}
+
+		// Rest of the band has no new coefficients
+		for (; k <= scan.end; k++)
+		{
+			if (block[zigzag[k]] != 0)
+			{
+				refine(block[zigzag[k]]);
+			}
+		}
+		state.eob_run--;
+		return true;
+	}
+
+	auto decode_block(msb_bit_reader &reader, jpeg_state &state, jpeg_component &component, const jpeg_scan &scan,
+	                  int16_t *block) -> bool
+	{
+		if (scan.start == 0 and not decode_dc(reader, state, component, scan, block))
+		{
+			return false;
+		}
+
+		auto ac_scan = scan;
+		ac_scan.start = std::max(scan.start, 1u);
+		if (ac_scan.start > scan.end)
+		{
+			return true;
+		}
+		return scan.high == 0 ? decode_ac(reader, state, component, ac_scan, block)
+		                      : refine_ac(reader, state, component, ac_scan, block);
+	}
+
+	auto decode_scan(std::span<const uint8_t> data, std::size_t &position, jpeg_state &state, const jpeg_scan &scan) -> bool
+	{
+		auto reset = [&]
+		{
+			state.eob_run = 0;
+			for (auto c : scan.components)
+			{
+				state.components[c].dc_prediction = 0;
+			}
+		};
+		reset();
+
+		// One component alone is coded in its own blocks, not in MCUs
+		auto single = scan.components.size() == 1;
+		auto &first = state.components[scan.components.front()];
+		auto units_x = single ? (first.width + 7) / 8 : state.mcus_x,
+		     units_y = single ? (first.height + 7) / 8 : state.mcus_y;
+
+		auto reader = msb_bit_reader(data, position);
+		auto unit_count = units_x * units_y;
+		for (auto unit = 0u; unit < unit_count; unit++)
+		{
+			if (state.restart_interval > 0 and unit > 0 and unit % state.restart_interval == 0)
+			{
+				if (not reader.restart())
+				{
+					return false;
+				}
+				reset();
+			}
+
+			auto unit_x = unit % units_x, unit_y = unit / units_x;
+			for (auto c : scan.components)
+			{
+				auto &component = state.components[c];
+				auto blocks_x = single ? 1 : component.h,
+				     blocks_y = single ? 1 : component.v;
+				for (auto by = 0u; by < blocks_y; by++)
+				{
+					for (auto bx = 0u; bx < blocks_x; bx++)
+					{
+						auto x = unit_x * blocks_x + bx, y = unit_y * blocks_y + by;
+						auto block = component.coefficients.data() + (std::size_t{ y } * (component.stride / 8) + x) * 64;
+						if (not decode_block(reader, state, component, scan, block))
+						{
+							return false;
+						}
+					}
+				}
+			}
+		}
+
+		position = reader.marker_position();
+		return true;
+	}
+
+	// Once every scan is in, blocks to texels a row of blocks at a time over the hardware threads
+	void decode_planes(jpeg_state &state)
+	{
+		for (auto &component : state.components)
+		{
+			auto &quant = state.quant_tables[component.quant_table];
+			auto blocks_x = component.stride / 8,
+			     blocks_y = static_cast<uint32_t>(component.plane.size() / component.stride / 8);
+			for_each_range(blocks_y, [&](uint32_t first, uint32_t last)
+			{
+				for (auto y = first; y < last; y++)
+				{
+					for (auto x = 0u; x < blocks_x; x++)
+					{
+						auto block = component.coefficients.data() + (std::size_t{ y } * blocks_x + x) * 64;
+						auto dst = component.plane.data() + std::size_t{ y } * 8 * component.stride + x * 8;
+						idct_block(block, quant, dst, component.stride);
+					}
+				}
+				return true;
+			});
+			component.coefficients = {};
+		}
+	}
+
+	// Row y of a component at full resolution, chroma upsampled the way libjpeg's fancy upsampling does
+	void upsample_row(const jpeg_state &state, const jpeg_component &component, uint32_t y, uint8_t *dst)
+	{
+		auto scale_x = state.max_h / component.h, scale_y = state.max_v / component.v;
+		auto plane_row = [&](int row)
+		{
+			row = std::clamp(row, 0, static_cast<int>(component.height) - 1);
+			return component.plane.data() + std::size_t(row) * component.stride;
+		};
+
+		if (scale_x == 1 and scale_y == 1)
+		{
+			std::memcpy(dst, plane_row(y), state.width);
+			return;
+		}
+
+		auto width = static_cast<int>(component.width);
+		if (scale_x == 2 and scale_y == 1)
+		{
+			auto in = plane_row(y);
+			for (auto x = 0; x < width; x++)
+			{
+				auto left = in[std::max(x - 1, 0)] , right = in[std::min(x + 1, width - 1)];
+				auto even = x == 0 ? in[x] : (in[x] * 3 + left + 1) >> 2;
+				auto odd = x == width - 1 ? in[x] : (in[x] * 3 + right + 2) >> 2;
+				dst[2 * x] = static_cast<uint8_t>(even);
+				if (2 * x + 1 < static_cast<int>(state.width))
+				{
+					dst[2 * x + 1] = static_cast<uint8_t>(odd);
+				}
+			}
+			return;
+		}
+
+		if (scale_x == 1 and scale_y == 2)
+		{
+			auto row = static_cast<int>(y / 2);
+			auto near = plane_row(row), far = plane_row(y % 2 == 0 ? row - 1 : row + 1);
+			auto bias = y % 2 == 0 ? 1 : 2;
+			for (auto x = 0u; x < state.width; x++)
+			{
+				dst[x] = static_cast<uint8_t>((near[x] * 3 + far[x] + bias) >> 2);
+			}
+			return;
+		}
+
+		if (scale_x == 2 and scale_y == 2)
+		{
+			// Nearer row weighs 3, the other 1, then the same across
+			auto row = static_cast<int>(y / 2);
+			auto near = plane_row(row), far = plane_row(y % 2 == 0 ? row - 1 : row + 1);
+			auto column = [&](int x)
+			{
+				return near[x] * 3 + far[x];
+			};
+			for (auto x = 0; x < width; x++)
+			{
+				auto sum = column(x);
+				auto even = x == 0 ? (sum * 4 + 8) >> 4 : (sum * 3 + column(x - 1) + 8) >> 4;
+				auto odd = x == width - 1 ? (sum * 4 + 7) >> 4 : (sum * 3 + column(x + 1) + 7) >> 4;
+				dst[2 * x] = static_cast<uint8_t>(even);
+				if (2 * x + 1 < static_cast<int>(state.width))
+				{
+					dst[2 * x + 1] = static_cast<uint8_t>(odd);
+				}
+			}
+			return;
+		}
+
+		auto in = plane_row(y / scale_y);
+		for (auto x = 0u; x < state.width; x++)
+		{
+			dst[x] = in[x / scale_x];
+		}
+	}
+
+	// JFIF YCbCr to RGB in 16.16 fixed point, rounded the same way as libjpeg
+	void ycbcr_to_rgba(const uint8_t *y_row, const uint8_t *cb_row, const uint8_t *cr_row, uint32_t count, uint8_t *dst)
+	{
+		constexpr auto one_half = 1 << 15;
+		constexpr auto fix = [](double value)
+		{
+			return static_cast<int>(value * 65536 + 0.5);
+		};
+		for (auto x = 0u; x < count; x++, dst += 4)
+		{
+			auto y = static_cast<int>(y_row[x]), cb = cb_row[x] - 128, cr = cr_row[x] - 128;
+			auto r = y + ((fix(1.40200) * cr + one_half) >> 16);
+			auto g = y + ((-fix(0.34414) * cb - fix(0.71414) * cr + one_half) >> 16);
+			auto b = y + ((fix(1.77200) * cb + one_half) >> 16);
+			dst[0] = static_cast<uint8_t>(std::clamp(r, 0, 255));
+			dst[1] = static_cast<uint8_t>(std::clamp(g, 0, 255));
+			dst[2] = static_cast<uint8_t>(std::clamp(b, 0, 255));
+			dst[3] = 255;
+		}
+	}
+
+	auto read_frame(std::span<const uint8_t> segment, jpeg_state &state) -> bool
+	{
+		if (segment.size() < 6 or segment[0] != 8)
+		{
+			return false;
+		}
+		state.height = read_u16_be(segment.data() + 1);
+		state.width = read_u16_be(segment.data() + 3);
+		auto count = segment[5];
+		if ((count != 1 and count != 3) or segment.size() < 6u + count * 3
+		    or state.width == 0 or state.height == 0 or state.width > max_image_size or state.height > max_image_size)
+		{
+			return false;
+		}
+
+		state.max_h = state.max_v = 1;
+		for (auto i = 0u; i < count; i++)
+		{
+			auto p = segment.data() + 6 + i * 3;
+			auto component = jpeg_component{ p[0], uint32_t{ p[1] } >> 4, p[1] & 15u, p[2], 0, 0, 0, 0, 0, 0, {}, {} };
+			if (component.h < 1 or component.h > 4 or component.v < 1 or component.v > 4 or component.quant_table > 3)
+			{
+				return false;
+			}
+			state.max_h = std::max(state.max_h, component.h);
+			state.max_v = std::max(state.max_v, component.v);
+			state.components.push_back(component);
+		}
+
+		state.mcus_x = (state.width + 8 * state.max_h - 1) / (8 * state.max_h);
+		state.mcus_y = (state.height + 8 * state.max_v - 1) / (8 * state.max_v);
+		for (auto &component : state.components)
+		{
+			if (state.max_h % component.h != 0 or state.max_v % component.v != 0)
+			{
+				return false;
+			}
+			component.width = (state.width * component.h + state.max_h - 1) / state.max_h;
+			component.height = (state.height * component.v + state.max_v - 1) / state.max_v;
+			component.stride = state.mcus_x * component.h * 8;
+			component.plane.resize(std::size_t{ component.stride } * state.mcus_y * component.v * 8);
+			component.coefficients.resize(component.plane.size());
+		}
+		return true;
+	}
+
+	auto read_tables(std::span<const uint8_t> segment, uint32_t marker, jpeg_state &state) -> bool
+	{
+		auto position = std::size_t{};
+		while (position < segment.size())
+		{
+			auto type = uint32_t{ segment[position] } >> 4, id = segment[position] & 15u;
+			position++;
+			if (id > 3)
+			{
+				return false;
+			}
+
+			if (marker == 0xDB)
+			{
+				auto size = type == 0 ? 64u : 128u;
+				if (type > 1 or position + size > segment.size())
+				{
+					return false;
+				}
+				for (auto k = 0u; k < 64; k++)
+				{
+					auto value = type == 0 ? segment[position + k] : read_u16_be(segment.data() + position + k * 2);
+					state.quant_tables[id][k] = static_cast<uint16_t>(value);
+				}
+				position += size;
+				continue;
+			}
+
+			if (type > 1 or position + 16 > segment.size())
+			{
+				return false;
+			}
+			auto counts = segment.subspan(position, 16);
+			auto total = std::size_t{};
+			for (auto count : counts)
+			{
+				total += count;
+			}
+			position += 16;
+			if (total > 256 or position + total > segment.size())
+			{
+				return false;
+			}
+
+			auto &table = type == 0 ? state.dc_tables[id] : state.ac_tables[id];
+			if (not table.build(counts.first<16>(), segment.subspan(position, total)))
+			{
+				return false;
+			}
+			position += total;
+		}
+		return true;
+	}
+
+	auto decode_jpeg(std::span<const uint8_t> data) -> std::optional<decoded_image>
+	{
+		auto state = jpeg_state{};
+		auto has_frame = false, has_scan = false;
+
+		auto position = std::size_t{ 2 };
+		while (position + 4 <= data.size())
+		{
+			if (data[position] != 0xFF)
+			{
+				return std::nullopt;
+			}
+			auto marker = data[position + 1];
+			if (marker == 0xFF)
+			{
+				position++;
+				continue;
+			}
+			if (marker == 0xD9)
+			{
+				break;
+			}
+
+			auto length = read_u16_be(data.data() + position + 2);
+			if (length < 2 or position + 2 + length > data.size())
+			{
+				return std::nullopt;
+			}
+			auto segment = data.subspan(position + 4, length - 2);
+			position += 2 + length;
+
+			auto good = true;
+			switch (marker)
+			{
+				case 0xC0:
+				case 0xC1:
+				case 0xC2:
+					good = not has_frame and read_frame(segment, state);
+					state.progressive = marker == 0xC2;
+					has_frame = true;
+					break;
+				case 0xC3: case 0xC5: case 0xC6: case 0xC7:
+				case 0xC9: case 0xCA: case 0xCB: case 0xCD: case 0xCE: case 0xCF:
+					return std::nullopt;   // lossless, hierarchical or arithmetic coded
+				case 0xC4:
+				case 0xDB:
+					good = read_tables(segment, marker, state);
+					break;
+				case 0xDD:
+					good = segment.size() >= 2;
+					state.restart_interval = good ? read_u16_be(segment.data()) : 0;
+					break;
+				case 0xEE:
+					if (segment.size() >= 12 and std::memcmp(segment.data(), "Adobe", 5) == 0)
+					{
+						state.adobe_transform = segment[11];
+					}
+					break;
+				case 0xDA:
+				{
+					auto count = segment.empty() ? 0u : segment[0];
+					good = has_frame and count >= 1 and count <= state.components.size() and segment.size() >= 4u + count * 2;
+					auto scan = jpeg_scan{ {}, 0, 63, 0, 0 };
+					if (good and state.progressive)
+					{
+						auto bands = segment.subspan(1 + count * 2);
+						scan = { {}, bands[0], bands[1], uint32_t{ bands[2] } >> 4, bands[2] & 15u };
+						good = scan.start <= scan.end and scan.end < 64 and scan.low < 14
+						   and (scan.start == 0) == (scan.end == 0) and (scan.start == 0 or count == 1);
+					}
+					for (auto i = 0u; good and i < count; i++)
+					{
+						auto id = segment[1 + i * 2], tables = segment[2 + i * 2];
+						auto found = std::find_if(state.components.begin(), state.components.end(), [&](const jpeg_component &c)
+						{
+							return c.id == id;
+						});
+						good = found != state.components.end() and (tables >> 4) < 4 and (tables & 15) < 4;
+						if (good)
+						{
+							found->dc_table = uint32_t{ tables } >> 4;
+							found->ac_table = tables & 15u;
+							scan.components.push_back(static_cast<uint32_t>(found - state.components.begin()));
+						}
+					}
+					good = good and decode_scan(data, position, state, scan);
+					has_scan = true;
+					break;
+				}
+			}
+			if (not good)
+			{
+				return std::nullopt;
+			}
+		}
+
+		if (not has_frame or not has_scan)
+		{
+			return std::nullopt;
+		}
+
+		decode_planes(state);
+
+		// Adobe's transform flag or R, G, B component ids say the three components aren't YCbCr
+		auto &components = state.components;
+		auto is_rgb = components.size() == 3
+		          and (state.adobe_transform == 0
+		               or (state.adobe_transform < 0 and components[0].id == 'R' and components[1].id == 'G' and components[2].id == 'B'));
+
+		auto image = make_image(state.width, state.height, false);
+		for_each_range(state.height, [&](uint32_t first, uint32_t last)
+		{
+			auto rows = std::vector<uint8_t>(std::size_t{ state.width + 1 } * components.size());
+			auto row = [&](std::size_t c)
+			{
+				return rows.data() + c * (state.width + 1);
+			};
+			auto interleaved = std::vector<uint8_t>(std::size_t{ state.width } * 3);
+			for (auto y = first; y < last; y++)
+			{
+				for (auto c = 0u; c < components.size(); c++)
+				{
+					upsample_row(state, components[c], y, row(c));
+				}
+
+				auto dst = image_row(image, y);
+				if (components.size() == 1)
+				{
+					to_rgba(row(0), state.width, texel_layout::grey, dst);
+				}
+				else if (is_rgb)
+				{
+					for (auto x = 0u; x < state.width; x++)
+					{
+						interleaved[x * 3] = row(0)[x];
+						interleaved[x * 3 + 1] = row(1)[x];
+						interleaved[x * 3 + 2] = row(2)[x];
+					}
+					to_rgba(interleaved.data(), state.width, texel_layout::rgb, dst);
+				}
+				else
+				{
+					ycbcr_to_rgba(row(0), row(1), row(2), state.width, dst);
+				}
+			}
+			return true;
+		});
+		return image;
+	}
+#pragma endregion
+}
+
+auto dx11_lessons::find_image_format(std::span<const std::byte> file_data) -> std::optional<image_file_format>
+{
+	auto data = as_bytes(file_data);
+	if (data.size() >= png_signature.size() and std::equal(png_signature.begin(), png_signature.end(), data.begin()))
+	{
+		return image_file_format::png;
+	}
+	if (data.size() >= 3 and data[0] == 0xFF and data[1] == 0xD8 and data[2] == 0xFF)
+	{
+		return image_file_format::jpeg;
+	}
+	if (data.size() >= 4 and std::memcmp(data.data(), "DDS ", 4) == 0)
+	{
+		return std::nullopt;
+	}
+	if (read_tga_header(data))
+	{
+		return image_file_format::tga;
+	}
+	return std::nullopt;
+}
+
+auto dx11_lessons::decode_image(std::span<const std::byte> file_data) -> std::optional<decoded_image>
+{
+	auto format = find_image_format(file_data);
+	if (not format)
+	{
+		return std::nullopt;
+	}
+
+	auto data = as_bytes(file_data);
+	switch (*format)
+	{
+		case image_file_format::png: return decode_png(data);
+		case image_file_format::tga: return decode_tga(data);
+		case image_file_format::jpeg: return decode_jpeg(data);
+	}
+	return std::nullopt;
+}
+
+auto dx11_lessons::decode_images(std::span<const std::span<const std::byte>> files) -> std::vector<std::optional<decoded_image>>
+{
+	auto images = std::vector<std::optional<decoded_image>>(files.size());
+	for_each_range(static_cast<uint32_t>(files.size()), [&](uint32_t first, uint32_t last)
+	{
+		for (auto i = first; i < last; i++)
+		{
+			images[i] = decode_image(files[i]);
+		}
+		return true;
+	});
+	return images;
+}
+
+auto dx11_lessons::image_texture(const decoded_image &image, bool srgb) -> dds_texture
+{
+	return {
+		srgb ? dxgi_format::r8g8b8a8_unorm_srgb : dxgi_format::r8g8b8a8_unorm,
+		image.width, image.height, 1, 1, false,
+		image.texels
+	};
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "dds_file.h"
+
+#include <span>
+#include <vector>
+#include <optional>
+#include <cstddef>
+#include <cstdint>
+
+namespace dx11_lessons
+{
+	enum class image_file_format
+	{
+		png,
+		tga,
+		jpeg,
+	};
+
+	struct decoded_image
+	{
+		uint32_t width;
+		uint32_t height;
+		bool has_alpha;                  // false when the file has no alpha and every texel is opaque
+		std::vector<std::byte> texels;   // RGBA8, top row first
+	};
+
+	// PNG and JPEG by their signature, TGA by a header that makes sense as it has none.
+	// nullopt for anything else, DDS included.
+	auto find_image_format(std::span<const std::byte> file_data) -> std::optional<image_file_format>;
+
+	// PNG: every colour type and bit depth, interlaced or not. TGA: true colour, grey and colour mapped, raw or RLE.
+	// JPEG: baseline, extended and progressive Huffman, grey or YCbCr with any subsampling, chroma upsampled like libjpeg.
+	// Arithmetic coded and CMYK JPEGs, images larger than D3D11 allows, and damaged files are nullopt.
+	// Rows go to RGBA over the hardware threads, 4 texels at a time with SSSE3 shuffles where the compiler allows them.
+	auto decode_image(std::span<const std::byte> file_data) -> std::optional<decoded_image>;
+
+	// Files are spread over the hardware threads, results are in the same order
+	auto decode_images(std::span<const std::span<const std::byte>> files) -> std::vector<std::optional<decoded_image>>;
+
+	// Mip 0 of a 2D texture over image.texels. _srgb for colour, so mips and sampling are in linear light,
+	// plain unorm for data such as normal maps.
+	auto image_texture(const decoded_image &image, bool srgb) -> dds_texture;
+}
@@ -0,0 +1,184 @@
+#include "job_system.h"
+
+#include <limits>
+#include <cassert>
+
+using namespace dx11_lessons;
+
+namespace
+{
+	constexpr auto no_worker = std::numeric_limits<uint32_t>::max();
+
+	// Which system's worker this thread is, jobs it runs push to its own deque
+	thread_local const job_system *current_system = nullptr;
+	thread_local auto current_worker = no_worker;
+}
+
+task_group::~task_group()
+{
+	assert(is_done());
+}
+
+auto task_group::is_done() const -> bool
+{
+	return pending_count.load(std::memory_order_acquire) == 0;
+}
+
+auto task_group::pending() const -> uint32_t
+{
+	return pending_count.load(std::memory_order_acquire);
+}
+
+job_system::job_system(uint32_t worker_count_)
+{
+	// One deque even without workers, so waiting threads still have somewhere to take jobs from
+	for (auto i = 0u; i < std::max(worker_count_, 1u); i++)
+	{
+		queues.push_back(std::make_unique<worker_queue>());
+	}
+	for (auto i = 0u; i < worker_count_; i++)
+	{
+		workers.emplace_back(&job_system::worker_loop, this, i);
+	}
+}
+
+job_system::~job_system()
+{
+	wait(detached);
+	{
+		auto lock = std::lock_guard{ sleep_mutex };
+		stopping = true;
+	}
+	wake.notify_all();
+	for (auto &w : workers)
+	{
+		w.join();
+	}
+}
+
+void job_system::run(task_group &group, job_fn job)
+{
+	group.pending_count.fetch_add(1, std::memory_order_relaxed);
+
+	// Workers keep their jobs to themselves until stolen, anyone else spreads them round
+	auto index = (current_system == this) ? current_worker
+	                                      : next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+	{
+		auto &queue = *queues[index];
+		auto lock = std::lock_guard{ queue.mutex };
+		queue.jobs.push_back({ std::move(job), &group });
+	}
+	queued.fetch_add(1, std::memory_order_release);
+
+	// Taking the lock orders this against a worker checking queued before it sleeps
+	{
+		auto lock = std::lock_guard{ sleep_mutex };
+	}
+	wake.notify_one();
+}
+
+void job_system::run(job_fn job)
+{
+	run(detached, std::move(job));
+}
+
+void job_system::wait(task_group &group)
+{
+	auto self = (current_system == this) ? current_worker : no_worker;
+	while (not group.is_done())
+	{
+		if (not try_run_one(self))
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+auto job_system::worker_count() const -> uint32_t
+{
+	return static_cast<uint32_t>(workers.size());
+}
+
+auto job_system::shared() -> job_system &
+{
+	static auto system = job_system(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+	return system;
+}
+
+void job_system::worker_loop(uint32_t index)
+{
+	current_system = this;
+	current_worker = index;
+
+	while (true)
+	{
+		if (try_run_one(index))
+		{
+			continue;
+		}
+
+		auto lock = std::unique_lock{ sleep_mutex };
+		wake.wait(lock, [&]
+		{
+			return queued.load(std::memory_order_acquire) > 0 or stopping;
+		});
+		if (stopping and queued.load(std::memory_order_acquire) == 0)
+		{
+			return;
+		}
+	}
+}
+
+// Own newest job first, it's likely still in cache, then the oldest of another deque, that's usually the largest
+auto job_system::take_job(uint32_t self) -> std::optional<job>
+{
+	auto count = static_cast<uint32_t>(queues.size());
+	if (self != no_worker)
+	{
+		auto &queue = *queues[self];
+		auto lock = std::lock_guard{ queue.mutex };
+		if (not queue.jobs.empty())
+		{
+			auto taken = std::move(queue.jobs.back());
+			queue.jobs.pop_back();
+			return taken;
+		}
+	}
+
+	auto start = (self != no_worker) ? self + 1 : next_queue.load(std::memory_order_relaxed);
+	for (auto i = 0u; i < count; i++)
+	{
+		auto &queue = *queues[(start + i) % count];
+		auto lock = std::lock_guard{ queue.mutex };
+		if (not queue.jobs.empty())
+		{
+			auto taken = std::move(queue.jobs.front());
+			queue.jobs.pop_front();
+			return taken;
+		}
+	}
+	return std::nullopt;
+}
+
+auto job_system::try_run_one(uint32_t self) -> bool
+{
+	if (queued.load(std::memory_order_acquire) == 0)
+	{
+		return false;
+	}
+
+	auto taken = take_job(self);
+	if (not taken)
+	{
+		return false;
+	}
+	queued.fetch_sub(1, std::memory_order_relaxed);
+
+	// The job's captures go before its group can finish, a waiter may free what they point to once it has
+	{
+		auto fn = std::move(taken->fn);
+		fn();
+	}
+	taken->group->pending_count.fetch_sub(1, std::memory_order_release);
+	return true;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+namespace dx11_lessons
+{
+	// Jobs still to finish, a job can add more to its own group before it returns
+	class task_group
+	{
+	public:
+		task_group() = default;
+		task_group(const task_group &) = delete;
+		auto operator=(const task_group &) -> task_group & = delete;
+		~task_group();
+
+		auto is_done() const -> bool;
+		auto pending() const -> uint32_t;
+
+	private:
+		friend class job_system;
+		std::atomic<uint32_t> pending_count{};
+	};
+
+	// Fixed set of worker threads, each with its own deque of jobs. Workers run their newest job first and,
+	// when out of work, steal the oldest job of another worker. Threads waiting on a group run jobs instead
+	// of blocking, so waits inside jobs (nested parallel_for) can't deadlock. Jobs must not throw.
+	class job_system
+	{
+	public:
+		using job_fn = std::function<void()>;
+
+		job_system() = delete;
+		explicit job_system(uint32_t worker_count_);
+		~job_system();   // runs what's queued, then joins
+
+		void run(task_group &group, job_fn job);
+		void wait(task_group &group);
+
+		// A job no one waits on, e.g. resuming a coroutine. It's run before the system is destroyed.
+		void run(job_fn job);
+
+		auto worker_count() const -> uint32_t;
+
+		// Splits [0, count) into ranges of grain and calls fn(first, last) for each, the first on the calling thread.
+		// Returns once every range is done.
+		template <typename fn_t>
+		void parallel_for(uint32_t count, uint32_t grain, fn_t fn)
+		{
+			grain = std::max(grain, 1u);
+			auto group = task_group{};
+			for (auto first = grain; first < count; first += grain)
+			{
+				run(group, [&fn, first, last = std::min(count - first, grain) + first]
+				{
+					fn(first, last);
+				});
+			}
+			if (count > 0)
+			{
+				fn(0u, std::min(grain, count));
+			}
+			wait(group);
+		}
+
+		// Shared by the whole process, a worker per hardware thread less one, as the thread waiting helps
+		static auto shared() -> job_system &;
+
+	private:
+		struct job
+		{
+			job_fn fn;
+			task_group *group;
+		};
+
+		struct worker_queue
+		{
+			std::mutex mutex;
+			std::deque<job> jobs;
+		};
+
+		void worker_loop(uint32_t index);
+		auto take_job(uint32_t self) -> std::optional<job>;
+		auto try_run_one(uint32_t self) -> bool;
+
+	private:
+		std::vector<std::unique_ptr<worker_queue>> queues;
+		std::vector<std::thread> workers;
+		task_group detached{};
+
+		std::atomic<uint32_t> queued{};
+		std::atomic<uint32_t> next_queue{};
+		std::atomic<bool> stopping{ false };
+
+		std::mutex sleep_mutex;
+		std::condition_variable wake;
+	};
+}
@@ -0,0 +1,281 @@
+#include "load_graph.h"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <array>
+#include <unordered_map>
+#include <cassert>
+
+using namespace dx11_lessons;
+
+namespace
+{
+	enum class visit : uint8_t
+	{
+		not_seen,
+		in_progress,
+		finished,
+	};
+
+	constexpr auto error_names = std::array{ "duplicate name", "unknown input", "cycle" };
+}
+
+load_graph::~load_graph()
+{
+	if (jobs != nullptr)
+	{
+		jobs->wait(group);
+	}
+}
+
+auto load_graph::add(std::string_view name, std::vector<std::string> inputs, node_fn fn) -> node_id
+{
+	assert(jobs == nullptr);
+
+	auto n = std::make_unique<node>();
+	n->name = name;
+	n->input_names = std::move(inputs);
+	n->fn = std::move(fn);
+	nodes.push_back(std::move(n));
+	return static_cast<node_id>(nodes.size() - 1);
+}
+
+auto load_graph::validate() const -> std::optional<load_graph_error>
+{
+	auto inputs = std::vector<std::vector<node_id>>{};
+	auto sorted = std::vector<node_id>{};
+	return resolve(inputs, sorted);
+}
+
+auto load_graph::start(job_system &jobs_) -> std::optional<load_graph_error>
+{
+	assert(jobs == nullptr);
+
+	auto inputs = std::vector<std::vector<node_id>>{};
+	auto error = resolve(inputs, order);
+	if (error)
+	{
+		return error;
+	}
+
+	for (auto id = 0u; id < nodes.size(); id++)
+	{
+		auto &n = *nodes[id];
+		n.inputs = std::move(inputs[id]);
+		n.inputs_left = static_cast<uint32_t>(n.inputs.size());
+		for (auto input : n.inputs)
+		{
+			nodes[input]->dependents.push_back(id);
+		}
+	}
+
+	jobs = &jobs_;
+	start_time = clock::now();
+	for (auto id = 0u; id < nodes.size(); id++)
+	{
+		if (nodes[id]->inputs.empty())
+		{
+			queue(id);
+		}
+	}
+	return std::nullopt;
+}
+
+void load_graph::wait()
+{
+	assert(jobs != nullptr);
+	jobs->wait(group);
+}
+
+auto load_graph::is_done() const -> bool
+{
+	return jobs != nullptr and group.is_done();
+}
+
+auto load_graph::is_done(node_id id) const -> bool
+{
+	return nodes[id]->done.load(std::memory_order_acquire);
+}
+
+auto load_graph::done_count() const -> uint32_t
+{
+	return finished.load(std::memory_order_acquire);
+}
+
+auto load_graph::node_count() const -> uint32_t
+{
+	return static_cast<uint32_t>(nodes.size());
+}
+
+auto load_graph::node_name(node_id id) const -> std::string_view
+{
+	return nodes[id]->name;
+}
+
+auto load_graph::node_time(node_id id) const -> clock::duration
+{
+	assert(is_done(id));
+	return nodes[id]->end_time - nodes[id]->start_time;
+}
+
+auto load_graph::elapsed() const -> clock::duration
+{
+	assert(is_done());
+	auto end = start_time;
+	for (auto &n : nodes)
+	{
+		end = std::max(end, n->end_time);
+	}
+	return end - start_time;
+}
+
+auto load_graph::critical_path() const -> std::vector<node_id>
+{
+	assert(is_done());
+	if (nodes.empty())
+	{
+		return {};
+	}
+
+	// Longest run time of any chain ending at each node, inputs are always seen first
+	auto longest = std::vector<clock::duration>(nodes.size());
+	auto previous = std::vector<std::optional<node_id>>(nodes.size());
+	for (auto id : order)
+	{
+		auto &n = *nodes[id];
+		auto before = clock::duration::zero();
+		for (auto input : n.inputs)
+		{
+			if (longest[input] > before or not previous[id])
+			{
+				before = longest[input];
+				previous[id] = input;
+			}
+		}
+		longest[id] = before + node_time(id);
+	}
+
+	auto path = std::vector<node_id>{};
+	auto last = static_cast<node_id>(std::max_element(longest.begin(), longest.end()) - longest.begin());
+	for (auto id = std::optional{ last }; id; id = previous[*id])
+	{
+		path.push_back(*id);
+	}
+	std::reverse(path.begin(), path.end());
+	return path;
+}
+
+// Depth first from every node, a node seen again while its inputs are still being visited closes a cycle
+auto load_graph::resolve(std::vector<std::vector<node_id>> &inputs, std::vector<node_id> &sorted) const -> std::optional<load_graph_error>
+{
+	using error_type = load_graph_error::error_type;
+
+	auto ids = std::unordered_map<std::string_view, node_id>{};
+	for (auto id = 0u; id < nodes.size(); id++)
+	{
+		if (not ids.emplace(nodes[id]->name, id).second)
+		{
+			return load_graph_error{ error_type::duplicate_name, { nodes[id]->name } };
+		}
+	}
+
+	inputs.assign(nodes.size(), {});
+	for (auto id = 0u; id < nodes.size(); id++)
+	{
+		for (auto &name : nodes[id]->input_names)
+		{
+			auto it = ids.find(name);
+			if (it == ids.end())
+			{
+				return load_graph_error{ error_type::unknown_input, { nodes[id]->name, name } };
+			}
+			inputs[id].push_back(it->second);
+		}
+	}
+
+	sorted.clear();
+	auto state = std::vector<visit>(nodes.size(), visit::not_seen);
+	auto stack = std::vector<std::pair<node_id, std::size_t>>{};   // node and how many of its inputs are visited
+	for (auto root = 0u; root < nodes.size(); root++)
+	{
+		if (state[root] != visit::not_seen)
+		{
+			continue;
+		}
+
+		state[root] = visit::in_progress;
+		stack.push_back({ root, 0 });
+		while (not stack.empty())
+		{
+			auto &[id, next] = stack.back();
+			if (next == inputs[id].size())
+			{
+				state[id] = visit::finished;
+				sorted.push_back(id);
+				stack.pop_back();
+				continue;
+			}
+
+			auto input = inputs[id][next++];
+			if (state[input] == visit::in_progress)
+			{
+				auto cycle = load_graph_error{ error_type::cycle, {} };
+				auto from = std::find_if(stack.begin(), stack.end(), [&](auto &entry)
+				{
+					return entry.first == input;
+				});
+				std::for_each(from, stack.end(), [&](auto &entry)
+				{
+					cycle.nodes.push_back(nodes[entry.first]->name);
+				});
+				cycle.nodes.push_back(nodes[input]->name);
+				return cycle;
+			}
+			if (state[input] == visit::not_seen)
+			{
+				state[input] = visit::in_progress;
+				stack.push_back({ input, 0 });
+			}
+		}
+	}
+	return std::nullopt;
+}
+
+void load_graph::queue(node_id id)
+{
+	jobs->run(group, [this, id]
+	{
+		run_node(id);
+	});
+}
+
+void load_graph::run_node(node_id id)
+{
+	auto &n = *nodes[id];
+	n.start_time = clock::now();
+	n.fn();
+	n.fn = nullptr;   // what it captured goes now, not with the graph
+	n.end_time = clock::now();
+
+	n.done.store(true, std::memory_order_release);
+	finished.fetch_add(1, std::memory_order_release);
+	for (auto dependent : n.dependents)
+	{
+		if (nodes[dependent]->inputs_left.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			queue(dependent);
+		}
+	}
+}
+
+auto dx11_lessons::describe(const load_graph_error &error) -> std::string
+{
+	auto text = fmt::format("{}:", error_names[static_cast<uint32_t>(error.type)]);
+	auto separator = error.type == load_graph_error::error_type::unknown_input ? " needs " : " > ";
+	for (auto i = 0u; i < error.nodes.size(); i++)
+	{
+		text += fmt::format("{}{}", i == 0 ? " " : separator, error.nodes[i]);
+	}
+	return text;
+}
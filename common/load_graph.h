@@ -0,0 +1,98 @@
+#pragma once
+
+#include "job_system.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace dx11_lessons
+{
+	// Why a graph can't run. For a cycle, nodes go round it with the first repeated at the end.
+	struct load_graph_error
+	{
+		enum class error_type
+		{
+			duplicate_name,
+			unknown_input,   // nodes are the one with the input, then the input
+			cycle,
+		};
+
+		error_type type;
+		std::vector<std::string> nodes;
+	};
+
+	// For logging, e.g. "cycle: a > b > a"
+	auto describe(const load_graph_error &error) -> std::string;
+
+	// Loading work as a DAG: file reads, decodes, pipeline states, buffers and textures.
+	// Each node names the nodes it reads from, in whatever order they're added, and runs on a job system
+	// as soon as they're all done. Nodes must not throw, and can't be added once the graph has started.
+	class load_graph
+	{
+	public:
+		using node_id = uint32_t;
+		using node_fn = std::function<void()>;
+		using clock = std::chrono::steady_clock;
+
+		load_graph() = default;
+		load_graph(const load_graph &) = delete;
+		auto operator=(const load_graph &) -> load_graph & = delete;
+		~load_graph();   // waits for nodes still running
+
+		auto add(std::string_view name, std::vector<std::string> inputs, node_fn fn) -> node_id;
+
+		auto validate() const -> std::optional<load_graph_error>;
+
+		// Queues every node without inputs, nothing runs if the graph isn't valid
+		auto start(job_system &jobs) -> std::optional<load_graph_error>;
+		void wait();
+
+		auto is_done() const -> bool;
+		auto is_done(node_id id) const -> bool;
+		auto done_count() const -> uint32_t;
+		auto node_count() const -> uint32_t;
+
+		// Once done. How long each node ran, from start to the last node finishing,
+		// and the chain of inputs with the longest run time, which is what no number of threads gets under.
+		auto node_name(node_id id) const -> std::string_view;
+		auto node_time(node_id id) const -> clock::duration;
+		auto elapsed() const -> clock::duration;
+		auto critical_path() const -> std::vector<node_id>;
+
+	private:
+		struct node
+		{
+			std::string name;
+			std::vector<std::string> input_names;
+			node_fn fn;
+
+			std::vector<node_id> inputs;
+			std::vector<node_id> dependents;
+			std::atomic<uint32_t> inputs_left{};
+			std::atomic<bool> done{ false };
+			clock::time_point start_time{};
+			clock::time_point end_time{};
+		};
+
+		// Inputs by id, and an order every node comes after its inputs in
+		auto resolve(std::vector<std::vector<node_id>> &inputs, std::vector<node_id> &order) const -> std::optional<load_graph_error>;
+		void queue(node_id id);
+		void run_node(node_id id);
+
+	private:
+		std::vector<std::unique_ptr<node>> nodes{};
+		std::vector<node_id> order{};
+
+		job_system *jobs{ nullptr };
+		task_group group{};
+		std::atomic<uint32_t> finished{};
+		clock::time_point start_time{};
+	};
+}
@@ -0,0 +1,100 @@
+#include "load_progress.h"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <iterator>
+
+using namespace dx11_lessons;
+
+namespace
+{
+	constexpr auto stage_names = std::array{ "read", "decode", "create" };
+
+	auto index(load_stage stage) -> uint32_t
+	{
+		return static_cast<uint32_t>(stage);
+	}
+}
+
+load_progress::load_progress() :
+	start_time{ clock::now() }
+{}
+
+load_progress::~load_progress() = default;
+
+void load_progress::expect(load_stage stage, uint64_t bytes, uint32_t items)
+{
+	auto &s = stages[index(stage)];
+	s.bytes_expected.fetch_add(bytes, std::memory_order_relaxed);
+	s.items_expected.fetch_add(items, std::memory_order_relaxed);
+}
+
+void load_progress::add(load_stage stage, uint64_t bytes, clock::duration busy, uint32_t items)
+{
+	auto &s = stages[index(stage)];
+	s.bytes_done.fetch_add(bytes, std::memory_order_relaxed);
+	s.items_done.fetch_add(items, std::memory_order_relaxed);
+	s.busy_ticks.fetch_add(busy.count(), std::memory_order_relaxed);
+}
+
+auto load_progress::snapshot() const -> load_progress_snapshot
+{
+	auto result = load_progress_snapshot{};
+	result.elapsed = clock::now() - start_time;
+
+	auto bytes_done = uint64_t{}, bytes_expected = uint64_t{};
+	auto items_done = uint64_t{}, items_expected = uint64_t{};
+	for (auto i = 0u; i < load_stage_count; i++)
+	{
+		auto &s = stages[i];
+		auto &counts = result.stages[i];
+		counts.bytes_done = s.bytes_done.load(std::memory_order_relaxed);
+		counts.bytes_expected = s.bytes_expected.load(std::memory_order_relaxed);
+		counts.items_done = s.items_done.load(std::memory_order_relaxed);
+		counts.items_expected = s.items_expected.load(std::memory_order_relaxed);
+		counts.busy = clock::duration{ s.busy_ticks.load(std::memory_order_relaxed) };
+
+		// Counters are read one at a time, so one can be done past what was expected when it was read
+		bytes_done += std::min(counts.bytes_done, counts.bytes_expected);
+		bytes_expected += counts.bytes_expected;
+		items_done += std::min(counts.items_done, counts.items_expected);
+		items_expected += counts.items_expected;
+	}
+
+	if (bytes_expected > 0)
+	{
+		result.fraction = static_cast<double>(bytes_done) / bytes_expected;
+	}
+	else if (items_expected > 0)
+	{
+		result.fraction = static_cast<double>(items_done) / items_expected;
+	}
+
+	if (result.fraction > 0.0)
+	{
+		auto elapsed = std::chrono::duration<double>(result.elapsed);
+		result.remaining = std::chrono::duration_cast<clock::duration>(elapsed * (1.0 - result.fraction) / result.fraction);
+	}
+	return result;
+}
+
+auto load_progress::breakdown() const -> std::string
+{
+	using ms = std::chrono::duration<double, std::milli>;
+	constexpr auto mib = 1024.0 * 1024.0;
+
+	auto progress = snapshot();
+	auto text = std::string{};
+	auto out = std::back_inserter(text);
+	for (auto i = 0u; i < load_stage_count; i++)
+	{
+		auto &counts = progress.stages[i];
+		auto busy = ms(counts.busy).count();
+		auto rate = busy > 0.0 ? counts.bytes_done / mib / (busy / 1000.0) : 0.0;
+		out = fmt::format_to(out, "{:<8} {:9.2f} MiB {:5} of {:<5} items {:9.2f} ms busy {:9.1f} MiB/s\n",
+		                     stage_names[i], counts.bytes_done / mib, counts.items_done, counts.items_expected, busy, rate);
+	}
+	fmt::format_to(out, "total    {:9.2f} ms, {:.0f}% done\n", ms(progress.elapsed).count(), progress.fraction * 100.0);
+	return text;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <string>
+#include <cstdint>
+
+namespace dx11_lessons
+{
+	enum class load_stage : uint32_t
+	{
+		read,     // bytes off disk or out of a pack
+		decode,   // bytes unpacked or parsed
+		create,   // objects made, weighted by the bytes they're made from
+	};
+	constexpr auto load_stage_count = 3u;
+
+	struct load_stage_counts
+	{
+		uint64_t bytes_done;
+		uint64_t bytes_expected;
+		uint32_t items_done;
+		uint32_t items_expected;
+		std::chrono::steady_clock::duration busy;   // summed over threads, so it can be more than elapsed
+	};
+
+	struct load_progress_snapshot
+	{
+		std::array<load_stage_counts, load_stage_count> stages;
+		double fraction;                                               // of bytes over every stage, of items if no bytes are expected
+		std::chrono::steady_clock::duration elapsed;
+		std::optional<std::chrono::steady_clock::duration> remaining;   // at the rate so far, once anything is done
+	};
+
+	// Per stage counters loading threads add to, read from any thread without locks.
+	// What's expected is best added before loading starts, or the fraction runs ahead of itself.
+	class load_progress
+	{
+	public:
+		using clock = std::chrono::steady_clock;
+
+		load_progress();   // starts the clock
+		load_progress(const load_progress &) = delete;
+		auto operator=(const load_progress &) -> load_progress & = delete;
+		~load_progress();
+
+		void expect(load_stage stage, uint64_t bytes, uint32_t items = 1);
+		void add(load_stage stage, uint64_t bytes, clock::duration busy, uint32_t items = 1);
+
+		// Runs fn and adds it to stage as one item of bytes
+		template <typename fn_t>
+		void measure(load_stage stage, uint64_t bytes, fn_t fn)
+		{
+			auto start = clock::now();
+			fn();
+			add(stage, bytes, clock::now() - start);
+		}
+
+		auto snapshot() const -> load_progress_snapshot;
+
+		// A line per stage with bytes, items, busy time and rate, then the total time. For a log.
+		auto breakdown() const -> std::string;
+
+	private:
+		struct stage_counters
+		{
+			std::atomic<uint64_t> bytes_done{};
+			std::atomic<uint64_t> bytes_expected{};
+			std::atomic<uint32_t> items_done{};
+			std::atomic<uint32_t> items_expected{};
+			std::atomic<int64_t> busy_ticks{};
+		};
+
+		std::array<stage_counters, load_stage_count> stages{};
+		clock::time_point start_time;
+	};
+}
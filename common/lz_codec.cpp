@@ -0,0 +1,197 @@
+#include "lz_codec.h"
+
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+using namespace dx11_lessons;
+
+namespace
+{
+	constexpr auto hash_bits = 14;
+	constexpr auto max_offset = std::size_t{ 65535 };
+	// Matches don't start in the last bytes, so the block always ends with literals
+	constexpr auto end_literals = std::size_t{ 5 };
+
+	auto read_u32(const std::byte *ptr) -> uint32_t
+	{
+		auto value = uint32_t{};
+		std::memcpy(&value, ptr, sizeof(value));
+		return value;
+	}
+
+	auto hash_u32(uint32_t value) -> uint32_t
+	{
+		return (value * 2654435761u) >> (32 - hash_bits);
+	}
+
+	void write_length(std::vector<std::byte> &out, std::size_t length)
+	{
+		while (length >= 255)
+		{
+			out.push_back(std::byte{ 255 });
+			length -= 255;
+		}
+		out.push_back(static_cast<std::byte>(length));
+	}
+
+	void write_sequence(std::vector<std::byte> &out, std::span<const std::byte> literals, std::size_t match_length, std::size_t offset)
+	{
+		auto literal_nibble = std::min<std::size_t>(literals.size(), 15);
+		auto match_nibble = match_length ? std::min<std::size_t>(match_length - lz_min_match, 15) : 0;
+		out.push_back(static_cast<std::byte>(literal_nibble << 4 | match_nibble));
+
+		if (literal_nibble == 15)
+		{
+			write_length(out, literals.size() - 15);
+		}
+		out.insert(out.end(), literals.begin(), literals.end());
+
+		if (match_length == 0)
+		{
+			return;
+		}
+
+		out.push_back(static_cast<std::byte>(offset & 0xff));
+		out.push_back(static_cast<std::byte>(offset >> 8));
+		if (match_nibble == 15)
+		{
+			write_length(out, match_length - lz_min_match - 15);
+		}
+	}
+
+	// Reads an extended length, false if it runs past the end of the block
+	auto read_length(const std::byte *&src, const std::byte *src_end, std::size_t &length) -> bool
+	{
+		auto value = std::byte{ 255 };
+		while (value == std::byte{ 255 })
+		{
+			if (src == src_end)
+			{
+				return false;
+			}
+			value = *src++;
+			length += static_cast<std::size_t>(value);
+		}
+		return true;
+	}
+}
+
+auto dx11_lessons::lz_compress(std::span<const std::byte> source) -> std::vector<std::byte>
+{
+	auto out = std::vector<std::byte>{};
+	out.reserve(source.size() + source.size() / 255 + 16);
+
+	auto src = source.data();
+	auto size = source.size();
+	auto anchor = std::size_t{};
+
+	if (size > lz_min_match + end_literals)
+	{
+		// Positions are stored + 1, so 0 means empty
+		auto table = std::vector<uint32_t>(std::size_t{ 1 } << hash_bits);
+		auto match_limit = size - end_literals;
+
+		auto pos = std::size_t{};
+		while (pos + lz_min_match <= match_limit)
+		{
+			auto value = read_u32(src + pos);
+			auto &slot = table[hash_u32(value)];
+			auto candidate = std::size_t{ slot };
+			slot = static_cast<uint32_t>(pos + 1);
+
+			if (candidate == 0 or pos - (candidate - 1) > max_offset or read_u32(src + candidate - 1) != value)
+			{
+				pos++;
+				continue;
+			}
+			candidate -= 1;
+
+			auto length = lz_min_match;
+			while (pos + length < match_limit and src[candidate + length] == src[pos + length])
+			{
+				length++;
+			}
+
+			write_sequence(out, source.subspan(anchor, pos - anchor), length, pos - candidate);
+			pos += length;
+			anchor = pos;
+		}
+	}
+
+	write_sequence(out, source.subspan(anchor), 0, 0);
+	return out;
+}
+
+auto dx11_lessons::lz_decompress(std::span<const std::byte> source, std::span<std::byte> destination) -> bool
+{
+	auto src = source.data();
+	auto src_end = src + source.size();
+	auto dst = destination.data();
+	auto dst_end = dst + destination.size();
+
+	while (src < src_end)
+	{
+		auto token = static_cast<std::size_t>(*src++);
+
+		auto literals = token >> 4;
+		if (literals == 15 and not read_length(src, src_end, literals))
+		{
+			return false;
+		}
+		if (literals > static_cast<std::size_t>(src_end - src) or literals > static_cast<std::size_t>(dst_end - dst))
+		{
+			return false;
+		}
+		std::copy_n(src, literals, dst);
+		src += literals;
+		dst += literals;
+
+		if (src == src_end)
+		{
+			break;
+		}
+
+		if (src_end - src < 2)
+		{
+			return false;
+		}
+		auto offset = static_cast<std::size_t>(src[0]) | static_cast<std::size_t>(src[1]) << 8;
+		src += 2;
+
+		auto length = token & 0xf;
+		if (length == 15 and not read_length(src, src_end, length))
+		{
+			return false;
+		}
+		length += lz_min_match;
+
+		if (offset == 0 or offset > static_cast<std::size_t>(dst - destination.data())
+		    or length > static_cast<std::size_t>(dst_end - dst))
+		{
+			return false;
+		}
+
+		auto match = dst - offset;
+		if (offset >= length)
+		{
+			std::memcpy(dst, match, length);
+			dst += length;
+		}
+		else
+		{
+			// Overlapping match repeats the last offset bytes, the repeated run doubles with each copy
+			auto run = offset;
+			while (length > 0)
+			{
+				auto count = std::min(run, length);
+				std::memcpy(dst, match, count);
+				dst += count;
+				length -= count;
+				run *= 2;
+			}
+		}
+	}
+
+	return dst == dst_end;
+}
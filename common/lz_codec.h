@@ -0,0 +1,24 @@
+#pragma once
+
+#include <vector>
+#include <span>
+#include <cstddef>
+
+namespace dx11_lessons
+{
+	// Byte oriented LZ77 codec in the style of LZ4, tuned for decode speed over ratio.
+	// Each call is an independent block, there is no state carried between blocks.
+	//
+	// Block is a series of sequences:
+	//   token: high 4 bits literal count, low 4 bits match length - lz_min_match
+	//          a nibble of 15 is extended by following bytes, each added until one is below 255
+	//   literal bytes
+	//   match offset, 2 bytes little endian, 1 to 65535 bytes back
+	// Last sequence only has literals.
+	constexpr auto lz_min_match = std::size_t{ 4 };
+
+	auto lz_compress(std::span<const std::byte> source) -> std::vector<std::byte>;
+
+	// Destination must be exactly the uncompressed size. False on malformed input.
+	auto lz_decompress(std::span<const std::byte> source, std::span<std::byte> destination) -> bool;
+}
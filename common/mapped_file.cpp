@@ -0,0 +1,198 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <fstream>
+#include <utility>
+
+using namespace dx11_lessons;
+
+namespace
+{
+	struct file_view
+	{
+		const std::byte *data;
+		std::size_t size;
+	};
+
+	// Returns a null view if the file can't be mapped, including empty files
+#ifdef _WIN32
+	auto map_file(const std::filesystem::path &path) -> file_view
+	{
+		auto file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		                        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return {};
+		}
+
+		auto size = LARGE_INTEGER{};
+		auto view = file_view{};
+		if (GetFileSizeEx(file, &size) and size.QuadPart > 0)
+		{
+			auto mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (mapping != nullptr)
+			{
+				// The view keeps the mapping alive, so both handles can be closed
+				view.data = static_cast<const std::byte *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+				view.size = view.data ? static_cast<std::size_t>(size.QuadPart) : 0;
+				CloseHandle(mapping);
+			}
+		}
+		CloseHandle(file);
+		return view;
+	}
+
+	void unmap_file(const file_view &view)
+	{
+		UnmapViewOfFile(view.data);
+	}
+#else
+	auto map_file(const std::filesystem::path &path) -> file_view
+	{
+		auto fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+		{
+			return {};
+		}
+
+		struct stat info{};
+		auto view = file_view{};
+		if (fstat(fd, &info) == 0 and S_ISREG(info.st_mode) and info.st_size > 0)
+		{
+			auto size = static_cast<std::size_t>(info.st_size);
+			auto ptr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (ptr != MAP_FAILED)
+			{
+				madvise(ptr, size, MADV_SEQUENTIAL);
+				view = { static_cast<const std::byte *>(ptr), size };
+			}
+		}
+		close(fd);
+		return view;
+	}
+
+	void unmap_file(const file_view &view)
+	{
+		munmap(const_cast<std::byte *>(view.data), view.size);
+	}
+#endif
+}
+
+mapped_file::mapped_file(const std::filesystem::path &path, file_access access)
+{
+	auto file_map = (access == file_access::map) ? map_file(path) : file_view{};
+	if (file_map.data != nullptr)
+	{
+		view = file_map.data;
+		view_size = file_map.size;
+		mapped = true;
+		return;
+	}
+
+	// Missing or unreadable files are left empty, same as a failed mapping
+	auto error = std::error_code{};
+	if (not std::filesystem::is_regular_file(path, error))
+	{
+		return;
+	}
+	auto file = std::ifstream(path, std::ios::in | std::ios::binary | std::ios::ate);
+	if (not file.is_open())
+	{
+		return;
+	}
+	auto size = static_cast<std::streamoff>(file.tellg());
+	if (size <= 0)
+	{
+		return;
+	}
+
+	fallback.resize(static_cast<std::size_t>(size));
+	file.seekg(0, std::ios::beg);
+	if (not file.read(reinterpret_cast<char *>(fallback.data()), static_cast<std::streamsize>(fallback.size())))
+	{
+		fallback.clear();
+		return;
+	}
+
+	view = fallback.data();
+	view_size = fallback.size();
+}
+
+mapped_file::~mapped_file()
+{
+	unmap();
+}
+
+mapped_file::mapped_file(mapped_file &&other) noexcept :
+	view{ std::exchange(other.view, nullptr) },
+	view_size{ std::exchange(other.view_size, 0) },
+	mapped{ std::exchange(other.mapped, false) },
+	fallback{ std::move(other.fallback) }
+{ }
+
+auto mapped_file::operator=(mapped_file &&other) noexcept -> mapped_file &
+{
+	if (this != &other)
+	{
+		unmap();
+		view = std::exchange(other.view, nullptr);
+		view_size = std::exchange(other.view_size, 0);
+		mapped = std::exchange(other.mapped, false);
+		fallback = std::move(other.fallback);
+	}
+	return *this;
+}
+
+void mapped_file::unmap()
+{
+	if (mapped)
+	{
+		unmap_file({ view, view_size });
+		mapped = false;
+	}
+	view = nullptr;
+	view_size = 0;
+}
+
+auto mapped_file::bytes() const -> std::span<const std::byte>
+{
+	return { view, view_size };
+}
+
+auto mapped_file::data() const -> const std::byte *
+{
+	return view;
+}
+
+auto mapped_file::size() const -> std::size_t
+{
+	return view_size;
+}
+
+auto mapped_file::empty() const -> bool
+{
+	return view_size == 0;
+}
+
+auto mapped_file::is_mapped() const -> bool
+{
+	return mapped;
+}
+
+auto mapped_file::begin() const -> const std::byte *
+{
+	return view;
+}
+
+auto mapped_file::end() const -> const std::byte *
+{
+	return view + view_size;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <filesystem>
+#include <span>
+#include <vector>
+#include <cstddef>
+
+namespace dx11_lessons
+{
+	// A mapping keeps Windows from writing the file while it lives, so a file that's rewritten
+	// while in use, like a re-cooked texture kept for streaming, is read into memory instead
+	enum class file_access
+	{
+		map,
+		read,
+	};
+
+	// Read-only view of a whole file. The file is memory mapped when possible,
+	// otherwise it is read into memory with a single read.
+	// Empty if the file is missing, empty or can't be read.
+	// Converts implicitly to std::span<const std::byte>, valid while the mapped_file lives.
+	class mapped_file
+	{
+	public:
+		mapped_file() = default;
+		explicit mapped_file(const std::filesystem::path &path, file_access access = file_access::map);
+		~mapped_file();
+
+		mapped_file(mapped_file &&other) noexcept;
+		auto operator=(mapped_file &&other) noexcept -> mapped_file &;
+		mapped_file(const mapped_file &) = delete;
+		auto operator=(const mapped_file &) -> mapped_file & = delete;
+
+		auto bytes() const -> std::span<const std::byte>;
+		auto data() const -> const std::byte *;
+		auto size() const -> std::size_t;
+		auto empty() const -> bool;
+		auto is_mapped() const -> bool;
+
+		auto begin() const -> const std::byte *;
+		auto end() const -> const std::byte *;
+
+	private:
+		void unmap();
+
+		const std::byte *view{};
+		std::size_t view_size{};
+		bool mapped{};
+		std::vector<std::byte> fallback{};
+	};
+}
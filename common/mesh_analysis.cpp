@@ -0,0 +1,249 @@
+#include "mesh_analysis.h"
+
+#include "mesh_welding.h"
+
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+
+using namespace dx11_lessons;
+using namespace DirectX;
+
+namespace
+{
+	constexpr auto invalid_index = std::numeric_limits<uint32_t>::max();
+
+	struct index_range
+	{
+		uint32_t start;
+		uint32_t count;
+	};
+
+	auto count_unique(const std::vector<uint32_t> &indicies, index_range range, std::vector<uint8_t> &seen) -> uint32_t
+	{
+		auto unique = 0u;
+		for (auto i = range.start; i < range.start + range.count; i++)
+		{
+			auto vi = indicies[i];
+			unique += seen[vi] == 0;
+			seen[vi] = 1;
+		}
+		for (auto i = range.start; i < range.start + range.count; i++)
+		{
+			seen[indicies[i]] = 0;
+		}
+		return unique;
+	}
+
+	// FIFO post transform cache, timestamps avoid searching the cache
+	auto cache_misses(const std::vector<uint32_t> &indicies, index_range range,
+	                  uint32_t cache_size, std::vector<uint32_t> &timestamps) -> uint32_t
+	{
+		auto misses = 0u;
+		for (auto i = range.start; i < range.start + range.count; i++)
+		{
+			auto vi = indicies[i];
+			if (timestamps[vi] == invalid_index or misses - timestamps[vi] > cache_size)
+			{
+				timestamps[vi] = misses;
+				misses++;
+			}
+		}
+		for (auto i = range.start; i < range.start + range.count; i++)
+		{
+			timestamps[indicies[i]] = invalid_index;
+		}
+		return misses;
+	}
+
+	auto fetched_bytes(const std::vector<uint32_t> &indicies, index_range range, const analysis_settings &settings) -> uint64_t
+	{
+		auto line_bytes = std::max(settings.fetch_line_bytes, 1u);
+		auto slots = std::max(settings.fetch_cache_bytes / line_bytes, 1u);
+		auto lines = std::vector<uint64_t>(slots, std::numeric_limits<uint64_t>::max());
+
+		auto fetched = uint64_t{};
+		for (auto i = range.start; i < range.start + range.count; i++)
+		{
+			auto first = static_cast<uint64_t>(indicies[i]) * settings.vertex_stride;
+			auto last = first + settings.vertex_stride - 1;
+			for (auto line = first / line_bytes; line <= last / line_bytes; line++)
+			{
+				auto &slot = lines[line % slots];
+				if (slot != line)
+				{
+					slot = line;
+					fetched += line_bytes;
+				}
+			}
+		}
+		return fetched;
+	}
+
+	// Rasterizes the triangles along each axis with early depth test,
+	// front and back facing triangles into separate depth buffers.
+	auto overdraw(const obj_data &data, index_range range, const XMFLOAT3 &bounds_min, const XMFLOAT3 &bounds_max,
+	              uint32_t resolution) -> float
+	{
+		auto res = static_cast<int>(resolution);
+		auto depth = std::vector<float>{};
+		auto shaded = uint64_t{},
+		     covered = uint64_t{};
+
+		auto lo = std::array{ bounds_min.x, bounds_min.y, bounds_min.z },
+		     hi = std::array{ bounds_max.x, bounds_max.y, bounds_max.z };
+
+		for (auto axis = 0; axis < 3; axis++)
+		{
+			auto u_axis = (axis + 1) % 3,
+			     v_axis = (axis + 2) % 3;
+			auto extent = std::max(hi[u_axis] - lo[u_axis], hi[v_axis] - lo[v_axis]);
+			if (extent <= 0.0f)
+			{
+				continue;
+			}
+			auto scale = (res - 1) / extent;
+
+			depth.assign(2 * resolution * resolution, std::numeric_limits<float>::max());
+
+			for (auto t = range.start; t + 2 < range.start + range.count; t += 3)
+			{
+				auto sx = std::array<float, 3>{}, sy = std::array<float, 3>{}, sz = std::array<float, 3>{};
+				for (auto k = 0; k < 3; k++)
+				{
+					auto &p = data.vertices[data.indicies[t + k]];
+					auto c = std::array{ p.x, p.y, p.z };
+					sx[k] = (c[u_axis] - lo[u_axis]) * scale;
+					sy[k] = (c[v_axis] - lo[v_axis]) * scale;
+					sz[k] = c[axis];
+				}
+
+				auto area = (sx[1] - sx[0]) * (sy[2] - sy[0]) - (sx[2] - sx[0]) * (sy[1] - sy[0]);
+				if (area == 0.0f)
+				{
+					continue;
+				}
+				auto side = area > 0.0f ? 0u : 1u;
+				auto sign = area > 0.0f ? 1.0f : -1.0f;
+				auto *buffer = depth.data() + side * resolution * resolution;
+
+				auto min_x = std::max(static_cast<int>(std::ceil(*std::min_element(sx.begin(), sx.end()) - 0.5f)), 0),
+				     max_x = std::min(static_cast<int>(std::floor(*std::max_element(sx.begin(), sx.end()) - 0.5f)), res - 1),
+				     min_y = std::max(static_cast<int>(std::ceil(*std::min_element(sy.begin(), sy.end()) - 0.5f)), 0),
+				     max_y = std::min(static_cast<int>(std::floor(*std::max_element(sy.begin(), sy.end()) - 0.5f)), res - 1);
+
+				for (auto y = min_y; y <= max_y; y++)
+				{
+					auto py = y + 0.5f;
+					for (auto x = min_x; x <= max_x; x++)
+					{
+						auto px = x + 0.5f;
+						auto w0 = sign * ((sx[2] - sx[1]) * (py - sy[1]) - (sy[2] - sy[1]) * (px - sx[1])),
+						     w1 = sign * ((sx[0] - sx[2]) * (py - sy[2]) - (sy[0] - sy[2]) * (px - sx[2])),
+						     w2 = sign * ((sx[1] - sx[0]) * (py - sy[0]) - (sy[1] - sy[0]) * (px - sx[0]));
+						if (w0 < 0.0f or w1 < 0.0f or w2 < 0.0f)
+						{
+							continue;
+						}
+
+						auto z = (w0 * sz[0] + w1 * sz[1] + w2 * sz[2]) / (w0 + w1 + w2);
+						auto &d = buffer[y * res + x];
+						if (z < d)
+						{
+							d = z;
+							shaded++;
+						}
+					}
+				}
+			}
+
+			covered += std::count_if(depth.begin(), depth.end(), [](float d)
+			{
+				return d != std::numeric_limits<float>::max();
+			});
+		}
+
+		return covered == 0 ? 0.0f : static_cast<float>(shaded) / covered;
+	}
+
+	auto make_stats(const obj_data &data, index_range range, uint32_t input_vertices,
+	                const analysis_settings &settings,
+	                std::vector<uint8_t> &seen, std::vector<uint32_t> &timestamps) -> mesh_stats
+	{
+		auto stats = mesh_stats{};
+		stats.vertex_count = count_unique(data.indicies, range, seen);
+		stats.triangle_count = range.count / 3;
+		stats.duplicate_ratio = input_vertices == 0 ? 0.0f
+		                      : 1.0f - static_cast<float>(stats.vertex_count) / input_vertices;
+
+		auto misses = cache_misses(data.indicies, range, settings.cache_size, timestamps);
+		stats.acmr = stats.triangle_count == 0 ? 0.0f : static_cast<float>(misses) / stats.triangle_count;
+		stats.atvr = stats.vertex_count == 0 ? 0.0f : static_cast<float>(misses) / stats.vertex_count;
+
+		auto fetched = fetched_bytes(data.indicies, range, settings);
+		stats.fetch_efficiency = fetched == 0 ? 0.0f
+		                       : static_cast<float>(static_cast<double>(stats.vertex_count) * settings.vertex_stride / fetched);
+
+		constexpr auto flt_max = std::numeric_limits<float>::max();
+		stats.bounds_min = { flt_max, flt_max, flt_max };
+		stats.bounds_max = { -flt_max, -flt_max, -flt_max };
+		for (auto i = range.start; i < range.start + range.count; i++)
+		{
+			auto &p = data.vertices[data.indicies[i]];
+			stats.bounds_min = { std::min(stats.bounds_min.x, p.x), std::min(stats.bounds_min.y, p.y), std::min(stats.bounds_min.z, p.z) };
+			stats.bounds_max = { std::max(stats.bounds_max.x, p.x), std::max(stats.bounds_max.y, p.y), std::max(stats.bounds_max.z, p.z) };
+		}
+		if (range.count == 0)
+		{
+			stats.bounds_min = stats.bounds_max = {};
+		}
+		else
+		{
+			stats.bounding_obb = fit_oriented_box(data.vertices, data.indicies, range.start, range.count);
+		}
+
+		stats.overdraw = overdraw(data, range, stats.bounds_min, stats.bounds_max, settings.overdraw_resolution);
+
+		auto index_size = stats.vertex_count <= std::numeric_limits<uint16_t>::max() + 1u ? 2u : 4u;
+		for (auto f = 0u; f < candidate_vertex_formats.size(); f++)
+		{
+			stats.memory[f] = static_cast<uint64_t>(stats.vertex_count) * candidate_vertex_formats[f].stride
+			                + static_cast<uint64_t>(range.count) * index_size;
+		}
+
+		return stats;
+	}
+}
+
+auto dx11_lessons::analyze_mesh(const obj_data &data, const analysis_settings &settings) -> mesh_report
+{
+	auto seen = std::vector<uint8_t>(data.vertices.size());
+	auto input_vertices = std::vector<uint32_t>{};
+	for (auto &grp : data.groups)
+	{
+		input_vertices.push_back(count_unique(data.indicies, { grp.index_start, grp.index_count }, seen));
+	}
+
+	auto welded = data;
+	weld_vertices(welded);
+
+	seen.assign(welded.vertices.size(), 0);
+	auto timestamps = std::vector<uint32_t>(welded.vertices.size(), invalid_index);
+
+	auto report = mesh_report{};
+	for (auto g = 0u; g < welded.groups.size(); g++)
+	{
+		auto &grp = welded.groups[g];
+		auto &stats = report.groups.emplace_back(make_stats(welded, { grp.index_start, grp.index_count },
+		                                                    input_vertices[g], settings, seen, timestamps));
+		stats.name = grp.name;
+		stats.material_name = grp.material_name;
+	}
+
+	report.total = make_stats(welded, { 0, static_cast<uint32_t>(welded.indicies.size()) },
+	                          static_cast<uint32_t>(data.vertices.size()), settings, seen, timestamps);
+	report.total.name = "total";
+
+	return report;
+}
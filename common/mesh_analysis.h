@@ -0,0 +1,68 @@
+#pragma once
+
+#include "obj_mtl_parser.h"
+
+#include <DirectXMath.h>
+#include <array>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+namespace dx11_lessons
+{
+	struct vertex_format
+	{
+		std::string_view name;
+		uint32_t stride;
+	};
+
+	// Layouts a mesh could be stored in, memory is reported for each of them
+	constexpr auto candidate_vertex_formats = std::array
+	{
+		vertex_format{ "p32n32t32", 32 },   // float3 position, float3 normal, float2 uv (gpu_datatypes vertex)
+		vertex_format{ "p32n8t16", 20 },    // float3 position, snorm8x4 normal, half2 uv
+		vertex_format{ "p16n8t16", 16 },    // half4 position, snorm8x4 normal, half2 uv
+		vertex_format{ "p16o16t16", 16 },   // unorm16x4 quantised position, octahedral snorm16x2 normal, unorm16x2 uv
+	};
+
+	struct analysis_settings
+	{
+		uint32_t cache_size = 16;              // post transform cache entries, FIFO
+		uint32_t fetch_cache_bytes = 16384;    // vertex fetch cache, direct mapped
+		uint32_t fetch_line_bytes = 64;
+		uint32_t vertex_stride = 32;           // stride used for fetch simulation
+		uint32_t overdraw_resolution = 256;
+	};
+
+	struct mesh_stats
+	{
+		std::string name;
+		std::string material_name;
+
+		uint32_t vertex_count;       // after welding
+		uint32_t triangle_count;     // after dropping degenerate triangles
+		float duplicate_ratio;       // share of input vertices that welding removed
+
+		float acmr;                  // cache misses per triangle
+		float atvr;                  // cache misses per vertex
+		float overdraw;              // fragments shaded per covered pixel, axis views
+		float fetch_efficiency;      // vertex bytes used / bytes fetched
+
+		DirectX::XMFLOAT3 bounds_min;
+		DirectX::XMFLOAT3 bounds_max;
+		oriented_box bounding_obb;
+
+		std::array<uint64_t, candidate_vertex_formats.size()> memory;   // vertex + index bytes per format
+	};
+
+	struct mesh_report
+	{
+		mesh_stats total;
+		std::vector<mesh_stats> groups;
+	};
+
+	// Welds a copy of the mesh and simulates the post transform cache,
+	// vertex fetch and an early-z rasterizer over the result.
+	auto analyze_mesh(const obj_data &data, const analysis_settings &settings = {}) -> mesh_report;
+}
@@ -0,0 +1,207 @@
+#include "mesh_optimizer.h"
+
+#include <vector>
+#include <array>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+using namespace dx11_lessons;
+
+namespace
+{
+	constexpr auto invalid_index = std::numeric_limits<uint32_t>::max();
+
+	// Scoring constants from Forsyth's article
+	constexpr auto cache_size = 32u;
+	constexpr auto cache_decay_power = 1.5f;
+	constexpr auto last_triangle_score = 0.75f;
+	constexpr auto valence_boost_scale = 2.0f;
+	constexpr auto valence_boost_power = 0.5f;
+
+	auto vertex_score(uint32_t cache_position, uint32_t remaining_triangles) -> float
+	{
+		if (remaining_triangles == 0)
+		{
+			return -1.0f;
+		}
+
+		auto score = 0.0f;
+		if (cache_position < 3)
+		{
+			// The triangle just drawn, don't favour reusing it straight away
+			score = last_triangle_score;
+		}
+		else if (cache_position < cache_size)
+		{
+			auto scaler = 1.0f / (cache_size - 3);
+			score = std::pow(1.0f - (cache_position - 3) * scaler, cache_decay_power);
+		}
+
+		score += valence_boost_scale * std::pow(static_cast<float>(remaining_triangles), -valence_boost_power);
+		return score;
+	}
+}
+
+void dx11_lessons::optimize_vertex_cache(std::span<uint32_t> indicies, uint32_t vertex_count)
+{
+	auto triangle_count = static_cast<uint32_t>(indicies.size() / 3);
+	if (triangle_count < 2)
+	{
+		return;
+	}
+
+	// Triangles using each vertex, as offsets into one flat list
+	auto remaining = std::vector<uint32_t>(vertex_count);
+	for (auto idx : indicies.first(triangle_count * 3))
+	{
+		remaining[idx]++;
+	}
+	auto first_triangle = std::vector<uint32_t>(vertex_count + 1);
+	for (auto v = 0u; v < vertex_count; v++)
+	{
+		first_triangle[v + 1] = first_triangle[v] + remaining[v];
+	}
+	auto vertex_triangles = std::vector<uint32_t>(first_triangle.back());
+	auto fill = std::vector<uint32_t>(first_triangle.begin(), first_triangle.end() - 1);
+	for (auto t = 0u; t < triangle_count; t++)
+	{
+		for (auto c = 0u; c < 3; c++)
+		{
+			vertex_triangles[fill[indicies[t * 3 + c]]++] = t;
+		}
+	}
+
+	auto cache_position = std::vector<uint32_t>(vertex_count, invalid_index);
+	auto scores = std::vector<float>(vertex_count);
+	for (auto v = 0u; v < vertex_count; v++)
+	{
+		scores[v] = vertex_score(invalid_index, remaining[v]);
+	}
+
+	auto triangle_scores = std::vector<float>(triangle_count);
+	auto emitted = std::vector<bool>(triangle_count);
+	for (auto t = 0u; t < triangle_count; t++)
+	{
+		triangle_scores[t] = scores[indicies[t * 3]] + scores[indicies[t * 3 + 1]] + scores[indicies[t * 3 + 2]];
+	}
+
+	auto output = std::vector<uint32_t>{};
+	output.reserve(triangle_count * 3);
+
+	auto cache = std::vector<uint32_t>{};
+	auto next_cache = std::vector<uint32_t>{};
+	auto scan_cursor = 0u;
+
+	auto best_triangle = static_cast<uint32_t>(std::max_element(triangle_scores.begin(), triangle_scores.end()) - triangle_scores.begin());
+	while (best_triangle != invalid_index)
+	{
+		emitted[best_triangle] = true;
+		auto corners = std::array{ indicies[best_triangle * 3], indicies[best_triangle * 3 + 1], indicies[best_triangle * 3 + 2] };
+		output.insert(output.end(), corners.begin(), corners.end());
+
+		// Drawn triangle's vertices move to the front, everything else shifts back
+		next_cache.assign(corners.begin(), corners.end());
+		for (auto v : cache)
+		{
+			if (std::find(corners.begin(), corners.end(), v) == corners.end())
+			{
+				next_cache.push_back(v);
+			}
+		}
+
+		for (auto v : corners)
+		{
+			auto begin = vertex_triangles.begin() + first_triangle[v],
+			     end = begin + remaining[v];
+			std::iter_swap(std::find(begin, end, best_triangle), end - 1);
+			remaining[v]--;
+		}
+
+		for (auto i = 0u; i < next_cache.size(); i++)
+		{
+			auto v = next_cache[i];
+			cache_position[v] = (i < cache_size) ? i : invalid_index;
+			scores[v] = vertex_score(cache_position[v], remaining[v]);
+		}
+		if (next_cache.size() > cache_size)
+		{
+			next_cache.resize(cache_size);
+		}
+		std::swap(cache, next_cache);
+
+		// Only triangles touching the cache changed score, so the best one is among them
+		best_triangle = invalid_index;
+		auto best_score = -1.0f;
+		for (auto v : cache)
+		{
+			for (auto i = first_triangle[v]; i < first_triangle[v] + remaining[v]; i++)
+			{
+				auto t = vertex_triangles[i];
+				auto score = scores[indicies[t * 3]] + scores[indicies[t * 3 + 1]] + scores[indicies[t * 3 + 2]];
+				triangle_scores[t] = score;
+				if (score > best_score)
+				{
+					best_score = score;
+					best_triangle = t;
+				}
+			}
+		}
+
+		// Cache ran dry, carry on from the next triangle that hasn't been drawn
+		if (best_triangle == invalid_index)
+		{
+			while (scan_cursor < triangle_count and emitted[scan_cursor])
+			{
+				scan_cursor++;
+			}
+			best_triangle = (scan_cursor < triangle_count) ? scan_cursor : invalid_index;
+		}
+	}
+
+	std::copy(output.begin(), output.end(), indicies.begin());
+}
+
+void dx11_lessons::optimize_mesh(obj_data &data)
+{
+	auto vertex_count = static_cast<uint32_t>(data.vertices.size());
+	if (data.groups.empty())
+	{
+		optimize_vertex_cache(data.indicies, vertex_count);
+	}
+	for (auto &grp : data.groups)
+	{
+		optimize_vertex_cache(std::span(data.indicies).subspan(grp.index_start, grp.index_count), vertex_count);
+	}
+
+	auto remap = std::vector<uint32_t>(vertex_count, invalid_index);
+	auto next_vertex = 0u;
+	for (auto &idx : data.indicies)
+	{
+		if (remap[idx] == invalid_index)
+		{
+			remap[idx] = next_vertex++;
+		}
+		idx = remap[idx];
+	}
+
+	auto reorder = [&](auto &attribute)
+	{
+		if (attribute.size() != vertex_count)
+		{
+			return;
+		}
+		auto reordered = std::remove_reference_t<decltype(attribute)>(next_vertex);
+		for (auto v = 0u; v < vertex_count; v++)
+		{
+			if (remap[v] != invalid_index)
+			{
+				reordered[remap[v]] = attribute[v];
+			}
+		}
+		attribute = std::move(reordered);
+	};
+	reorder(data.vertices);
+	reorder(data.normals);
+	reorder(data.uv_coords);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "obj_mtl_parser.h"
+
+#include <span>
+#include <cstdint>
+
+namespace dx11_lessons
+{
+	// Reorders the triangles of one index range for the post transform cache,
+	// using Tom Forsyth's linear-speed vertex cache optimisation.
+	void optimize_vertex_cache(std::span<uint32_t> indicies, uint32_t vertex_count);
+
+	// Triangles of each group are optimised for the post transform cache, group ranges stay the same.
+	// Then vertices are renumbered in first use order, for the fetch cache, and unused vertices dropped.
+	// Expects welded data, i.e. normals and uv_coords either empty or one per vertex.
+	void optimize_mesh(obj_data &data);
+}
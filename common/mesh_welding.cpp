@@ -0,0 +1,260 @@
+#include "mesh_welding.h"
+
+#include <vector>
+#include <array>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+
+using namespace dx11_lessons;
+
+namespace
+{
+	using position = obj_data::position;
+	using normal = obj_data::normal;
+	using uv_coord = obj_data::uv_coord;
+
+	constexpr auto invalid_index = std::numeric_limits<uint32_t>::max();
+
+	using cell_key = std::array<int32_t, 3>;
+
+	// Open addressing hash map of grid cell -> first vertex in that cell.
+	// Vertices in the same cell are chained through next_in_cell.
+	class spatial_hash
+	{
+	public:
+		spatial_hash(std::size_t vertex_count)
+		{
+			auto capacity = std::size_t{ 16 };
+			while (capacity < vertex_count * 2)
+			{
+				capacity <<= 1;
+			}
+			mask = capacity - 1;
+			keys.resize(capacity);
+			heads.resize(capacity, invalid_index);
+		}
+
+		auto find(const cell_key &key) const -> uint32_t
+		{
+			for (auto slot = hash(key) & mask; ; slot = (slot + 1) & mask)
+			{
+				if (heads[slot] == invalid_index)
+				{
+					return invalid_index;
+				}
+				if (keys[slot] == key)
+				{
+					return heads[slot];
+				}
+			}
+		}
+
+		auto head(const cell_key &key) -> uint32_t &
+		{
+			for (auto slot = hash(key) & mask; ; slot = (slot + 1) & mask)
+			{
+				if (heads[slot] == invalid_index)
+				{
+					keys[slot] = key;
+					return heads[slot];
+				}
+				if (keys[slot] == key)
+				{
+					return heads[slot];
+				}
+			}
+		}
+
+	private:
+		static auto hash(const cell_key &key) -> std::size_t
+		{
+			auto h = static_cast<uint64_t>(static_cast<uint32_t>(key[0])) * 73856093ull
+			       ^ static_cast<uint64_t>(static_cast<uint32_t>(key[1])) * 19349663ull
+			       ^ static_cast<uint64_t>(static_cast<uint32_t>(key[2])) * 83492791ull;
+			return static_cast<std::size_t>(h ^ (h >> 29));
+		}
+
+	private:
+		std::size_t mask{};
+		std::vector<cell_key> keys{};
+		std::vector<uint32_t> heads{};
+	};
+
+	auto to_cell(float value) -> int32_t
+	{
+		constexpr auto cell_min = static_cast<float>(std::numeric_limits<int32_t>::min() / 2);
+		constexpr auto cell_max = static_cast<float>(std::numeric_limits<int32_t>::max() / 2);
+		return static_cast<int32_t>(std::clamp(std::floor(value), cell_min, cell_max));
+	}
+
+	auto distance_sq(const DirectX::XMFLOAT3 &a, const DirectX::XMFLOAT3 &b) -> float
+	{
+		auto dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+		return dx * dx + dy * dy + dz * dz;
+	}
+
+	auto distance_sq(const DirectX::XMFLOAT2 &a, const DirectX::XMFLOAT2 &b) -> float
+	{
+		auto dx = a.x - b.x, dy = a.y - b.y;
+		return dx * dx + dy * dy;
+	}
+
+	auto is_degenerate(const position &a, const position &b, const position &c) -> bool
+	{
+		auto e0 = position{ b.x - a.x, b.y - a.y, b.z - a.z },
+		     e1 = position{ c.x - a.x, c.y - a.y, c.z - a.z };
+		auto cross = position{ e0.y * e1.z - e0.z * e1.y,
+		                       e0.z * e1.x - e0.x * e1.z,
+		                       e0.x * e1.y - e0.y * e1.x };
+
+		// Relative test, |e0 x e1|^2 = |e0|^2 |e1|^2 sin^2(angle)
+		constexpr auto min_sin_sq = 1.0e-12f;
+		auto area_sq = cross.x * cross.x + cross.y * cross.y + cross.z * cross.z;
+		auto e0_sq = e0.x * e0.x + e0.y * e0.y + e0.z * e0.z,
+		     e1_sq = e1.x * e1.x + e1.y * e1.y + e1.z * e1.z;
+		return area_sq <= min_sin_sq * e0_sq * e1_sq;
+	}
+}
+
+auto dx11_lessons::weld_vertices(obj_data &data, const weld_settings &settings) -> weld_stats
+{
+	auto &positions = data.vertices;
+	auto &normals = data.normals;
+	auto &uvs = data.uv_coords;
+
+	auto vertex_count = static_cast<uint32_t>(positions.size());
+	auto has_normals = normals.size() == positions.size();
+	auto has_uvs = uvs.size() == positions.size();
+
+	auto stats = weld_stats{};
+	stats.vertices_before = vertex_count;
+	stats.triangles_before = static_cast<uint32_t>(data.indicies.size() / 3);
+
+	auto position_tol_sq = settings.position_tolerance * settings.position_tolerance;
+	auto normal_tol_sq = settings.normal_tolerance * settings.normal_tolerance;
+	auto uv_tol_sq = settings.uv_tolerance * settings.uv_tolerance;
+
+	// Cells are twice the tolerance wide, so any match lies in the 2x2x2 block
+	// made of the vertex's own cell and the neighbours on the nearer side.
+	auto cell_size = std::max(2.0f * settings.position_tolerance, std::numeric_limits<float>::epsilon());
+	auto inv_cell_size = 1.0f / cell_size;
+
+	auto grid = spatial_hash(vertex_count);
+	auto next_in_cell = std::vector<uint32_t>(vertex_count, invalid_index);
+	auto remap = std::vector<uint32_t>(vertex_count, invalid_index);
+
+	auto is_match = [&](uint32_t a, uint32_t b)
+	{
+		return distance_sq(positions[a], positions[b]) <= position_tol_sq
+		   and (not has_normals or distance_sq(normals[a], normals[b]) <= normal_tol_sq)
+		   and (not has_uvs or distance_sq(uvs[a], uvs[b]) <= uv_tol_sq);
+	};
+
+	for (auto i = 0u; i < vertex_count; i++)
+	{
+		auto &p = positions[i];
+		auto g = std::array{ p.x * inv_cell_size, p.y * inv_cell_size, p.z * inv_cell_size };
+		auto cell = cell_key{ to_cell(g[0]), to_cell(g[1]), to_cell(g[2]) };
+		auto side = cell_key{};
+		for (auto axis = 0u; axis < 3; axis++)
+		{
+			side[axis] = (g[axis] - std::floor(g[axis]) < 0.5f) ? -1 : 1;
+		}
+
+		for (auto n = 0u; n < 8 and remap[i] == invalid_index; n++)
+		{
+			auto neighbour = cell_key{ cell[0] + ((n & 1) ? side[0] : 0),
+			                           cell[1] + ((n & 2) ? side[1] : 0),
+			                           cell[2] + ((n & 4) ? side[2] : 0) };
+
+			for (auto r = grid.find(neighbour); r != invalid_index; r = next_in_cell[r])
+			{
+				if (is_match(i, r))
+				{
+					remap[i] = r;
+					break;
+				}
+			}
+		}
+
+		if (remap[i] == invalid_index)
+		{
+			remap[i] = i;
+			auto &head = grid.head(cell);
+			next_in_cell[i] = head;
+			head = i;
+		}
+	}
+
+	// Rebuild index list per group, dropping collapsed triangles and
+	// compacting vertices in order of first use.
+	auto compact = std::vector<uint32_t>(vertex_count, invalid_index);
+	auto new_positions = std::vector<position>{};
+	auto new_normals = std::vector<normal>{};
+	auto new_uvs = std::vector<uv_coord>{};
+	auto new_indicies = std::vector<uint32_t>{};
+	new_indicies.reserve(data.indicies.size());
+
+	auto emit = [&](uint32_t rep) -> uint32_t
+	{
+		if (compact[rep] == invalid_index)
+		{
+			compact[rep] = static_cast<uint32_t>(new_positions.size());
+			new_positions.push_back(positions[rep]);
+			if (has_normals)
+			{
+				new_normals.push_back(normals[rep]);
+			}
+			if (has_uvs)
+			{
+				new_uvs.push_back(uvs[rep]);
+			}
+		}
+		return compact[rep];
+	};
+
+	for (auto &grp : data.groups)
+	{
+		auto group_start = static_cast<uint32_t>(new_indicies.size());
+		auto triangle_count = grp.index_count / 3;
+
+		for (auto t = 0u; t < triangle_count; t++)
+		{
+			auto base = grp.index_start + t * 3;
+			auto a = remap[data.indicies[base + 0]],
+			     b = remap[data.indicies[base + 1]],
+			     c = remap[data.indicies[base + 2]];
+
+			if (a == b or b == c or c == a
+			    or is_degenerate(positions[a], positions[b], positions[c]))
+			{
+				stats.triangles_removed++;
+				continue;
+			}
+
+			new_indicies.push_back(emit(a));
+			new_indicies.push_back(emit(b));
+			new_indicies.push_back(emit(c));
+		}
+
+		grp.index_start = group_start;
+		grp.index_count = static_cast<uint32_t>(new_indicies.size()) - group_start;
+	}
+
+	stats.vertices_removed = vertex_count - static_cast<uint32_t>(new_positions.size());
+
+	positions = std::move(new_positions);
+	if (has_normals)
+	{
+		normals = std::move(new_normals);
+	}
+	if (has_uvs)
+	{
+		uvs = std::move(new_uvs);
+	}
+	data.indicies = std::move(new_indicies);
+
+	return stats;
+}
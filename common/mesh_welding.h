@@ -0,0 +1,28 @@
+#pragma once
+
+#include "obj_mtl_parser.h"
+
+#include <cstdint>
+
+namespace dx11_lessons
+{
+	struct weld_settings
+	{
+		float position_tolerance = 1.0e-5f;  // max distance between merged positions
+		float normal_tolerance = 1.0e-3f;    // max distance between merged (unit) normals
+		float uv_tolerance = 1.0e-5f;        // max distance between merged uv coords
+	};
+
+	struct weld_stats
+	{
+		uint32_t vertices_before;
+		uint32_t vertices_removed;
+		uint32_t triangles_before;
+		uint32_t triangles_removed;
+	};
+
+	// Merges vertices of obj_data that are within tolerance of each other,
+	// then drops triangles that collapsed or have zero area.
+	// Group ranges are updated to the new index list.
+	auto weld_vertices(obj_data &data, const weld_settings &settings = {}) -> weld_stats;
+}
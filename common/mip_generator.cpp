@@ -0,0 +1,408 @@
+#include "mip_generator.h"
+#include "parallel_range.h"
+
+#include <DirectXMath.h>
+#include <array>
+#include <span>
+#include <algorithm>
+#include <numbers>
+#include <cmath>
+#include <bit>
+#include <cassert>
+
+using namespace dx11_lessons;
+using namespace DirectX;
+
+namespace
+{
+	using image = std::vector<XMFLOAT4A>;
+
+	constexpr auto kaiser_radius = 1.5f;   // in texels of the smaller mip
+	constexpr auto kaiser_alpha = 4.0f;
+
+	// Source texels that make up one destination texel along one axis, and their weights
+	struct axis_taps
+	{
+		int32_t first;   // may be outside the source, the padding covers it
+		std::vector<float> weights;
+	};
+
+	auto bessel_i0(float x) -> float
+	{
+		auto sum = 1.0f, term = 1.0f;
+		for (auto k = 1; k < 16; k++)
+		{
+			auto half_x_over_k = x / (2.0f * k);
+			term *= half_x_over_k * half_x_over_k;
+			sum += term;
+		}
+		return sum;
+	}
+
+	// t in destination texels
+	auto kaiser_weight(float t) -> float
+	{
+		constexpr auto pi = std::numbers::pi_v<float>;
+		auto r = t / kaiser_radius;
+		if (std::abs(r) >= 1.0f)
+		{
+			return 0.0f;
+		}
+		auto sinc = (t == 0.0f) ? 1.0f : std::sin(pi * t) / (pi * t);
+		return sinc * bessel_i0(kaiser_alpha * std::sqrt(1.0f - r * r)) / bessel_i0(kaiser_alpha);
+	}
+
+	auto make_taps(mip_filter filter, uint32_t src_size, uint32_t dst_size) -> std::vector<axis_taps>
+	{
+		auto taps = std::vector<axis_taps>(dst_size);
+		auto scale = static_cast<float>(src_size) / dst_size;
+
+		for (auto x = 0u; x < dst_size; x++)
+		{
+			auto &tap = taps[x];
+			if (src_size == dst_size)
+			{
+				tap = { static_cast<int32_t>(x), { 1.0f } };
+				continue;
+			}
+
+			if (filter == mip_filter::box)
+			{
+				// Every source texel overlapping [x, x + 1) of the destination, by how much it overlaps
+				auto begin = x * scale, end = (x + 1) * scale;
+				tap.first = static_cast<int32_t>(std::floor(begin));
+				for (auto i = tap.first; i < end; i++)
+				{
+					auto overlap = std::min(end, i + 1.0f) - std::max(begin, static_cast<float>(i));
+					tap.weights.push_back(overlap);
+				}
+			}
+			else
+			{
+				auto center = (x + 0.5f) * scale - 0.5f;
+				auto reach = kaiser_radius * scale;
+				tap.first = static_cast<int32_t>(std::floor(center - reach)) + 1;
+				auto last = static_cast<int32_t>(std::ceil(center + reach)) - 1;
+				for (auto i = tap.first; i <= last; i++)
+				{
+					tap.weights.push_back(kaiser_weight((i - center) / scale));
+				}
+			}
+
+			auto sum = 0.0f;
+			for (auto w : tap.weights)
+			{
+				sum += w;
+			}
+			for (auto &w : tap.weights)
+			{
+				w /= sum;
+			}
+		}
+		return taps;
+	}
+
+	// Texels the taps reach past either end of the source
+	auto padding_for(const std::vector<axis_taps> &taps, uint32_t src_size) -> uint32_t
+	{
+		auto pad = 0;
+		for (auto &tap : taps)
+		{
+			auto last = tap.first + static_cast<int32_t>(tap.weights.size()) - 1;
+			pad = std::max({ pad, -tap.first, last - static_cast<int32_t>(src_size) + 1 });
+		}
+		return static_cast<uint32_t>(pad);
+	}
+
+	// D3D face order +x -x +y -y +z -z, u right and v down, both -1 to 1 across a face
+	auto cube_direction(uint32_t face, float u, float v) -> std::array<float, 3>
+	{
+		switch (face)
+		{
+			case 0: return { 1.0f, -v, -u };
+			case 1: return { -1.0f, -v, u };
+			case 2: return { u, 1.0f, v };
+			case 3: return { u, -1.0f, -v };
+			case 4: return { u, -v, 1.0f };
+			default: return { -u, -v, -1.0f };
+		}
+	}
+
+	struct cube_coord
+	{
+		uint32_t face;
+		float u, v;
+	};
+
+	auto cube_face_of(const std::array<float, 3> &d) -> cube_coord
+	{
+		auto [x, y, z] = d;
+		auto ax = std::abs(x), ay = std::abs(y), az = std::abs(z);
+		if (ax >= ay and ax >= az)
+		{
+			return (x > 0) ? cube_coord{ 0, -z / ax, -y / ax } : cube_coord{ 1, z / ax, -y / ax };
+		}
+		if (ay >= az)
+		{
+			return (y > 0) ? cube_coord{ 2, x / ay, z / ay } : cube_coord{ 3, x / ay, -z / ay };
+		}
+		return (z > 0) ? cube_coord{ 4, x / az, -y / az } : cube_coord{ 5, -x / az, -y / az };
+	}
+
+	// Source with pad texels of border all round, so the filter passes don't check bounds.
+	// Cube borders come from the neighbouring faces, so there are no seams between filtered faces.
+	auto pad_slice(const std::vector<image> &level, uint32_t slice, uint32_t width, uint32_t height,
+	               uint32_t pad, bool is_cube, bool wrap) -> image
+	{
+		auto padded_width = width + 2 * pad,
+		     padded_height = height + 2 * pad;
+		auto padded = image(std::size_t{ padded_width } * padded_height);
+		auto &src = level[slice];
+
+		auto wrap_or_clamp = [&](int32_t i, uint32_t size) -> uint32_t
+		{
+			auto n = static_cast<int32_t>(size);
+			return wrap ? static_cast<uint32_t>((i % n + n) % n) : static_cast<uint32_t>(std::clamp(i, 0, n - 1));
+		};
+
+		for (auto py = 0u; py < padded_height; py++)
+		{
+			for (auto px = 0u; px < padded_width; px++)
+			{
+				auto x = static_cast<int32_t>(px) - static_cast<int32_t>(pad),
+				     y = static_cast<int32_t>(py) - static_cast<int32_t>(pad);
+				auto inside = x >= 0 and y >= 0 and x < static_cast<int32_t>(width) and y < static_cast<int32_t>(height);
+				auto &out = padded[std::size_t{ py } * padded_width + px];
+
+				if (inside or not is_cube)
+				{
+					out = src[std::size_t{ wrap_or_clamp(y, height) } * width + wrap_or_clamp(x, width)];
+					continue;
+				}
+
+				auto face = slice % 6;
+				auto u = 2.0f * (x + 0.5f) / width - 1.0f,
+				     v = 2.0f * (y + 0.5f) / height - 1.0f;
+				auto [other_face, other_u, other_v] = cube_face_of(cube_direction(face, u, v));
+				auto ox = std::clamp(static_cast<int32_t>((other_u + 1.0f) * 0.5f * width), 0, static_cast<int32_t>(width) - 1),
+				     oy = std::clamp(static_cast<int32_t>((other_v + 1.0f) * 0.5f * height), 0, static_cast<int32_t>(height) - 1);
+				out = level[slice - face + other_face][std::size_t{ static_cast<uint32_t>(oy) } * width + ox];
+			}
+		}
+		return padded;
+	}
+
+	auto srgb_to_linear(float c) -> float
+	{
+		return (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+	auto srgb_decode_table() -> const std::array<float, 256> &
+	{
+		static const auto table = []
+		{
+			auto t = std::array<float, 256>{};
+			for (auto i = 0u; i < t.size(); i++)
+			{
+				t[i] = srgb_to_linear(i / 255.0f);
+			}
+			return t;
+		}();
+		return table;
+	}
+
+	// Linear values half way between neighbouring 8 bit sRGB codes, encoding finds the bracket
+	auto srgb_encode_table() -> const std::array<float, 255> &
+	{
+		static const auto table = []
+		{
+			auto t = std::array<float, 255>{};
+			for (auto i = 0u; i < t.size(); i++)
+			{
+				t[i] = srgb_to_linear((i + 0.5f) / 255.0f);
+			}
+			return t;
+		}();
+		return table;
+	}
+
+	struct texel_codec
+	{
+		bool srgb;
+		bool alpha_weighted;
+
+		void decode(std::span<const std::byte> src, image &dst) const
+		{
+			auto &decode_table = srgb_decode_table();
+			dst.resize(src.size() / 4);
+			for (auto i = std::size_t{}; i < dst.size(); i++)
+			{
+				auto channel = [&](uint32_t c)
+				{
+					auto value = static_cast<uint8_t>(src[i * 4 + c]);
+					return (srgb and c < 3) ? decode_table[value] : value / 255.0f;
+				};
+				auto alpha = channel(3);
+				auto weight = alpha_weighted ? alpha : 1.0f;
+				dst[i] = XMFLOAT4A{ channel(0) * weight, channel(1) * weight, channel(2) * weight, alpha };
+			}
+		}
+
+		void encode(std::span<const XMFLOAT4A> src, std::byte *dst) const
+		{
+			auto &encode_table = srgb_encode_table();
+			for (auto &texel : src)
+			{
+				auto alpha = std::clamp(texel.w, 0.0f, 1.0f);
+				auto weight = (alpha_weighted and alpha > 0.0f) ? 1.0f / alpha : 1.0f;
+				for (auto c : { texel.x, texel.y, texel.z })
+				{
+					c = std::clamp(c * weight, 0.0f, 1.0f);
+					auto code = srgb ? std::upper_bound(encode_table.begin(), encode_table.end(), c) - encode_table.begin()
+					                 : std::lround(c * 255.0f);
+					*dst++ = static_cast<std::byte>(code);
+				}
+				*dst++ = static_cast<std::byte>(std::lround(alpha * 255.0f));
+			}
+		}
+	};
+
+	// Horizontal pass, one row
+	void filter_row(const XMFLOAT4A *src, XMFLOAT4A *dst, const std::vector<axis_taps> &taps, uint32_t pad)
+	{
+		for (auto x = 0u; x < taps.size(); x++)
+		{
+			auto texel = src + pad + taps[x].first;
+			auto sum = XMVectorZero();
+			for (auto w : taps[x].weights)
+			{
+				sum = XMVectorMultiplyAdd(XMLoadFloat4A(texel++), XMVectorReplicate(w), sum);
+			}
+			XMStoreFloat4A(dst + x, sum);
+		}
+	}
+
+	// Vertical pass, one row, whole rows are accumulated at a time so loads are sequential
+	void filter_column(const XMFLOAT4A *src, XMFLOAT4A *dst, uint32_t width, const axis_taps &tap, uint32_t pad)
+	{
+		auto row = src + std::size_t{ pad + tap.first } * width;
+		for (auto x = 0u; x < width; x++)
+		{
+			XMStoreFloat4A(dst + x, XMVectorScale(XMLoadFloat4A(row + x), tap.weights[0]));
+		}
+		for (auto k = 1u; k < tap.weights.size(); k++)
+		{
+			row += width;
+			auto w = XMVectorReplicate(tap.weights[k]);
+			for (auto x = 0u; x < width; x++)
+			{
+				XMStoreFloat4A(dst + x, XMVectorMultiplyAdd(XMLoadFloat4A(row + x), w, XMLoadFloat4A(dst + x)));
+			}
+		}
+	}
+
+	auto is_srgb(dxgi_format format) -> bool
+	{
+		return format == dxgi_format::r8g8b8a8_unorm_srgb or format == dxgi_format::b8g8r8a8_unorm_srgb;
+	}
+}
+
+auto dx11_lessons::full_mip_count(uint32_t width, uint32_t height) -> uint32_t
+{
+	return static_cast<uint32_t>(std::bit_width(std::max(width, height)));
+}
+
+auto dx11_lessons::can_generate_mips(dxgi_format format) -> bool
+{
+	return format == dxgi_format::r8g8b8a8_unorm or format == dxgi_format::r8g8b8a8_unorm_srgb
+	    or format == dxgi_format::b8g8r8a8_unorm or format == dxgi_format::b8g8r8a8_unorm_srgb
+	    or format == dxgi_format::b8g8r8x8_unorm;
+}
+
+auto dx11_lessons::generate_mips(const dds_texture &texture, const mip_settings &settings) -> std::vector<std::byte>
+{
+	assert(can_generate_mips(texture.format));
+
+	auto codec = texel_codec{ settings.srgb or is_srgb(texture.format),
+	                          settings.alpha_weighted and texture.format != dxgi_format::b8g8r8x8_unorm };
+	auto mip_count = full_mip_count(texture.width, texture.height);
+	auto slice_count = texture.array_size;
+
+	auto mip_width = [&](uint32_t mip) { return std::max(1u, texture.width >> mip); };
+	auto mip_height = [&](uint32_t mip) { return std::max(1u, texture.height >> mip); };
+
+	auto slice_size = std::size_t{};
+	for (auto mip = 0u; mip < mip_count; mip++)
+	{
+		slice_size += std::size_t{ mip_width(mip) } * mip_height(mip) * 4;
+	}
+	auto output = std::vector<std::byte>(slice_size * slice_count);
+
+	// Mip 0 goes out as it came in, and to float for filtering the next one
+	auto level = std::vector<image>(slice_count);
+	for_each_range(slice_count, [&](uint32_t first, uint32_t last)
+	{
+		for (auto slice = first; slice < last; slice++)
+		{
+			auto src = dds_subresource(texture, slice, 0);
+			std::copy(src.begin(), src.end(), output.begin() + slice * slice_size);
+			codec.decode(src, level[slice]);
+		}
+		return true;
+	});
+
+	auto level_offset = std::size_t{ mip_width(0) } * mip_height(0) * 4;
+	for (auto mip = 1u; mip < mip_count; mip++)
+	{
+		auto src_width = mip_width(mip - 1), src_height = mip_height(mip - 1),
+		     dst_width = mip_width(mip), dst_height = mip_height(mip);
+		auto taps_x = make_taps(settings.filter, src_width, dst_width),
+		     taps_y = make_taps(settings.filter, src_height, dst_height);
+		auto pad = std::max(padding_for(taps_x, src_width), padding_for(taps_y, src_height));
+		auto padded_width = src_width + 2 * pad,
+		     padded_height = src_height + 2 * pad;
+
+		auto padded = std::vector<image>(slice_count);
+		for_each_range(slice_count, [&](uint32_t first, uint32_t last)
+		{
+			for (auto slice = first; slice < last; slice++)
+			{
+				padded[slice] = pad_slice(level, slice, src_width, src_height, pad, texture.is_cube, settings.wrap);
+			}
+			return true;
+		});
+
+		// Rows of every slice go in one range, so a single large face still spreads over every thread
+		auto across = std::vector<image>(slice_count, image(std::size_t{ dst_width } * padded_height));
+		for_each_range(slice_count * padded_height, [&](uint32_t first, uint32_t last)
+		{
+			for (auto row = first; row < last; row++)
+			{
+				auto slice = row / padded_height, y = row % padded_height;
+				filter_row(padded[slice].data() + std::size_t{ y } * padded_width,
+				           across[slice].data() + std::size_t{ y } * dst_width,
+				           taps_x, pad);
+			}
+			return true;
+		});
+
+		auto next = std::vector<image>(slice_count, image(std::size_t{ dst_width } * dst_height));
+		for_each_range(slice_count * dst_height, [&](uint32_t first, uint32_t last)
+		{
+			for (auto row = first; row < last; row++)
+			{
+				auto slice = row / dst_height, y = row % dst_height;
+				auto dst = next[slice].data() + std::size_t{ y } * dst_width;
+				filter_column(across[slice].data(), dst, dst_width, taps_y[y], pad);
+				codec.encode({ dst, dst_width },
+				             output.data() + slice * slice_size + level_offset + std::size_t{ y } * dst_width * 4);
+			}
+			return true;
+		});
+
+		level = std::move(next);
+		level_offset += std::size_t{ dst_width } * dst_height * 4;
+	}
+
+	return output;
+}
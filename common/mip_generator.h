@@ -0,0 +1,35 @@
+#pragma once
+
+#include "dds_file.h"
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace dx11_lessons
+{
+	enum class mip_filter
+	{
+		box,      // area average, cheap, a little blurry
+		kaiser,   // windowed sinc over 3 texels of the smaller mip, sharper, the usual offline choice
+	};
+
+	struct mip_settings
+	{
+		mip_filter filter = mip_filter::box;
+		bool srgb = false;             // filter in linear light even if the format isn't an _srgb one
+		bool alpha_weighted = false;   // weight colour by alpha, so transparent texels don't bleed into edges
+		bool wrap = false;             // tiling texture, filter across opposite edges. Cubes always filter across faces.
+	};
+
+	auto full_mip_count(uint32_t width, uint32_t height) -> uint32_t;
+
+	// 8 bit, 4 channel formats, alpha last
+	auto can_generate_mips(dxgi_format format) -> bool;
+
+	// Full mip chain of every array slice of a texture, in dds_texture data order.
+	// Only mip 0 of the source is read, it is copied as is, the rest are filtered from the mip above in float.
+	// _srgb formats are always filtered in linear light.
+	// Faces and rows are spread over the hardware threads, texels are filtered 4 channels at a time.
+	auto generate_mips(const dds_texture &texture, const mip_settings &settings) -> std::vector<std::byte>;
+}
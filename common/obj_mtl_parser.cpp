@@ -2,8 +2,6 @@
 
 #include "helpers.h"
 
-#include <cppitertools\zip.hpp>
-
 #include <charconv>
 #include <filesystem>
 #include <sstream>
@@ -69,7 +67,7 @@ namespace
 		for (auto &in_grp : groups)
 		{
 			auto mtl_name = in_grp.mtl_name;
-			if (mtl_name == "")
+			if (mtl_name == "" and not output.groups.empty())
 			{
 				mtl_name = output.groups.back().material_name;
 			}
@@ -90,13 +88,17 @@ namespace
 				output.uv_coords.push_back(t);
 			}
 			out_grp.index_count = static_cast<uint32_t>(output.indicies.size()) - out_grp.index_start;
+			out_grp.bounding_obb = fit_oriented_box(output.vertices, output.indicies,
+			                                        out_grp.index_start, out_grp.index_count);
 		}
 
+		output.bounding_obb = fit_oriented_box(verticies);
+
 		return output;
 	}
 }
 
-auto dx11_lessons::parse_obj(const std::vector<uint8_t> &file_data) -> obj_data
+auto dx11_lessons::parse_obj(std::span<const std::byte> file_data) -> obj_data
 {
 	auto data_stream = memory_stream(reinterpret_cast<const char *>(file_data.data()),
 	                                 file_data.size());
@@ -213,7 +215,7 @@ auto dx11_lessons::parse_obj(const std::vector<uint8_t> &file_data) -> obj_data
 	return to_obj_data(min_point, max_point, obj_groups, obj_mtls, obj_v, obj_vn, obj_vt);
 }
 
-auto dx11_lessons::parse_mtl(const std::vector<uint8_t> &file_data) -> mtl_data
+auto dx11_lessons::parse_mtl(std::span<const std::byte> file_data) -> mtl_data
 {
 	auto data_stream = memory_stream(reinterpret_cast<const char *>(file_data.data()), 
 	                                 file_data.size());
@@ -1,7 +1,11 @@
 #pragma once
 
+#include "oriented_box.h"
+
 #include <vector>
 #include <array>
+#include <span>
+#include <cstddef>
 #include <string_view>
 #include <filesystem>
 #include <DirectXMath.h>
@@ -16,6 +20,7 @@ namespace dx11_lessons
 		using file_path = std::filesystem::path;
 		
 		std::array<position, 8> bounding_box;
+		oriented_box bounding_obb;
 		std::vector<position> vertices;
 		std::vector<normal> normals;
 		std::vector<uv_coord> uv_coords;
@@ -27,6 +32,7 @@ namespace dx11_lessons
 			std::string material_name;
 			uint32_t index_start;
 			uint32_t index_count;
+			oriented_box bounding_obb;
 		};
 
 		std::vector<group> groups;
@@ -62,16 +68,16 @@ namespace dx11_lessons
 		std::vector<material> materials;
 	};
 
-	auto parse_obj(const std::vector<uint8_t> &file_data) -> obj_data;
-	auto parse_mtl(const std::vector<uint8_t> &file_data) -> mtl_data;
+	auto parse_obj(std::span<const std::byte> file_data) -> obj_data;
+	auto parse_mtl(std::span<const std::byte> file_data) -> mtl_data;
 
 	class obj_parser
 	{
-		void parse_obj(const std::vector<uint8_t> &file_data);
+		void parse_obj(std::span<const std::byte> file_data);
 	};
 
 	class mtl_parser
 	{
-		void parse_mtl(const std::vector<uint8_t> &file_data);
+		void parse_mtl(std::span<const std::byte> file_data);
 	};
 }
\ No newline at end of file
@@ -0,0 +1,384 @@
+#include "oriented_box.h"
+
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cassert>
+
+using namespace dx11_lessons;
+using namespace DirectX;
+
+namespace
+{
+	using point_list = std::vector<XMFLOAT3>;
+	using basis = std::array<XMVECTOR, 3>;
+
+	constexpr auto sweep_steps = 16;
+	constexpr auto refine_passes = 4;
+
+	// Eigen vectors of symmetric 3x3 matrix, using cyclic Jacobi rotations
+	auto eigen_vectors(std::array<std::array<double, 3>, 3> a) -> std::array<std::array<double, 3>, 3>
+	{
+		auto v = std::array<std::array<double, 3>, 3>{ { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } } };
+
+		for (auto sweep = 0; sweep < 32; sweep++)
+		{
+			auto off = a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+			if (off < 1.0e-24)
+			{
+				break;
+			}
+
+			for (auto [p, q] : { std::pair{ 0, 1 }, std::pair{ 0, 2 }, std::pair{ 1, 2 } })
+			{
+				if (std::abs(a[p][q]) < 1.0e-30)
+				{
+					continue;
+				}
+
+				auto theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+				auto t = (theta >= 0.0 ? 1.0 : -1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+				auto c = 1.0 / std::sqrt(t * t + 1.0),
+				     s = t * c;
+
+				for (auto k = 0; k < 3; k++)
+				{
+					auto akp = a[k][p], akq = a[k][q];
+					a[k][p] = c * akp - s * akq;
+					a[k][q] = s * akp + c * akq;
+				}
+				for (auto k = 0; k < 3; k++)
+				{
+					auto apk = a[p][k], aqk = a[q][k];
+					a[p][k] = c * apk - s * aqk;
+					a[q][k] = s * apk + c * aqk;
+				}
+				for (auto k = 0; k < 3; k++)
+				{
+					auto vkp = v[k][p], vkq = v[k][q];
+					v[k][p] = c * vkp - s * vkq;
+					v[k][q] = s * vkp + c * vkq;
+				}
+			}
+		}
+
+		return v;
+	}
+
+	auto pca_basis(const point_list &points) -> basis
+	{
+		auto mean = std::array<double, 3>{};
+		for (auto &p : points)
+		{
+			mean[0] += p.x; mean[1] += p.y; mean[2] += p.z;
+		}
+		for (auto &m : mean)
+		{
+			m /= static_cast<double>(points.size());
+		}
+
+		auto cov = std::array<std::array<double, 3>, 3>{};
+		for (auto &p : points)
+		{
+			auto d = std::array{ p.x - mean[0], p.y - mean[1], p.z - mean[2] };
+			for (auto r = 0; r < 3; r++)
+			{
+				for (auto c = r; c < 3; c++)
+				{
+					cov[r][c] += d[r] * d[c];
+				}
+			}
+		}
+		cov[1][0] = cov[0][1];
+		cov[2][0] = cov[0][2];
+		cov[2][1] = cov[1][2];
+
+		auto v = eigen_vectors(cov);
+		auto a0 = XMVector3Normalize(XMVectorSet(static_cast<float>(v[0][0]), static_cast<float>(v[1][0]), static_cast<float>(v[2][0]), 0.0f)),
+		     a1 = XMVector3Normalize(XMVectorSet(static_cast<float>(v[0][1]), static_cast<float>(v[1][1]), static_cast<float>(v[2][1]), 0.0f));
+		a1 = XMVector3Normalize(a1 - XMVector3Dot(a1, a0) * a0);
+
+		return { a0, a1, XMVector3Cross(a0, a1) };
+	}
+
+	// Points that are extreme along the 13 k-DOP directions of both the world
+	// and the PCA frame. Every one of them is on the convex hull.
+	auto hull_candidates(const point_list &points, const basis &pca) -> point_list
+	{
+		auto directions = std::vector<XMVECTOR>{};
+		auto add_kdop_directions = [&](XMVECTOR x, XMVECTOR y, XMVECTOR z)
+		{
+			directions.insert(directions.end(), {
+				x, y, z,
+				x + y, x - y, x + z, x - z, y + z, y - z,
+				x + y + z, x + y - z, x - y + z, x - y - z,
+			});
+		};
+		add_kdop_directions(XMVectorSet(1, 0, 0, 0), XMVectorSet(0, 1, 0, 0), XMVectorSet(0, 0, 1, 0));
+		add_kdop_directions(pca[0], pca[1], pca[2]);
+
+		auto candidate_idx = std::vector<std::size_t>{};
+		for (auto &dir : directions)
+		{
+			auto min_d = std::numeric_limits<float>::max(),
+			     max_d = std::numeric_limits<float>::lowest();
+			auto min_i = std::size_t{}, max_i = std::size_t{};
+			for (auto i = std::size_t{}; i < points.size(); i++)
+			{
+				auto d = XMVectorGetX(XMVector3Dot(XMLoadFloat3(&points[i]), dir));
+				if (d < min_d) { min_d = d; min_i = i; }
+				if (d > max_d) { max_d = d; max_i = i; }
+			}
+			candidate_idx.push_back(min_i);
+			candidate_idx.push_back(max_i);
+		}
+
+		std::sort(candidate_idx.begin(), candidate_idx.end());
+		candidate_idx.erase(std::unique(candidate_idx.begin(), candidate_idx.end()), candidate_idx.end());
+
+		auto candidates = point_list{};
+		for (auto i : candidate_idx)
+		{
+			candidates.push_back(points[i]);
+		}
+		return candidates;
+	}
+
+	struct box_range
+	{
+		XMVECTOR min_proj;
+		XMVECTOR max_proj;
+	};
+
+	auto project(const point_list &points, const basis &axes) -> box_range
+	{
+		auto min_proj = XMVectorReplicate(std::numeric_limits<float>::max()),
+		     max_proj = XMVectorReplicate(std::numeric_limits<float>::lowest());
+
+		auto rows = XMMATRIX{ axes[0], axes[1], axes[2], XMVectorZero() };
+		auto to_local = XMMatrixTranspose(rows);
+
+		for (auto &p : points)
+		{
+			auto local = XMVector3TransformNormal(XMLoadFloat3(&p), to_local);
+			min_proj = XMVectorMin(min_proj, local);
+			max_proj = XMVectorMax(max_proj, local);
+		}
+
+		return { min_proj, max_proj };
+	}
+
+	auto volume(const box_range &range, float padding) -> float
+	{
+		auto size = XMVectorAdd(XMVectorSubtract(range.max_proj, range.min_proj), XMVectorReplicate(padding));
+		return XMVectorGetX(size) * XMVectorGetY(size) * XMVectorGetZ(size);
+	}
+
+	auto rotate_about(const basis &axes, int k, float angle) -> basis
+	{
+		auto c = std::cos(angle), s = std::sin(angle);
+		auto u = (k + 1) % 3, w = (k + 2) % 3;
+
+		auto result = axes;
+		result[u] = c * axes[u] + s * axes[w];
+		result[w] = c * axes[w] - s * axes[u];
+		return result;
+	}
+
+	auto to_oriented_box(const basis &axes, const box_range &range) -> oriented_box
+	{
+		auto local_center = 0.5f * (range.min_proj + range.max_proj);
+		auto center = XMVectorGetX(local_center) * axes[0]
+		            + XMVectorGetY(local_center) * axes[1]
+		            + XMVectorGetZ(local_center) * axes[2];
+
+		auto box = oriented_box{};
+		XMStoreFloat3(&box.center, center);
+		XMStoreFloat3(&box.extents, 0.5f * (range.max_proj - range.min_proj));
+		for (auto i = 0; i < 3; i++)
+		{
+			XMStoreFloat3(&box.axes[i], axes[i]);
+		}
+		return box;
+	}
+}
+
+auto dx11_lessons::fit_oriented_box(const std::vector<XMFLOAT3> &points) -> oriented_box
+{
+	const auto world_axes = basis{ XMVectorSet(1, 0, 0, 0), XMVectorSet(0, 1, 0, 0), XMVectorSet(0, 0, 1, 0) };
+
+	if (points.empty())
+	{
+		return to_oriented_box(world_axes, { XMVectorZero(), XMVectorZero() });
+	}
+
+	auto pca = pca_basis(points);
+	auto candidates = hull_candidates(points, pca);
+
+	auto world_range = project(points, world_axes);
+	auto padding = 1.0e-4f * XMVectorGetX(XMVector3Length(world_range.max_proj - world_range.min_proj));
+
+	// Sweep rotations about each axis in turn, narrowing the range every pass.
+	auto best = pca;
+	auto best_volume = volume(project(candidates, best), padding);
+	auto sweep_range = XM_PIDIV2 * 0.5f;
+	for (auto pass = 0; pass < refine_passes; pass++)
+	{
+		for (auto k = 0; k < 3; k++)
+		{
+			auto pivot = best;
+			for (auto step = -sweep_steps; step <= sweep_steps; step++)
+			{
+				auto angle = sweep_range * static_cast<float>(step) / sweep_steps;
+				auto trial = rotate_about(pivot, k, angle);
+				auto trial_volume = volume(project(candidates, trial), padding);
+				if (trial_volume < best_volume)
+				{
+					best_volume = trial_volume;
+					best = trial;
+				}
+			}
+		}
+		sweep_range /= sweep_steps * 0.5f;
+	}
+
+	auto best_range = project(points, best);
+	if (volume(world_range, padding) <= volume(best_range, padding))
+	{
+		return to_oriented_box(world_axes, world_range);
+	}
+
+	return to_oriented_box(best, best_range);
+}
+
+auto dx11_lessons::fit_oriented_box(const std::vector<XMFLOAT3> &points,
+                                    const std::vector<uint32_t> &indicies,
+                                    uint32_t index_start, uint32_t index_count) -> oriented_box
+{
+	auto used = std::vector<uint32_t>(indicies.begin() + index_start,
+	                                  indicies.begin() + index_start + index_count);
+	std::sort(used.begin(), used.end());
+	used.erase(std::unique(used.begin(), used.end()), used.end());
+
+	auto group_points = point_list{};
+	group_points.reserve(used.size());
+	for (auto i : used)
+	{
+		group_points.push_back(points.at(i));
+	}
+
+	return fit_oriented_box(group_points);
+}
+
+auto dx11_lessons::transform_oriented_box(const oriented_box &box, FXMMATRIX transform) -> oriented_box
+{
+	auto result = oriented_box{};
+	XMStoreFloat3(&result.center, XMVector3TransformCoord(XMLoadFloat3(&box.center), transform));
+
+	auto extents = std::array{ box.extents.x, box.extents.y, box.extents.z };
+	auto new_extents = std::array<float, 3>{};
+	for (auto i = 0; i < 3; i++)
+	{
+		auto axis = XMVector3TransformNormal(XMLoadFloat3(&box.axes[i]), transform);
+		auto scale = XMVectorGetX(XMVector3Length(axis));
+		XMStoreFloat3(&result.axes[i], XMVector3Normalize(axis));
+		new_extents[i] = extents[i] * scale;
+	}
+	result.extents = { new_extents[0], new_extents[1], new_extents[2] };
+
+	return result;
+}
+
+auto dx11_lessons::make_view_frustum(FXMMATRIX view_projection) -> view_frustum
+{
+	auto columns = XMMatrixTranspose(view_projection);
+	auto planes = std::array
+	{
+		XMPlaneNormalize(columns.r[3] + columns.r[0]),  // left
+		XMPlaneNormalize(columns.r[3] - columns.r[0]),  // right
+		XMPlaneNormalize(columns.r[3] + columns.r[1]),  // bottom
+		XMPlaneNormalize(columns.r[3] - columns.r[1]),  // top
+		XMPlaneNormalize(columns.r[2]),                 // near
+		XMPlaneNormalize(columns.r[3] - columns.r[2]),  // far
+		XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f),
+		XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f),
+	};
+
+	auto frustum = view_frustum{};
+	for (auto b = 0; b < 2; b++)
+	{
+		auto soa = XMMatrixTranspose(XMMATRIX{ planes[b * 4 + 0], planes[b * 4 + 1], planes[b * 4 + 2], planes[b * 4 + 3] });
+		frustum.normal_x[b] = soa.r[0];
+		frustum.normal_y[b] = soa.r[1];
+		frustum.normal_z[b] = soa.r[2];
+		frustum.distance[b] = soa.r[3];
+	}
+	return frustum;
+}
+
+auto dx11_lessons::intersects(const oriented_box &box, const view_frustum &frustum) -> bool
+{
+	auto splat = [](const XMFLOAT3 &v)
+	{
+		return std::array{ XMVectorReplicate(v.x), XMVectorReplicate(v.y), XMVectorReplicate(v.z) };
+	};
+
+	auto c = splat(box.center);
+	auto a0 = splat(box.axes[0]),
+	     a1 = splat(box.axes[1]),
+	     a2 = splat(box.axes[2]);
+	auto e = splat(box.extents);
+
+	for (auto b = 0; b < 2; b++)
+	{
+		auto &nx = frustum.normal_x[b];
+		auto &ny = frustum.normal_y[b];
+		auto &nz = frustum.normal_z[b];
+
+		auto dot = [&](const std::array<XMVECTOR, 3> &v)
+		{
+			return XMVectorMultiplyAdd(nx, v[0], XMVectorMultiplyAdd(ny, v[1], XMVectorMultiply(nz, v[2])));
+		};
+
+		// Signed distance of centre, and projected radius of the box, for 4 planes at once
+		auto dist = XMVectorAdd(dot(c), frustum.distance[b]);
+		auto radius = XMVectorMultiplyAdd(XMVectorAbs(dot(a0)), e[0],
+		              XMVectorMultiplyAdd(XMVectorAbs(dot(a1)), e[1],
+		              XMVectorMultiply(XMVectorAbs(dot(a2)), e[2])));
+
+		if (not XMVector4GreaterOrEqual(XMVectorAdd(dist, radius), XMVectorZero()))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+auto dx11_lessons::intersects(const oriented_box &box, FXMVECTOR ray_origin, FXMVECTOR ray_direction)
+	-> std::optional<float>
+{
+	auto rows = XMMATRIX{ XMLoadFloat3(&box.axes[0]), XMLoadFloat3(&box.axes[1]), XMLoadFloat3(&box.axes[2]), XMVectorZero() };
+	auto to_local = XMMatrixTranspose(rows);
+
+	auto origin = XMVector3TransformNormal(XMVectorSubtract(ray_origin, XMLoadFloat3(&box.center)), to_local);
+	auto direction = XMVector3TransformNormal(ray_direction, to_local);
+	auto extents = XMLoadFloat3(&box.extents);
+
+	// Slab test in box space, all three slabs at once
+	auto inv_dir = XMVectorReciprocal(direction);
+	auto t0 = XMVectorMultiply(XMVectorSubtract(XMVectorNegate(extents), origin), inv_dir),
+	     t1 = XMVectorMultiply(XMVectorSubtract(extents, origin), inv_dir);
+	auto t_near = XMVectorMin(t0, t1),
+	     t_far = XMVectorMax(t0, t1);
+
+	auto t_enter = std::max({ XMVectorGetX(t_near), XMVectorGetY(t_near), XMVectorGetZ(t_near), 0.0f }),
+	     t_exit = std::min({ XMVectorGetX(t_far), XMVectorGetY(t_far), XMVectorGetZ(t_far) });
+
+	if (t_enter > t_exit)
+	{
+		return std::nullopt;
+	}
+
+	return t_enter;
+}
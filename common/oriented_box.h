@@ -0,0 +1,44 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <array>
+#include <vector>
+#include <optional>
+#include <cstdint>
+
+namespace dx11_lessons
+{
+	struct oriented_box
+	{
+		DirectX::XMFLOAT3 center;
+		DirectX::XMFLOAT3 extents;               // half size along each axis
+		std::array<DirectX::XMFLOAT3, 3> axes;   // orthonormal
+	};
+
+	// Frustum planes in SoA form, 4 planes per vector.
+	// Plane 6 and 7 are padding that always passes.
+	struct view_frustum
+	{
+		std::array<DirectX::XMVECTOR, 2> normal_x;
+		std::array<DirectX::XMVECTOR, 2> normal_y;
+		std::array<DirectX::XMVECTOR, 2> normal_z;
+		std::array<DirectX::XMVECTOR, 2> distance;
+	};
+
+	// PCA fit followed by a rotation sweep over extreme points to minimise volume.
+	auto fit_oriented_box(const std::vector<DirectX::XMFLOAT3> &points) -> oriented_box;
+	auto fit_oriented_box(const std::vector<DirectX::XMFLOAT3> &points,
+	                      const std::vector<uint32_t> &indicies,
+	                      uint32_t index_start, uint32_t index_count) -> oriented_box;
+
+	// Assumes transform is rotation, uniform scale and translation (e.g. instance transforms)
+	auto transform_oriented_box(const oriented_box &box, DirectX::FXMMATRIX transform) -> oriented_box;
+
+	auto make_view_frustum(DirectX::FXMMATRIX view_projection) -> view_frustum;
+
+	auto intersects(const oriented_box &box, const view_frustum &frustum) -> bool;
+
+	// Returns distance along direction to the nearest intersection, if any.
+	auto intersects(const oriented_box &box, DirectX::FXMVECTOR ray_origin, DirectX::FXMVECTOR ray_direction)
+		-> std::optional<float>;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "job_system.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+namespace dx11_lessons
+{
+	// Splits [0, count) into a few ranges per hardware thread and calls fn(first, last) -> bool for each,
+	// on the shared job system. The calling thread runs ranges too until all are done, so calls nest.
+	// True if every call returned true.
+	template <typename fn_t>
+	auto for_each_range(uint32_t count, fn_t fn) -> bool
+	{
+		constexpr auto ranges_per_thread = 4u;
+
+		auto &jobs = job_system::shared();
+		auto range_count = std::min(count, (jobs.worker_count() + 1) * ranges_per_thread);
+		if (range_count <= 1)
+		{
+			return fn(0u, count);
+		}
+
+		auto all_good = std::atomic<bool>{ true };
+		jobs.parallel_for(count, (count + range_count - 1) / range_count, [&](uint32_t first, uint32_t last)
+		{
+			if (not fn(first, last))
+			{
+				all_good = false;
+			}
+		});
+		return all_good;
+	}
+}
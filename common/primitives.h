@@ -0,0 +1,232 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <array>
+#include <cstdint>
+
+// Built-in shapes generated at compile time.
+// vertex_t needs position (XMFLOAT3), normal (XMFLOAT3) and texcoord (XMFLOAT2) members,
+// like gpu_datatypes vertex. Triangles are wound like the lesson cube, (b - a) x (c - a) points out.
+namespace dx11_lessons::primitives
+{
+	template <typename vertex_t, std::size_t vertex_count, std::size_t index_count>
+	struct shape
+	{
+		std::array<vertex_t, vertex_count> vertices;
+		std::array<uint32_t, index_count> indicies;
+	};
+
+	namespace detail
+	{
+		constexpr auto pi = 3.14159265358979323846;
+
+		// Taylor series after reducing to [-pi, pi], good to float precision
+		constexpr auto sin(double x) -> double
+		{
+			while (x > pi)
+			{
+				x -= 2.0 * pi;
+			}
+			while (x < -pi)
+			{
+				x += 2.0 * pi;
+			}
+
+			auto term = x, sum = x;
+			for (auto n = 1; n < 12; n++)
+			{
+				term *= -x * x / ((2.0 * n) * (2.0 * n + 1.0));
+				sum += term;
+			}
+			return sum;
+		}
+
+		constexpr auto cos(double x) -> double
+		{
+			return sin(x + pi / 2.0);
+		}
+
+		template <typename vertex_t>
+		constexpr auto make_vertex(double px, double py, double pz,
+		                           double nx, double ny, double nz,
+		                           double u, double v) -> vertex_t
+		{
+			auto vtx = vertex_t{};
+			vtx.position = { static_cast<float>(px), static_cast<float>(py), static_cast<float>(pz) };
+			vtx.normal = { static_cast<float>(nx), static_cast<float>(ny), static_cast<float>(nz) };
+			vtx.texcoord = { static_cast<float>(u), static_cast<float>(v) };
+			return vtx;
+		}
+	}
+
+	// Same layout as the lessons' cube_base, 4 vertices per face
+	template <typename vertex_t>
+	constexpr auto cube(float half_size = 1.0f) -> shape<vertex_t, 24, 36>
+	{
+		using face_corners = std::array<std::array<float, 3>, 4>;
+		constexpr auto corners = std::array<face_corners, 6>
+		{ {
+			{ { { -1, -1, +1 }, { +1, -1, +1 }, { +1, +1, +1 }, { -1, +1, +1 } } },   // front
+			{ { { -1, -1, -1 }, { +1, -1, -1 }, { +1, -1, +1 }, { -1, -1, +1 } } },   // bottom
+			{ { { +1, -1, -1 }, { +1, +1, -1 }, { +1, +1, +1 }, { +1, -1, +1 } } },   // right
+			{ { { -1, -1, -1 }, { -1, -1, +1 }, { -1, +1, +1 }, { -1, +1, -1 } } },   // left
+			{ { { -1, -1, -1 }, { -1, +1, -1 }, { +1, +1, -1 }, { +1, -1, -1 } } },   // back
+			{ { { -1, +1, -1 }, { -1, +1, +1 }, { +1, +1, +1 }, { +1, +1, -1 } } },   // top
+		} };
+		constexpr auto normals = std::array<std::array<float, 3>, 6>
+		{ {
+			{ 0, 0, +1 }, { 0, -1, 0 }, { +1, 0, 0 }, { -1, 0, 0 }, { 0, 0, -1 }, { 0, +1, 0 },
+		} };
+		constexpr auto uvs = std::array<std::array<float, 2>, 4>{ { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } } };
+
+		auto result = shape<vertex_t, 24, 36>{};
+		for (auto f = 0u; f < 6; f++)
+		{
+			for (auto c = 0u; c < 4; c++)
+			{
+				auto &p = corners[f][c];
+				auto &n = normals[f];
+				result.vertices[f * 4 + c] = detail::make_vertex<vertex_t>(p[0] * half_size, p[1] * half_size, p[2] * half_size,
+				                                                           n[0], n[1], n[2],
+				                                                           uvs[c][0], uvs[c][1]);
+			}
+
+			auto base = f * 4;
+			auto tris = std::array{ base + 0, base + 1, base + 2, base + 0, base + 2, base + 3 };
+			for (auto i = 0u; i < 6; i++)
+			{
+				result.indicies[f * 6 + i] = tris[i];
+			}
+		}
+		return result;
+	}
+
+	// Square in the XZ plane, facing +Y
+	template <typename vertex_t>
+	constexpr auto plane(float half_size = 1.0f) -> shape<vertex_t, 4, 6>
+	{
+		auto s = static_cast<double>(half_size);
+		return {
+			{
+				detail::make_vertex<vertex_t>(-s, 0, -s, 0, 1, 0, 0, 0),
+				detail::make_vertex<vertex_t>(-s, 0, +s, 0, 1, 0, 0, 1),
+				detail::make_vertex<vertex_t>(+s, 0, +s, 0, 1, 0, 1, 1),
+				detail::make_vertex<vertex_t>(+s, 0, -s, 0, 1, 0, 1, 0),
+			},
+			{ 0, 1, 2, 0, 2, 3 }
+		};
+	}
+
+	// Full screen quad in the XY plane, -1 to +1, facing -Z, uv (0, 0) at top left
+	template <typename vertex_t>
+	constexpr auto quad() -> shape<vertex_t, 4, 6>
+	{
+		return {
+			{
+				detail::make_vertex<vertex_t>(-1, +1, 0, 0, 0, -1, 0, 0),
+				detail::make_vertex<vertex_t>(+1, +1, 0, 0, 0, -1, 1, 0),
+				detail::make_vertex<vertex_t>(+1, -1, 0, 0, 0, -1, 1, 1),
+				detail::make_vertex<vertex_t>(-1, -1, 0, 0, 0, -1, 0, 1),
+			},
+			{ 0, 1, 2, 0, 2, 3 }
+		};
+	}
+
+	// Longitude/latitude sphere, the seam column is duplicated for uvs
+	template <typename vertex_t, uint32_t segments = 16, uint32_t rings = 8>
+	constexpr auto sphere(float radius = 1.0f)
+		-> shape<vertex_t, (segments + 1) * (rings + 1), segments * (rings - 1) * 6>
+	{
+		static_assert(segments >= 3 and rings >= 2);
+
+		auto result = shape<vertex_t, (segments + 1) * (rings + 1), segments * (rings - 1) * 6>{};
+		for (auto r = 0u; r <= rings; r++)
+		{
+			auto phi = detail::pi * r / rings;
+			for (auto s = 0u; s <= segments; s++)
+			{
+				auto theta = 2.0 * detail::pi * s / segments;
+				auto x = detail::sin(phi) * detail::cos(theta),
+				     y = detail::cos(phi),
+				     z = detail::sin(phi) * detail::sin(theta);
+				result.vertices[r * (segments + 1) + s] = detail::make_vertex<vertex_t>(x * radius, y * radius, z * radius,
+				                                                                        x, y, z,
+				                                                                        static_cast<double>(s) / segments,
+				                                                                        static_cast<double>(r) / rings);
+			}
+		}
+
+		// Pole rows collapse to a point, so they only get one triangle per quad
+		auto i = 0u;
+		for (auto r = 0u; r < rings; r++)
+		{
+			for (auto s = 0u; s < segments; s++)
+			{
+				auto a = r * (segments + 1) + s, b = a + 1,
+				     c = a + segments + 1, d = c + 1;
+				if (r != 0)
+				{
+					result.indicies[i++] = a; result.indicies[i++] = b; result.indicies[i++] = c;
+				}
+				if (r != rings - 1)
+				{
+					result.indicies[i++] = b; result.indicies[i++] = d; result.indicies[i++] = c;
+				}
+			}
+		}
+		return result;
+	}
+
+	// Along Y from -half_height to +half_height, with caps
+	template <typename vertex_t, uint32_t segments = 16>
+	constexpr auto cylinder(float radius = 1.0f, float half_height = 1.0f)
+		-> shape<vertex_t, (segments + 1) * 2 + (segments + 1) * 2, segments * 12>
+	{
+		static_assert(segments >= 3);
+
+		auto result = shape<vertex_t, (segments + 1) * 2 + (segments + 1) * 2, segments * 12>{};
+		auto h = static_cast<double>(half_height);
+
+		// Side: top row then bottom row
+		for (auto s = 0u; s <= segments; s++)
+		{
+			auto theta = 2.0 * detail::pi * s / segments;
+			auto x = detail::cos(theta), z = detail::sin(theta);
+			auto u = static_cast<double>(s) / segments;
+			result.vertices[s] = detail::make_vertex<vertex_t>(x * radius, +h, z * radius, x, 0, z, u, 0);
+			result.vertices[segments + 1 + s] = detail::make_vertex<vertex_t>(x * radius, -h, z * radius, x, 0, z, u, 1);
+		}
+
+		// Caps: centre then ring, top then bottom
+		auto top = (segments + 1) * 2,
+		     bottom = top + segments + 1;
+		result.vertices[top] = detail::make_vertex<vertex_t>(0, +h, 0, 0, +1, 0, 0.5, 0.5);
+		result.vertices[bottom] = detail::make_vertex<vertex_t>(0, -h, 0, 0, -1, 0, 0.5, 0.5);
+		for (auto s = 0u; s < segments; s++)
+		{
+			auto theta = 2.0 * detail::pi * s / segments;
+			auto x = detail::cos(theta), z = detail::sin(theta);
+			result.vertices[top + 1 + s] = detail::make_vertex<vertex_t>(x * radius, +h, z * radius, 0, +1, 0,
+			                                                             0.5 + 0.5 * x, 0.5 - 0.5 * z);
+			result.vertices[bottom + 1 + s] = detail::make_vertex<vertex_t>(x * radius, -h, z * radius, 0, -1, 0,
+			                                                                0.5 + 0.5 * x, 0.5 + 0.5 * z);
+		}
+
+		auto i = 0u;
+		for (auto s = 0u; s < segments; s++)
+		{
+			auto a = s, b = s + 1,
+			     c = segments + 1 + s, d = c + 1;
+			auto r0 = 1 + s, r1 = 1 + (s + 1) % segments;
+
+			for (auto idx : { a, b, c,
+			                  b, d, c,
+			                  top, top + r1, top + r0,
+			                  bottom, bottom + r0, bottom + r1 })
+			{
+				result.indicies[i++] = idx;
+			}
+		}
+		return result;
+	}
+}
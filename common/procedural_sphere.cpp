@@ -0,0 +1,228 @@
+#include "procedural_sphere.h"
+
+#include <array>
+#include <limits>
+#include <utility>
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+
+using namespace dx11_lessons;
+using namespace DirectX;
+
+namespace
+{
+	struct base_shape
+	{
+		std::vector<XMFLOAT3> positions;
+		std::vector<XMFLOAT2> uv_coords;
+		std::vector<uint32_t> indicies;
+		uint32_t edge_count;
+	};
+
+	// Same faces, corners and uvs as cube_base in the lessons.
+	// Faces don't share vertices so each keeps its own uv square.
+	auto make_cube() -> base_shape
+	{
+		constexpr auto corners = std::array<std::array<XMFLOAT3, 4>, 6>
+		{ {
+			{ { { -1.0f, -1.0f, +1.0f }, { +1.0f, -1.0f, +1.0f }, { +1.0f, +1.0f, +1.0f }, { -1.0f, +1.0f, +1.0f } } },
+			{ { { -1.0f, -1.0f, -1.0f }, { +1.0f, -1.0f, -1.0f }, { +1.0f, -1.0f, +1.0f }, { -1.0f, -1.0f, +1.0f } } },
+			{ { { +1.0f, -1.0f, -1.0f }, { +1.0f, +1.0f, -1.0f }, { +1.0f, +1.0f, +1.0f }, { +1.0f, -1.0f, +1.0f } } },
+			{ { { -1.0f, -1.0f, -1.0f }, { -1.0f, -1.0f, +1.0f }, { -1.0f, +1.0f, +1.0f }, { -1.0f, +1.0f, -1.0f } } },
+			{ { { -1.0f, -1.0f, -1.0f }, { -1.0f, +1.0f, -1.0f }, { +1.0f, +1.0f, -1.0f }, { +1.0f, -1.0f, -1.0f } } },
+			{ { { -1.0f, +1.0f, -1.0f }, { -1.0f, +1.0f, +1.0f }, { +1.0f, +1.0f, +1.0f }, { +1.0f, +1.0f, -1.0f } } },
+		} };
+		constexpr auto face_uvs = std::array<XMFLOAT2, 4>{ { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f } } };
+
+		auto shape = base_shape{};
+		for (auto &face : corners)
+		{
+			auto base = static_cast<uint32_t>(shape.positions.size());
+			shape.positions.insert(shape.positions.end(), face.begin(), face.end());
+			shape.uv_coords.insert(shape.uv_coords.end(), face_uvs.begin(), face_uvs.end());
+			shape.indicies.insert(shape.indicies.end(), { base + 0, base + 1, base + 2, base + 0, base + 2, base + 3 });
+		}
+		shape.edge_count = 5 * 6;   // 4 sides and a diagonal per face
+		return shape;
+	}
+
+	auto make_icosahedron() -> base_shape
+	{
+		const auto t = (1.0f + std::sqrt(5.0f)) / 2.0f;
+
+		auto shape = base_shape{};
+		shape.positions = {
+			{ -1.0f, +t, 0.0f }, { +1.0f, +t, 0.0f }, { -1.0f, -t, 0.0f }, { +1.0f, -t, 0.0f },
+			{ 0.0f, -1.0f, +t }, { 0.0f, +1.0f, +t }, { 0.0f, -1.0f, -t }, { 0.0f, +1.0f, -t },
+			{ +t, 0.0f, -1.0f }, { +t, 0.0f, +1.0f }, { -t, 0.0f, -1.0f }, { -t, 0.0f, +1.0f },
+		};
+		shape.uv_coords.resize(shape.positions.size());
+		shape.indicies = {
+			0, 11, 5,   0, 5, 1,    0, 1, 7,    0, 7, 10,   0, 10, 11,
+			1, 5, 9,    5, 11, 4,   11, 10, 2,  10, 7, 6,   7, 1, 8,
+			3, 9, 4,    3, 4, 2,    3, 2, 6,    3, 6, 8,    3, 8, 9,
+			4, 9, 5,    2, 4, 11,   6, 2, 10,   8, 6, 7,    9, 8, 1,
+		};
+
+		// Wind the same way as the cube, (b - a) x (c - a) pointing out of the sphere
+		for (auto i = 0u; i < shape.indicies.size(); i += 3)
+		{
+			auto a = XMLoadFloat3(&shape.positions[shape.indicies[i + 0]]),
+			     b = XMLoadFloat3(&shape.positions[shape.indicies[i + 1]]),
+			     c = XMLoadFloat3(&shape.positions[shape.indicies[i + 2]]);
+			if (XMVectorGetX(XMVector3Dot(XMVector3Cross(b - a, c - a), a)) < 0.0f)
+			{
+				std::swap(shape.indicies[i + 1], shape.indicies[i + 2]);
+			}
+		}
+		shape.edge_count = 30;
+		return shape;
+	}
+
+	// Open addressing map of edge (lower index, higher index) -> midpoint vertex
+	class edge_cache
+	{
+	public:
+		void reset(std::size_t edge_count)
+		{
+			auto capacity = std::size_t{ 16 };
+			while (capacity < edge_count * 2)
+			{
+				capacity <<= 1;
+			}
+			mask = capacity - 1;
+			keys.assign(capacity, std::numeric_limits<uint64_t>::max());
+			values.resize(capacity);
+		}
+
+		auto find_or_insert(uint32_t a, uint32_t b, uint32_t new_value) -> std::pair<uint32_t, bool>
+		{
+			auto key = (a < b) ? (uint64_t{ a } << 32 | b) : (uint64_t{ b } << 32 | a);
+			for (auto slot = hash(key) & mask; ; slot = (slot + 1) & mask)
+			{
+				if (keys[slot] == key)
+				{
+					return { values[slot], false };
+				}
+				if (keys[slot] == std::numeric_limits<uint64_t>::max())
+				{
+					keys[slot] = key;
+					values[slot] = new_value;
+					return { new_value, true };
+				}
+			}
+		}
+
+	private:
+		static auto hash(uint64_t key) -> std::size_t
+		{
+			key ^= key >> 33;
+			key *= 0xff51afd7ed558ccdull;
+			key ^= key >> 33;
+			return static_cast<std::size_t>(key);
+		}
+
+	private:
+		std::size_t mask{};
+		std::vector<uint64_t> keys{};
+		std::vector<uint32_t> values{};
+	};
+}
+
+auto dx11_lessons::make_sphere(const sphere_settings &settings) -> sphere_data
+{
+	auto is_ico = settings.topology == sphere_topology::icosahedron;
+	auto shape = is_ico ? make_icosahedron() : make_cube();
+
+	// Each level adds a vertex per edge, splits each edge in 2 and adds 3 inner edges per triangle
+	auto vertex_count = shape.positions.size(),
+	     edge_count = std::size_t{ shape.edge_count },
+	     triangle_count = shape.indicies.size() / 3;
+	for (auto level = 0u; level < settings.subdivide_count; level++)
+	{
+		vertex_count += edge_count;
+		edge_count = 2 * edge_count + 3 * triangle_count;
+		triangle_count *= 4;
+	}
+
+	auto sphere = sphere_data{};
+	auto &positions = sphere.positions;
+	auto &uvs = sphere.uv_coords;
+	positions.resize(vertex_count);
+	uvs.resize(vertex_count);
+	std::copy(shape.positions.begin(), shape.positions.end(), positions.begin());
+	std::copy(shape.uv_coords.begin(), shape.uv_coords.end(), uvs.begin());
+
+	auto indicies = std::vector<uint32_t>(triangle_count * 3),
+	     next_indicies = std::vector<uint32_t>(triangle_count * 3);
+	std::copy(shape.indicies.begin(), shape.indicies.end(), indicies.begin());
+
+	auto used_vertices = static_cast<uint32_t>(shape.positions.size());
+	auto used_indicies = shape.indicies.size();
+	edge_count = shape.edge_count;
+
+	auto cache = edge_cache{};
+	auto midpoint = [&](uint32_t a, uint32_t b) -> uint32_t
+	{
+		auto [idx, inserted] = cache.find_or_insert(a, b, used_vertices);
+		if (inserted)
+		{
+			auto p = 0.5f * (XMLoadFloat3(&positions[a]) + XMLoadFloat3(&positions[b]));
+			XMStoreFloat3(&positions[idx], is_ico ? XMVector3Normalize(p) : p);
+			uvs[idx] = { 0.5f * (uvs[a].x + uvs[b].x), 0.5f * (uvs[a].y + uvs[b].y) };
+			used_vertices++;
+		}
+		return idx;
+	};
+
+	for (auto level = 0u; level < settings.subdivide_count; level++)
+	{
+		cache.reset(edge_count);
+
+		auto out = next_indicies.begin();
+		for (auto i = 0u; i < used_indicies; i += 3)
+		{
+			auto a = indicies[i], b = indicies[i + 1], c = indicies[i + 2];
+			auto ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+
+			out = std::copy_n(std::array{ a, ab, ca,
+			                              ab, b, bc,
+			                              ca, bc, c,
+			                              ab, bc, ca }.begin(), 12, out);
+		}
+
+		edge_count = 2 * edge_count + used_indicies;
+		used_indicies *= 4;
+		std::swap(indicies, next_indicies);
+	}
+	assert(used_vertices == vertex_count);
+	assert(used_indicies == indicies.size());
+
+	auto inward = settings.facing == sphere_facing::inward;
+	sphere.normals.resize(vertex_count);
+	for (auto i = 0u; i < vertex_count; i++)
+	{
+		auto dir = XMVector3Normalize(XMLoadFloat3(&positions[i]));
+		XMStoreFloat3(&positions[i], dir * settings.radius);
+		XMStoreFloat3(&sphere.normals[i], inward ? -dir : dir);
+
+		if (is_ico)
+		{
+			auto &p = positions[i];
+			uvs[i] = { 0.5f + std::atan2(p.z, p.x) / XM_2PI,
+			           0.5f - std::asin(std::clamp(p.y / settings.radius, -1.0f, 1.0f)) / XM_PI };
+		}
+	}
+
+	if (inward)
+	{
+		for (auto i = 0u; i < indicies.size(); i += 3)
+		{
+			std::swap(indicies[i + 1], indicies[i + 2]);
+		}
+	}
+	sphere.indicies = std::move(indicies);
+
+	return sphere;
+}
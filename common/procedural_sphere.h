@@ -0,0 +1,60 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+#include <cstdint>
+
+namespace dx11_lessons
+{
+	enum class sphere_topology
+	{
+		icosahedron,   // uniform triangles, uv from longitude/latitude (has a seam)
+		cube,          // normalized cube, one uv square per face
+	};
+
+	enum class sphere_facing
+	{
+		outward,
+		inward,        // flipped winding and normals, for sky domes
+	};
+
+	struct sphere_settings
+	{
+		sphere_topology topology = sphere_topology::icosahedron;
+		uint32_t subdivide_count = 2;
+		sphere_facing facing = sphere_facing::outward;
+		float radius = 1.0f;
+	};
+
+	struct sphere_data
+	{
+		std::vector<DirectX::XMFLOAT3> positions;
+		std::vector<DirectX::XMFLOAT3> normals;
+		std::vector<DirectX::XMFLOAT2> uv_coords;
+		std::vector<uint32_t> indicies;
+	};
+
+	// Each subdivision splits every triangle in 4. Edge midpoints are cached,
+	// so vertices are shared, and all arrays are sized up front.
+	auto make_sphere(const sphere_settings &settings) -> sphere_data;
+
+	// mesh_t needs vertices of { position, normal, texcoord } and indicies, like gpu_datatypes mesh
+	template <typename mesh_t>
+	auto make_sphere_mesh(const sphere_settings &settings) -> mesh_t
+	{
+		auto sphere = make_sphere(settings);
+
+		auto result = mesh_t{};
+		result.vertices.resize(sphere.positions.size());
+		for (auto i = 0u; i < sphere.positions.size(); i++)
+		{
+			auto &v = result.vertices[i];
+			v.position = sphere.positions[i];
+			v.normal = sphere.normals[i];
+			v.texcoord = sphere.uv_coords[i];
+		}
+		result.indicies = std::move(sphere.indicies);
+
+		return result;
+	}
+}
@@ -0,0 +1,323 @@
+#include "texture_packer.h"
+#include "mip_generator.h"
+
+#include <algorithm>
+#include <numeric>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <cassert>
+
+using namespace dx11_lessons;
+
+namespace
+{
+	constexpr auto texel_size = 4u;
+
+	auto align_up(uint32_t value, uint32_t alignment) -> uint32_t
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	auto is_plain_2d(const dds_texture &source) -> bool
+	{
+		return source.array_size == 1 and not source.is_cube;
+	}
+
+	auto same_layout(const dds_texture &a, const dds_texture &b) -> bool
+	{
+		return a.format == b.format and a.width == b.width and a.height == b.height and a.mip_count == b.mip_count;
+	}
+
+	// Rect of an atlas page with its gutter, rounded to whole gutters so rects stay apart in every mip kept
+	auto padded_size(uint32_t size, const texture_pack_settings &settings) -> uint32_t
+	{
+		return align_up(size + 2 * settings.gutter, std::max(settings.gutter, 4u));
+	}
+
+	auto is_whole_blocks(const dds_texture &source) -> bool
+	{
+		return source.width % 4 == 0 and source.height % 4 == 0;
+	}
+
+	// Any size that fits a page if it isn't whole 4x4 blocks, the rect pads it out
+	auto can_atlas(const dds_texture &source, const texture_pack_settings &settings) -> bool
+	{
+		return is_plain_2d(source) and source.mip_count == 1 and can_generate_mips(source.format)
+		   and (std::max(source.width, source.height) <= settings.atlas_max or not is_whole_blocks(source))
+		   and padded_size(source.width, settings) <= settings.atlas_size
+		   and padded_size(source.height, settings) <= settings.atlas_size;
+	}
+
+	// Left as they are these can't be block compressed, so they go in an atlas even without a partner
+	auto needs_padding(const dds_texture &source, const texture_pack_settings &settings) -> bool
+	{
+		return not is_whole_blocks(source) and can_atlas(source, settings);
+	}
+
+	auto add_array(texture_pack &pack, std::span<const dds_texture> sources, const std::vector<uint32_t> &members)
+	{
+		auto &first = sources[members.front()];
+		auto index = static_cast<uint32_t>(pack.textures.size());
+		pack.textures.push_back({ first.format, first.width, first.height, first.mip_count, 0,
+		                          static_cast<uint32_t>(members.size()) * first.array_size, false, members });
+		for (auto slice = 0u; slice < members.size(); slice++)
+		{
+			pack.placements[members[slice]] = { index, slice, { 0.0f, 0.0f }, { 1.0f, 1.0f } };
+		}
+	}
+
+	// Shelves of rects, tallest first, a new page when one is full. A single page is cropped to what it holds.
+	void add_atlas(texture_pack &pack, std::span<const dds_texture> sources, std::vector<uint32_t> members,
+	               const texture_pack_settings &settings)
+	{
+		std::stable_sort(members.begin(), members.end(), [&](uint32_t a, uint32_t b)
+		{
+			return std::pair{ sources[a].height, sources[a].width } > std::pair{ sources[b].height, sources[b].width };
+		});
+
+		struct rect
+		{
+			uint32_t x, y, page;
+		};
+		auto rects = std::vector<rect>{};
+		auto x = 0u, y = 0u, shelf_height = 0u, page = 0u;
+		auto used_width = 0u, used_height = 0u;
+		for (auto source : members)
+		{
+			auto width = padded_size(sources[source].width, settings),
+			     height = padded_size(sources[source].height, settings);
+			if (x + width > settings.atlas_size)
+			{
+				x = 0;
+				y += shelf_height;
+				shelf_height = 0;
+			}
+			if (y + height > settings.atlas_size)
+			{
+				page++;
+				x = y = shelf_height = 0;
+			}
+			rects.push_back({ x, y, page });
+			x += width;
+			shelf_height = std::max(shelf_height, height);
+			used_width = std::max(used_width, x);
+			used_height = std::max(used_height, y + height);
+		}
+
+		auto page_width = page == 0 ? used_width : settings.atlas_size,
+		     page_height = page == 0 ? used_height : settings.atlas_size;
+		auto index = static_cast<uint32_t>(pack.textures.size());
+		auto mip_limit = std::max(1u, static_cast<uint32_t>(std::bit_width(settings.gutter)));
+		pack.textures.push_back({ sources[members.front()].format, page_width, page_height, 1, mip_limit, page + 1, true, members });
+
+		for (auto i = 0u; i < members.size(); i++)
+		{
+			auto &source = sources[members[i]];
+			auto &r = rects[i];
+			pack.placements[members[i]] = {
+				index, r.page,
+				{ static_cast<float>(r.x + settings.gutter) / page_width, static_cast<float>(r.y + settings.gutter) / page_height },
+				{ static_cast<float>(source.width) / page_width, static_cast<float>(source.height) / page_height },
+			};
+		}
+	}
+}
+
+auto dx11_lessons::plan_texture_pack(std::span<const dds_texture> sources, const texture_pack_settings &settings) -> texture_pack
+{
+	assert(std::has_single_bit(settings.gutter) or settings.gutter == 0);
+
+	auto pack = texture_pack{};
+	pack.placements.resize(sources.size());
+	auto placed = std::vector<bool>(sources.size());
+	auto count = static_cast<uint32_t>(sources.size());
+
+	// Same layout sources share an array, arrays in the order their first source comes
+	for (auto i = 0u; i < count; i++)
+	{
+		auto members = std::vector<uint32_t>{};
+		for (auto j = i; j < count and not placed[i] and is_plain_2d(sources[i]) and not needs_padding(sources[i], settings); j++)
+		{
+			if (not placed[j] and is_plain_2d(sources[j]) and same_layout(sources[i], sources[j]))
+			{
+				members.push_back(j);
+			}
+		}
+		if (members.size() < 2)
+		{
+			continue;
+		}
+		for (auto member : members)
+		{
+			placed[member] = true;
+		}
+		add_array(pack, sources, members);
+	}
+
+	// Small leftovers into atlases, one per format, as long as there's more than one to share it or one needs padding
+	for (auto i = 0u; i < count; i++)
+	{
+		auto members = std::vector<uint32_t>{};
+		for (auto j = i; j < count and not placed[i] and can_atlas(sources[i], settings); j++)
+		{
+			if (not placed[j] and sources[j].format == sources[i].format and can_atlas(sources[j], settings))
+			{
+				members.push_back(j);
+			}
+		}
+		auto padded = std::ranges::any_of(members, [&](uint32_t member) { return needs_padding(sources[member], settings); });
+		if (members.size() < 2 and not padded)
+		{
+			continue;
+		}
+		for (auto member : members)
+		{
+			placed[member] = true;
+		}
+		add_atlas(pack, sources, members, settings);
+	}
+
+	for (auto i = 0u; i < count; i++)
+	{
+		if (not placed[i])
+		{
+			add_array(pack, sources, { i });
+		}
+	}
+	return pack;
+}
+
+auto dx11_lessons::build_packed_texture(const texture_pack &pack, uint32_t index, std::span<const dds_texture> sources,
+                                        const texture_pack_settings &settings) -> std::vector<std::byte>
+{
+	auto &texture = pack.textures[index];
+	auto output = std::vector<std::byte>{};
+	if (not texture.is_atlas)
+	{
+		for (auto source : texture.sources)
+		{
+			output.insert(output.end(), sources[source].data.begin(), sources[source].data.end());
+		}
+		return output;
+	}
+
+	// Unused parts of a page stay transparent black
+	auto page_size = std::size_t{ texture.width } * texture.height * texel_size;
+	output.resize(page_size * texture.array_size);
+	for (auto source : texture.sources)
+	{
+		auto &src = sources[source];
+		auto &placement = pack.placements[source];
+		auto x0 = static_cast<uint32_t>(std::lround(placement.uv_offset[0] * texture.width)) - settings.gutter,
+		     y0 = static_cast<uint32_t>(std::lround(placement.uv_offset[1] * texture.height)) - settings.gutter;
+		auto width = src.width + 2 * settings.gutter,
+		     height = src.height + 2 * settings.gutter;
+		auto src_pitch = dds_surface_size(src.format, src.width, src.height).row_pitch;
+
+		auto page = output.data() + placement.slice * page_size;
+		for (auto y = 0u; y < height; y++)
+		{
+			auto sy = (y + src.height - settings.gutter % src.height) % src.height;
+			auto src_row = src.data.data() + std::size_t{ sy } * src_pitch;
+			auto dst_row = page + (std::size_t{ y0 } + y) * texture.width * texel_size + std::size_t{ x0 } * texel_size;
+			for (auto x = 0u; x < width; x++)
+			{
+				auto sx = (x + src.width - settings.gutter % src.width) % src.width;
+				std::memcpy(dst_row + std::size_t{ x } * texel_size, src_row + std::size_t{ sx } * texel_size, texel_size);
+			}
+		}
+	}
+	return output;
+}
+
+auto material_table::texture_name(const material_table_texture &texture) const -> std::string_view
+{
+	return names.substr(texture.name_offset, texture.name_size);
+}
+
+auto material_table::material_name(const material_table_entry &entry) const -> std::string_view
+{
+	return names.substr(entry.material_offset, entry.material_size);
+}
+
+auto dx11_lessons::write_material_table(std::span<const std::string> texture_names, std::span<const material_map_ref> maps) -> std::vector<std::byte>
+{
+	auto names = std::string{};
+	auto add_name = [&](std::string_view name)
+	{
+		auto offset = static_cast<uint32_t>(names.size());
+		names += name;
+		return std::pair{ offset, static_cast<uint32_t>(name.size()) };
+	};
+
+	auto textures = std::vector<material_table_texture>{};
+	for (auto &name : texture_names)
+	{
+		auto [offset, size] = add_name(name);
+		textures.push_back({ offset, size });
+	}
+
+	auto entries = std::vector<material_table_entry>{};
+	for (auto &ref : maps)
+	{
+		auto [offset, size] = add_name(ref.material);
+		entries.push_back({ offset, size, ref.map, ref.placement.texture, ref.placement.slice,
+		                    ref.placement.uv_offset, ref.placement.uv_scale });
+	}
+
+	auto header = material_table_header{ material_table_magic, material_table_version,
+	                                     static_cast<uint32_t>(textures.size()), static_cast<uint32_t>(entries.size()),
+	                                     static_cast<uint32_t>(names.size()) };
+
+	auto textures_offset = sizeof(header);
+	auto entries_offset = textures_offset + textures.size() * sizeof(material_table_texture);
+	auto names_offset = entries_offset + entries.size() * sizeof(material_table_entry);
+
+	auto file = std::vector<std::byte>(names_offset + names.size());
+	std::memcpy(file.data(), &header, sizeof(header));
+	std::ranges::copy(std::as_bytes(std::span(textures)), file.begin() + textures_offset);
+	std::ranges::copy(std::as_bytes(std::span(entries)), file.begin() + entries_offset);
+	std::ranges::copy(std::as_bytes(std::span(names)), file.begin() + names_offset);
+	return file;
+}
+
+auto dx11_lessons::read_material_table(std::span<const std::byte> file_data) -> std::optional<material_table>
+{
+	auto header = material_table_header{};
+	if (file_data.size() < sizeof(header))
+	{
+		return std::nullopt;
+	}
+	std::memcpy(&header, file_data.data(), sizeof(header));
+
+	auto textures_offset = uint64_t{ sizeof(material_table_header) };
+	auto entries_offset = textures_offset + uint64_t{ header.texture_count } * sizeof(material_table_texture);
+	auto names_offset = entries_offset + uint64_t{ header.entry_count } * sizeof(material_table_entry);
+	if (header.magic != material_table_magic or header.version != material_table_version
+	    or names_offset + header.names_size > file_data.size())
+	{
+		return std::nullopt;
+	}
+
+	auto table = material_table{};
+	table.textures = { reinterpret_cast<const material_table_texture *>(file_data.data() + textures_offset), header.texture_count };
+	table.entries = { reinterpret_cast<const material_table_entry *>(file_data.data() + entries_offset), header.entry_count };
+	table.names = { reinterpret_cast<const char *>(file_data.data() + names_offset), header.names_size };
+
+	auto textures_in_range = std::all_of(table.textures.begin(), table.textures.end(), [&](const material_table_texture &texture)
+	{
+		return uint64_t{ texture.name_offset } + texture.name_size <= header.names_size;
+	});
+	auto entries_in_range = std::all_of(table.entries.begin(), table.entries.end(), [&](const material_table_entry &entry)
+	{
+		return uint64_t{ entry.material_offset } + entry.material_size <= header.names_size
+		   and entry.texture < header.texture_count and entry.map <= material_map::bump;
+	});
+	if (not textures_in_range or not entries_in_range)
+	{
+		return std::nullopt;
+	}
+
+	return table;
+}
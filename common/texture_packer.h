@@ -0,0 +1,134 @@
+#pragma once
+
+#include "dds_file.h"
+
+#include <array>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <optional>
+#include <span>
+#include <cstddef>
+#include <cstdint>
+
+namespace dx11_lessons
+{
+	struct texture_pack_settings
+	{
+		uint32_t atlas_size = 1024;   // largest atlas page, square
+		uint32_t atlas_max = 256;     // textures this size or smaller with no same size partner go in atlases
+		uint32_t gutter = 8;          // wrapped texels round each atlas rect, a power of 2
+	};
+
+	// Where one source texture ended up. Sampled at uv_offset + frac(uv) * uv_scale in slice of texture,
+	// with gradients from uv * uv_scale. Array slices have offset 0 and scale 1, so a wrap sampler is enough.
+	struct texture_placement
+	{
+		uint32_t texture;
+		uint32_t slice;
+		std::array<float, 2> uv_offset;
+		std::array<float, 2> uv_scale;
+	};
+
+	// One Texture2DArray the pack makes, slices of the same size and format, or atlas pages
+	struct packed_texture
+	{
+		dxgi_format format;
+		uint32_t width;
+		uint32_t height;
+		uint32_t mip_count;              // the sources' for arrays, 1 for atlas pages
+		uint32_t mip_limit;              // mips past this lose the gutter, 0 for arrays
+		uint32_t array_size;
+		bool is_atlas;
+		std::vector<uint32_t> sources;   // in slice order for arrays
+	};
+
+	struct texture_pack
+	{
+		std::vector<packed_texture> textures;
+		std::vector<texture_placement> placements;   // one per source, same order
+	};
+
+	// Sources with the same format, size and mip count share an array. Of the rest, single mip 8 bit
+	// RGBA or BGRA ones no larger than atlas_max are shelf packed into atlas pages, one array of pages per format.
+	// Ones whose size isn't a multiple of 4 go in an atlas whatever their size, alone if need be, padded to whole blocks.
+	// Anything left is an array of one, so every source has a placement.
+	auto plan_texture_pack(std::span<const dds_texture> sources, const texture_pack_settings &settings) -> texture_pack;
+
+	// Every subresource of one packed texture, in dds_texture data order. Array slices are copied as they are,
+	// atlas pages are mip 0 only, with each rect's gutter wrapped from its opposite edge since material maps tile.
+	auto build_packed_texture(const texture_pack &pack, uint32_t index, std::span<const dds_texture> sources,
+	                          const texture_pack_settings &settings) -> std::vector<std::byte>;
+
+	// Cooked material table layout, little endian:
+	//   material_table_header
+	//   material_table_texture[texture_count]
+	//   material_table_entry[entry_count]
+	//   names, not null terminated
+	// Textures are packed DDS files next to the table, entries say where each material's maps are in them.
+	constexpr auto material_table_magic = std::array{ 'D', 'X', 'M', 'T' };
+	constexpr auto material_table_version = uint32_t{ 1 };
+
+	enum class material_map : uint32_t
+	{
+		ambient,
+		diffuse,
+		specular,
+		shininess,
+		transparency,
+		bump,
+	};
+
+	struct material_table_header
+	{
+		std::array<char, 4> magic;
+		uint32_t version;
+		uint32_t texture_count;
+		uint32_t entry_count;
+		uint32_t names_size;
+	};
+
+	struct material_table_texture
+	{
+		uint32_t name_offset;   // from start of names
+		uint32_t name_size;
+	};
+
+	struct material_table_entry
+	{
+		uint32_t material_offset;   // from start of names
+		uint32_t material_size;
+		material_map map;
+		uint32_t texture;
+		uint32_t slice;
+		std::array<float, 2> uv_offset;
+		std::array<float, 2> uv_scale;
+	};
+
+	static_assert(sizeof(material_table_header) == 20);
+	static_assert(sizeof(material_table_texture) == 8);
+	static_assert(sizeof(material_table_entry) == 36);
+
+	struct material_map_ref
+	{
+		std::string material;
+		material_map map;
+		texture_placement placement;
+	};
+
+	// Views into the cooked file, valid while its bytes are
+	struct material_table
+	{
+		std::span<const material_table_texture> textures;
+		std::span<const material_table_entry> entries;
+		std::string_view names;
+
+		auto texture_name(const material_table_texture &texture) const -> std::string_view;
+		auto material_name(const material_table_entry &entry) const -> std::string_view;
+	};
+
+	auto write_material_table(std::span<const std::string> texture_names, std::span<const material_map_ref> maps) -> std::vector<std::byte>;
+
+	// nullopt if the header doesn't match or anything is out of bounds
+	auto read_material_table(std::span<const std::byte> file_data) -> std::optional<material_table>;
+}
@@ -0,0 +1,234 @@
+#include "texture_streamer.h"
+
+#include <queue>
+#include <tuple>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <cassert>
+
+using namespace dx11_lessons;
+
+texture_streamer::texture_streamer(uint32_t tail_size_, std::size_t memory_budget_) :
+	tail_size{ tail_size_ }, memory_budget{ memory_budget_ }
+{}
+
+texture_streamer::~texture_streamer() = default;
+
+void texture_streamer::add(uint32_t id, streamed_texture_info info)
+{
+	assert(not info.mip_bytes.empty() and info.mip_bytes.size() <= 32);
+	if (id >= entries.size())
+	{
+		entries.resize(id + 1);
+	}
+	remove(id);
+
+	auto mip_count = static_cast<uint32_t>(info.mip_bytes.size());
+	auto tail_mip = 0u;
+	while (tail_mip + 1 < mip_count and (info.size >> tail_mip) > tail_size)
+	{
+		tail_mip++;
+	}
+
+	entries[id] = { true, std::move(info), tail_mip, mip_count, 0.0f, frame, 0u };
+}
+
+void texture_streamer::remove(uint32_t id)
+{
+	if (not contains(id))
+	{
+		return;
+	}
+
+	auto &texture = entries[id];
+	for (auto mip = texture.resident_mip; mip < texture.info.mip_bytes.size(); mip++)
+	{
+		counters.resident_bytes -= texture.info.mip_bytes[mip];
+	}
+	texture = {};
+}
+
+auto texture_streamer::contains(uint32_t id) const -> bool
+{
+	return id < entries.size() and entries[id].active;
+}
+
+void texture_streamer::set_screen_size(uint32_t id, float pixels)
+{
+	assert(contains(id));
+	entries[id].screen_size = pixels;
+}
+
+void texture_streamer::set_memory_budget(std::size_t bytes)
+{
+	memory_budget = bytes;
+}
+
+auto texture_streamer::schedule(std::size_t upload_budget) -> stream_schedule
+{
+	frame++;
+	for (auto &texture : entries)
+	{
+		if (texture.active and texture.screen_size > 0.0f)
+		{
+			texture.last_used = frame;
+		}
+	}
+
+	auto result = stream_schedule{};
+	auto upload = [&](uint32_t id, entry &texture)
+	{
+		texture.resident_mip--;
+		auto mip = texture.resident_mip;
+		auto bytes = texture.info.mip_bytes[mip];
+		result.uploads.push_back({ id, mip, bytes });
+		counters.uploads++;
+		counters.uploaded_bytes += bytes;
+		counters.resident_bytes += bytes;
+		if (texture.evicted_mips & (1u << mip))
+		{
+			texture.evicted_mips &= ~(1u << mip);
+			counters.refetches++;
+		}
+		return bytes;
+	};
+
+	// Tails first and outside both budgets, they are small and make the texture usable
+	for (auto id = 0u; id < entries.size(); id++)
+	{
+		auto &texture = entries[id];
+		while (texture.active and texture.resident_mip > texture.tail_mip)
+		{
+			upload(id, texture);
+		}
+	}
+
+	// Mips finer than wanted can go, least recently used texture first then the largest mip
+	auto evictable = std::vector<uint32_t>{};
+	for (auto id = 0u; id < entries.size(); id++)
+	{
+		if (entries[id].active and entries[id].resident_mip < wanted_mip(id))
+		{
+			evictable.push_back(id);
+		}
+	}
+	std::sort(evictable.begin(), evictable.end(), [&](uint32_t a, uint32_t b)
+	{
+		auto &ta = entries[a], &tb = entries[b];
+		return std::tuple{ ta.last_used, tb.info.mip_bytes[tb.resident_mip] }
+		     < std::tuple{ tb.last_used, ta.info.mip_bytes[ta.resident_mip] };
+	});
+
+	auto next_evictable = evictable.begin();
+	auto make_room = [&](std::size_t bytes)
+	{
+		while (counters.resident_bytes + bytes > memory_budget and next_evictable != evictable.end())
+		{
+			auto id = *next_evictable;
+			auto &texture = entries[id];
+			auto mip = texture.resident_mip;
+			auto mip_bytes = texture.info.mip_bytes[mip];
+			result.evictions.push_back({ id, mip, mip_bytes });
+			texture.resident_mip++;
+			texture.evicted_mips |= 1u << mip;
+			counters.evictions++;
+			counters.evicted_bytes += mip_bytes;
+			counters.resident_bytes -= mip_bytes;
+
+			if (texture.resident_mip == wanted_mip(id))
+			{
+				++next_evictable;
+			}
+		}
+		return counters.resident_bytes + bytes <= memory_budget;
+	};
+	make_room(0);
+
+	// Then the texture with the fewest resident texels per pixel, one mip at a time
+	using candidate = std::pair<float, uint32_t>;
+	auto queue = std::priority_queue<candidate, std::vector<candidate>, std::greater<>>{};
+	for (auto id = 0u; id < entries.size(); id++)
+	{
+		if (entries[id].active and entries[id].resident_mip > wanted_mip(id))
+		{
+			queue.emplace(texels_per_pixel(entries[id]), id);
+		}
+	}
+
+	auto spent = std::size_t{};
+	while (not queue.empty())
+	{
+		auto id = queue.top().second;
+		auto &texture = entries[id];
+		auto bytes = texture.info.mip_bytes[texture.resident_mip - 1];
+		if (spent > 0 and spent + bytes > upload_budget)
+		{
+			break;
+		}
+		queue.pop();
+
+		// Stays at the mips it has, a less magnified texture may still have a mip small enough to fit
+		if (not make_room(bytes))
+		{
+			continue;
+		}
+
+		spent += upload(id, texture);
+		if (texture.resident_mip > wanted_mip(id))
+		{
+			queue.emplace(texels_per_pixel(texture), id);
+		}
+	}
+
+	counters.textures = 0;
+	counters.pending_bytes = 0;
+	for (auto id = 0u; id < entries.size(); id++)
+	{
+		auto &texture = entries[id];
+		if (not texture.active)
+		{
+			continue;
+		}
+		counters.textures++;
+		for (auto mip = wanted_mip(id); mip < texture.resident_mip; mip++)
+		{
+			counters.pending_bytes += texture.info.mip_bytes[mip];
+		}
+	}
+	return result;
+}
+
+auto texture_streamer::resident_mip(uint32_t id) const -> uint32_t
+{
+	assert(contains(id));
+	return entries[id].resident_mip;
+}
+
+// Finest mip worth having, the smallest one still with a texel per pixel
+auto texture_streamer::wanted_mip(uint32_t id) const -> uint32_t
+{
+	assert(contains(id));
+	auto &texture = entries[id];
+	if (texture.screen_size <= 0.0f)
+	{
+		return texture.tail_mip;
+	}
+
+	auto mip = texture.tail_mip;
+	while (mip > 0 and (texture.info.size >> mip) < texture.screen_size)
+	{
+		mip--;
+	}
+	return mip;
+}
+
+auto texture_streamer::stats() const -> const texture_stream_stats &
+{
+	return counters;
+}
+
+auto texture_streamer::texels_per_pixel(const entry &texture) const -> float
+{
+	return static_cast<float>(texture.info.size >> texture.resident_mip) / texture.screen_size;
+}
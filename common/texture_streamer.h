@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace dx11_lessons
+{
+	struct streamed_texture_info
+	{
+		uint32_t size;                        // larger of mip 0's width and height
+		std::vector<std::size_t> mip_bytes;   // each mip over every array slice, largest first
+	};
+
+	struct stream_request
+	{
+		uint32_t texture;
+		uint32_t mip;
+		std::size_t bytes;
+	};
+
+	// Evictions are applied before uploads. Uploads go coarse to fine per texture and evictions
+	// fine to coarse, so a texture's resident mips are always the end of its chain.
+	struct stream_schedule
+	{
+		std::vector<stream_request> evictions;
+		std::vector<stream_request> uploads;
+	};
+
+	struct texture_stream_stats
+	{
+		uint32_t textures;           // being streamed
+		uint32_t uploads;
+		std::size_t uploaded_bytes;
+		std::size_t pending_bytes;   // still to upload before every texture has its wanted mip
+		std::size_t resident_bytes;
+		uint32_t evictions;
+		std::size_t evicted_bytes;
+		uint32_t refetches;          // uploads of a mip that was evicted before
+	};
+
+	// Decides which mip of which texture is uploaded or evicted next, the caller does the uploading.
+	// Textures start with nothing resident. Their tail, the mips no larger than tail_size, is requested
+	// on the next schedule whatever the budgets, so a texture can be drawn the frame after it's added.
+	// Finer mips follow one at a time, most magnified texture first, until each has the mip it needs
+	// for the size it's drawn at. Needs no device, so it runs headless.
+	//
+	// Resident bytes are kept under memory_budget by evicting mips finer than a texture wants,
+	// from the texture least recently on screen first. Tails are never evicted, so a texture falls back
+	// to its resident low mips. When nothing can be evicted, textures stay at the mips they have.
+	class texture_streamer
+	{
+	public:
+		texture_streamer() = delete;
+		texture_streamer(uint32_t tail_size_, std::size_t memory_budget_);
+		~texture_streamer();
+
+		// Ids are picked by the caller, small numbers since they index a vector
+		void add(uint32_t id, streamed_texture_info info);
+		void remove(uint32_t id);
+		auto contains(uint32_t id) const -> bool;
+
+		// Pixels mip 0's larger side spans on screen, 0 when it isn't visible.
+		// A texture counts as used on every schedule while its size isn't 0.
+		void set_screen_size(uint32_t id, float pixels);
+		void set_memory_budget(std::size_t bytes);
+
+		// Upload about upload_budget bytes in all before the next call.
+		// At least one finer mip is requested when any is wanted and fits in memory, even if it's larger than upload_budget.
+		auto schedule(std::size_t upload_budget) -> stream_schedule;
+
+		auto resident_mip(uint32_t id) const -> uint32_t;   // mip count when nothing is resident
+		auto wanted_mip(uint32_t id) const -> uint32_t;
+		auto stats() const -> const texture_stream_stats &;
+
+	private:
+		struct entry
+		{
+			bool active;
+			streamed_texture_info info;
+			uint32_t tail_mip;
+			uint32_t resident_mip;
+			float screen_size;
+			uint64_t last_used;
+			uint32_t evicted_mips;   // bit per mip
+		};
+
+		auto texels_per_pixel(const entry &texture) const -> float;
+
+		uint32_t tail_size;
+		std::size_t memory_budget;
+		uint64_t frame{};
+		std::vector<entry> entries{};
+		texture_stream_stats counters{};
+	};
+}
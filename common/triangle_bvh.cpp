@@ -0,0 +1,484 @@
+#include "triangle_bvh.h"
+#include "job_system.h"
+
+#include <algorithm>
+#include <memory>
+#include <limits>
+#include <cmath>
+#include <cassert>
+
+using namespace dx11_lessons;
+using namespace DirectX;
+
+namespace
+{
+	constexpr auto bin_count = 16u;
+	constexpr auto max_leaf_size = 8u;
+	constexpr auto traversal_cost = 1.0f;
+	constexpr auto parallel_threshold = 16'384u;
+	constexpr auto max_parallel_depth = 6u;
+	// Past this a node is a leaf however many triangles it has. Each level of the 4 wide tree
+	// leaves at most 3 siblings on the traversal stack, so this also bounds the stack.
+	constexpr auto max_depth = 64u;
+	constexpr auto traversal_stack_size = 3 * max_depth + 1;
+	constexpr auto invalid_index = std::numeric_limits<uint32_t>::max();
+	constexpr auto infinity = std::numeric_limits<float>::infinity();
+
+	struct aabb
+	{
+		XMFLOAT3 min{ infinity, infinity, infinity };
+		XMFLOAT3 max{ -infinity, -infinity, -infinity };
+
+		void grow(const XMFLOAT3 &p)
+		{
+			min = { std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z) };
+			max = { std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z) };
+		}
+
+		void grow(const aabb &b)
+		{
+			grow(b.min);
+			grow(b.max);
+		}
+
+		auto area() const -> float
+		{
+			auto dx = max.x - min.x, dy = max.y - min.y, dz = max.z - min.z;
+			if (dx < 0.0f or dy < 0.0f or dz < 0.0f)
+			{
+				return 0.0f;
+			}
+			return 2.0f * (dx * dy + dy * dz + dz * dx);
+		}
+	};
+
+	auto axis_value(const XMFLOAT3 &p, uint32_t axis) -> float
+	{
+		return (axis == 0) ? p.x : (axis == 1) ? p.y : p.z;
+	}
+
+	struct build_triangle
+	{
+		aabb bounds;
+		XMFLOAT3 centroid;
+		uint32_t id;
+	};
+
+	struct build_node
+	{
+		aabb bounds;
+		std::unique_ptr<build_node> left, right;
+		uint32_t first, count;
+
+		auto is_leaf() const -> bool
+		{
+			return not left;
+		}
+	};
+
+	using build_list = std::vector<build_triangle>;
+
+	auto build_recursive(build_list &tris, uint32_t first, uint32_t count, uint32_t depth) -> std::unique_ptr<build_node>
+	{
+		auto node = std::make_unique<build_node>();
+		node->first = first;
+		node->count = count;
+
+		auto centroid_bounds = aabb{};
+		for (auto i = first; i < first + count; i++)
+		{
+			node->bounds.grow(tris[i].bounds);
+			centroid_bounds.grow(tris[i].centroid);
+		}
+
+		if (count <= 2 or depth >= max_depth)
+		{
+			return node;
+		}
+
+		struct bin
+		{
+			aabb bounds;
+			uint32_t count;
+		};
+
+		auto best_cost = infinity;
+		auto best_axis = 0u, best_split = 0u;
+
+		for (auto axis = 0u; axis < 3; axis++)
+		{
+			auto c_min = axis_value(centroid_bounds.min, axis),
+			     c_max = axis_value(centroid_bounds.max, axis);
+			if (c_max - c_min <= 0.0f)
+			{
+				continue;
+			}
+			auto scale = bin_count / (c_max - c_min);
+
+			auto bins = std::array<bin, bin_count>{};
+			for (auto i = first; i < first + count; i++)
+			{
+				auto b = std::min(static_cast<uint32_t>((axis_value(tris[i].centroid, axis) - c_min) * scale), bin_count - 1);
+				bins[b].bounds.grow(tris[i].bounds);
+				bins[b].count++;
+			}
+
+			// Sweep from the right to get area*count for every right hand side
+			auto right_cost = std::array<float, bin_count>{};
+			auto right_box = aabb{};
+			auto right_count = 0u;
+			for (auto b = bin_count - 1; b > 0; b--)
+			{
+				right_box.grow(bins[b].bounds);
+				right_count += bins[b].count;
+				right_cost[b] = right_box.area() * right_count;
+			}
+
+			auto left_box = aabb{};
+			auto left_count = 0u;
+			for (auto b = 0u; b < bin_count - 1; b++)
+			{
+				left_box.grow(bins[b].bounds);
+				left_count += bins[b].count;
+				auto cost = left_box.area() * left_count + right_cost[b + 1];
+				if (left_count > 0 and left_count < count and cost < best_cost)
+				{
+					best_cost = cost;
+					best_axis = axis;
+					best_split = b + 1;
+				}
+			}
+		}
+
+		auto parent_area = node->bounds.area();
+		auto split_cost = traversal_cost + ((parent_area > 0.0f) ? best_cost / parent_area : infinity);
+		auto mid = first;
+
+		if (best_cost < infinity and (split_cost < count or count > max_leaf_size))
+		{
+			auto c_min = axis_value(centroid_bounds.min, best_axis);
+			auto scale = bin_count / (axis_value(centroid_bounds.max, best_axis) - c_min);
+			auto it = std::partition(tris.begin() + first, tris.begin() + first + count, [&](const build_triangle &t)
+			{
+				auto b = std::min(static_cast<uint32_t>((axis_value(t.centroid, best_axis) - c_min) * scale), bin_count - 1);
+				return b < best_split;
+			});
+			mid = static_cast<uint32_t>(it - tris.begin());
+		}
+		else if (count > max_leaf_size)
+		{
+			// All centroids coincide, split by count
+			mid = first + count / 2;
+		}
+		else
+		{
+			return node;
+		}
+
+		auto left_count = mid - first,
+		     right_count = count - left_count;
+
+		if (count > parallel_threshold and depth < max_parallel_depth)
+		{
+			auto &jobs = job_system::shared();
+			auto left = task_group{};
+			jobs.run(left, [&]
+			{
+				node->left = build_recursive(tris, first, left_count, depth + 1);
+			});
+			node->right = build_recursive(tris, mid, right_count, depth + 1);
+			jobs.wait(left);
+		}
+		else
+		{
+			node->left = build_recursive(tris, first, left_count, depth + 1);
+			node->right = build_recursive(tris, mid, right_count, depth + 1);
+		}
+
+		return node;
+	}
+}
+
+auto dx11_lessons::make_picking_ray(FXMVECTOR camera_position,
+                                    FXMMATRIX view, CXMMATRIX projection,
+                                    float x, float y, float width, float height) -> ray
+{
+	auto ndc_x = 2.0f * x / width - 1.0f,
+	     ndc_y = 1.0f - 2.0f * y / height;
+
+	auto inv_view_proj = XMMatrixInverse(nullptr, XMMatrixMultiply(view, projection));
+	auto far_point = XMVector3TransformCoord(XMVectorSet(ndc_x, ndc_y, 1.0f, 1.0f), inv_view_proj);
+
+	auto result = ray{};
+	XMStoreFloat3(&result.origin, camera_position);
+	XMStoreFloat3(&result.direction, XMVector3Normalize(far_point - camera_position));
+	return result;
+}
+
+triangle_bvh::triangle_bvh(const obj_data &data)
+{
+	auto &positions = data.vertices;
+	auto &indicies = data.indicies;
+
+	for (auto &grp : data.groups)
+	{
+		group_starts.push_back(grp.index_start / 3);
+	}
+
+	auto tri_count = static_cast<uint32_t>(indicies.size() / 3);
+	auto build_tris = build_list(tri_count);
+	for (auto t = 0u; t < tri_count; t++)
+	{
+		auto &bt = build_tris[t];
+		bt.id = t;
+		for (auto k = 0u; k < 3; k++)
+		{
+			bt.bounds.grow(positions[indicies[t * 3 + k]]);
+		}
+		bt.centroid = { 0.5f * (bt.bounds.min.x + bt.bounds.max.x),
+		                0.5f * (bt.bounds.min.y + bt.bounds.max.y),
+		                0.5f * (bt.bounds.min.z + bt.bounds.max.z) };
+	}
+
+	if (tri_count == 0)
+	{
+		return;
+	}
+
+	auto root = build_recursive(build_tris, 0, tri_count, 0);
+
+	triangles.reserve(tri_count);
+	for (auto &bt : build_tris)
+	{
+		auto &p0 = positions[indicies[bt.id * 3 + 0]],
+		     &p1 = positions[indicies[bt.id * 3 + 1]],
+		     &p2 = positions[indicies[bt.id * 3 + 2]];
+		triangles.push_back({
+			p0,
+			{ p1.x - p0.x, p1.y - p0.y, p1.z - p0.z },
+			{ p2.x - p0.x, p2.y - p0.y, p2.z - p0.z },
+			bt.id,
+		});
+	}
+
+	// Collapse binary tree into 4 wide nodes, children of the largest
+	// inner child get pulled up first.
+	auto flatten = [&](auto &self, const build_node &bn) -> uint32_t
+	{
+		auto node_idx = static_cast<uint32_t>(nodes.size());
+		nodes.emplace_back();
+
+		auto kids = std::vector<const build_node *>{};
+		if (bn.is_leaf())
+		{
+			kids.push_back(&bn);
+		}
+		else
+		{
+			kids = { bn.left.get(), bn.right.get() };
+		}
+
+		while (kids.size() < 4)
+		{
+			auto largest = kids.end();
+			auto largest_area = -1.0f;
+			for (auto it = kids.begin(); it != kids.end(); it++)
+			{
+				if (not (*it)->is_leaf() and (*it)->bounds.area() > largest_area)
+				{
+					largest = it;
+					largest_area = (*it)->bounds.area();
+				}
+			}
+			if (largest == kids.end())
+			{
+				break;
+			}
+
+			auto expand = *largest;
+			*largest = expand->left.get();
+			kids.push_back(expand->right.get());
+		}
+
+		auto out = node{};
+		for (auto i = 0u; i < 4; i++)
+		{
+			out.min_x[i] = out.min_y[i] = out.min_z[i] = infinity;
+			out.max_x[i] = out.max_y[i] = out.max_z[i] = -infinity;
+			out.child[i] = invalid_index;
+			out.count[i] = 0;
+		}
+
+		for (auto i = 0u; i < kids.size(); i++)
+		{
+			auto &kid = *kids[i];
+			out.min_x[i] = kid.bounds.min.x; out.max_x[i] = kid.bounds.max.x;
+			out.min_y[i] = kid.bounds.min.y; out.max_y[i] = kid.bounds.max.y;
+			out.min_z[i] = kid.bounds.min.z; out.max_z[i] = kid.bounds.max.z;
+
+			if (kid.is_leaf())
+			{
+				out.child[i] = kid.first;
+				out.count[i] = kid.count;
+			}
+			else
+			{
+				out.child[i] = self(self, kid);
+			}
+		}
+
+		nodes[node_idx] = out;
+		return node_idx;
+	};
+
+	flatten(flatten, *root);
+	nodes.shrink_to_fit();
+}
+
+triangle_bvh::~triangle_bvh() = default;
+
+auto triangle_bvh::intersect(const ray &r) const -> std::optional<ray_hit>
+{
+	if (nodes.empty())
+	{
+		return std::nullopt;
+	}
+
+	auto origin = XMLoadFloat3(&r.origin),
+	     direction = XMLoadFloat3(&r.direction);
+	auto inv_dir = XMVectorReciprocal(direction);
+
+	auto ox = XMVectorSplatX(origin), oy = XMVectorSplatY(origin), oz = XMVectorSplatZ(origin);
+	auto ix = XMVectorSplatX(inv_dir), iy = XMVectorSplatY(inv_dir), iz = XMVectorSplatZ(inv_dir);
+
+	auto best = ray_hit{};
+	auto best_t = infinity;
+
+	auto intersect_leaf = [&](uint32_t first, uint32_t count)
+	{
+		for (auto i = first; i < first + count; i++)
+		{
+			// Moller-Trumbore, two sided
+			auto &tri = triangles[i];
+			auto e1 = XMLoadFloat3(&tri.edge1),
+			     e2 = XMLoadFloat3(&tri.edge2);
+			auto p = XMVector3Cross(direction, e2);
+			auto det = XMVectorGetX(XMVector3Dot(e1, p));
+			if (std::abs(det) < 1.0e-12f)
+			{
+				continue;
+			}
+			auto inv_det = 1.0f / det;
+
+			auto s = origin - XMLoadFloat3(&tri.v0);
+			auto u = XMVectorGetX(XMVector3Dot(s, p)) * inv_det;
+			if (u < 0.0f or u > 1.0f)
+			{
+				continue;
+			}
+
+			auto q = XMVector3Cross(s, e1);
+			auto v = XMVectorGetX(XMVector3Dot(direction, q)) * inv_det;
+			if (v < 0.0f or u + v > 1.0f)
+			{
+				continue;
+			}
+
+			auto t = XMVectorGetX(XMVector3Dot(e2, q)) * inv_det;
+			if (t > 0.0f and t < best_t)
+			{
+				best_t = t;
+				best.triangle = tri.id;
+				best.distance = t;
+				best.u = u;
+				best.v = v;
+			}
+		}
+	};
+
+	// Entry distance is kept with each node, so nodes behind a closer hit are skipped
+	auto stack = std::array<std::pair<float, uint32_t>, traversal_stack_size>{};
+	auto stack_size = 1u;
+	stack[0] = { 0.0f, 0 };
+
+	while (stack_size > 0)
+	{
+		auto [node_t, node_idx] = stack[--stack_size];
+		if (node_t > best_t)
+		{
+			continue;
+		}
+		auto &n = nodes[node_idx];
+
+		// Slab test against all 4 children at once
+		auto tx0 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4 *>(n.min_x.data())), ox), ix),
+		     tx1 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4 *>(n.max_x.data())), ox), ix),
+		     ty0 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4 *>(n.min_y.data())), oy), iy),
+		     ty1 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4 *>(n.max_y.data())), oy), iy),
+		     tz0 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4 *>(n.min_z.data())), oz), iz),
+		     tz1 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4 *>(n.max_z.data())), oz), iz);
+
+		auto t_enter = XMVectorMax(XMVectorMax(XMVectorMin(tx0, tx1), XMVectorMin(ty0, ty1)),
+		                           XMVectorMax(XMVectorMin(tz0, tz1), XMVectorZero()));
+		auto t_exit = XMVectorMin(XMVectorMin(XMVectorMax(tx0, tx1), XMVectorMax(ty0, ty1)),
+		                          XMVectorMin(XMVectorMax(tz0, tz1), XMVectorReplicate(best_t)));
+
+		auto enter = XMFLOAT4{}, exit = XMFLOAT4{};
+		XMStoreFloat4(&enter, t_enter);
+		XMStoreFloat4(&exit, t_exit);
+		auto enter_t = std::array{ enter.x, enter.y, enter.z, enter.w },
+		     exit_t = std::array{ exit.x, exit.y, exit.z, exit.w };
+
+		auto inner = std::array<std::pair<float, uint32_t>, 4>{};
+		auto inner_count = 0u;
+		for (auto i = 0u; i < 4; i++)
+		{
+			if (n.child[i] == invalid_index or not (enter_t[i] <= exit_t[i]))
+			{
+				continue;
+			}
+
+			if (n.count[i] > 0)
+			{
+				intersect_leaf(n.child[i], n.count[i]);
+			}
+			else
+			{
+				inner[inner_count++] = { enter_t[i], n.child[i] };
+			}
+		}
+
+		// Push far children first, so nearest is visited next
+		for (auto i = 1u; i < inner_count; i++)
+		{
+			for (auto j = i; j > 0 and inner[j - 1].first < inner[j].first; j--)
+			{
+				std::swap(inner[j - 1], inner[j]);
+			}
+		}
+		for (auto i = 0u; i < inner_count; i++)
+		{
+			assert(stack_size < stack.size());
+			stack[stack_size++] = inner[i];
+		}
+	}
+
+	if (best_t == infinity)
+	{
+		return std::nullopt;
+	}
+
+	auto grp = std::upper_bound(group_starts.begin(), group_starts.end(), best.triangle);
+	best.group = static_cast<uint32_t>(std::max(std::ptrdiff_t{ 0 }, (grp - group_starts.begin()) - 1));
+	return best;
+}
+
+auto triangle_bvh::node_count() const -> std::size_t
+{
+	return nodes.size();
+}
+
+auto triangle_bvh::triangle_count() const -> std::size_t
+{
+	return triangles.size();
+}
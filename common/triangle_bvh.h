@@ -0,0 +1,65 @@
+#pragma once
+
+#include "obj_mtl_parser.h"
+
+#include <DirectXMath.h>
+#include <array>
+#include <vector>
+#include <optional>
+#include <cstdint>
+
+namespace dx11_lessons
+{
+	struct ray
+	{
+		DirectX::XMFLOAT3 origin;
+		DirectX::XMFLOAT3 direction;
+	};
+
+	struct ray_hit
+	{
+		uint32_t triangle;   // index of triangle in obj_data::indicies / 3
+		uint32_t group;      // index into obj_data::groups
+		float distance;
+		float u, v;          // barycentrics of vertex 1 and 2
+	};
+
+	// Ray through pixel (x, y) from the camera position.
+	// view and projection are DirectXMath (non-transposed) matrices.
+	auto make_picking_ray(DirectX::FXMVECTOR camera_position,
+	                      DirectX::FXMMATRIX view, DirectX::CXMMATRIX projection,
+	                      float x, float y, float width, float height) -> ray;
+
+	// 4-wide BVH over the triangles of a mesh, built with binned SAH.
+	class triangle_bvh
+	{
+	public:
+		triangle_bvh() = delete;
+		triangle_bvh(const obj_data &data);
+		~triangle_bvh();
+
+		auto intersect(const ray &r) const -> std::optional<ray_hit>;
+
+		auto node_count() const -> std::size_t;
+		auto triangle_count() const -> std::size_t;
+
+	private:
+		struct alignas(16) node
+		{
+			std::array<float, 4> min_x, min_y, min_z;
+			std::array<float, 4> max_x, max_y, max_z;
+			std::array<uint32_t, 4> child;   // node index, or first triangle for leaves
+			std::array<uint32_t, 4> count;   // triangles in leaf, 0 for inner nodes
+		};
+
+		struct triangle
+		{
+			DirectX::XMFLOAT3 v0, edge1, edge2;
+			uint32_t id;
+		};
+
+		std::vector<node> nodes{};
+		std::vector<triangle> triangles{};
+		std::vector<uint32_t> group_starts{};
+	};
+}